@@ -0,0 +1,1240 @@
+#include "commandline.h"
+#include <QCoreApplication>
+#include <QGuiApplication>
+#include <QDir>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QElapsedTimer>
+#include <QThread>
+#include <QImage>
+#include <QTextStream>
+#include <QLocalSocket>
+#include <QSharedMemory>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <cstdio>
+#ifdef Q_OS_WIN
+#include <Windows.h>
+#endif
+#include "../core/diff/imagediff.h"
+#include "../core/ipc/controlserver.h"
+#include "../core/export/imageexporter.h"
+#include "../core/export/qoicodec.h"
+#include "../core/export/palettequantizer.h"
+#include "../core/batch/batchpipeline.h"
+#include "../core/image/resampler.h"
+#include "../core/barcode/codescanner.h"
+#include "../core/capture/capturemanager.h"
+#include "../core/search/searchindex.h"
+#include "../core/redaction/sensitivecontentscanner.h"
+#include "../core/redaction/textrecognizer.h"
+#include <QTemporaryDir>
+#include <QFileInfo>
+#include <QThreadPool>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <QBuffer>
+#include <QRandomGenerator>
+#include <QPainter>
+#include <QLinearGradient>
+#include <QRadialGradient>
+#include <cmath>
+#include <QtMath>
+
+bool CommandLine::run(int argc, char *argv[], int &exitCode)
+{
+    if (argc < 2) {
+        return false;
+    }
+
+    const QString command = QString::fromLocal8Bit(argv[1]);
+    if (command != "diff" && command != "ctl" && command != "bench-export" && command != "bench-palette"
+        && command != "batch" && command != "bench-resample" && command != "codes" && command != "stress"
+        && command != "bench-search" && command != "bench-redact") {
+        return false;
+    }
+
+    // 子命令只需要 QCoreApplication（图片插件路径），不创建任何窗口；
+    // batch 可能绘制文字标注、stress 创建 CaptureManager、bench-redact 在测试图上绘制文字，需要 QGuiApplication
+    std::unique_ptr<QCoreApplication> app;
+    if (command == "batch" || command == "stress" || command == "bench-redact") {
+        app.reset(new QGuiApplication(argc, argv));
+    } else {
+        app.reset(new QCoreApplication(argc, argv));
+    }
+    attachConsole();
+
+    QStringList args = app->arguments().mid(2);
+    if (command == "diff") {
+        exitCode = runDiff(args);
+    } else if (command == "ctl") {
+        exitCode = runControl(args);
+    } else if (command == "bench-export") {
+        exitCode = runBenchExport(args);
+    } else if (command == "bench-palette") {
+        exitCode = runBenchPalette(args);
+    } else if (command == "batch") {
+        exitCode = runBatch(args);
+    } else if (command == "bench-resample") {
+        exitCode = runBenchResample(args);
+    } else if (command == "codes") {
+        exitCode = runCodes(args);
+    } else if (command == "stress") {
+        exitCode = runStress(args);
+    } else if (command == "bench-search") {
+        exitCode = runBenchSearch(args);
+    } else if (command == "bench-redact") {
+        exitCode = runBenchRedact(args);
+    }
+    return true;
+}
+
+void CommandLine::attachConsole()
+{
+#ifdef Q_OS_WIN
+    // 程序以 GUI 子系统构建，从终端启动时需要手动连接父进程的控制台
+    if (AttachConsole(ATTACH_PARENT_PROCESS)) {
+        freopen("CONOUT$", "w", stdout);
+        freopen("CONOUT$", "w", stderr);
+    }
+#endif
+}
+
+int CommandLine::runDiff(const QStringList &args)
+{
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    // 用法：SCD diff <before> <after> [--tolerance N] [--mask out.png]
+    QStringList files;
+    ImageDiff::Options options;
+    QString maskPath;
+    for (int i = 0; i < args.size(); ++i) {
+        if (args[i] == "--tolerance" && i + 1 < args.size()) {
+            options.tolerance = args[++i].toInt();
+        } else if (args[i] == "--mask" && i + 1 < args.size()) {
+            maskPath = args[++i];
+        } else {
+            files.append(args[i]);
+        }
+    }
+    if (files.size() != 2) {
+        err << "usage: SCD diff <before> <after> [--tolerance N] [--mask out.png]\n";
+        return 2;
+    }
+
+    QImage before(files[0]);
+    QImage after(files[1]);
+    if (before.isNull() || after.isNull()) {
+        err << "failed to load " << (before.isNull() ? files[0] : files[1]) << "\n";
+        return 2;
+    }
+
+    options.buildMask = !maskPath.isEmpty();
+    QElapsedTimer timer;
+    timer.start();
+    ImageDiff::Result result = ImageDiff::compare(before, after, options);
+    const qint64 elapsed = timer.elapsed();
+
+    for (const QRect& region : result.regions) {
+        out << region.x() << "," << region.y() << "," << region.width() << "," << region.height() << "\n";
+    }
+    err << result.regions.size() << " region(s), " << result.changedPixels
+        << " changed pixel(s), " << elapsed << " ms\n";
+
+    if (!maskPath.isEmpty() && !result.mask.save(maskPath)) {
+        err << "failed to write " << maskPath << "\n";
+        return 2;
+    }
+    // 与 diff 工具一致：0 表示相同，1 表示有差异
+    return result.isIdentical() ? 0 : 1;
+}
+
+int CommandLine::runControl(const QStringList &args)
+{
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    // 用法：SCD ctl '<json 请求>' [--save out.png]
+    // 本地测试客户端：发送一条请求，打印应答，图片从共享内存读出
+    QString request;
+    QString savePath;
+    for (int i = 0; i < args.size(); ++i) {
+        if (args[i] == "--save" && i + 1 < args.size()) {
+            savePath = args[++i];
+        } else {
+            request = args[i];
+        }
+    }
+    if (request.isEmpty()) {
+        err << "usage: SCD ctl '<json request>' [--save out.png]\n";
+        return 2;
+    }
+
+    QLocalSocket socket;
+    socket.connectToServer(ControlServer::serverName());
+    if (!socket.waitForConnected(1000)) {
+        err << "cannot connect to " << ControlServer::serverName() << ": " << socket.errorString() << "\n";
+        return 2;
+    }
+
+    auto roundTrip = [&socket](const QByteArray& line) -> QJsonObject {
+        socket.write(line.trimmed() + "\n");
+        socket.waitForBytesWritten(1000);
+        while (!socket.canReadLine()) {
+            if (!socket.waitForReadyRead(10000)) {
+                return QJsonObject{{"ok", false}, {"error", "timeout"}};
+            }
+        }
+        return QJsonDocument::fromJson(socket.readLine()).object();
+    };
+
+    QJsonObject reply = roundTrip(request.toUtf8());
+    out << QJsonDocument(reply).toJson(QJsonDocument::Compact) << "\n";
+    out.flush();
+    if (!reply.value("ok").toBool()) {
+        return 1;
+    }
+
+    QJsonObject imageInfo = reply.value("image").toObject();
+    const QString key = imageInfo.value("shm").toString();
+    if (key.isEmpty()) {
+        return 0;
+    }
+
+    // 从共享内存复制像素，然后通知服务端释放该段
+    QSharedMemory segment(key);
+    QImage image;
+    if (segment.attach(QSharedMemory::ReadOnly)) {
+        segment.lock();
+        image = QImage(static_cast<const uchar*>(segment.constData()),
+                       imageInfo.value("width").toInt(),
+                       imageInfo.value("height").toInt(),
+                       imageInfo.value("stride").toInt(),
+                       QImage::Format_ARGB32_Premultiplied).copy();
+        segment.unlock();
+        segment.detach();
+    } else {
+        err << "cannot attach shared memory: " << segment.errorString() << "\n";
+    }
+    roundTrip(QJsonDocument(QJsonObject{{"cmd", "release"}, {"shm", key}}).toJson(QJsonDocument::Compact));
+
+    if (image.isNull()) {
+        return 1;
+    }
+    if (!savePath.isEmpty() && !image.save(savePath)) {
+        err << "failed to write " << savePath << "\n";
+        return 1;
+    }
+    return 0;
+}
+
+namespace {
+
+// 类似截图的测试图：大面积纯色面板、渐变标题栏和密集的“文字”像素
+QImage syntheticScreenshot(const QSize& size)
+{
+    QImage image(size, QImage::Format_ARGB32_Premultiplied);
+    QRandomGenerator random(42);
+    const int panelWidth = qMax(1, size.width() / 6);
+    for (int y = 0; y < size.height(); ++y) {
+        QRgb* line = reinterpret_cast<QRgb*>(image.scanLine(y));
+        const bool titleBar = (y % 400) < 32;
+        const bool textRow = (y % 20) < 12;
+        for (int x = 0; x < size.width(); ++x) {
+            QRgb color = (x / panelWidth) % 2 ? qRgb(245, 245, 245) : qRgb(32, 33, 36);
+            if (titleBar) {
+                color = qRgb(30, 60 + (x * 120 / size.width()), 200);
+            } else if (textRow && (x % panelWidth) > 16 && random.bounded(4) == 0) {
+                color = qRgb(90, 90, 90);
+            }
+            line[x] = color;
+        }
+    }
+    return image;
+}
+
+// 更接近真实界面的测试图：抗锯齿的圆角按钮和头像、渐变卡片和阴影，颜色远超 256 种
+QImage syntheticInterface(const QSize& size, quint32 seed)
+{
+    QImage image(size, QImage::Format_ARGB32_Premultiplied);
+    image.fill(QColor(250, 250, 252));
+    QRandomGenerator random(seed);
+    QPainter painter(&image);
+    painter.setRenderHint(QPainter::Antialiasing);
+
+    QLinearGradient header(0, 0, 0, 56);
+    header.setColorAt(0, QColor(52, 120, 246));
+    header.setColorAt(1, QColor(38, 92, 210));
+    painter.fillRect(QRect(0, 0, size.width(), 56), header);
+    painter.fillRect(QRect(0, 56, 240, size.height() - 56), QColor(32, 33, 36));
+
+    const QColor accents[] = {QColor(52, 168, 83), QColor(234, 67, 53), QColor(251, 188, 5), QColor(66, 133, 244)};
+    for (int y = 80; y + 120 < size.height(); y += 140) {
+        for (int x = 264; x + 280 < size.width(); x += 300) {
+            // 卡片阴影：几层半透明圆角矩形叠加
+            painter.setPen(Qt::NoPen);
+            for (int blur = 6; blur > 0; --blur) {
+                painter.setBrush(QColor(0, 0, 0, 6));
+                painter.drawRoundedRect(QRectF(x - blur, y - blur + 3, 280 + 2 * blur, 120 + 2 * blur), 10, 10);
+            }
+            painter.setBrush(Qt::white);
+            painter.drawRoundedRect(QRectF(x, y, 280, 120), 8, 8);
+
+            const QColor accent = accents[random.bounded(4)];
+            QRadialGradient avatar(x + 36, y + 36, 22);
+            avatar.setColorAt(0, accent.lighter(140));
+            avatar.setColorAt(1, accent);
+            painter.setBrush(avatar);
+            painter.drawEllipse(QPointF(x + 36, y + 36), 20, 20);
+
+            // 灰色横条代表文字，按钮带描边
+            painter.setBrush(QColor(95, 99, 104));
+            for (int line = 0; line < 3; ++line) {
+                painter.drawRoundedRect(QRectF(x + 68, y + 20 + line * 16, 60 + random.bounded(140), 8), 4, 4);
+            }
+            painter.setPen(QPen(accent, 1.5));
+            painter.setBrush(accent.lighter(180));
+            painter.drawRoundedRect(QRectF(x + 180, y + 82, 84, 26), 13, 13);
+        }
+    }
+    return image;
+}
+
+// 对比两张图的峰值信噪比（四个通道），完全相同时返回无穷大
+double psnr(const QImage& a, const QImage& b)
+{
+    const QImage left = a.convertToFormat(QImage::Format_ARGB32);
+    const QImage right = b.convertToFormat(QImage::Format_ARGB32);
+    if (left.size() != right.size()) {
+        return 0.0;
+    }
+    double squared = 0.0;
+    for (int y = 0; y < left.height(); ++y) {
+        const uchar* p = left.constScanLine(y);
+        const uchar* q = right.constScanLine(y);
+        for (int i = 0; i < left.width() * 4; ++i) {
+            const int d = int(p[i]) - int(q[i]);
+            squared += d * d;
+        }
+    }
+    const double mse = squared / (double(left.width()) * left.height() * 4);
+    return mse == 0.0 ? INFINITY : 10.0 * std::log10(255.0 * 255.0 / mse);
+}
+
+using BenchInputs = QList<QPair<QString, QImage>>;
+
+// bench-* 与 codes 共用的参数：[image ...] [--runs N]，图片转为 ARGB32_Premultiplied；
+// 图片读取失败时输出错误并返回 false
+bool parseBenchArgs(const QStringList& args, int* runs, BenchInputs* inputs)
+{
+    for (int i = 0; i < args.size(); ++i) {
+        if (args[i] == "--runs" && i + 1 < args.size()) {
+            *runs = qMax(1, args[++i].toInt());
+        } else {
+            QImage image(args[i]);
+            if (image.isNull()) {
+                QTextStream(stderr) << "failed to load " << args[i] << "\n";
+                return false;
+            }
+            inputs->append({args[i], image.convertToFormat(QImage::Format_ARGB32_Premultiplied)});
+        }
+    }
+    return true;
+}
+
+// 运行 runs 次，返回最短耗时（微秒），result 为最后一次的结果
+template <typename Body, typename Result>
+qint64 bestOf(int runs, Body body, Result* result)
+{
+    qint64 best = -1;
+    for (int run = 0; run < runs; ++run) {
+        QElapsedTimer timer;
+        timer.start();
+        *result = body();
+        const qint64 elapsed = timer.nsecsElapsed() / 1000;
+        best = best < 0 ? elapsed : qMin(best, elapsed);
+    }
+    return best;
+}
+
+} // namespace
+
+int CommandLine::runBenchExport(const QStringList &args)
+{
+    QTextStream out(stdout);
+
+    // 用法：SCD bench-export [image ...] [--runs N]
+    // 未指定图片时使用合成的 4K 与 8K 截图；基准为 QImage::save（QPixmap::save 使用同一个 PNG 写入器）
+    int runs = 3;
+    BenchInputs inputs;
+    if (!parseBenchArgs(args, &runs, &inputs)) {
+        return 2;
+    }
+    if (inputs.isEmpty()) {
+        inputs.append({"synthetic-4k", syntheticScreenshot(QSize(3840, 2160))});
+        inputs.append({"synthetic-8k", syntheticScreenshot(QSize(7680, 4320))});
+    }
+
+    struct Candidate {
+        QString name;
+        std::function<QByteArray(const QImage&)> encode;
+        ImageExporter::Format format;
+    };
+    QList<Candidate> candidates;
+    candidates.append({"qt-png", [](const QImage& image) {
+        QByteArray data;
+        QBuffer buffer(&data);
+        buffer.open(QIODevice::WriteOnly);
+        image.save(&buffer, "png");
+        return data;
+    }, ImageExporter::Format::Png});
+    for (ImageExporter::Preset preset : {ImageExporter::Preset::Fastest, ImageExporter::Preset::Balanced,
+                                         ImageExporter::Preset::Smallest}) {
+        candidates.append({"png-" + ImageExporter::presetName(preset), [preset](const QImage& image) {
+            return ImageExporter::encode(image, ImageExporter::Format::Png, preset);
+        }, ImageExporter::Format::Png});
+    }
+    candidates.append({"qoi", [](const QImage& image) {
+        return ImageExporter::encode(image, ImageExporter::Format::Qoi, ImageExporter::Preset::Balanced);
+    }, ImageExporter::Format::Qoi});
+    if (ImageExporter::isWebPAvailable()) {
+        candidates.append({"webp-lossless", [](const QImage& image) {
+            return ImageExporter::encode(image, ImageExporter::Format::WebP, ImageExporter::Preset::Balanced);
+        }, ImageExporter::Format::WebP});
+    }
+
+    bool allValid = true;
+    for (const auto& input : inputs) {
+        const QImage& image = input.second;
+        out << input.first << " (" << image.width() << "x" << image.height() << ")\n";
+        for (const Candidate& candidate : candidates) {
+            QByteArray data;
+            const qint64 best = bestOf(runs, [&]() { return candidate.encode(image); }, &data);
+
+            // 解码回来逐像素比较，确认输出是合法且无损的
+            QImage decoded;
+            if (candidate.format == ImageExporter::Format::Qoi) {
+                decoded = QoiCodec::decode(data);
+            } else {
+                decoded = QImage::fromData(data);
+            }
+            const bool valid = !decoded.isNull()
+                && decoded.convertToFormat(QImage::Format_ARGB32) == image.convertToFormat(QImage::Format_ARGB32);
+            allValid = allValid && valid;
+
+            out << QString("  %1 %2 ms %3 KB %4\n")
+                       .arg(candidate.name, -16)
+                       .arg(best / 1000.0, 8, 'f', 2)
+                       .arg(data.size() / 1024, 8)
+                       .arg(valid ? "ok" : "MISMATCH");
+            out.flush();
+        }
+    }
+    return allValid ? 0 : 1;
+}
+
+int CommandLine::runBenchPalette(const QStringList &args)
+{
+    QTextStream out(stdout);
+
+    // 用法：SCD bench-palette [image ...] [--runs N]
+    // 未指定图片时使用合成的界面截图；基准为贴图窗口保存时的全彩 PNG（当前导出预设）
+    int runs = 3;
+    BenchInputs inputs;
+    if (!parseBenchArgs(args, &runs, &inputs)) {
+        return 2;
+    }
+    if (inputs.isEmpty()) {
+        inputs.append({"flat-1080p", syntheticScreenshot(QSize(1920, 1080))});
+        inputs.append({"flat-4k", syntheticScreenshot(QSize(3840, 2160))});
+        inputs.append({"ui-1080p", syntheticInterface(QSize(1920, 1080), 1)});
+        inputs.append({"ui-4k", syntheticInterface(QSize(3840, 2160), 2)});
+    }
+
+    const ImageExporter::Preset preset = ImageExporter::preset();
+    struct Candidate {
+        QString name;
+        ImageExporter::PaletteMode mode;
+        bool dither;
+    };
+    const Candidate candidates[] = {
+        {"full-color", ImageExporter::PaletteMode::Off, false},
+        {"palette-exact", ImageExporter::PaletteMode::Exact, false},
+        {"quantize", ImageExporter::PaletteMode::Quantize, false},
+        {"quantize-dither", ImageExporter::PaletteMode::Quantize, true}
+    };
+
+    bool allValid = true;
+    for (const auto& input : inputs) {
+        const QImage& image = input.second;
+        const int colors = PaletteQuantizer::countColors(image, 1 << 16);
+        out << input.first << " (" << image.width() << "x" << image.height() << ", "
+            << (colors > (1 << 16) ? QString(">65536") : QString::number(colors)) << " colors)\n";
+
+        qint64 baselineSize = 0;
+        for (const Candidate& candidate : candidates) {
+            QByteArray data;
+            const qint64 best = bestOf(runs, [&]() {
+                return ImageExporter::encode(image, ImageExporter::Format::Png, preset, candidate.mode, candidate.dither);
+            }, &data);
+            if (baselineSize == 0) {
+                baselineSize = data.size();
+            }
+
+            // 解码回来：无损的候选必须逐像素一致，有损的报告 PSNR
+            const QImage decoded = QImage::fromData(data);
+            const double quality = decoded.isNull() ? 0.0 : psnr(image, decoded);
+            const bool lossless = std::isinf(quality);
+            const bool valid = !decoded.isNull() && (candidate.mode == ImageExporter::PaletteMode::Quantize || lossless);
+            allValid = allValid && valid;
+
+            out << QString("  %1 %2 ms %3 KB %4% %5 %6\n")
+                       .arg(candidate.name, -16)
+                       .arg(best / 1000.0, 8, 'f', 2)
+                       .arg(data.size() / 1024, 8)
+                       .arg(baselineSize > 0 ? 100.0 * data.size() / baselineSize : 0.0, 6, 'f', 1)
+                       .arg(lossless ? QString("lossless") : QString("%1 dB").arg(quality, 0, 'f', 2), 10)
+                       .arg(valid ? "ok" : "MISMATCH");
+            out.flush();
+        }
+    }
+    return allValid ? 0 : 1;
+}
+
+int CommandLine::runBatch(const QStringList &args)
+{
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    // 用法：SCD batch <dir|glob|file ...> --out DIR [--format png|qoi|webp|jpg] [--preset fastest|balanced|smallest]
+    //                 [--palette off|exact|quantize] [--threads N] [--scaling] [步骤 ...]
+    // --scaling 依次用 1、2、4……个线程（每个阶段）处理同一批输入，输出各次的吞吐量、加速比和各阶段耗时
+    // 步骤按出现顺序执行：
+    //   --crop x,y,w,h
+    //   --scale 50%|0.5|WxH|Wx|xH[,box|lanczos3|mitchell]
+    //   --pixelate x,y,w,h[,block]
+    //   --rect x,y,w,h[,color[,thickness]]
+    //   --arrow x1,y1,x2,y2[,color[,thickness]]
+    //   --text x,y,pointSize,color,text
+    QStringList patterns;
+    QVector<BatchPipeline::Step> steps;
+    BatchPipeline::Options options;
+    options.preset = ImageExporter::preset();
+    options.palette = ImageExporter::PaletteMode::Off;
+    bool quiet = false;
+    bool scaling = false;
+    for (int i = 0; i < args.size(); ++i) {
+        const QString& arg = args[i];
+        const bool hasValue = i + 1 < args.size();
+        if (BatchPipeline::isStepOption(arg) && hasValue) {
+            BatchPipeline::Step step;
+            QString error;
+            if (!BatchPipeline::parseStep(arg, args[++i], &step, &error)) {
+                err << error << "\n";
+                return 2;
+            }
+            steps.append(step);
+        } else if (arg == "--out" && hasValue) {
+            options.outputDirectory = args[++i];
+        } else if (arg == "--format" && hasValue) {
+            options.suffix = args[++i].toLower();
+        } else if (arg == "--preset" && hasValue) {
+            const QString name = args[++i];
+            if (name == "fastest") {
+                options.preset = ImageExporter::Preset::Fastest;
+            } else if (name == "smallest") {
+                options.preset = ImageExporter::Preset::Smallest;
+            } else {
+                options.preset = ImageExporter::Preset::Balanced;
+            }
+        } else if (arg == "--palette" && hasValue) {
+            const QString name = args[++i];
+            if (name == "exact") {
+                options.palette = ImageExporter::PaletteMode::Exact;
+            } else if (name == "quantize") {
+                options.palette = ImageExporter::PaletteMode::Quantize;
+            } else {
+                options.palette = ImageExporter::PaletteMode::Off;
+            }
+        } else if (arg == "--threads" && hasValue) {
+            options.threads = qMax(0, args[++i].toInt());
+        } else if (arg == "--quiet") {
+            quiet = true;
+        } else if (arg == "--scaling") {
+            scaling = true;
+        } else if (arg.startsWith("--")) {
+            err << "unknown or incomplete option " << arg << "\n";
+            return 2;
+        } else {
+            patterns.append(arg);
+        }
+    }
+
+    if (options.outputDirectory.isEmpty()) {
+        err << "usage: SCD batch <dir|glob|file ...> --out DIR [--format png] [steps ...]\n";
+        return 2;
+    }
+    const QStringList files = BatchPipeline::expandInputs(patterns);
+    if (files.isEmpty()) {
+        err << "no input images\n";
+        return 2;
+    }
+    if (!QDir().mkpath(options.outputDirectory)) {
+        err << "cannot create " << options.outputDirectory << "\n";
+        return 2;
+    }
+    QStringList outputs;
+    QString planError;
+    if (!BatchPipeline(steps, options).outputPaths(files, &outputs, &planError)) {
+        err << planError << "\n";
+        return 2;
+    }
+    if (scaling) {
+        return runBatchScaling(files, steps, options);
+    }
+
+    // 进度回调在工作线程中调用，输出需要加锁
+    QMutex outputMutex;
+    int done = 0;
+    const BatchPipeline pipeline(steps, options);
+    const BatchPipeline::Stats stats = pipeline.run(files, [&](const QString& input, const QString& error) {
+        QMutexLocker locker(&outputMutex);
+        ++done;
+        if (!error.isEmpty()) {
+            err << input << ": " << error << "\n";
+            err.flush();
+        } else if (!quiet && (done % 100 == 0 || done == files.size())) {
+            out << done << "/" << files.size() << "\n";
+            out.flush();
+        }
+    });
+
+    const double seconds = qMax<qint64>(1, stats.elapsedMs) / 1000.0;
+    out << QString("%1 ok, %2 failed in %3 s: %4 images/s, %5 MP/s, %6 MB -> %7 MB\n")
+               .arg(stats.succeeded)
+               .arg(stats.failed)
+               .arg(seconds, 0, 'f', 2)
+               .arg(stats.succeeded / seconds, 0, 'f', 1)
+               .arg(stats.pixels / 1e6 / seconds, 0, 'f', 1)
+               .arg(stats.inputBytes / 1048576.0, 0, 'f', 1)
+               .arg(stats.outputBytes / 1048576.0, 0, 'f', 1);
+    // 各阶段累计耗时：占比最大的阶段即为瓶颈
+    out << QString("stage time: decode %1 s, process %2 s, encode %3 s\n")
+               .arg(stats.decodeMs / 1000.0, 0, 'f', 2)
+               .arg(stats.processMs / 1000.0, 0, 'f', 2)
+               .arg(stats.encodeMs / 1000.0, 0, 'f', 2);
+    return stats.failed == 0 ? 0 : 1;
+}
+
+int CommandLine::runBatchScaling(const QStringList &files, const QVector<BatchPipeline::Step> &steps,
+                                 const BatchPipeline::Options &options)
+{
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    // 线程数依次翻倍直到 CPU 核心数；加速比以单线程为基准，接近线程数说明各阶段都在线性扩展
+    QVector<int> threadCounts;
+    const int maxThreads = qMax(1, QThread::idealThreadCount());
+    for (int threads = 1; threads < maxThreads; threads *= 2) {
+        threadCounts.append(threads);
+    }
+    threadCounts.append(maxThreads);
+
+    double baseline = 0;
+    bool allSucceeded = true;
+    out << QString("%1 images, %2 hardware threads\n").arg(files.size()).arg(maxThreads);
+    for (int threads : threadCounts) {
+        BatchPipeline::Options run = options;
+        run.threads = threads;
+        const BatchPipeline::Stats stats = BatchPipeline(steps, run).run(files, [&](const QString& input,
+                                                                                  const QString& error) {
+            if (!error.isEmpty()) {
+                err << input << ": " << error << "\n";
+            }
+        });
+        allSucceeded = allSucceeded && stats.failed == 0;
+        const double seconds = qMax<qint64>(1, stats.elapsedMs) / 1000.0;
+        const double rate = stats.succeeded / seconds;
+        if (baseline <= 0) {
+            baseline = rate;
+        }
+        out << QString("threads %1: %2 s, %3 images/s, speedup %4x, stage time decode %5 s, process %6 s, encode %7 s\n")
+                   .arg(threads, 3)
+                   .arg(seconds, 0, 'f', 2)
+                   .arg(rate, 0, 'f', 1)
+                   .arg(baseline > 0 ? rate / baseline : 0.0, 0, 'f', 2)
+                   .arg(stats.decodeMs / 1000.0, 0, 'f', 2)
+                   .arg(stats.processMs / 1000.0, 0, 'f', 2)
+                   .arg(stats.encodeMs / 1000.0, 0, 'f', 2);
+        out.flush();
+    }
+    return allSucceeded ? 0 : 1;
+}
+
+namespace {
+
+struct ReferenceTaps {
+    int start = 0;
+    QVector<double> weights;
+};
+
+// 与 Resampler 相同的采样位置和滤波核，权重不量化
+QVector<ReferenceTaps> referenceTaps(int sourceLength, int targetLength, Resampler::Filter filter)
+{
+    const double scale = double(sourceLength) / targetLength;
+    const double filterScale = qMax(1.0, scale);
+    const double support = Resampler::radius(filter) * filterScale;
+    QVector<ReferenceTaps> result(targetLength);
+    for (int i = 0; i < targetLength; ++i) {
+        const double center = (i + 0.5) * scale;
+        const int left = qMax(0, int(std::floor(center - support)));
+        const int right = qMin(sourceLength, int(std::ceil(center + support)));
+        ReferenceTaps& taps = result[i];
+        taps.start = left;
+        double sum = 0.0;
+        for (int x = left; x < right; ++x) {
+            const double weight = filter == Resampler::Filter::Box
+                ? qMax(0.0, qMin(x + 1.0, center + support) - qMax(double(x), center - support))
+                : Resampler::kernel(filter, (x + 0.5 - center) / filterScale);
+            taps.weights.append(weight);
+            sum += weight;
+        }
+        for (double& weight : taps.weights) {
+            weight /= sum;
+        }
+    }
+    return result;
+}
+
+// 浮点参考实现：先水平后竖直，中间结果不取整也不截断，只在最后截断到 [0, alpha]
+QImage referenceScale(const QImage& image, const QSize& size, Resampler::Filter filter)
+{
+    const QImage source = image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    const int height = source.height();
+    const int width = size.width();
+    const QVector<ReferenceTaps> horizontal = referenceTaps(source.width(), width, filter);
+    const QVector<ReferenceTaps> vertical = referenceTaps(height, size.height(), filter);
+
+    QVector<float> rows(qsizetype(height) * width * 4);
+    for (int y = 0; y < height; ++y) {
+        const uchar* line = source.constScanLine(y);
+        float* out = rows.data() + qsizetype(y) * width * 4;
+        for (int x = 0; x < width; ++x) {
+            const ReferenceTaps& taps = horizontal[x];
+            for (int c = 0; c < 4; ++c) {
+                double sum = 0.0;
+                for (int t = 0; t < taps.weights.size(); ++t) {
+                    sum += taps.weights[t] * line[(taps.start + t) * 4 + c];
+                }
+                out[x * 4 + c] = float(sum);
+            }
+        }
+    }
+
+    QImage result(size, QImage::Format_ARGB32_Premultiplied);
+    for (int y = 0; y < size.height(); ++y) {
+        const ReferenceTaps& taps = vertical[y];
+        uchar* out = result.scanLine(y);
+        for (int x = 0; x < width; ++x) {
+            double channels[4];
+            for (int c = 0; c < 4; ++c) {
+                double sum = 0.0;
+                for (int t = 0; t < taps.weights.size(); ++t) {
+                    sum += taps.weights[t] * rows[(qsizetype(taps.start + t) * width + x) * 4 + c];
+                }
+                channels[c] = sum;
+            }
+            // 小端序 ARGB32 的字节顺序为 B、G、R、A
+            const double alpha = qBound(0.0, channels[3], 255.0);
+            for (int c = 0; c < 3; ++c) {
+                out[x * 4 + c] = uchar(qRound(qBound(0.0, channels[c], alpha)));
+            }
+            out[x * 4 + 3] = uchar(qRound(alpha));
+        }
+    }
+    return result;
+}
+
+// 解析图案：三个通道是方向和周期不同的低频余弦（缩小 8 倍后周期仍不少于 20 像素），
+// 像素值为像素中心处的函数值
+double patternValue(int channel, double x, double y)
+{
+    static const double periods[3][2] = {{160.0, 224.0}, {192.0, -288.0}, {256.0, 320.0}};
+    const double phase = 2.0 * M_PI * (x / periods[channel][0] + y / periods[channel][1]) + channel;
+    return 127.5 + 100.0 * std::cos(phase);
+}
+
+QImage analyticImage(const QSize& size, double scaleX, double scaleY)
+{
+    QImage image(size, QImage::Format_ARGB32_Premultiplied);
+    for (int y = 0; y < size.height(); ++y) {
+        QRgb* line = reinterpret_cast<QRgb*>(image.scanLine(y));
+        const double v = (y + 0.5) * scaleY;
+        for (int x = 0; x < size.width(); ++x) {
+            const double u = (x + 0.5) * scaleX;
+            line[x] = qRgb(qRound(patternValue(0, u, v)), qRound(patternValue(1, u, v)), qRound(patternValue(2, u, v)));
+        }
+    }
+    return image;
+}
+
+// 独立于 Resampler 滤波核的检查：
+// - 盒式滤波整数倍缩小，每个像素必须等于对应方块的算术平均（±1）
+// - 三种滤波器缩放低频余弦图案，结果与在目标像素中心直接求值的图案对比（不含边缘），
+//   低频信号几乎不受滤波影响，核的位置、宽度或归一化出错都会使 PSNR 明显下降
+bool checkAnalytic(QTextStream& out)
+{
+    constexpr double kMinAnalyticPsnr = 32.0;
+    constexpr int kMargin = 6;
+    bool allValid = true;
+
+    const QImage source = analyticImage(QSize(2048, 1152), 1.0, 1.0);
+    for (int factor : {2, 4}) {
+        const QImage scaled = Resampler::scale(source, source.size() / factor, Resampler::Filter::Box);
+        int worst = 0;
+        for (int y = 0; y < scaled.height(); ++y) {
+            for (int x = 0; x < scaled.width(); ++x) {
+                int sum[3] = {0, 0, 0};
+                for (int dy = 0; dy < factor; ++dy) {
+                    for (int dx = 0; dx < factor; ++dx) {
+                        const QRgb pixel = source.pixel(x * factor + dx, y * factor + dy);
+                        sum[0] += qRed(pixel);
+                        sum[1] += qGreen(pixel);
+                        sum[2] += qBlue(pixel);
+                    }
+                }
+                const QRgb pixel = scaled.pixel(x, y);
+                const int actual[3] = {qRed(pixel), qGreen(pixel), qBlue(pixel)};
+                for (int c = 0; c < 3; ++c) {
+                    const double mean = double(sum[c]) / (factor * factor);
+                    worst = qMax(worst, int(std::ceil(std::abs(actual[c] - mean) - 0.5)));
+                }
+            }
+        }
+        const bool valid = worst <= 1;
+        allValid = allValid && valid;
+        out << QString("analytic box 1/%1 block mean max error %2 %3\n").arg(factor).arg(worst)
+                   .arg(valid ? "ok" : "WRONG");
+    }
+
+    for (qreal factor : {0.5, 0.125, 1.5}) {
+        const QSize size = (QSizeF(source.size()) * factor).toSize();
+        const QImage expected = analyticImage(size, double(source.width()) / size.width(),
+                                              double(source.height()) / size.height());
+        const QRect interior = QRect(QPoint(0, 0), size).adjusted(kMargin, kMargin, -kMargin, -kMargin);
+        for (Resampler::Filter filter : {Resampler::Filter::Box, Resampler::Filter::Lanczos3,
+                                         Resampler::Filter::Mitchell}) {
+            const QImage scaled = Resampler::scale(source, size, filter);
+            const double quality = psnr(scaled.copy(interior), expected.copy(interior));
+            const bool valid = quality >= kMinAnalyticPsnr;
+            allValid = allValid && valid;
+            out << QString("analytic %1 x%2 %3 dB %4\n").arg(Resampler::filterName(filter)).arg(factor)
+                       .arg(std::isinf(quality) ? 99.99 : quality, 0, 'f', 2).arg(valid ? "ok" : "WRONG");
+        }
+    }
+    out.flush();
+    return allValid;
+}
+
+} // namespace
+
+int CommandLine::runBenchResample(const QStringList &args)
+{
+    QTextStream out(stdout);
+
+    // 用法：SCD bench-resample [image ...] [--runs N]
+    // 每种滤波器与同一滤波器的浮点参考实现对比 PSNR（低于 40 dB 视为失败），
+    // 并与 QImage::scaled（SmoothTransformation，双线性/盒式）对比耗时；
+    // QImage::scaled 的 PSNR 以 Lanczos3 的参考结果为准，仅供参考。
+    // 浮点参考与 Resampler 共用滤波核，另外用解析图案检查滤波核本身，见 checkAnalytic
+    int runs = 3;
+    BenchInputs inputs;
+    if (!parseBenchArgs(args, &runs, &inputs)) {
+        return 2;
+    }
+    if (inputs.isEmpty()) {
+        inputs.append({"flat-4k", syntheticScreenshot(QSize(3840, 2160))});
+        inputs.append({"ui-4k", syntheticInterface(QSize(3840, 2160), 3)});
+    }
+
+    constexpr double kMinPsnr = 40.0;
+    const qreal factors[] = {0.5, 0.37, 0.125, 1.5};
+    const Resampler::Filter filters[] = {Resampler::Filter::Box, Resampler::Filter::Lanczos3, Resampler::Filter::Mitchell};
+
+    bool allValid = checkAnalytic(out);
+    for (const auto& input : inputs) {
+        const QImage& image = input.second;
+        for (qreal factor : factors) {
+            const QSize size = (QSizeF(image.size()) * factor).toSize().expandedTo(QSize(1, 1));
+            out << QString("%1 %2x%3 -> %4x%5\n").arg(input.first).arg(image.width()).arg(image.height())
+                       .arg(size.width()).arg(size.height());
+
+            QImage scaled;
+            const qint64 baseline = bestOf(runs, [&]() {
+                return image.scaled(size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+            }, &scaled);
+            const QImage lanczosReference = referenceScale(image, size, Resampler::Filter::Lanczos3);
+            out << QString("  %1 %2 ms %3 dB\n")
+                       .arg("QImage::scaled", -16)
+                       .arg(baseline / 1000.0, 8, 'f', 2)
+                       .arg(psnr(scaled, lanczosReference), 7, 'f', 2);
+
+            for (Resampler::Filter filter : filters) {
+                const qint64 elapsed = bestOf(runs, [&]() { return Resampler::scale(image, size, filter); }, &scaled);
+                const QImage reference = filter == Resampler::Filter::Lanczos3
+                    ? lanczosReference : referenceScale(image, size, filter);
+                const double quality = psnr(scaled, reference);
+                const bool valid = quality >= kMinPsnr;
+                allValid = allValid && valid;
+                out << QString("  %1 %2 ms %3 dB %4x %5\n")
+                           .arg(Resampler::filterName(filter), -16)
+                           .arg(elapsed / 1000.0, 8, 'f', 2)
+                           .arg(std::isinf(quality) ? 99.99 : quality, 7, 'f', 2)
+                           .arg(elapsed > 0 ? double(baseline) / elapsed : 0.0, 5, 'f', 2)
+                           .arg(valid ? "ok" : "LOW");
+                out.flush();
+            }
+        }
+    }
+    return allValid ? 0 : 1;
+}
+
+int CommandLine::runCodes(const QStringList &args)
+{
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    // 用法：SCD codes [image ...] [--runs N]
+    // 输出每张图片中识别到的码及扫描耗时（多次运行取最短），用于检查整屏扫描的耗时；
+    // 未指定图片时扫描合成的 4K 界面截图，只报告耗时
+    if (!CodeScanner::isAvailable()) {
+        err << "built without ZXing, barcode decoding is unavailable\n";
+        return 2;
+    }
+    int runs = 1;
+    BenchInputs inputs;
+    if (!parseBenchArgs(args, &runs, &inputs)) {
+        return 2;
+    }
+    const bool synthetic = inputs.isEmpty();
+    if (synthetic) {
+        inputs.append({"synthetic-4k", syntheticInterface(QSize(3840, 2160), 4)});
+        runs = qMax(runs, 3);
+    }
+
+    bool anyFound = false;
+    for (const auto& input : inputs) {
+        const QString& file = input.first;
+        const QImage& image = input.second;
+        QVector<CodeScanner::Result> results;
+        const qint64 best = bestOf(runs, [&]() { return CodeScanner::scan(image); }, &results);
+        out << QString("%1 %2x%3 %4 codes %5 ms\n").arg(file).arg(image.width()).arg(image.height())
+                   .arg(results.size()).arg(best / 1000.0, 0, 'f', 2);
+        for (const CodeScanner::Result& result : results) {
+            const QRect bounds = result.position.boundingRect();
+            out << QString("  %1 (%2,%3 %4x%5) %6\n").arg(result.format).arg(bounds.x()).arg(bounds.y())
+                       .arg(bounds.width()).arg(bounds.height()).arg(result.text);
+        }
+        out.flush();
+        anyFound = anyFound || !results.isEmpty();
+    }
+    return anyFound || synthetic ? 0 : 1;
+}
+
+int CommandLine::runStress(const QStringList &args)
+{
+    QTextStream out(stdout);
+
+    // 用法：SCD stress [--seconds N] [--exporters N]
+    // 截图、标注和导出同时进行：一个线程不断替换当前帧，一个线程增删改标注（含带排版的文字），
+    // 其余线程取快照渲染并导出，主线程按界面的方式绘制并处理转交回来的排版对象释放。
+    // 检查快照在并发写入下保持不变、导出无损。配合 -DSCD_TSAN=ON 构建即为数据竞争检查。
+    // 不启动历史、索引等后台服务，不读写用户数据
+    int seconds = 10;
+    int exporters = qMax(2, QThread::idealThreadCount() - 2);
+    for (int i = 0; i + 1 < args.size(); ++i) {
+        if (args[i] == "--seconds") {
+            seconds = qMax(1, args[++i].toInt());
+        } else if (args[i] == "--exporters") {
+            exporters = qMax(1, args[++i].toInt());
+        }
+    }
+
+    CaptureManager manager(nullptr, CaptureManager::Services::None);
+    const QSize frameSize(1280, 720);
+    QVector<CaptureFramePtr> frames;
+    for (quint32 seed = 1; seed <= 4; ++seed) {
+        frames.append(std::make_shared<const CaptureFrame>(syntheticInterface(frameSize, seed), QPoint(0, 0)));
+    }
+    manager.setFrame(frames.first());
+
+    std::atomic<bool> stop{false};
+    std::atomic<int> failures{0};
+    std::atomic<qint64> captures{0};
+    std::atomic<qint64> edits{0};
+    std::atomic<qint64> exports{0};
+    auto fail = [&](const QString& message) {
+        if (failures.fetch_add(1) < 10) {
+            QTextStream(stderr) << "stress: " << message << "\n";
+        }
+    };
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(exporters + 2);
+
+    // 截图：轮流发布预先生成的帧
+    pool.start([&]() {
+        for (int i = 0; !stop.load(); ++i) {
+            manager.setFrame(frames.at(i % frames.size()));
+            captures.fetch_add(1);
+            QThread::usleep(200);
+        }
+    });
+
+    // 标注：四种标注的添加、修改、删除和命中测试；太多时清空
+    pool.start([&]() {
+        QRandomGenerator random(7);
+        while (!stop.load()) {
+            CaptureManager::Annotation annotation;
+            annotation.type = CaptureManager::AnnotationType(random.bounded(4));
+            annotation.rect = QRect(random.bounded(frameSize.width() - 64), random.bounded(frameSize.height() - 64),
+                                    16 + random.bounded(48), 16 + random.bounded(48));
+            annotation.color = QColor::fromRgb(random.generate());
+            annotation.thickness = 1 + random.bounded(4);
+            annotation.filled = random.bounded(2) == 0;
+            annotation.startPoint = annotation.rect.topLeft();
+            annotation.endPoint = annotation.rect.bottomRight();
+            if (annotation.type == CaptureManager::AnnotationType::Text) {
+                annotation.text = QString("stress %1").arg(edits.load());
+                annotation.font = QFont("Arial", 10 + random.bounded(10));
+                // 一半带排版对象：它们随快照在导出线程中释放
+                if (random.bounded(2) == 0) {
+                    annotation.textLayout = CaptureManager::createTextLayout(annotation.text, annotation.font);
+                }
+            }
+            const int count = manager.annotations().size();
+            switch (random.bounded(5)) {
+            case 0:
+            case 1:
+                manager.addAnnotation(annotation);
+                break;
+            case 2:
+                manager.updateAnnotation(count > 0 ? random.bounded(count) : 0, annotation);
+                break;
+            case 3:
+                manager.removeAnnotation(count > 0 ? random.bounded(count) : 0);
+                break;
+            default:
+                manager.hitTest(annotation.rect.center());
+                break;
+            }
+            if (count > 64) {
+                manager.clearAnnotations();
+            }
+            edits.fetch_add(1);
+        }
+    });
+
+    // 导出：快照渲染两次必须一致（快照不受之后的写入影响），部分结果编码后解码比较
+    for (int worker = 0; worker < exporters; ++worker) {
+        pool.start([&, worker]() {
+            QRandomGenerator random(100 + quint32(worker));
+            for (int i = 0; !stop.load(); ++i) {
+                const CaptureManager::Snapshot snapshot = manager.snapshot();
+                if (!snapshot.isValid()) {
+                    continue;
+                }
+                const QRect rect(random.bounded(frameSize.width() / 2), random.bounded(frameSize.height() / 2),
+                                 64 + random.bounded(frameSize.width() / 2), 64 + random.bounded(frameSize.height() / 2));
+                const QImage first = snapshot.render(rect);
+                if (first.size() != rect.size()) {
+                    fail(QString("render size %1x%2 for %3x%4").arg(first.width()).arg(first.height())
+                             .arg(rect.width()).arg(rect.height()));
+                    continue;
+                }
+                QThread::yieldCurrentThread();
+                if (snapshot.render(rect) != first) {
+                    fail("snapshot changed while it was being exported");
+                }
+                if (i % 8 == 0) {
+                    const QByteArray data = ImageExporter::encode(first, ImageExporter::Format::Png,
+                                                                  ImageExporter::Preset::Fastest);
+                    const QImage decoded = QImage::fromData(data);
+                    if (decoded.convertToFormat(QImage::Format_ARGB32) != first.convertToFormat(QImage::Format_ARGB32)) {
+                        fail("exported PNG does not match the rendered snapshot");
+                    }
+                }
+                exports.fetch_add(1);
+            }
+        });
+    }
+
+    // 主线程扮演界面：用缓存的排版绘制文字，并删除工作线程转交回来的排版对象
+    QElapsedTimer elapsed;
+    elapsed.start();
+    QImage canvas(frameSize, QImage::Format_ARGB32_Premultiplied);
+    while (elapsed.elapsed() < seconds * 1000) {
+        {
+            QPainter painter(&canvas);
+            manager.drawAnnotations(painter, canvas.rect());
+        }
+        QCoreApplication::processEvents();
+        QThread::msleep(20);
+    }
+    stop.store(true);
+    pool.waitForDone();
+    QCoreApplication::processEvents();
+
+    out << QString("%1 s, %2 exporters: %3 captures, %4 annotation edits, %5 exports, %6 failures\n")
+               .arg(seconds).arg(exporters).arg(captures.load()).arg(edits.load()).arg(exports.load())
+               .arg(failures.load());
+    return failures.load() == 0 ? 0 : 1;
+}
+
+int CommandLine::runBenchSearch(const QStringList &args)
+{
+    QTextStream out(stdout);
+
+    // 用法：SCD bench-search [--documents N] [--words N] [--runs N]
+    // 用合成的识别结果建立 N 张截图的索引（词频近似 Zipf 分布），
+    // 报告建立、保存、加载的耗时和几类查询的延迟（多次运行取最短）
+    int documents = 30000;
+    int wordsPerDocument = 80;
+    int runs = 5;
+    for (int i = 0; i + 1 < args.size(); ++i) {
+        if (args[i] == "--documents") {
+            documents = qMax(1, args[++i].toInt());
+        } else if (args[i] == "--words") {
+            wordsPerDocument = qMax(1, args[++i].toInt());
+        } else if (args[i] == "--runs") {
+            runs = qMax(1, args[++i].toInt());
+        }
+    }
+
+    QRandomGenerator random(11);
+    QStringList vocabulary;
+    for (int i = 0; i < 50000; ++i) {
+        QString word;
+        const int length = 3 + random.bounded(8);
+        for (int c = 0; c < length; ++c) {
+            word.append(QChar('a' + random.bounded(26)));
+        }
+        vocabulary.append(word);
+    }
+
+    QTemporaryDir directory;
+    const QString path = directory.filePath("index.bin");
+    SearchIndex index(path);
+    QElapsedTimer timer;
+    timer.start();
+    for (int id = 1; id <= documents; ++id) {
+        QVector<SearchIndex::Word> words;
+        words.reserve(wordsPerDocument);
+        for (int w = 0; w < wordsPerDocument; ++w) {
+            // 三次方使小编号的词远比大编号的常见
+            const double r = random.generateDouble();
+            const QString& text = vocabulary.at(int(r * r * r * vocabulary.size()));
+            words.append({text, QRect((w % 10) * 180, (w / 10) * 24, 160, 20)});
+        }
+        index.add(id, QSize(1920, 1080), words);
+    }
+    const qint64 buildMs = timer.restart();
+    index.save();
+    const qint64 saveMs = timer.restart();
+    SearchIndex reloaded(path);
+    const bool loadedOk = reloaded.load();
+    const qint64 loadMs = timer.elapsed();
+    out << QString("%1 captures x %2 words: build %3 ms, save %4 ms (%5 KB), load %6 ms%7\n")
+               .arg(documents).arg(wordsPerDocument).arg(buildMs).arg(saveMs)
+               .arg(QFileInfo(path).size() / 1024).arg(loadMs).arg(loadedOk ? "" : " FAILED");
+
+    const QString common = vocabulary.at(0);
+    const QString rare = vocabulary.at(vocabulary.size() / 2);
+    const struct {
+        QString name;
+        QString query;
+    } queries[] = {
+        {"common word", common},
+        {"rare word", rare},
+        {"prefix (2 chars)", common.left(2)},
+        {"substring (3 chars)", rare.mid(1, 3)},
+        {"two words", common + " " + vocabulary.at(1)},
+        {"no match", QString("zzzzzzzzzz")}
+    };
+    for (const auto& query : queries) {
+        QVector<SearchIndex::Result> results;
+        const qint64 elapsed = bestOf(runs, [&]() { return reloaded.search(query.query, 200); }, &results);
+        out << QString("  %1 %2 ms %3 results  \"%4\"\n")
+                   .arg(query.name, -20)
+                   .arg(elapsed / 1000.0, 8, 'f', 3)
+                   .arg(results.size(), 4)
+                   .arg(query.query);
+        out.flush();
+    }
+    return loadedOk ? 0 : 1;
+}
+
+int CommandLine::runBenchRedact(const QStringList &args)
+{
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    // 用法：SCD bench-redact [image ...] [--runs N]
+    // 对图片中央 1920x1080 的选区（图片更小时为整张图）做一次完整的敏感信息扫描并等待结束，
+    // 每次使用新的帧，不命中缓存；报告最短耗时和匹配数，目标约 150 ms。
+    // 未指定图片时使用合成的 4K 界面截图，上面写有邮箱和卡号
+    if (!TextRecognizer::isAvailable()) {
+        err << "built without Tesseract, text recognition is unavailable\n";
+        return 2;
+    }
+    int runs = 3;
+    BenchInputs inputs;
+    if (!parseBenchArgs(args, &runs, &inputs)) {
+        return 2;
+    }
+    if (inputs.isEmpty()) {
+        QImage image = syntheticInterface(QSize(3840, 2160), 7);
+        QPainter painter(&image);
+        painter.setPen(QColor(32, 33, 36));
+        painter.setFont(QFont("Segoe UI", 11));
+        for (int y = 900; y < 1300; y += 60) {
+            painter.drawText(1200, y, QString("Contact alice.%1@example.com  card 4111 1111 1111 1111").arg(y));
+        }
+        painter.end();
+        inputs.append({"synthetic-4k", image});
+    }
+
+    SensitiveContentScanner scanner;
+    for (const auto& input : inputs) {
+        const QString& file = input.first;
+        const QImage& image = input.second;
+        QRect region(QPoint(0, 0), QSize(1920, 1080).boundedTo(image.size()));
+        region.moveCenter(image.rect().center());
+
+        // 帧的构建不计入耗时；第一次扫描会在各工作线程初始化识别引擎，也不计入
+        QVector<CaptureFramePtr> frames;
+        for (int run = 0; run <= runs; ++run) {
+            frames.append(std::make_shared<const CaptureFrame>(image, QPoint(0, 0)));
+        }
+        int next = 0;
+        auto scanOnce = [&]() {
+            scanner.scan(frames.at(next++), region);
+            scanner.waitForFinished(-1);
+            return scanner.matches(region);
+        };
+        scanOnce();
+        QVector<QRect> found;
+        const qint64 best = bestOf(runs, scanOnce, &found);
+        if (!scanner.isAvailable()) {
+            err << "text recognizer failed to initialise (missing tessdata?)\n";
+            return 2;
+        }
+        out << QString("%1 region %2x%3 %4 bands %5 matches %6 ms (budget 150 ms)\n")
+                   .arg(file).arg(region.width()).arg(region.height())
+                   .arg(scanner.progress().second).arg(found.size()).arg(best / 1000.0, 0, 'f', 2);
+        out.flush();
+    }
+    return 0;
+}
@@ -0,0 +1,32 @@
+#ifndef COMMANDLINE_H
+#define COMMANDLINE_H
+
+#include <QStringList>
+#include <QVector>
+#include "../core/batch/batchpipeline.h"
+
+// 命令行子命令：无需创建主窗口即可使用的功能
+class CommandLine
+{
+public:
+    // 若 argv 中包含可识别的子命令则执行并返回 true，exitCode 为进程退出码；
+    // 否则返回 false，由调用方继续启动图形界面
+    static bool run(int argc, char *argv[], int &exitCode);
+
+private:
+    static int runDiff(const QStringList &args);
+    static int runControl(const QStringList &args);
+    static int runBenchExport(const QStringList &args);
+    static int runBenchPalette(const QStringList &args);
+    static int runBatch(const QStringList &args);
+    static int runBatchScaling(const QStringList &files, const QVector<BatchPipeline::Step> &steps,
+                               const BatchPipeline::Options &options);
+    static int runBenchResample(const QStringList &args);
+    static int runCodes(const QStringList &args);
+    static int runStress(const QStringList &args);
+    static int runBenchSearch(const QStringList &args);
+    static int runBenchRedact(const QStringList &args);
+    static void attachConsole();
+};
+
+#endif // COMMANDLINE_H
@@ -16,6 +16,32 @@
 #include <QStyle>
 #include "../ui/floatimage/floatwindow.h"  // 使用相对路径
 #include <QIcon>
+#include <QInputDialog>
+#include <QFileDialog>
+#include <QStandardPaths>
+#include "../core/capture/capturescheduler.h"
+#include "../core/capture/replaybuffer.h"
+#include "../core/history/capturehistory.h"
+#include "../core/diff/imagediff.h"
+#include "../core/ipc/controlserver.h"
+#include "../core/image/progressiveimage.h"
+#include "../core/export/imageexporter.h"
+#include "../core/redaction/redactionrules.h"
+#include "../core/redaction/sensitivecontentscanner.h"
+#include "../core/redaction/textrecognizer.h"
+#include "../core/search/captureindexer.h"
+#include "../core/image/autotrim.h"
+#include "../core/export/beautifier.h"
+#include "../ui/search/searchwindow.h"
+#include <QActionGroup>
+#include "../utils/startupprofiler.h"
+#include <QMimeData>
+#include <QDragEnterEvent>
+#include <QDropEvent>
+#include <QImageReader>
+#include <QThreadPool>
+#include <QPointer>
+#include <QDebug>
 
 // 初始化静态成员
 HHOOK MainWindow::keyboardHook = nullptr;
@@ -24,7 +50,6 @@ MainWindow* MainWindow::instance = nullptr;
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
     , m_captureManager(new CaptureManager(this))
-    , m_overlay(new OverlayWidget(nullptr, m_captureManager.data())) // 传入 CaptureManager
 {
     // 添加这行，设置一个合适的初始大小
     resize(800, 600);
@@ -45,23 +70,112 @@ MainWindow::MainWindow(QWidget *parent)
     
     setCentralWidget(centralWidget);
     
+    // 托盘图标不能接收拖放，图片文件可拖到主窗口或已有贴图上
+    setAcceptDrops(true);
+    
     setupHotkeys();
+    StartupProfiler::mark("hotkeys");
     setupTrayIcon();
+    StartupProfiler::mark("tray");
+    
+    // 本地控制接口：供内部工具自动触发截图和读取历史
+    m_controlServer = new ControlServer(m_captureManager.data(), this);
+    m_controlServer->start();
+    connect(m_controlServer, &ControlServer::pinRequested, this, [this](const QImage& image) {
+        pinPixmap(QPixmap::fromImage(image), QCursor::pos());
+    });
+    connect(m_controlServer, &ControlServer::launchRequested,
+            this, &MainWindow::executeLaunchRequest);
+    StartupProfiler::mark("control-server");
+    
+    QTimer::singleShot(0, this, []() {
+        StartupProfiler::mark("event-loop");
+    });
+    
+    // 后台服务、截图界面和工具栏不在启动路径上创建：事件循环跑起来、托盘可用之后
+    // 再预热，首次截图前如果还没预热则在 overlay() 中立即创建
+    QTimer::singleShot(kWarmupDelayMs, this, [this]() {
+        startServices();
+        StartupProfiler::mark("services");
+        overlay();
+        StartupProfiler::mark("overlay-ready");
+        emit warmupFinished();
+    });
+}
+
+void MainWindow::startServices()
+{
+    if (m_servicesStarted) {
+        return;
+    }
+    m_servicesStarted = true;
+    m_captureManager->startServices();
+    
+    // 延时截图：倒计时显示在遮罩上，结束后进入正常截图流程
+    CaptureScheduler* scheduler = m_captureManager->scheduler();
+    connect(scheduler, &CaptureScheduler::countdownTick, this, [this](int seconds) {
+        overlay()->showCountdown(seconds);
+    });
+    connect(scheduler, &CaptureScheduler::delayedCaptureDue, this, &MainWindow::startCapture);
+    connect(scheduler, &CaptureScheduler::jobsChanged, this, [this]() {
+        m_stopScheduleAction->setEnabled(!m_captureManager->scheduler()->jobs().isEmpty());
+    });
+    
+    m_replayAction->setChecked(m_captureManager->replay()->isEnabled());
+    connect(m_replayAction, &QAction::toggled, this, [this](bool checked) {
+        m_captureManager->replay()->setEnabled(checked);
+    });
+    
+    // 识别引擎运行时初始化失败（缺少语言数据等）：截图不会被检查，需要告知用户
+    connect(m_captureManager->scanner(), &SensitiveContentScanner::unavailable, this, [this]() {
+        m_redactAction->setEnabled(false);
+        m_redactAction->setToolTip("文字识别组件初始化失败");
+        if (RedactionRules::isEnabled()) {
+            m_trayIcon->showMessage("自动打码", "文字识别组件初始化失败，截图不会自动打码敏感信息",
+                                    QSystemTrayIcon::Warning, 5000);
+        }
+    });
+}
+
+OverlayWidget* MainWindow::overlay()
+{
+    if (m_overlay) {
+        return m_overlay.data();
+    }
+    
+    startServices();
+    m_overlay.reset(new OverlayWidget(nullptr, m_captureManager.data()));
     
-    // 修改connect的使用方式，使用.data()获取原始指针
     connect(m_overlay.data(), &OverlayWidget::areaSelected, this, [this](const QRect &rect) {
-        QPixmap screenshot = m_captureManager->captureScreen();
-        QPixmap croppedShot = screenshot.copy(rect);
-        handleCapture(croppedShot);
+        m_captureManager->presets().setLastRegion(m_overlay->selectedGlobalRect());
+        // 从冻结的画面裁剪并渲染标注，同时记录会话以便之后重新编辑
+        CaptureManager::Snapshot snapshot = m_captureManager->snapshot();
+        m_session.setFrame(snapshot.frame);
+        m_session.setAnnotations(*snapshot.annotations);
+        m_session.setSelection(rect);
+        handleCapture(snapshot.render(rect), m_session);
+        m_session = CaptureSession();
     });
     
     // 连接截图完成信号
     connect(m_overlay.data(), &OverlayWidget::captureFinished, 
             this, &MainWindow::onCaptureFinished);
+    connect(m_overlay.data(), &OverlayWidget::captureFinished, this, [this]() {
+        m_session = CaptureSession();
+    });
     
     // 连接贴图信号
     connect(m_overlay.data(), &OverlayWidget::createFloatWindow,
             this, &MainWindow::createFloatWindow);
+    
+    // 选区与贴图对比
+    connect(m_overlay.data(), &OverlayWidget::compareRequested,
+            this, &MainWindow::compareWithPin);
+    
+    // 二维码/条码内容复制到剪贴板
+    connect(m_overlay.data(), &OverlayWidget::codesDecoded,
+            this, &MainWindow::copyDecodedCodes);
+    return m_overlay.data();
 }
 
 MainWindow::~MainWindow()
@@ -92,16 +206,28 @@ LRESULT CALLBACK MainWindow::KeyboardProc(int nCode, WPARAM wParam, LPARAM lPara
                 return 1;
             }
         }
+        
+        // Ctrl+Alt+R：重复截取上次选区，不显示截图界面
+        if (ctrlPressed && altPressed && kbStruct->vkCode == 'R') {
+            if (instance) {
+                QMetaObject::invokeMethod(instance, "repeatLastRegion", 
+                                        Qt::QueuedConnection);
+                return 1;
+            }
+        }
     }
     return CallNextHookEx(keyboardHook, nCode, wParam, lParam);
 }
 
 void MainWindow::startCapture()
 {
+    overlay()->hideCountdown();
+    
     // 先清理资源
     m_captureManager->clearResources();
     
-    // 隐藏主窗口
+    // 隐藏主窗口，截图结束后只在原来可见时恢复
+    m_restoreWindow = m_restoreWindow || isVisible();
     hide();
     
     // 延迟显示截图界面
@@ -110,21 +236,289 @@ void MainWindow::startCapture()
     });
 }
 
-void MainWindow::handleCapture(const QPixmap &pixmap)
+void MainWindow::executeLaunchRequest(const QJsonObject& request)
 {
-    if (pixmap.isNull()) {
+    const QString command = request.value("cmd").toString();
+    if (command == "capture.interactive") {
+        startCapture();
+    } else if (command == "pin.file") {
+        pinFile(request.value("path").toString(), QCursor::pos());
+    } else {
+        show();
+        raise();
+        activateWindow();
+    }
+}
+
+void MainWindow::handleCapture(const QImage &image, const CaptureSession& session)
+{
+    if (image.isNull()) {
         return;
     }
     
-    QApplication::clipboard()->setPixmap(pixmap);
+    // QImage 隐式共享，交给历史记录的写盘线程时不会复制像素
+    // 美化只作用于复制出去的图片，历史记录和会话保留原始截图
+    QApplication::clipboard()->setImage(Beautifier::isEnabled() ? Beautifier::apply(image, Beautifier::style()) : image);
+    bool duplicate = false;
+    int id = m_captureManager->history()->add(image, &duplicate);
+    // 重复的截图关联到已有记录，会话仍然保存，保证最近一次的编辑状态可以重新打开
+    m_captureManager->history()->saveSession(id, session);
+    if (!duplicate) {
+        // 文字识别在后台空闲时进行，不影响本次截图
+        m_captureManager->indexer()->enqueue(id, image);
+    }
     m_captureManager->clearResources();
-    show();
+    if (m_restoreWindow) {
+        m_restoreWindow = false;
+        show();
+    }
+}
+
+void MainWindow::editSession(const CaptureSession& session)
+{
+    if (!session.isValid()) {
+        qDebug() << "Failed to load capture session";
+        return;
+    }
+    m_session = session;
+    m_restoreWindow = m_restoreWindow || isVisible();
+    hide();
+    // 标注仍可选中、移动和删除；像素已解压时直接编辑
+    if (session.isDecoded()) {
+        overlay()->showSession(session.frame(), session.annotations(), session.selection());
+        return;
+    }
+    
+    // 整帧解压放到工作线程，截图界面先显示缩略图放大的预览
+    overlay()->showSession(session.previewFrame(), session.annotations(), session.selection(), true);
+    const int load = ++m_sessionLoad;
+    QPointer<MainWindow> guard(this);
+    QThreadPool::globalInstance()->start([guard, session, load]() {
+        session.frame();
+        QMetaObject::invokeMethod(qApp, [guard, session, load]() {
+            if (!guard || load != guard->m_sessionLoad) {
+                return;
+            }
+            // 解压后的会话替换 m_session，帧不变时保存仍复用其中已压缩的像素
+            if (guard->overlay()->finishSessionLoad(session.frame())) {
+                guard->m_session = session;
+            }
+        }, Qt::QueuedConnection);
+    });
+}
+
+void MainWindow::editLastSession()
+{
+    CaptureHistory* history = m_captureManager->history();
+    for (const CaptureHistory::Entry& entry : history->entries()) {
+        CaptureSession session = history->loadSession(entry.id);
+        if (session.isValid()) {
+            editSession(session);
+            return;
+        }
+    }
+}
+
+void MainWindow::openSessionDialog()
+{
+    QString path = QFileDialog::getOpenFileName(nullptr, "打开截图会话", CaptureHistory::storageDirectory(),
+                                                QString("截图会话 (*.%1)").arg(CaptureSession::kSuffix));
+    if (path.isEmpty()) {
+        return;
+    }
+    editSession(CaptureSession::load(path));
+}
+
+void MainWindow::showSearchWindow()
+{
+    if (!m_searchWindow) {
+        m_searchWindow = new SearchWindow(m_captureManager->history(), m_captureManager->indexer(), this);
+        connect(m_searchWindow, &SearchWindow::entryActivated, this, [this](int id) {
+            QImage image = m_captureManager->history()->load(id);
+            if (!image.isNull()) {
+                pinPixmap(QPixmap::fromImage(image), QCursor::pos());
+            }
+        });
+    }
+    m_searchWindow->show();
+    m_searchWindow->raise();
+    m_searchWindow->activateWindow();
+}
+
+void MainWindow::compareWithPin(const QImage& selection, qreal devicePixelRatio)
+{
+    if (selection.isNull()) {
+        return;
+    }
+    auto compare = [this, selection, devicePixelRatio](QImage reference) {
+        if (reference.isNull()) {
+            return;
+        }
+        // 文件贴图按原图像素存储：在高 DPI 屏幕上截取的图片是选区逻辑尺寸的设备像素比倍，
+        // 换算到选区的逻辑像素后再逐像素比较
+        if (reference.size() != selection.size()) {
+            const QSize logical = (QSizeF(reference.size()) / devicePixelRatio).toSize();
+            if (qAbs(logical.width() - selection.width()) <= 1 && qAbs(logical.height() - selection.height()) <= 1) {
+                reference = reference.scaled(selection.size(), Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+            }
+        }
+        
+        ImageDiff::Options options;
+        options.buildMask = false;
+        ImageDiff::Result result = ImageDiff::compare(reference, selection, options);
+        
+        overlay()->showDiffRegions(result.regions);
+    };
+    
+    // 优先与最近的贴图对比，文件贴图解码原图后再比较（预览图分辨率不够）；没有贴图时与最近一次截图对比
+    if (!m_floatWindows.isEmpty()) {
+        m_floatWindows.last()->withFullImage(compare);
+    } else if (m_captureManager->history()->count() > 0) {
+        compare(m_captureManager->history()->load(m_captureManager->history()->entries().first().id));
+    }
+}
+
+void MainWindow::copyDecodedCodes(const QStringList& payloads)
+{
+    if (payloads.isEmpty()) {
+        m_trayIcon->showMessage("识别二维码/条码", "没有找到二维码或条码", QSystemTrayIcon::Information, 2000);
+        return;
+    }
+    QApplication::clipboard()->setText(payloads.join('\n'));
+    const QString summary = payloads.size() == 1 ? payloads.first().left(120)
+                                                 : QString("已复制 %1 个码的内容").arg(payloads.size());
+    m_trayIcon->showMessage("识别二维码/条码", summary, QSystemTrayIcon::Information, 2000);
+}
+
+void MainWindow::compareLastTwoCaptures()
+{
+    CaptureHistory* history = m_captureManager->history();
+    if (history->count() < 2) {
+        return;
+    }
+    
+    const QVector<CaptureHistory::Entry> entries = history->entries();
+    QImage previous = history->load(entries.at(1).id);
+    QImage latest = history->load(entries.at(0).id);
+    if (previous.isNull() || latest.isNull()) {
+        return;
+    }
+    
+    ImageDiff::Options options;
+    options.buildMask = false;
+    ImageDiff::Result result = ImageDiff::compare(previous, latest, options);
+    
+    // 在最新一次截图上标出变化区域并贴出
+    QPixmap marked = QPixmap::fromImage(latest);
+    QPainter painter(&marked);
+    painter.setPen(QPen(QColor(255, 0, 255), 2));
+    painter.setBrush(QColor(255, 0, 255, 40));
+    for (const QRect& region : result.regions) {
+        painter.drawRect(region);
+    }
+    painter.end();
+    
+    pinPixmap(marked, QCursor::pos());
+}
+
+void MainWindow::repeatLastRegion()
+{
+    QRect region = m_captureManager->presets().lastRegion();
+    if (region.isEmpty()) {
+        // 还没有选过区域，退回普通截图流程
+        startCapture();
+        return;
+    }
+    captureRegion(region);
+}
+
+void MainWindow::captureRegion(const QRect& globalRect)
+{
+    // 只抓取该区域所在的屏幕，直接送入剪贴板，不显示遮罩
+    QPixmap pixmap = m_captureManager->captureRegion(globalRect);
+    if (pixmap.isNull()) {
+        return;
+    }
+    m_captureManager->presets().setLastRegion(globalRect);
+    if (RedactionRules::isEnabled() || Beautifier::isEnabled()) {
+        // 不经过遮罩，无法人工检查，直接打码后再送入剪贴板；识别较慢，在工作线程中完成
+        const QImage image = pixmap.toImage();
+        const bool redact = RedactionRules::isEnabled();
+        const bool beautify = Beautifier::isEnabled();
+        const Beautifier::Style style = Beautifier::style();
+        SensitiveContentScanner* scanner = m_captureManager->scanner();
+        QPointer<MainWindow> self(this);
+        QThreadPool::globalInstance()->start([self, scanner, image, redact, beautify, style]() {
+            QImage result = redact ? scanner->redact(image) : image;
+            if (beautify) {
+                result = Beautifier::apply(result, style);
+            }
+            QMetaObject::invokeMethod(qApp, [self, result]() {
+                if (self) {
+                    QApplication::clipboard()->setImage(result);
+                }
+            }, Qt::QueuedConnection);
+        });
+        return;
+    }
+    QApplication::clipboard()->setPixmap(pixmap);
+}
+
+void MainWindow::startDelayedCapture(int seconds)
+{
+    m_restoreWindow = m_restoreWindow || isVisible();
+    hide();
+    m_captureManager->scheduler()->startCountdown(seconds);
+}
+
+void MainWindow::startIntervalCapture()
+{
+    QRect region = m_captureManager->presets().lastRegion();
+    if (region.isEmpty()) {
+        return;
+    }
+    
+    bool ok = false;
+    int interval = QInputDialog::getInt(nullptr, "定时截图", "截图间隔（毫秒）：",
+                                        1000, 50, 24 * 3600 * 1000, 100, &ok);
+    if (!ok) {
+        return;
+    }
+    
+    QString directory = QFileDialog::getExistingDirectory(
+        nullptr, "选择保存目录",
+        QStandardPaths::writableLocation(QStandardPaths::PicturesLocation));
+    if (directory.isEmpty()) {
+        return;
+    }
+    
+    m_captureManager->scheduler()->addIntervalJob(region, interval, directory);
+}
+
+void MainWindow::saveLastRegionAsPreset()
+{
+    QRect region = m_captureManager->presets().lastRegion();
+    if (region.isEmpty()) {
+        return;
+    }
+    
+    bool ok = false;
+    QString name = QInputDialog::getText(nullptr, "保存选区预设", "预设名称：",
+                                         QLineEdit::Normal,
+                                         QString("%1×%2").arg(region.width()).arg(region.height()),
+                                         &ok);
+    if (ok && !name.trimmed().isEmpty()) {
+        m_captureManager->presets().savePreset(name.trimmed(), region);
+    }
 }
 
 void MainWindow::onCaptureFinished()
 {
     m_captureManager->clearResources();
-    show();
+    if (m_restoreWindow) {
+        m_restoreWindow = false;
+        show();
+    }
 }
 
 void MainWindow::setupTrayIcon()
@@ -150,6 +544,160 @@ void MainWindow::createTrayMenu()
     QAction* captureAction = new QAction("截图", this);
     connect(captureAction, &QAction::triggered, this, &MainWindow::startCapture);
     
+    QAction* repeatAction = new QAction("重复上次选区 (Ctrl+Alt+R)", this);
+    connect(repeatAction, &QAction::triggered, this, &MainWindow::repeatLastRegion);
+    
+    // 选区预设子菜单，每次弹出时按当前预设重建
+    m_presetMenu = new QMenu("选区预设", m_trayMenu);
+    connect(m_presetMenu, &QMenu::aboutToShow, this, &MainWindow::rebuildPresetMenu);
+    
+    // 延时截图
+    QMenu* delayMenu = new QMenu("延时截图", m_trayMenu);
+    for (int seconds : {3, 5, 10}) {
+        QAction* action = delayMenu->addAction(QString("%1 秒").arg(seconds));
+        connect(action, &QAction::triggered, this, [this, seconds]() {
+            startDelayedCapture(seconds);
+        });
+    }
+    
+    QAction* intervalAction = new QAction("定时截取上次选区...", this);
+    connect(intervalAction, &QAction::triggered, this, &MainWindow::startIntervalCapture);
+    
+    m_stopScheduleAction = new QAction("停止定时截图", this);
+    m_stopScheduleAction->setEnabled(false);
+    connect(m_stopScheduleAction, &QAction::triggered, this, [this]() {
+        m_captureManager->scheduler()->clearJobs();
+    });
+    
+    // 导出预设：速度与体积的取舍，作用于保存、历史记录和定时截图
+    QMenu* exportMenu = new QMenu("导出预设", m_trayMenu);
+    QActionGroup* presetGroup = new QActionGroup(exportMenu);
+    const QPair<ImageExporter::Preset, QString> exportPresets[] = {
+        {ImageExporter::Preset::Fastest, "速度优先"},
+        {ImageExporter::Preset::Balanced, "均衡"},
+        {ImageExporter::Preset::Smallest, "体积优先"}
+    };
+    for (const auto& item : exportPresets) {
+        QAction* action = exportMenu->addAction(item.second);
+        action->setCheckable(true);
+        action->setChecked(ImageExporter::preset() == item.first);
+        presetGroup->addAction(action);
+        const ImageExporter::Preset preset = item.first;
+        connect(action, &QAction::triggered, this, [preset]() {
+            ImageExporter::setPreset(preset);
+        });
+    }
+    
+    // PNG 调色板：界面截图颜色少，调色板 PNG 通常只有全彩的几分之一
+    exportMenu->addSeparator();
+    QActionGroup* paletteGroup = new QActionGroup(exportMenu);
+    const QPair<ImageExporter::PaletteMode, QString> paletteModes[] = {
+        {ImageExporter::PaletteMode::Off, "全彩 PNG"},
+        {ImageExporter::PaletteMode::Exact, "颜色不超过 256 种时使用调色板（无损）"},
+        {ImageExporter::PaletteMode::Quantize, "量化为 256 色（有损）"}
+    };
+    for (const auto& item : paletteModes) {
+        QAction* action = exportMenu->addAction(item.second);
+        action->setCheckable(true);
+        action->setChecked(ImageExporter::paletteMode() == item.first);
+        paletteGroup->addAction(action);
+        const ImageExporter::PaletteMode mode = item.first;
+        connect(action, &QAction::triggered, this, [mode]() {
+            ImageExporter::setPaletteMode(mode);
+        });
+    }
+    QAction* ditherAction = exportMenu->addAction("量化时抖动");
+    ditherAction->setCheckable(true);
+    ditherAction->setChecked(ImageExporter::isDitherEnabled());
+    connect(ditherAction, &QAction::toggled, this, [](bool checked) {
+        ImageExporter::setDitherEnabled(checked);
+    });
+    
+    // 贴图另存为的尺寸：高分屏截图按 50% 保存即为逻辑像素大小
+    exportMenu->addSeparator();
+    QActionGroup* scaleGroup = new QActionGroup(exportMenu);
+    for (int percent : {100, 75, 50}) {
+        QAction* action = exportMenu->addAction(QString("另存为原尺寸的 %1%").arg(percent));
+        action->setCheckable(true);
+        action->setChecked(ImageExporter::scalePercent() == percent);
+        scaleGroup->addAction(action);
+        connect(action, &QAction::triggered, this, [percent]() {
+            ImageExporter::setScalePercent(percent);
+        });
+    }
+    
+    // 美化：复制和保存时加留白、背景、圆角和投影，截图界面中预览投影
+    exportMenu->addSeparator();
+    QAction* beautifyAction = exportMenu->addAction("美化：留白、圆角与投影");
+    beautifyAction->setCheckable(true);
+    beautifyAction->setChecked(Beautifier::isEnabled());
+    connect(beautifyAction, &QAction::toggled, this, [](bool checked) {
+        Beautifier::setEnabled(checked);
+    });
+    
+    // 自动去边：拖动选区时预览去掉纯色边距后的区域，松开后选区收缩到内容
+    QAction* trimAction = new QAction("选区自动去除四周空白", this);
+    trimAction->setCheckable(true);
+    trimAction->setChecked(AutoTrim::isEnabled());
+    connect(trimAction, &QAction::toggled, this, [](bool checked) {
+        AutoTrim::setEnabled(checked);
+    });
+    
+    // 回放缓冲：截图界面中按 PageUp/PageDown 查看按下快捷键之前的画面
+    // 勾选状态和信号在服务创建后于 startServices() 中设置
+    m_replayAction = new QAction("后台保留最近画面（截图时可回看）", this);
+    m_replayAction->setCheckable(true);
+    
+    m_redactAction = new QAction("截图导出前自动打码敏感信息", this);
+    m_redactAction->setCheckable(true);
+    if (TextRecognizer::isAvailable()) {
+        m_redactAction->setChecked(RedactionRules::isEnabled());
+    } else {
+        m_redactAction->setEnabled(false);
+        m_redactAction->setToolTip("未找到文字识别组件");
+    }
+    connect(m_redactAction, &QAction::toggled, this, [](bool checked) {
+        RedactionRules::setEnabled(checked);
+    });
+    
+    QAction* pinFileAction = new QAction("从文件贴图...", this);
+    connect(pinFileAction, &QAction::triggered, this, &MainWindow::pinFromFileDialog);
+    
+    QAction* pinClipboardAction = new QAction("从剪贴板贴图", this);
+    connect(pinClipboardAction, &QAction::triggered, this, &MainWindow::pinFromClipboard);
+    
+    // 重新编辑：菜单弹出时读取最近会话的缩略图作为图标，只读取文件开头的缩略图块
+    m_editSessionAction = new QAction("重新编辑最近截图", this);
+    connect(m_editSessionAction, &QAction::triggered, this, &MainWindow::editLastSession);
+    connect(m_trayMenu, &QMenu::aboutToShow, this, [this]() {
+        // 预热之前打开菜单时立即创建服务，菜单项的状态才正确
+        startServices();
+        QVector<CaptureHistory::Entry> entries = m_captureManager->history()->entries();
+        QImage thumbnail = entries.isEmpty() ? QImage()
+            : CaptureSession::loadThumbnail(CaptureHistory::sessionPath(entries.first()));
+        m_editSessionAction->setIcon(thumbnail.isNull() ? QIcon() : QIcon(QPixmap::fromImage(thumbnail)));
+    });
+    
+    QAction* openSessionAction = new QAction("打开截图会话...", this);
+    connect(openSessionAction, &QAction::triggered, this, &MainWindow::openSessionDialog);
+    
+    QAction* searchAction = new QAction("搜索截图历史...", this);
+    connect(searchAction, &QAction::triggered, this, &MainWindow::showSearchWindow);
+    
+    QAction* historySizeAction = new QAction("历史记录保留数量...", this);
+    connect(historySizeAction, &QAction::triggered, this, [this]() {
+        CaptureHistory* history = m_captureManager->history();
+        bool ok = false;
+        int count = QInputDialog::getInt(nullptr, "截图历史", "最多保留的截图数量：",
+                                         history->maxEntries(), 1, CaptureHistory::kMaxEntriesLimit, 100, &ok);
+        if (ok) {
+            history->setMaxEntries(count);
+        }
+    });
+    
+    QAction* compareAction = new QAction("对比最近两次截图", this);
+    connect(compareAction, &QAction::triggered, this, &MainWindow::compareLastTwoCaptures);
+    
     QAction* showAction = new QAction("显示主窗口", this);
     connect(showAction, &QAction::triggered, this, &MainWindow::show);
     
@@ -157,11 +705,59 @@ void MainWindow::createTrayMenu()
     connect(quitAction, &QAction::triggered, this, &MainWindow::closeApplication);
     
     m_trayMenu->addAction(captureAction);
+    m_trayMenu->addAction(repeatAction);
+    m_trayMenu->addMenu(m_presetMenu);
+    m_trayMenu->addMenu(delayMenu);
+    m_trayMenu->addAction(intervalAction);
+    m_trayMenu->addAction(m_stopScheduleAction);
+    m_trayMenu->addMenu(exportMenu);
+    m_trayMenu->addAction(trimAction);
+    m_trayMenu->addAction(m_replayAction);
+    m_trayMenu->addAction(m_redactAction);
+    m_trayMenu->addAction(pinFileAction);
+    m_trayMenu->addAction(pinClipboardAction);
+    m_trayMenu->addAction(m_editSessionAction);
+    m_trayMenu->addAction(openSessionAction);
+    m_trayMenu->addAction(searchAction);
+    m_trayMenu->addAction(historySizeAction);
+    m_trayMenu->addAction(compareAction);
     m_trayMenu->addAction(showAction);
     m_trayMenu->addSeparator();
     m_trayMenu->addAction(quitAction);
 }
 
+void MainWindow::rebuildPresetMenu()
+{
+    m_presetMenu->clear();
+    RegionPresets& presets = m_captureManager->presets();
+    
+    for (const QString& name : presets.names()) {
+        QRect region = presets.preset(name);
+        QAction* action = m_presetMenu->addAction(
+            QString("%1  (%2×%3)").arg(name).arg(region.width()).arg(region.height()));
+        connect(action, &QAction::triggered, this, [this, region]() {
+            captureRegion(region);
+        });
+    }
+    if (!presets.names().isEmpty()) {
+        m_presetMenu->addSeparator();
+    }
+    
+    QAction* saveAction = m_presetMenu->addAction("将上次选区保存为预设...");
+    saveAction->setEnabled(!presets.lastRegion().isEmpty());
+    connect(saveAction, &QAction::triggered, this, &MainWindow::saveLastRegionAsPreset);
+    
+    if (!presets.names().isEmpty()) {
+        QMenu* removeMenu = m_presetMenu->addMenu("删除预设");
+        for (const QString& name : presets.names()) {
+            QAction* action = removeMenu->addAction(name);
+            connect(action, &QAction::triggered, this, [this, name]() {
+                m_captureManager->presets().removePreset(name);
+            });
+        }
+    }
+}
+
 void MainWindow::handleTrayActivated(QSystemTrayIcon::ActivationReason reason)
 {
     if (reason == QSystemTrayIcon::Trigger) {
@@ -180,6 +776,16 @@ void MainWindow::closeEvent(QCloseEvent *event)
 }
 
 void MainWindow::createFloatWindow(const QPixmap& pixmap)
+{
+    // 获取当前选区的位置（全局坐标）
+    QRect selectedRect = m_overlay->selectedGlobalRect();
+    m_captureManager->presets().setLastRegion(selectedRect);
+    
+    // 设置贴图窗口的位置为选区位置
+    pinPixmap(pixmap, selectedRect.topLeft());
+}
+
+FloatWindow* MainWindow::pinPixmap(const QPixmap& pixmap, const QPoint& pos)
 {
     FloatWindow* floatWin = new FloatWindow(pixmap);
     
@@ -191,15 +797,87 @@ void MainWindow::createFloatWindow(const QPixmap& pixmap)
         m_floatWindows.removeOne(floatWin);
     });
     
+    // 拖放到贴图上的图片在落点处新建贴图
+    connect(floatWin, &FloatWindow::dropReceived, this, &MainWindow::pinMimeData);
+    
     m_floatWindows.append(floatWin);
     
-    // 获取当前选区的位置
-    QRect selectedRect = QRect(m_overlay->getStartPos(), m_overlay->getEndPos()).normalized();
+    floatWin->move(pos);
+    floatWin->show();
+    return floatWin;
+}
+
+FloatWindow* MainWindow::pinFile(const QString& path, const QPoint& pos)
+{
+    // 大图只解码缩小的预览图，放大时再按图块加载原图
+    ProgressiveImage* source = new ProgressiveImage(path);
+    if (!source->isValid()) {
+        qDebug() << "Failed to load image for pinning:" << path;
+        delete source;
+        return nullptr;
+    }
+    
+    FloatWindow* floatWin = pinPixmap(QPixmap::fromImage(source->preview()), pos);
+    floatWin->setImageSource(source);
+    return floatWin;
+}
+
+void MainWindow::pinMimeData(const QMimeData* mimeData, const QPoint& pos)
+{
+    if (!mimeData) {
+        return;
+    }
     
-    // 设置贴图窗口的位置为选区位置
-    floatWin->move(selectedRect.topLeft());
+    QPoint next = pos;
+    bool pinned = false;
+    for (const QUrl& url : mimeData->urls()) {
+        if (url.isLocalFile() && pinFile(url.toLocalFile(), next)) {
+            next += QPoint(24, 24);
+            pinned = true;
+        }
+    }
+    if (!pinned && mimeData->hasImage()) {
+        QImage image = qvariant_cast<QImage>(mimeData->imageData());
+        if (!image.isNull()) {
+            pinPixmap(QPixmap::fromImage(image), pos);
+        }
+    }
+}
+
+void MainWindow::pinFromClipboard()
+{
+    pinMimeData(QApplication::clipboard()->mimeData(), QCursor::pos());
+}
+
+void MainWindow::pinFromFileDialog()
+{
+    QStringList filters;
+    for (const QByteArray& format : QImageReader::supportedImageFormats()) {
+        filters << "*." + QString::fromLatin1(format);
+    }
+    QStringList files = QFileDialog::getOpenFileNames(
+        nullptr, "选择要贴图的图片", QDir::homePath(),
+        QString("Images (%1)").arg(filters.join(' ')));
     
-    floatWin->show();
+    QPoint next = QCursor::pos();
+    for (const QString& file : files) {
+        if (pinFile(file, next)) {
+            next += QPoint(24, 24);
+        }
+    }
+}
+
+void MainWindow::dragEnterEvent(QDragEnterEvent *event)
+{
+    if (event->mimeData()->hasUrls() || event->mimeData()->hasImage()) {
+        event->acceptProposedAction();
+    }
+}
+
+void MainWindow::dropEvent(QDropEvent *event)
+{
+    pinMimeData(event->mimeData(), mapToGlobal(event->pos()));
+    event->acceptProposedAction();
 }
 
 void MainWindow::closeApplication()
@@ -5,12 +5,17 @@
 #include <QScopedPointer>
 #include <QTimer>
 #include <QClipboard>
+#include <QJsonObject>
 #include <Windows.h>
 #include "../core/capture/capturemanager.h"
 #include "../ui/overlay/overlaywidget.h"
 #include <QSystemTrayIcon>
 #include <QMenu>
 #include "../ui/floatimage/floatwindow.h"
+#include "../core/session/capturesession.h"
+
+class ControlServer;
+class SearchWindow;
 
 class MainWindow : public QMainWindow
 {
@@ -20,22 +25,48 @@ public:
     MainWindow(QWidget *parent = nullptr);
     ~MainWindow();
 
+    // 执行启动请求（来自本进程的命令行或第二次启动的转发）
+    void executeLaunchRequest(const QJsonObject& request);
+
+signals:
+    // 启动后的预热（截图界面、工具栏）完成
+    void warmupFinished();
+
 protected:
     void closeEvent(QCloseEvent *event) override;
+    void dragEnterEvent(QDragEnterEvent *event) override;
+    void dropEvent(QDropEvent *event) override;
 
 private slots:
     void startCapture();
-    void handleCapture(const QPixmap &pixmap);
+    void handleCapture(const QImage &image, const CaptureSession& session = CaptureSession());
     void onCaptureFinished();
     void createFloatWindow(const QPixmap& pixmap);
     void closeApplication();
+    void repeatLastRegion();
+    void captureRegion(const QRect& globalRect);
+    void saveLastRegionAsPreset();
+    void startDelayedCapture(int seconds);
+    void startIntervalCapture();
+    void compareWithPin(const QImage& selection, qreal devicePixelRatio);
+    void copyDecodedCodes(const QStringList& payloads);
+    void compareLastTwoCaptures();
+    void pinFromClipboard();
+    void pinFromFileDialog();
+    void editLastSession();
+    void openSessionDialog();
+    void showSearchWindow();
 
 private:
     // 使用智能指针管理资源
     QScopedPointer<CaptureManager> m_captureManager;
-    QScopedPointer<OverlayWidget> m_overlay;
+    QScopedPointer<OverlayWidget> m_overlay;  // 首次使用或启动预热时创建
+    OverlayWidget* overlay();
     void setupHotkeys();
 
+    // 托盘可用后再预热截图界面
+    static constexpr int kWarmupDelayMs = 300;
+
     // 全局快捷键相关
     static HHOOK keyboardHook;
     static MainWindow* instance;
@@ -43,11 +74,35 @@ private:
 
     QSystemTrayIcon* m_trayIcon;
     QMenu* m_trayMenu;
+    QMenu* m_presetMenu{nullptr};
+    QAction* m_stopScheduleAction{nullptr};
+    QAction* m_replayAction{nullptr};
+    QAction* m_redactAction{nullptr};
+    
+    // 截图管理器的后台服务（历史、扫描、回放、索引、调度）不在启动路径上创建：
+    // 托盘可用后随预热创建，或在更早需要时创建，并连接与界面相关的信号
+    bool m_servicesStarted{false};
+    void startServices();
+    // 截图前主窗口是否可见，截图结束后只恢复原来可见的窗口
+    bool m_restoreWindow{false};
     
     void setupTrayIcon();
     void createTrayMenu();
+    void rebuildPresetMenu();
     void handleTrayActivated(QSystemTrayIcon::ActivationReason reason);
+    FloatWindow* pinPixmap(const QPixmap& pixmap, const QPoint& pos);
+    FloatWindow* pinFile(const QString& path, const QPoint& pos);
+    // 文件链接逐个贴出，否则使用其中的图片数据
+    void pinMimeData(const QMimeData* mimeData, const QPoint& pos);
+    void editSession(const CaptureSession& session);
+    
+    // 正在重新编辑的会话：帧不变时保存直接复用其中已压缩的像素
+    CaptureSession m_session;
+    int m_sessionLoad{0};                     // 每次打开会话递增，丢弃过期的解压结果
+    QAction* m_editSessionAction{nullptr};
 
+    SearchWindow* m_searchWindow{nullptr};    // 首次打开时创建
+    ControlServer* m_controlServer{nullptr};  // 本地自动化控制接口
     QList<FloatWindow*> m_floatWindows;  // 管理所有贴图窗口
     bool m_isClosing{false};  // 添加标志位
 };
@@ -0,0 +1,95 @@
+#include "singleinstance.h"
+#include <QCoreApplication>
+#include <QLocalSocket>
+#include <QJsonDocument>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QThread>
+#include <QDir>
+#include <QDebug>
+#include "../core/ipc/controlserver.h"
+
+SingleInstance::SingleInstance() = default;
+
+SingleInstance::~SingleInstance() = default;
+
+QString SingleInstance::lockPath()
+{
+    return QDir(QDir::tempPath()).filePath(ControlServer::serverName() + ".lock");
+}
+
+QJsonObject SingleInstance::requestFromArguments(const QStringList &arguments)
+{
+    const QStringList args = arguments.mid(1);
+    for (int i = 0; i < args.size(); ++i) {
+        if (args[i] == "--startup-report") {
+            ++i;
+            continue;
+        }
+        if (args[i] == "--capture") {
+            return QJsonObject{{"cmd", "capture.interactive"}};
+        }
+        QString file;
+        if (args[i] == "--pin" && i + 1 < args.size()) {
+            file = args[i + 1];
+        } else if (!args[i].startsWith("--") && QFileInfo::exists(args[i])) {
+            file = args[i];
+        }
+        if (!file.isEmpty()) {
+            // 常驻进程的工作目录与启动器不同，必须传绝对路径
+            return QJsonObject{{"cmd", "pin.file"}, {"path", QFileInfo(file).absoluteFilePath()}};
+        }
+    }
+    return QJsonObject{{"cmd", "activate"}};
+}
+
+bool SingleInstance::sendRequest(const QJsonObject &request)
+{
+    QLocalSocket socket;
+    socket.connectToServer(ControlServer::serverName());
+    if (!socket.waitForConnected(200)) {
+        return false;
+    }
+    socket.write(QJsonDocument(request).toJson(QJsonDocument::Compact) + "\n");
+    if (!socket.waitForBytesWritten(500)) {
+        return false;
+    }
+    // 等待应答，确认请求已被常驻进程接收
+    while (!socket.canReadLine()) {
+        if (!socket.waitForReadyRead(1000)) {
+            return false;
+        }
+    }
+    socket.readLine();
+    return true;
+}
+
+bool SingleInstance::forwardToRunning(int argc, char *argv[])
+{
+    // 只创建 QCoreApplication，转发路径上不加载任何界面模块
+    QCoreApplication app(argc, argv);
+
+    // 锁文件决定谁是常驻实例；持锁进程异常退出后锁会被判定为过期
+    m_lock = std::make_unique<QLockFile>(lockPath());
+    m_lock->setStaleLockTime(0);
+    if (m_lock->tryLock(0)) {
+        return false;
+    }
+
+    const QJsonObject request = requestFromArguments(app.arguments());
+    QElapsedTimer timer;
+    timer.start();
+    while (timer.elapsed() < kHandoffTimeoutMs) {
+        if (sendRequest(request)) {
+            return true;
+        }
+        // 持锁进程已退出，由当前进程接替
+        if (m_lock->tryLock(0)) {
+            return false;
+        }
+        QThread::msleep(20);
+    }
+
+    qDebug() << "Running instance did not respond, starting a new one";
+    return false;
+}
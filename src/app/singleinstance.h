@@ -0,0 +1,41 @@
+#ifndef SINGLEINSTANCE_H
+#define SINGLEINSTANCE_H
+
+#include <QJsonObject>
+#include <QStringList>
+#include <QLockFile>
+#include <memory>
+
+// 单实例：第二次启动时把命令行请求转交给常驻进程后立即退出，
+// 避免重复创建 QApplication、托盘图标和全局键盘钩子
+//
+// 支持的启动参数：
+//   SCD                 激活已运行的实例
+//   SCD --capture       立即开始交互截图
+//   SCD --pin <file>    将图片文件贴到屏幕上（也可直接传入文件路径）
+//   SCD --startup-report <file>
+//                       冷启动完成预热后写出各阶段耗时并退出（需无常驻实例）
+class SingleInstance
+{
+public:
+    SingleInstance();
+    ~SingleInstance();
+
+    // 已有实例在运行时转发请求并返回 true，调用方应直接退出；
+    // 返回 false 时当前进程成为常驻实例，并在整个生命周期内持有锁
+    bool forwardToRunning(int argc, char *argv[]);
+
+    // 将启动参数转换为控制接口请求（文件路径会转换为绝对路径）
+    static QJsonObject requestFromArguments(const QStringList &arguments);
+
+private:
+    // 常驻实例可能仍在启动，最多等待这么久让它开始监听
+    static constexpr int kHandoffTimeoutMs = 3000;
+
+    std::unique_ptr<QLockFile> m_lock;
+
+    static QString lockPath();
+    static bool sendRequest(const QJsonObject &request);
+};
+
+#endif // SINGLEINSTANCE_H
@@ -0,0 +1,219 @@
+#include "codescanner.h"
+#include "../../utils/parallelutils.h"
+#include "../../utils/simdutils.h"
+#include <algorithm>
+#include <cstring>
+#ifdef SCD_WITH_ZXING
+#include <ZXing/ReadBarcode.h>
+#endif
+
+namespace {
+
+#ifdef SCD_WITH_ZXING
+
+constexpr int kMaxLevels = 4;
+constexpr int kMinLevelEdge = 160;      // 金字塔最小一层的短边
+constexpr int kTileEdge = 1536;         // 原分辨率层的图块边长
+constexpr int kTileOverlap = 256;       // 相邻图块的重叠；更大的码在缩小一半的层上能完整找到
+constexpr int kRowChunk = 64;
+
+// 转为灰度（0.30R + 0.59G + 0.11B），每次处理 4 个像素
+void toGray(const QRgb* source, uchar* target, int width)
+{
+    int x = 0;
+#ifdef SCD_HAVE_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i coeffs = _mm_set_epi16(0, 77, 150, 29, 0, 77, 150, 29);
+    const __m128i rounding = _mm_set1_epi32(128);
+    for (; x + 4 <= width; x += 4) {
+        const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + x));
+        // [b*29 + g*150, r*77] 两两相加得到每个像素的加权和
+        __m128i low = _mm_madd_epi16(_mm_unpacklo_epi8(pixels, zero), coeffs);
+        __m128i high = _mm_madd_epi16(_mm_unpackhi_epi8(pixels, zero), coeffs);
+        low = _mm_add_epi32(low, _mm_srli_epi64(low, 32));
+        high = _mm_add_epi32(high, _mm_srli_epi64(high, 32));
+        __m128i sums = _mm_unpacklo_epi64(_mm_shuffle_epi32(low, _MM_SHUFFLE(3, 3, 2, 0)),
+                                          _mm_shuffle_epi32(high, _MM_SHUFFLE(3, 3, 2, 0)));
+        sums = _mm_srli_epi32(_mm_add_epi32(sums, rounding), 8);
+        const __m128i packed = _mm_packs_epi32(sums, sums);
+        const int gray = _mm_cvtsi128_si32(_mm_packus_epi16(packed, packed));
+        std::memcpy(target + x, &gray, 4);
+    }
+#endif
+    for (; x < width; ++x) {
+        const QRgb pixel = source[x];
+        target[x] = uchar((qRed(pixel) * 77 + qGreen(pixel) * 150 + qBlue(pixel) * 29 + 128) >> 8);
+    }
+}
+
+// 2×2 平均缩小一行：row0、row1 为相邻两行源像素，target 宽度为 width
+void halveRow(const uchar* row0, const uchar* row1, uchar* target, int width)
+{
+    int x = 0;
+#ifdef SCD_HAVE_SSE2
+    const __m128i lowBytes = _mm_set1_epi16(0x00ff);
+    for (; x + 16 <= width; x += 16) {
+        const __m128i first = _mm_avg_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + 2 * x)),
+                                           _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + 2 * x)));
+        const __m128i second = _mm_avg_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + 2 * x + 16)),
+                                            _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + 2 * x + 16)));
+        // 每 16 位中低字节为偶数列、高字节为奇数列
+        const __m128i a = _mm_avg_epu16(_mm_and_si128(first, lowBytes), _mm_srli_epi16(first, 8));
+        const __m128i b = _mm_avg_epu16(_mm_and_si128(second, lowBytes), _mm_srli_epi16(second, 8));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(target + x), _mm_packus_epi16(a, b));
+    }
+#endif
+    for (; x < width; ++x) {
+        target[x] = uchar((row0[2 * x] + row0[2 * x + 1] + row1[2 * x] + row1[2 * x + 1] + 2) >> 2);
+    }
+}
+
+QImage grayLevel(const QImage& image)
+{
+    const QImage source = image.format() == QImage::Format_RGB32 || image.format() == QImage::Format_ARGB32
+                              || image.format() == QImage::Format_ARGB32_Premultiplied
+                          ? image : image.convertToFormat(QImage::Format_RGB32);
+    QImage gray(source.size(), QImage::Format_Grayscale8);
+    const uchar* sourceBits = source.constBits();
+    const qsizetype sourceStride = source.bytesPerLine();
+    uchar* targetBits = gray.bits();
+    const qsizetype targetStride = gray.bytesPerLine();
+    const int width = source.width();
+    ParallelUtils::forRange(source.height(), kRowChunk, [=](int begin, int end) {
+        for (int y = begin; y < end; ++y) {
+            toGray(reinterpret_cast<const QRgb*>(sourceBits + y * sourceStride), targetBits + y * targetStride, width);
+        }
+    });
+    return gray;
+}
+
+QImage halve(const QImage& level)
+{
+    QImage result(level.width() / 2, level.height() / 2, QImage::Format_Grayscale8);
+    const uchar* sourceBits = level.constBits();
+    const qsizetype sourceStride = level.bytesPerLine();
+    uchar* targetBits = result.bits();
+    const qsizetype targetStride = result.bytesPerLine();
+    const int width = result.width();
+    ParallelUtils::forRange(result.height(), kRowChunk, [=](int begin, int end) {
+        for (int y = begin; y < end; ++y) {
+            const uchar* row0 = sourceBits + 2 * y * sourceStride;
+            halveRow(row0, row0 + sourceStride, targetBits + y * targetStride, width);
+        }
+    });
+    return result;
+}
+
+struct Job {
+    int level;
+    QRect rect;     // 该层中的区域
+};
+
+QVector<CodeScanner::Result> decode(const QImage& level, const Job& job)
+{
+    ZXing::ReaderOptions options;
+    options.setFormats(ZXing::BarcodeFormat::QRCode | ZXing::BarcodeFormat::DataMatrix
+                       | ZXing::BarcodeFormat::LinearCodes);
+    options.setTryHarder(false);
+    options.setTryRotate(true);
+    options.setTryInvert(true);      // 深色主题中的反色二维码
+    options.setTryDownscale(false);  // 已经自己建立了金字塔
+
+    const ZXing::ImageView view(level.constScanLine(job.rect.y()) + job.rect.x(), job.rect.width(),
+                                job.rect.height(), ZXing::ImageFormat::Lum, int(level.bytesPerLine()));
+    const int scale = 1 << job.level;
+    QVector<CodeScanner::Result> results;
+    for (const ZXing::Barcode& barcode : ZXing::ReadBarcodes(view, options)) {
+        if (!barcode.isValid()) {
+            continue;
+        }
+        const ZXing::Position& position = barcode.position();
+        QPolygon polygon;
+        for (const ZXing::PointI& point : {position.topLeft(), position.topRight(),
+                                           position.bottomRight(), position.bottomLeft()}) {
+            polygon.append((QPoint(point.x, point.y) + job.rect.topLeft()) * scale);
+        }
+        results.append({QString::fromStdString(barcode.text()),
+                        QString::fromStdString(std::string(ZXing::ToString(barcode.format()))), polygon});
+    }
+    return results;
+}
+
+#endif // SCD_WITH_ZXING
+
+} // namespace
+
+bool CodeScanner::isAvailable()
+{
+#ifdef SCD_WITH_ZXING
+    return true;
+#else
+    return false;
+#endif
+}
+
+QVector<CodeScanner::Result> CodeScanner::scan(const QImage& image)
+{
+    QVector<Result> results;
+#ifdef SCD_WITH_ZXING
+    if (image.isNull()) {
+        return results;
+    }
+
+    QVector<QImage> levels{grayLevel(image)};
+    while (levels.size() < kMaxLevels && qMin(levels.last().width(), levels.last().height()) / 2 >= kMinLevelEdge) {
+        levels.append(halve(levels.last()));
+    }
+
+    // 原分辨率层切块，其余各层整体作为一个任务
+    QVector<Job> jobs;
+    const QRect full = levels.first().rect();
+    const int step = kTileEdge - kTileOverlap;
+    for (int y = 0; y < full.height(); y += step) {
+        for (int x = 0; x < full.width(); x += step) {
+            jobs.append({0, QRect(x, y, kTileEdge, kTileEdge).intersected(full)});
+            if (x + kTileEdge >= full.width()) {
+                break;
+            }
+        }
+        if (y + kTileEdge >= full.height()) {
+            break;
+        }
+    }
+    for (int level = 1; level < levels.size(); ++level) {
+        jobs.append({level, levels[level].rect()});
+    }
+
+    QVector<QVector<Result>> found(jobs.size());
+    QVector<Result>* foundData = found.data();
+    const QImage* levelData = levels.constData();
+    const Job* jobData = jobs.constData();
+    ParallelUtils::forRange(jobs.size(), 1, [=](int begin, int end) {
+        for (int i = begin; i < end; ++i) {
+            foundData[i] = decode(levelData[jobData[i].level], jobData[i]);
+        }
+    });
+
+    // 同一个码可能在重叠的图块和多个层上都被找到：内容相同且位置重叠的只保留第一个（分辨率最高的）
+    for (const QVector<Result>& jobResults : found) {
+        for (const Result& result : jobResults) {
+            const QRect bounds = result.position.boundingRect();
+            const bool duplicate = std::any_of(results.cbegin(), results.cend(), [&](const Result& existing) {
+                return existing.text == result.text && existing.format == result.format
+                    && existing.position.boundingRect().intersects(bounds);
+            });
+            if (!duplicate) {
+                results.append(result);
+            }
+        }
+    }
+    std::sort(results.begin(), results.end(), [](const Result& a, const Result& b) {
+        const QRect left = a.position.boundingRect();
+        const QRect right = b.position.boundingRect();
+        return left.top() != right.top() ? left.top() < right.top() : left.left() < right.left();
+    });
+#else
+    Q_UNUSED(image);
+#endif
+    return results;
+}
@@ -0,0 +1,29 @@
+#ifndef CODESCANNER_H
+#define CODESCANNER_H
+
+#include <QImage>
+#include <QPolygon>
+#include <QString>
+#include <QVector>
+
+// 二维码与条码识别：QR Code、DataMatrix 和常见一维码，解码由 ZXing-cpp 完成（SCD_WITH_ZXING）
+//
+// 截图先转为灰度，再逐层缩小一半建立金字塔：大码在缩小的层上就能找到，小码只在原分辨率上可辨。
+// 原分辨率层切成相互重叠的图块，所有图块和各层作为独立任务并行做二值化和定位图案搜索，
+// 结果映射回原图坐标后去重
+class CodeScanner
+{
+public:
+    struct Result {
+        QString text;
+        QString format;     // 例如 "QRCode"、"EAN-13"
+        QPolygon position;  // 相对输入图片的四个角
+    };
+
+    // 编译时未启用 ZXing 时返回 false，scan 始终返回空列表
+    static bool isAvailable();
+    // 可在任意线程调用；结果按从上到下、从左到右排列
+    static QVector<Result> scan(const QImage& image);
+};
+
+#endif // CODESCANNER_H
@@ -0,0 +1,615 @@
+#include "batchpipeline.h"
+#include <QAtomicInteger>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QImageReader>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QQueue>
+#include <QSet>
+#include <QThread>
+#include <QWaitCondition>
+#include <cstring>
+#include <memory>
+
+// 像素缓冲池：编码阶段用完的图片放回池中，解码与裁剪时取同尺寸同格式的一张覆盖写入。
+// 取出的图片只被一个阶段持有（引用计数为 1），原地修改不会触发隐式共享的深拷贝
+class BatchImagePool
+{
+public:
+    QImage acquire(const QSize& size, QImage::Format format)
+    {
+        {
+            QMutexLocker locker(&m_mutex);
+            for (int i = m_images.size() - 1; i >= 0; --i) {
+                if (m_images[i].size() == size && m_images[i].format() == format) {
+                    QImage image = std::move(m_images[i]);
+                    m_images.removeAt(i);
+                    m_bytes -= image.sizeInBytes();
+                    return image;
+                }
+            }
+        }
+        return QImage(size, format);
+    }
+
+    void release(QImage& image)
+    {
+        // 仍被其他地方引用的图片不能覆盖写入
+        if (image.isNull() || !image.isDetached()) {
+            image = QImage();
+            return;
+        }
+        QMutexLocker locker(&m_mutex);
+        m_bytes += image.sizeInBytes();
+        m_images.append(std::move(image));
+        image = QImage();
+        while (m_bytes > kMaxPooledBytes) {
+            m_bytes -= m_images.first().sizeInBytes();
+            m_images.removeFirst();
+        }
+    }
+
+private:
+    static constexpr qint64 kMaxPooledBytes = qint64(512) << 20;   // 池中最多保留的像素内存
+
+    QMutex m_mutex;
+    QVector<QImage> m_images;
+    qint64 m_bytes{0};
+};
+
+namespace {
+
+// 有界阻塞队列：满时 push 等待，空时 pop 等待；close 之后 push 失败，pop 取完剩余项后返回 false
+template <typename T>
+class BoundedQueue
+{
+public:
+    explicit BoundedQueue(int capacity) : m_capacity(qMax(1, capacity)) {}
+
+    bool push(T item)
+    {
+        QMutexLocker locker(&m_mutex);
+        while (m_items.size() >= m_capacity && !m_closed) {
+            m_notFull.wait(&m_mutex);
+        }
+        if (m_closed) {
+            return false;
+        }
+        m_items.enqueue(std::move(item));
+        m_notEmpty.wakeOne();
+        return true;
+    }
+
+    bool pop(T& item)
+    {
+        QMutexLocker locker(&m_mutex);
+        while (m_items.isEmpty() && !m_closed) {
+            m_notEmpty.wait(&m_mutex);
+        }
+        if (m_items.isEmpty()) {
+            return false;
+        }
+        item = m_items.dequeue();
+        m_notFull.wakeOne();
+        return true;
+    }
+
+    void close()
+    {
+        QMutexLocker locker(&m_mutex);
+        m_closed = true;
+        m_notFull.wakeAll();
+        m_notEmpty.wakeAll();
+    }
+
+private:
+    const int m_capacity;
+    QQueue<T> m_items;
+    QMutex m_mutex;
+    QWaitCondition m_notFull;
+    QWaitCondition m_notEmpty;
+    bool m_closed{false};
+};
+
+struct WorkItem {
+    int index = -1;
+    QImage image;
+};
+
+struct SharedState {
+    QStringList files;
+    QStringList outputs;
+    QAtomicInt nextFile{0};
+    QAtomicInt succeeded{0};
+    QAtomicInt failed{0};
+    QAtomicInteger<qint64> inputBytes{0};
+    QAtomicInteger<qint64> outputBytes{0};
+    QAtomicInteger<qint64> pixels{0};
+    QAtomicInteger<qint64> decodeNs{0};
+    QAtomicInteger<qint64> processNs{0};
+    QAtomicInteger<qint64> encodeNs{0};
+    BatchImagePool pool;
+};
+
+// 解码到池中的缓冲区：QImageReader 在目标尺寸和格式与文件一致时直接复用其内存
+QImage decode(const QString& path, BatchImagePool& pool)
+{
+    if (ImageExporter::formatForPath(path) == ImageExporter::Format::Qoi) {
+        return ImageExporter::load(path);
+    }
+    QImageReader reader(path);
+    const QSize size = reader.size();
+    const QImage::Format format = reader.imageFormat();
+    QImage image;
+    if (size.isValid() && format != QImage::Format_Invalid) {
+        image = pool.acquire(size, format);
+    }
+    if (!reader.read(&image)) {
+        return QImage();
+    }
+    return image;
+}
+
+// 复制 image 中的 rect 到池中的缓冲区，逐行 memcpy
+QImage crop(const QImage& image, const QRect& rect, BatchImagePool& pool)
+{
+    if (image.depth() < 8) {
+        return image.copy(rect);
+    }
+    QImage result = pool.acquire(rect.size(), image.format());
+    result.setColorTable(image.colorTable());
+    const int bytesPerPixel = image.depth() / 8;
+    const size_t rowBytes = size_t(rect.width()) * bytesPerPixel;
+    for (int y = 0; y < rect.height(); ++y) {
+        std::memcpy(result.scanLine(y), image.constScanLine(rect.y() + y) + rect.x() * bytesPerPixel, rowBytes);
+    }
+    return result;
+}
+
+QSize scaledSize(const BatchPipeline::Step& step, const QSize& size)
+{
+    if (step.factor > 0) {
+        return QSize(qMax(1, qRound(size.width() * step.factor)), qMax(1, qRound(size.height() * step.factor)));
+    }
+    if (step.size.width() > 0 && step.size.height() > 0) {
+        return step.size;
+    }
+    if (step.size.width() > 0) {
+        return QSize(step.size.width(), qMax(1, qRound(qreal(size.height()) * step.size.width() / size.width())));
+    }
+    return QSize(qMax(1, qRound(qreal(size.width()) * step.size.height() / size.height())), step.size.height());
+}
+
+bool parseInts(const QStringList& parts, int count, int* values)
+{
+    if (parts.size() < count) {
+        return false;
+    }
+    for (int i = 0; i < count; ++i) {
+        bool ok = false;
+        values[i] = parts[i].trimmed().toInt(&ok);
+        if (!ok) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 标注的可选颜色与粗细，例如 ",#ff0000,3"
+bool parseStyle(const QStringList& parts, int from, CaptureManager::Annotation* annotation)
+{
+    annotation->color = Qt::red;
+    annotation->thickness = 2;
+    if (parts.size() > from) {
+        annotation->color = QColor(parts[from].trimmed());
+        if (!annotation->color.isValid()) {
+            return false;
+        }
+    }
+    if (parts.size() > from + 1) {
+        bool ok = false;
+        annotation->thickness = parts[from + 1].trimmed().toInt(&ok);
+        if (!ok || annotation->thickness <= 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 比较路径用的键：Windows 上文件名不区分大小写
+QString pathKey(const QString& path)
+{
+    const QString absolute = QDir::cleanPath(QFileInfo(path).absoluteFilePath());
+#ifdef Q_OS_WIN
+    return absolute.toLower();
+#else
+    return absolute;
+#endif
+}
+
+} // namespace
+
+BatchPipeline::BatchPipeline(const QVector<Step>& steps, const Options& options)
+    : m_steps(steps)
+    , m_options(options)
+{
+}
+
+bool BatchPipeline::process(QImage& image, BatchImagePool& pool, QString* error) const
+{
+    for (const Step& step : m_steps) {
+        switch (step.type) {
+            case Step::Type::Crop: {
+                const QRect area = step.rect.intersected(image.rect());
+                if (area.isEmpty()) {
+                    *error = QString("crop %1,%2,%3,%4 is outside the %5x%6 image")
+                                 .arg(step.rect.x()).arg(step.rect.y()).arg(step.rect.width()).arg(step.rect.height())
+                                 .arg(image.width()).arg(image.height());
+                    return false;
+                }
+                if (area != image.rect()) {
+                    QImage cropped = crop(image, area, pool);
+                    pool.release(image);
+                    image = std::move(cropped);
+                }
+                break;
+            }
+            case Step::Type::Scale: {
+                const QSize size = scaledSize(step, image.size());
+                if (size != image.size()) {
+                    QImage scaled = Resampler::scale(image, size, step.filter);
+                    pool.release(image);
+                    image = std::move(scaled);
+                }
+                break;
+            }
+            case Step::Type::Pixelate:
+            case Step::Type::Annotate: {
+                // 标注在 32 位格式上绘制，原地转换可以复用原缓冲区
+                if (image.format() != QImage::Format_RGB32 && image.format() != QImage::Format_ARGB32_Premultiplied) {
+                    image.convertTo(image.hasAlphaChannel() ? QImage::Format_ARGB32_Premultiplied
+                                                            : QImage::Format_RGB32);
+                }
+                CaptureManager::Annotation annotation = step.annotation;
+                if (step.type == Step::Type::Pixelate) {
+                    const QRect area = step.rect.intersected(image.rect());
+                    if (area.isEmpty()) {
+                        break;
+                    }
+                    annotation.type = CaptureManager::AnnotationType::Pixelate;
+                    annotation.rect = area;
+                    annotation.mosaic = CaptureManager::pixelate(image.copy(area), step.blockSize);
+                }
+                QPainter painter(&image);
+                painter.setRenderHint(QPainter::Antialiasing);
+                CaptureManager::drawAnnotation(painter, annotation);
+                break;
+            }
+        }
+    }
+    return true;
+}
+
+BatchPipeline::Stats BatchPipeline::run(const QStringList& files, const Progress& progress) const
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    const int threads = m_options.threads > 0 ? m_options.threads : qMax(1, QThread::idealThreadCount());
+    SharedState state;
+    state.files = files;
+    QString planError;
+    if (!outputPaths(files, &state.outputs, &planError)) {
+        // 输出文件名冲突或会覆盖输入时一张都不处理
+        Stats stats;
+        for (const QString& file : files) {
+            ++stats.failed;
+            if (progress) {
+                progress(file, planError);
+            }
+        }
+        stats.elapsedMs = timer.elapsed();
+        return stats;
+    }
+    // 每个阶段的队列容量为线程数的两倍：足够让下游不空等，又不至于积压过多解码后的图片
+    BoundedQueue<WorkItem> decoded(2 * threads);
+    BoundedQueue<WorkItem> processed(2 * threads);
+    QAtomicInt decodersLeft(threads);
+    QAtomicInt processorsLeft(threads);
+
+    auto report = [&](int index, const QString& error) {
+        if (error.isEmpty()) {
+            state.succeeded.fetchAndAddRelaxed(1);
+        } else {
+            state.failed.fetchAndAddRelaxed(1);
+        }
+        if (progress) {
+            progress(state.files.at(index), error);
+        }
+    };
+
+    auto decodeWorker = [&]() {
+        forever {
+            const int index = state.nextFile.fetchAndAddRelaxed(1);
+            if (index >= state.files.size()) {
+                break;
+            }
+            QElapsedTimer stage;
+            stage.start();
+            const QString& path = state.files.at(index);
+            WorkItem item{index, decode(path, state.pool)};
+            state.inputBytes.fetchAndAddRelaxed(QFileInfo(path).size());
+            state.decodeNs.fetchAndAddRelaxed(stage.nsecsElapsed());
+            if (item.image.isNull()) {
+                report(index, "cannot decode");
+                continue;
+            }
+            if (!decoded.push(std::move(item))) {
+                break;
+            }
+        }
+        if (decodersLeft.fetchAndAddOrdered(-1) == 1) {
+            decoded.close();
+        }
+    };
+
+    auto processWorker = [&]() {
+        WorkItem item;
+        while (decoded.pop(item)) {
+            QElapsedTimer stage;
+            stage.start();
+            QString error;
+            const bool ok = process(item.image, state.pool, &error);
+            state.processNs.fetchAndAddRelaxed(stage.nsecsElapsed());
+            if (!ok) {
+                state.pool.release(item.image);
+                report(item.index, error);
+                continue;
+            }
+            processed.push(std::move(item));
+        }
+        if (processorsLeft.fetchAndAddOrdered(-1) == 1) {
+            processed.close();
+        }
+    };
+
+    auto encodeWorker = [&]() {
+        WorkItem item;
+        while (processed.pop(item)) {
+            QElapsedTimer stage;
+            stage.start();
+            const QString& path = state.outputs.at(item.index);
+            const bool ok = ImageExporter::save(item.image, path, m_options.preset, m_options.palette, m_options.dither);
+            state.encodeNs.fetchAndAddRelaxed(stage.nsecsElapsed());
+            if (ok) {
+                state.outputBytes.fetchAndAddRelaxed(QFileInfo(path).size());
+                state.pixels.fetchAndAddRelaxed(qint64(item.image.width()) * item.image.height());
+            }
+            state.pool.release(item.image);
+            report(item.index, ok ? QString() : QString("cannot write %1").arg(path));
+        }
+    };
+
+    QVector<QThread*> workers;
+    for (int i = 0; i < threads; ++i) {
+        workers.append(QThread::create(decodeWorker));
+        workers.append(QThread::create(processWorker));
+        workers.append(QThread::create(encodeWorker));
+    }
+    for (QThread* worker : workers) {
+        worker->setObjectName("BatchPipeline");
+        worker->start();
+    }
+    for (QThread* worker : workers) {
+        worker->wait();
+        delete worker;
+    }
+
+    Stats stats;
+    stats.succeeded = state.succeeded.loadRelaxed();
+    stats.failed = state.failed.loadRelaxed();
+    stats.elapsedMs = timer.elapsed();
+    stats.inputBytes = state.inputBytes.loadRelaxed();
+    stats.outputBytes = state.outputBytes.loadRelaxed();
+    stats.pixels = state.pixels.loadRelaxed();
+    stats.decodeMs = state.decodeNs.loadRelaxed() / 1000000;
+    stats.processMs = state.processNs.loadRelaxed() / 1000000;
+    stats.encodeMs = state.encodeNs.loadRelaxed() / 1000000;
+    return stats;
+}
+
+bool BatchPipeline::outputPaths(const QStringList& files, QStringList* paths, QString* error) const
+{
+    // 输出名默认取输入的文件名（去掉扩展名）。不同目录下的同名文件、同一目录下只有扩展名不同的文件
+    // 会得到相同的输出名：按输入顺序第一个保留原名，之后的依次加上原扩展名和序号，
+    // 否则多个编码线程会同时写同一个文件，后写的覆盖先写的
+    const QDir directory(m_options.outputDirectory);
+    QSet<QString> inputs;
+    for (const QString& file : files) {
+        inputs.insert(pathKey(file));
+    }
+
+    QSet<QString> used;
+    paths->clear();
+    for (const QString& file : files) {
+        const QFileInfo info(file);
+        QString path = directory.filePath(info.completeBaseName() + "." + m_options.suffix);
+        if (used.contains(pathKey(path))) {
+            const QString base = info.completeBaseName() + "_" + info.suffix();
+            path = directory.filePath(base + "." + m_options.suffix);
+            for (int n = 2; used.contains(pathKey(path)); ++n) {
+                path = directory.filePath(QString("%1_%2.%3").arg(base).arg(n).arg(m_options.suffix));
+            }
+        }
+        // 输出目录与输入目录相同且格式一致时会覆盖尚未读取的输入
+        if (inputs.contains(pathKey(path))) {
+            *error = QString("output %1 would overwrite an input; choose another --out directory").arg(path);
+            return false;
+        }
+        used.insert(pathKey(path));
+        paths->append(path);
+    }
+    return true;
+}
+
+bool BatchPipeline::isStepOption(const QString& option)
+{
+    return option == "--crop" || option == "--scale" || option == "--pixelate"
+        || option == "--rect" || option == "--arrow" || option == "--text";
+}
+
+bool BatchPipeline::parseStep(const QString& option, const QString& value, Step* step, QString* error)
+{
+    const QStringList parts = value.split(',');
+    int v[4] = {0, 0, 0, 0};
+    *step = Step();
+    step->annotation.filled = false;
+
+    if (option == "--crop") {
+        // x,y,w,h
+        if (!parseInts(parts, 4, v) || parts.size() != 4 || v[2] <= 0 || v[3] <= 0) {
+            *error = "--crop expects x,y,width,height";
+            return false;
+        }
+        step->type = Step::Type::Crop;
+        step->rect = QRect(v[0], v[1], v[2], v[3]);
+        return true;
+    }
+    if (option == "--scale") {
+        // 50%、0.5、1280x720、1280x（按比例）、x720（按比例），可加 ,box / ,lanczos3 / ,mitchell
+        step->type = Step::Type::Scale;
+        const QString spec = parts.first();
+        if (parts.size() > 2) {
+            *error = "--scale expects SIZE[,filter]";
+            return false;
+        }
+        if (parts.size() == 2) {
+            const QString filter = parts[1].trimmed().toLower();
+            if (filter == Resampler::filterName(Resampler::Filter::Box)) {
+                step->filter = Resampler::Filter::Box;
+            } else if (filter == Resampler::filterName(Resampler::Filter::Mitchell)) {
+                step->filter = Resampler::Filter::Mitchell;
+            } else if (filter != Resampler::filterName(Resampler::Filter::Lanczos3)) {
+                *error = QString("unknown filter %1").arg(parts[1]);
+                return false;
+            }
+        }
+        bool ok = false;
+        if (spec.endsWith('%')) {
+            step->factor = spec.chopped(1).toDouble(&ok) / 100.0;
+            ok = ok && step->factor > 0;
+        } else if (spec.contains('x')) {
+            const QStringList size = spec.split('x');
+            int width = 0;
+            int height = 0;
+            bool widthOk = size[0].isEmpty();
+            bool heightOk = size.size() == 2 && size[1].isEmpty();
+            if (!widthOk) {
+                width = size[0].toInt(&widthOk);
+            }
+            if (size.size() == 2 && !heightOk) {
+                height = size[1].toInt(&heightOk);
+            }
+            ok = widthOk && heightOk && width >= 0 && height >= 0 && (width > 0 || height > 0);
+            step->size = QSize(width, height);
+        } else {
+            step->factor = spec.toDouble(&ok);
+            ok = ok && step->factor > 0;
+        }
+        if (!ok) {
+            *error = "--scale expects a percentage, a factor or WIDTHxHEIGHT";
+            return false;
+        }
+        return true;
+    }
+    if (option == "--pixelate") {
+        // x,y,w,h[,block]
+        if (!parseInts(parts, 4, v) || parts.size() > 5 || v[2] <= 0 || v[3] <= 0) {
+            *error = "--pixelate expects x,y,width,height[,block]";
+            return false;
+        }
+        step->type = Step::Type::Pixelate;
+        step->rect = QRect(v[0], v[1], v[2], v[3]);
+        if (parts.size() == 5) {
+            bool ok = false;
+            step->blockSize = parts[4].toInt(&ok);
+            if (!ok || step->blockSize <= 0) {
+                *error = "--pixelate block size must be positive";
+                return false;
+            }
+        }
+        return true;
+    }
+    if (option == "--rect") {
+        // x,y,w,h[,color[,thickness]]
+        if (!parseInts(parts, 4, v) || parts.size() > 6 || !parseStyle(parts, 4, &step->annotation)) {
+            *error = "--rect expects x,y,width,height[,color[,thickness]]";
+            return false;
+        }
+        step->type = Step::Type::Annotate;
+        step->annotation.type = CaptureManager::AnnotationType::Rectangle;
+        step->annotation.rect = QRect(v[0], v[1], v[2], v[3]);
+        return true;
+    }
+    if (option == "--arrow") {
+        // x1,y1,x2,y2[,color[,thickness]]
+        if (!parseInts(parts, 4, v) || parts.size() > 6 || !parseStyle(parts, 4, &step->annotation)) {
+            *error = "--arrow expects x1,y1,x2,y2[,color[,thickness]]";
+            return false;
+        }
+        step->type = Step::Type::Annotate;
+        step->annotation.type = CaptureManager::AnnotationType::Arrow;
+        step->annotation.startPoint = QPoint(v[0], v[1]);
+        step->annotation.endPoint = QPoint(v[2], v[3]);
+        step->annotation.rect = QRect(step->annotation.startPoint, step->annotation.endPoint).normalized();
+        return true;
+    }
+    if (option == "--text") {
+        // x,y,pointSize,color,文字（文字放在最后，可以包含逗号）
+        const QStringList head = value.split(',').mid(0, 4);
+        const int textStart = head.join(',').size() + 1;
+        if (!parseInts(head, 3, v) || head.size() < 4 || textStart > value.size() || v[2] <= 0) {
+            *error = "--text expects x,y,pointSize,color,text";
+            return false;
+        }
+        step->type = Step::Type::Annotate;
+        step->annotation.type = CaptureManager::AnnotationType::Text;
+        step->annotation.color = QColor(head[3].trimmed());
+        step->annotation.thickness = 1;
+        step->annotation.text = value.mid(textStart);
+        step->annotation.font.setPointSize(v[2]);
+        if (!step->annotation.color.isValid() || step->annotation.text.isEmpty()) {
+            *error = "--text expects x,y,pointSize,color,text";
+            return false;
+        }
+        // drawAnnotation 在工作线程上按 rect 左上对齐绘制，区域给足即可
+        step->annotation.rect = QRect(v[0], v[1], 1 << 16, 1 << 16);
+        return true;
+    }
+    *error = QString("unknown step %1").arg(option);
+    return false;
+}
+
+QStringList BatchPipeline::expandInputs(const QStringList& patterns)
+{
+    static const QStringList imageFilters = {"*.png", "*.jpg", "*.jpeg", "*.bmp", "*.webp", "*.qoi"};
+    QStringList files;
+    for (const QString& pattern : patterns) {
+        const QFileInfo info(pattern);
+        if (info.isDir()) {
+            for (const QString& name : QDir(pattern).entryList(imageFilters, QDir::Files, QDir::Name)) {
+                files.append(QDir(pattern).filePath(name));
+            }
+        } else if (pattern.contains('*') || pattern.contains('?') || pattern.contains('[')) {
+            const QDir dir = info.dir();
+            for (const QString& name : dir.entryList(QStringList(info.fileName()), QDir::Files, QDir::Name)) {
+                files.append(dir.filePath(name));
+            }
+        } else {
+            files.append(pattern);
+        }
+    }
+    return files;
+}
@@ -0,0 +1,91 @@
+#ifndef BATCHPIPELINE_H
+#define BATCHPIPELINE_H
+
+#include <QImage>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QRect>
+#include <QSize>
+#include <functional>
+#include "../capture/capturemanager.h"
+#include "../export/imageexporter.h"
+#include "../image/resampler.h"
+
+class BatchImagePool;
+
+// 批量处理图片：按顺序执行一组步骤（裁剪、缩放、打码、绘制标注）后编码写出
+//
+// 解码、处理、编码三个阶段各有一组线程，阶段之间用有界队列连接：
+// 某一阶段跟不上时上游在队列满处阻塞，内存中同时存在的图片数量有上限。
+// 图片缓冲区在阶段之间流转，写出后回到缓冲池，解码与裁剪时按尺寸和格式复用，
+// 处理上千张同样大小的截图时基本不再分配新的像素内存
+class BatchPipeline
+{
+public:
+    struct Step {
+        enum class Type {
+            Crop,       // rect
+            Scale,      // size（某一边为 0 时按比例）或 factor，filter
+            Pixelate,   // rect，blockSize
+            Annotate    // annotation：矩形、箭头或文字
+        };
+
+        Type type = Type::Crop;
+        QRect rect;
+        QSize size;
+        qreal factor = 0;
+        Resampler::Filter filter = Resampler::Filter::Lanczos3;
+        int blockSize = CaptureManager::kPixelateBlock;
+        CaptureManager::Annotation annotation{};
+    };
+
+    struct Options {
+        QString outputDirectory;
+        QString suffix = "png";         // 输出格式，决定编码器
+        ImageExporter::Preset preset = ImageExporter::Preset::Balanced;
+        ImageExporter::PaletteMode palette = ImageExporter::PaletteMode::Off;
+        bool dither = true;
+        int threads = 0;                // 每个阶段的线程数，0 为 CPU 核心数
+    };
+
+    struct Stats {
+        int succeeded = 0;
+        int failed = 0;
+        qint64 elapsedMs = 0;
+        qint64 inputBytes = 0;
+        qint64 outputBytes = 0;
+        qint64 pixels = 0;              // 处理后的像素总数
+        // 各阶段线程的累计耗时（不含排队等待），用于判断瓶颈在哪一阶段
+        qint64 decodeMs = 0;
+        qint64 processMs = 0;
+        qint64 encodeMs = 0;
+    };
+
+    // 单张图片处理完成后调用，error 为空表示成功；在工作线程中调用
+    using Progress = std::function<void(const QString& input, const QString& error)>;
+
+    BatchPipeline(const QVector<Step>& steps, const Options& options);
+
+    // 输出路径冲突或会覆盖输入时不处理任何图片，每张图片都以该错误报告失败
+    Stats run(const QStringList& files, const Progress& progress = Progress()) const;
+    // 每个输入对应的输出路径，保证互不相同：同名输入依次加上原扩展名和序号；
+    // 某个输出会覆盖输入文件时返回 false
+    bool outputPaths(const QStringList& files, QStringList* paths, QString* error) const;
+
+    // 解析命令行的一个步骤参数，例如 ("--crop", "0,0,800,600")
+    static bool parseStep(const QString& option, const QString& value, Step* step, QString* error);
+    static bool isStepOption(const QString& option);
+
+    // 展开输入：目录取其中的图片文件，含通配符时在所在目录中匹配，其他视为单个文件
+    static QStringList expandInputs(const QStringList& patterns);
+
+private:
+    QVector<Step> m_steps;
+    Options m_options;
+
+    // 对一张图片执行全部步骤，image 原地替换为结果；失败时返回 false 并设置 error
+    bool process(QImage& image, BatchImagePool& pool, QString* error) const;
+};
+
+#endif // BATCHPIPELINE_H
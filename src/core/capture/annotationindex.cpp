@@ -0,0 +1,70 @@
+#include "annotationindex.h"
+#include <algorithm>
+
+int AnnotationIndex::cellOf(int coordinate)
+{
+    // 向下取整，负坐标同样适用
+    return coordinate >= 0 ? coordinate / kCellSize : (coordinate - kCellSize + 1) / kCellSize;
+}
+
+quint64 AnnotationIndex::cellKey(int cx, int cy)
+{
+    return (quint64(quint32(cx)) << 32) | quint32(cy);
+}
+
+void AnnotationIndex::insert(int id, const QRect& bounds)
+{
+    if (bounds.isEmpty()) {
+        return;
+    }
+    for (int cy = cellOf(bounds.top()); cy <= cellOf(bounds.bottom()); ++cy) {
+        for (int cx = cellOf(bounds.left()); cx <= cellOf(bounds.right()); ++cx) {
+            m_cells[cellKey(cx, cy)].append(id);
+        }
+    }
+}
+
+void AnnotationIndex::remove(int id, const QRect& bounds)
+{
+    if (bounds.isEmpty()) {
+        return;
+    }
+    for (int cy = cellOf(bounds.top()); cy <= cellOf(bounds.bottom()); ++cy) {
+        for (int cx = cellOf(bounds.left()); cx <= cellOf(bounds.right()); ++cx) {
+            auto it = m_cells.find(cellKey(cx, cy));
+            if (it == m_cells.end()) {
+                continue;
+            }
+            it->removeAll(id);
+            if (it->isEmpty()) {
+                m_cells.erase(it);
+            }
+        }
+    }
+}
+
+QVector<int> AnnotationIndex::query(const QPoint& pos) const
+{
+    QVector<int> result = m_cells.value(cellKey(cellOf(pos.x()), cellOf(pos.y())));
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+QVector<int> AnnotationIndex::query(const QRect& rect) const
+{
+    QVector<int> result;
+    if (rect.isEmpty()) {
+        return result;
+    }
+    for (int cy = cellOf(rect.top()); cy <= cellOf(rect.bottom()); ++cy) {
+        for (int cx = cellOf(rect.left()); cx <= cellOf(rect.right()); ++cx) {
+            auto it = m_cells.constFind(cellKey(cx, cy));
+            if (it != m_cells.constEnd()) {
+                result += *it;
+            }
+        }
+    }
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    return result;
+}
@@ -0,0 +1,31 @@
+#ifndef ANNOTATIONINDEX_H
+#define ANNOTATIONINDEX_H
+
+#include <QHash>
+#include <QPoint>
+#include <QRect>
+#include <QVector>
+
+// 标注的空间索引：均匀网格，每个格子记录与之相交的标注序号
+// 命中测试和局部重绘只需要查询少量格子，而不是遍历全部标注
+class AnnotationIndex
+{
+public:
+    void clear() { m_cells.clear(); }
+    void insert(int id, const QRect& bounds);
+    void remove(int id, const QRect& bounds);
+
+    // 返回可能命中的标注序号（升序、去重），调用方再做精确判断
+    QVector<int> query(const QPoint& pos) const;
+    QVector<int> query(const QRect& rect) const;
+
+private:
+    static constexpr int kCellSize = 64;
+
+    QHash<quint64, QVector<int>> m_cells;
+
+    static int cellOf(int coordinate);
+    static quint64 cellKey(int cx, int cy);
+};
+
+#endif // ANNOTATIONINDEX_H
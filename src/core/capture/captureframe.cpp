@@ -0,0 +1,156 @@
+#include "captureframe.h"
+#include <QDateTime>
+#include <QPainter>
+#include <atomic>
+
+namespace {
+std::atomic<quint64> s_nextFrameId{1};
+}
+
+CaptureFrame::CaptureFrame(const QVector<Region>& regions, const QPoint& origin)
+    : m_origin(origin)
+    , m_timestamp(QDateTime::currentMSecsSinceEpoch())
+    , m_id(s_nextFrameId.fetch_add(1))
+{
+    QRect bounds;
+    for (const Region& region : regions) {
+        if (region.rect.isEmpty() || region.image.isNull()) {
+            continue;
+        }
+        QImage image = region.image.format() == QImage::Format_ARGB32_Premultiplied
+            ? region.image : region.image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+        // 高 DPI 屏幕的抓图按物理像素存储，统一缩放到逻辑坐标
+        if (image.size() != region.rect.size()) {
+            image = image.scaled(region.rect.size(), Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+        }
+        image.setDevicePixelRatio(1.0);
+        m_regions.append({region.rect, image});
+        bounds = bounds.united(region.rect);
+    }
+    m_size = QSize(bounds.right() + 1, bounds.bottom() + 1).expandedTo(QSize(0, 0));
+    buildTiles();
+}
+
+CaptureFrame::CaptureFrame(const QImage& image, const QPoint& origin)
+    : CaptureFrame(QVector<Region>{{image.rect(), image}}, origin)
+{
+}
+
+void CaptureFrame::buildTiles()
+{
+    m_columns = (m_size.width() + kTileSize - 1) / kTileSize;
+    m_rows = (m_size.height() + kTileSize - 1) / kTileSize;
+    m_tiles.resize(m_columns * m_rows);
+
+    for (int row = 0; row < m_rows; ++row) {
+        for (int column = 0; column < m_columns; ++column) {
+            const QRect rect = tileRect(column, row);
+            QImage& tile = m_tiles[row * m_columns + column];
+
+            // 图块完全落在一个屏幕内：直接引用抓图的像素
+            const Region* owner = nullptr;
+            bool touched = false;
+            for (const Region& region : m_regions) {
+                if (region.rect.contains(rect)) {
+                    owner = &region;
+                    break;
+                }
+                touched = touched || region.rect.intersects(rect);
+            }
+            if (owner) {
+                const QImage& source = owner->image;
+                const QPoint offset = rect.topLeft() - owner->rect.topLeft();
+                tile = QImage(source.constBits() + offset.y() * source.bytesPerLine() + offset.x() * 4,
+                              rect.width(), rect.height(), source.bytesPerLine(), source.format());
+                continue;
+            }
+            if (!touched) {
+                continue;   // 屏幕之间的空隙，不分配
+            }
+
+            // 跨越屏幕边界的图块单独合成
+            tile = QImage(rect.size(), QImage::Format_ARGB32_Premultiplied);
+            tile.fill(Qt::transparent);
+            QPainter painter(&tile);
+            painter.setCompositionMode(QPainter::CompositionMode_Source);
+            for (const Region& region : m_regions) {
+                QRect part = region.rect.intersected(rect);
+                if (!part.isEmpty()) {
+                    painter.drawImage(part.topLeft() - rect.topLeft(), region.image,
+                                      part.translated(-region.rect.topLeft()));
+                }
+            }
+        }
+    }
+}
+
+QRect CaptureFrame::tileRect(int column, int row) const
+{
+    return QRect(column * kTileSize, row * kTileSize, kTileSize, kTileSize).intersected(rect());
+}
+
+qint64 CaptureFrame::memoryBytes() const
+{
+    qint64 bytes = 0;
+    for (const Region& region : m_regions) {
+        bytes += region.image.sizeInBytes();
+    }
+    // 引用抓图的图块不拥有像素，只统计单独合成的图块
+    for (const QImage& tile : m_tiles) {
+        bool shared = false;
+        for (const Region& region : m_regions) {
+            const uchar* begin = region.image.constBits();
+            if (tile.constBits() >= begin && tile.constBits() < begin + region.image.sizeInBytes()) {
+                shared = true;
+                break;
+            }
+        }
+        if (!tile.isNull() && !shared) {
+            bytes += tile.sizeInBytes();
+        }
+    }
+    return bytes;
+}
+
+void CaptureFrame::draw(QPainter& painter, const QRect& rect) const
+{
+    const QRect area = rect.intersected(this->rect());
+    if (area.isEmpty()) {
+        return;
+    }
+    for (int row = area.top() / kTileSize; row <= area.bottom() / kTileSize; ++row) {
+        for (int column = area.left() / kTileSize; column <= area.right() / kTileSize; ++column) {
+            const QImage& image = tile(column, row);
+            if (image.isNull()) {
+                continue;
+            }
+            const QRect bounds = tileRect(column, row);
+            const QRect part = bounds.intersected(area);
+            painter.drawImage(part.topLeft(), image, part.translated(-bounds.topLeft()));
+        }
+    }
+}
+
+QImage CaptureFrame::crop(const QRect& rect) const
+{
+    const QRect area = rect.intersected(this->rect());
+    if (area.isEmpty()) {
+        return QImage();
+    }
+
+    // 选区完全落在一个屏幕内时直接复制，无需逐块合成
+    for (const Region& region : m_regions) {
+        if (region.rect.contains(rect)) {
+            return region.image.copy(rect.translated(-region.rect.topLeft()));
+        }
+    }
+
+    QImage result(rect.size(), QImage::Format_ARGB32_Premultiplied);
+    result.fill(Qt::transparent);
+    QPainter painter(&result);
+    painter.setCompositionMode(QPainter::CompositionMode_Source);
+    painter.translate(-rect.topLeft());
+    draw(painter, area);
+    painter.end();
+    return result;
+}
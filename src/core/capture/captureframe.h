@@ -0,0 +1,68 @@
+#ifndef CAPTUREFRAME_H
+#define CAPTUREFRAME_H
+
+#include <QImage>
+#include <QPoint>
+#include <QRect>
+#include <QVector>
+#include <memory>
+
+class QPainter;
+
+// 一帧截图：创建后不可修改，通过 shared_ptr 在线程间共享
+// QImage 可以在任意线程读取，因此工作线程（编码、识别、对比、历史）可直接持有同一帧
+//
+// 像素按 kTileSize 的稀疏图块存储，只覆盖真实的屏幕区域：
+// 多显示器错位排列时，包围盒中没有屏幕的部分不分配内存。
+// 完全落在一个屏幕内的图块直接引用该屏幕的抓图，不复制像素
+class CaptureFrame
+{
+public:
+    static constexpr int kTileSize = 256;
+
+    // 一块有内容的区域（通常是一个屏幕），rect 相对于帧左上角
+    struct Region {
+        QRect rect;
+        QImage image;
+    };
+
+    CaptureFrame(const QVector<Region>& regions, const QPoint& origin);
+    CaptureFrame(const QImage& image, const QPoint& origin);
+
+    QPoint origin() const { return m_origin; }     // 帧左上角在虚拟桌面中的全局坐标
+    QSize size() const { return m_size; }          // 包围盒尺寸
+    QRect rect() const { return QRect(QPoint(0, 0), m_size); }
+    qint64 timestamp() const { return m_timestamp; }
+    // 进程内唯一的编号。帧释放后地址可能被新帧复用，按帧缓存结果时用编号区分
+    quint64 id() const { return m_id; }
+    const QVector<Region>& regions() const { return m_regions; }
+
+    // 图块网格，没有屏幕内容的图块为空图
+    int columns() const { return m_columns; }
+    int rows() const { return m_rows; }
+    QRect tileRect(int column, int row) const;
+    const QImage& tile(int column, int row) const { return m_tiles.at(row * m_columns + column); }
+    // 实际占用的像素字节数
+    qint64 memoryBytes() const;
+
+    // 把 rect（帧坐标）内的像素画到 painter 的相同坐标上，屏幕间的空隙不绘制
+    void draw(QPainter& painter, const QRect& rect) const;
+    // 裁剪出一块独立的图片（坐标相对于帧左上角），屏幕间的空隙为透明
+    QImage crop(const QRect& rect) const;
+
+private:
+    QVector<Region> m_regions;      // 抓图原始数据，图块可能直接引用其中的像素
+    QVector<QImage> m_tiles;
+    QSize m_size;
+    int m_columns{0};
+    int m_rows{0};
+    QPoint m_origin;
+    qint64 m_timestamp;
+    quint64 m_id;
+
+    void buildTiles();
+};
+
+using CaptureFramePtr = std::shared_ptr<const CaptureFrame>;
+
+#endif // CAPTUREFRAME_H
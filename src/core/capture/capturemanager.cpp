@@ -1,17 +1,75 @@
 #include "capturemanager.h"
+#include "capturescheduler.h"
+#include "replaybuffer.h"
+#include "../history/capturehistory.h"
+#include "../redaction/sensitivecontentscanner.h"
+#include "../search/captureindexer.h"
 #include <QScreen>
 #include <QGuiApplication>
 #include <QWindow>
 #include <QDebug>
 #include <QPainter>
+#include <QThread>
+#include <QCoreApplication>
 #include <cmath>
 
-CaptureManager::CaptureManager(QObject *parent)
+CaptureManager::CaptureManager(QObject *parent, Services services)
     : QObject(parent)
-    , m_lastCapture()
+    , m_annotations(std::make_shared<const QVector<Annotation>>())
+    , m_services(services)
 {
 }
 
+CaptureScheduler* CaptureManager::scheduler()
+{
+    if (!m_scheduler && m_services == Services::All) {
+        m_scheduler = new CaptureScheduler(this, this);
+    }
+    return m_scheduler;
+}
+
+CaptureHistory* CaptureManager::history()
+{
+    // 历史记录创建时扫描并清理存储目录，条目很多时耗时明显
+    if (!m_history && m_services == Services::All) {
+        m_history = new CaptureHistory(this);
+    }
+    return m_history;
+}
+
+SensitiveContentScanner* CaptureManager::scanner()
+{
+    if (!m_scanner && m_services == Services::All) {
+        m_scanner = new SensitiveContentScanner(this);
+    }
+    return m_scanner;
+}
+
+ReplayBuffer* CaptureManager::replay()
+{
+    if (!m_replay && m_services == Services::All) {
+        m_replay = new ReplayBuffer(this);
+    }
+    return m_replay;
+}
+
+CaptureIndexer* CaptureManager::indexer()
+{
+    if (!m_indexer && m_services == Services::All) {
+        m_indexer = new CaptureIndexer(history(), this);
+    }
+    return m_indexer;
+}
+
+void CaptureManager::startServices()
+{
+    scheduler();
+    history();
+    scanner();
+    replay();
+    indexer();
+}
+
 void CaptureManager::startCapture()
 {
     // 获取主屏幕
@@ -21,8 +79,9 @@ void CaptureManager::startCapture()
     }
 
     // 捕获整个屏幕
-    m_lastCapture = screen->grabWindow(0);
-    emit captureTaken(m_lastCapture);
+    QPixmap pixmap = screen->grabWindow(0);
+    setFrame(std::make_shared<const CaptureFrame>(pixmap.toImage(), screen->geometry().topLeft()));
+    emit captureTaken(pixmap);
 }
 
 QPixmap CaptureManager::captureScreen()
@@ -46,43 +105,355 @@ QPixmap CaptureManager::captureWindow(WId windowId)
     return screen->grabWindow(windowId);
 }
 
+QPixmap CaptureManager::captureRegion(const QRect& globalRect)
+{
+    QRect region = globalRect.normalized();
+    if (region.isEmpty()) {
+        return QPixmap();
+    }
+
+    QPixmap result;
+    QPainter painter;
+    for (QScreen *screen : QGuiApplication::screens()) {
+        QRect screenRect = screen->geometry();
+        QRect part = region.intersected(screenRect);
+        if (part.isEmpty()) {
+            continue;
+        }
+
+        // grabWindow(0, ...) 的坐标相对于该屏幕
+        QRect local = part.translated(-screenRect.topLeft());
+        QPixmap shot = screen->grabWindow(0, local.x(), local.y(), local.width(), local.height());
+
+        // 区域完全落在一个屏幕内时直接返回，省去合成
+        if (part == region) {
+            return shot;
+        }
+
+        if (result.isNull()) {
+            result = QPixmap(region.size());
+            result.fill(Qt::transparent);
+            painter.begin(&result);
+        }
+        painter.drawPixmap(part.translated(-region.topLeft()), shot);
+    }
+    if (painter.isActive()) {
+        painter.end();
+    }
+    return result;
+}
+
+QVector<QPixmap> CaptureManager::captureRegions(const QVector<QRect>& globalRects)
+{
+    QRect united;
+    for (const QRect& rect : globalRects) {
+        united = united.united(rect.normalized());
+    }
+
+    QVector<QPixmap> crops;
+    crops.reserve(globalRects.size());
+    QPixmap frame = captureRegion(united);
+    if (frame.isNull()) {
+        crops.resize(globalRects.size());
+        return crops;
+    }
+
+    // 抓图按物理像素存储，裁剪坐标需要乘以设备像素比
+    const qreal dpr = frame.devicePixelRatio();
+    for (const QRect& rect : globalRects) {
+        QRect source = rect.normalized().translated(-united.topLeft());
+        if (!qFuzzyCompare(dpr, 1.0)) {
+            source = QRect(source.topLeft() * dpr, source.size() * dpr);
+        }
+        crops.append(frame.copy(source));
+    }
+    return crops;
+}
+
+CaptureManager::Snapshot CaptureManager::snapshot() const
+{
+    // 读路径不加锁：只原子地读取两个共享指针
+    Snapshot result;
+    result.frame = std::atomic_load(&m_frame);
+    result.annotations = std::atomic_load(&m_annotations);
+    return result;
+}
+
+void CaptureManager::setFrame(const CaptureFramePtr& frame)
+{
+    QMutexLocker locker(&m_mutex);
+    // 扫描结果只属于原来的帧
+    if (m_scanner && std::atomic_load(&m_frame) != frame) {
+        m_scanner->reset();
+    }
+    std::atomic_store(&m_frame, frame);
+}
+
+void CaptureManager::clearResources()
+{
+    QMutexLocker locker(&m_mutex);  // 添加互斥锁保护
+    if (m_scanner) {
+        m_scanner->reset();
+    }
+    std::atomic_store(&m_frame, CaptureFramePtr());
+    std::atomic_store(&m_annotations, std::make_shared<const QVector<Annotation>>());
+    m_annotationIndex.clear();
+}
+
 void CaptureManager::addAnnotation(const Annotation& annotation)
 {
-    m_annotations.append(annotation);
+    QMutexLocker locker(&m_mutex);
+    auto updated = std::make_shared<QVector<Annotation>>(*std::atomic_load(&m_annotations));
+    updated->append(preparedAnnotation(annotation));
+    m_annotationIndex.insert(updated->size() - 1, annotationBounds(updated->last()));
+    std::atomic_store(&m_annotations, AnnotationList(std::move(updated)));
+}
+
+CaptureManager::Annotation CaptureManager::preparedAnnotation(const Annotation& annotation) const
+{
+    if (annotation.type != AnnotationType::Pixelate) {
+        return annotation;
+    }
+    // 帧不可修改，马赛克在添加或移动时生成一次，之后任意线程都可直接绘制
+    Annotation prepared = annotation;
+    CaptureFramePtr frame = std::atomic_load(&m_frame);
+    QRect rect = annotation.rect.normalized();
+    prepared.mosaic = frame && !rect.isEmpty() ? pixelate(frame->crop(rect)) : QImage();
+    return prepared;
+}
+
+QImage CaptureManager::pixelate(const QImage& image, int blockSize)
+{
+    if (image.isNull()) {
+        return QImage();
+    }
+    // 先缩小再用最近邻放大，得到块状的平均色
+    const QSize small((image.width() + blockSize - 1) / blockSize,
+                      (image.height() + blockSize - 1) / blockSize);
+    return image.scaled(small, Qt::IgnoreAspectRatio, Qt::SmoothTransformation)
+        .scaled(image.size(), Qt::IgnoreAspectRatio, Qt::FastTransformation);
 }
 
 void CaptureManager::removeLastAnnotation()
 {
-    if (!m_annotations.isEmpty()) {
-        m_annotations.removeLast();
+    QMutexLocker locker(&m_mutex);
+    AnnotationList current = std::atomic_load(&m_annotations);
+    if (current->isEmpty()) {
+        return;
     }
+    auto updated = std::make_shared<QVector<Annotation>>(*current);
+    m_annotationIndex.remove(updated->size() - 1, annotationBounds(updated->last()));
+    updated->removeLast();
+    std::atomic_store(&m_annotations, AnnotationList(std::move(updated)));
 }
 
 void CaptureManager::clearAnnotations()
 {
-    m_annotations.clear();
+    QMutexLocker locker(&m_mutex);
+    std::atomic_store(&m_annotations, std::make_shared<const QVector<Annotation>>());
+    m_annotationIndex.clear();
 }
 
-QPixmap CaptureManager::getEditedPixmap() const
+void CaptureManager::updateAnnotation(int index, const Annotation& annotation)
 {
-    if (m_lastCapture.isNull()) {
-        return QPixmap();
+    QMutexLocker locker(&m_mutex);
+    AnnotationList current = std::atomic_load(&m_annotations);
+    if (index < 0 || index >= current->size()) {
+        return;
+    }
+    auto updated = std::make_shared<QVector<Annotation>>(*current);
+    m_annotationIndex.remove(index, annotationBounds(current->at(index)));
+    (*updated)[index] = preparedAnnotation(annotation);
+    m_annotationIndex.insert(index, annotationBounds(annotation));
+    std::atomic_store(&m_annotations, AnnotationList(std::move(updated)));
+}
+
+void CaptureManager::removeAnnotation(int index)
+{
+    QMutexLocker locker(&m_mutex);
+    AnnotationList current = std::atomic_load(&m_annotations);
+    if (index < 0 || index >= current->size()) {
+        return;
+    }
+    auto updated = std::make_shared<QVector<Annotation>>(*current);
+    updated->removeAt(index);
+    // 删除会改变后续标注的序号，重建索引
+    rebuildAnnotationIndex(*updated);
+    std::atomic_store(&m_annotations, AnnotationList(std::move(updated)));
+}
+
+void CaptureManager::setAnnotations(const QVector<Annotation>& annotations)
+{
+    QMutexLocker locker(&m_mutex);
+    auto updated = std::make_shared<QVector<Annotation>>();
+    updated->reserve(annotations.size());
+    for (const Annotation& annotation : annotations) {
+        Annotation prepared = preparedAnnotation(annotation);
+        if (prepared.type == AnnotationType::Text && !prepared.textLayout && !prepared.text.isEmpty()) {
+            prepared.textLayout = createTextLayout(prepared.text, prepared.font);
+        }
+        updated->append(prepared);
     }
+    rebuildAnnotationIndex(*updated);
+    std::atomic_store(&m_annotations, AnnotationList(std::move(updated)));
+}
 
+void CaptureManager::rebuildAnnotationIndex(const QVector<Annotation>& annotations)
+{
+    m_annotationIndex.clear();
+    for (int i = 0; i < annotations.size(); ++i) {
+        m_annotationIndex.insert(i, annotationBounds(annotations[i]));
+    }
+}
+
+int CaptureManager::hitTest(const QPoint& pos) const
+{
+    QMutexLocker locker(&m_mutex);
+    AnnotationList annotations = std::atomic_load(&m_annotations);
+    
+    // 从最上层开始判断
+    const QVector<int> candidates = m_annotationIndex.query(pos);
+    for (int i = candidates.size() - 1; i >= 0; --i) {
+        if (annotationContains(annotations->at(candidates[i]), pos)) {
+            return candidates[i];
+        }
+    }
+    return -1;
+}
+
+bool CaptureManager::annotationContains(const Annotation& annotation, const QPoint& pos)
+{
+    const qreal tolerance = annotation.thickness / 2.0 + 4.0;
+    switch (annotation.type) {
+        case AnnotationType::Rectangle: {
+            QRectF rect = QRectF(annotation.rect.normalized());
+            if (annotation.filled) {
+                return rect.adjusted(-tolerance, -tolerance, tolerance, tolerance).contains(pos);
+            }
+            // 空心矩形只在边框附近命中
+            return rect.adjusted(-tolerance, -tolerance, tolerance, tolerance).contains(pos)
+                && !rect.adjusted(tolerance, tolerance, -tolerance, -tolerance).contains(pos);
+        }
+        case AnnotationType::Arrow: {
+            QPointF a = annotation.startPoint;
+            QPointF b = annotation.endPoint;
+            QPointF ab = b - a;
+            qreal lengthSquared = QPointF::dotProduct(ab, ab);
+            qreal t = lengthSquared > 0 ? QPointF::dotProduct(QPointF(pos) - a, ab) / lengthSquared : 0;
+            QPointF nearest = a + qBound(0.0, t, 1.0) * ab;
+            QPointF offset = QPointF(pos) - nearest;
+            // 箭头头部更宽
+            return qSqrt(QPointF::dotProduct(offset, offset)) <= tolerance + (t > 0.8 ? 8.0 : 0.0);
+        }
+        case AnnotationType::Text:
+            return annotation.rect.adjusted(-2, -2, 2, 2).contains(pos);
+        case AnnotationType::Pixelate:
+            return annotation.rect.normalized().contains(pos);
+    }
+    return false;
+}
+
+QRect CaptureManager::annotationBounds(const Annotation& annotation)
+{
+    int margin = annotation.thickness / 2 + 2;
+    switch (annotation.type) {
+        case AnnotationType::Rectangle:
+            return annotation.rect.normalized().adjusted(-margin, -margin, margin, margin);
+        case AnnotationType::Arrow:
+            margin += 10;  // 箭头头部宽度
+            return QRect(annotation.startPoint, annotation.endPoint).normalized()
+                .adjusted(-margin, -margin, margin, margin);
+        case AnnotationType::Text:
+            return annotation.rect.adjusted(-2, -2, 2, 2);
+        case AnnotationType::Pixelate:
+            return annotation.rect.normalized();
+    }
+    return annotation.rect;
+}
+
+CaptureManager::Annotation CaptureManager::translatedAnnotation(const Annotation& annotation, const QPoint& delta)
+{
+    Annotation moved = annotation;
+    moved.rect.translate(delta);
+    moved.startPoint += delta;
+    moved.endPoint += delta;
+    return moved;
+}
+
+QPixmap CaptureManager::getEditedPixmap() const
+{
     // 创建副本以保持原始截图不变
-    QPixmap result = m_lastCapture;
+    return QPixmap::fromImage(snapshot().render());
+}
+
+QPixmap CaptureManager::getEditedPixmap(const QRect& rect) const
+{
+    return QPixmap::fromImage(snapshot().render(rect));
+}
+
+QImage CaptureManager::Snapshot::render(const QRect& rect) const
+{
+    if (!frame || !annotations || rect.isEmpty()) {
+        return QImage();
+    }
+
+    // 先裁剪再绘制，只处理与区域相交的标注
+    QImage result = frame->crop(rect);
     QPainter painter(&result);
     painter.setRenderHint(QPainter::Antialiasing);
+    painter.translate(-rect.topLeft());
+    for (const Annotation& annotation : *annotations) {
+        if (annotationBounds(annotation).intersects(rect)) {
+            drawAnnotation(painter, annotation);
+        }
+    }
+    return result;
+}
 
-    // 绘制所有标注
-    for (const auto& annotation : m_annotations) {
-        drawAnnotation(painter, annotation);
+void CaptureManager::drawAnnotations(QPainter& painter, const QRect& clip) const
+{
+    QVector<int> visible;
+    AnnotationList annotations;
+    {
+        QMutexLocker locker(&m_mutex);
+        visible = m_annotationIndex.query(clip);
+        annotations = std::atomic_load(&m_annotations);
     }
+    for (int index : visible) {
+        drawAnnotation(painter, annotations->at(index));
+    }
+}
 
-    return result;
+QSharedPointer<QTextLayout> CaptureManager::createTextLayout(const QString& text, const QFont& font)
+{
+    // QTextLayout 只识别行分隔符，换行符需要转换
+    QString content = text;
+    content.replace(QLatin1Char('\n'), QChar(QChar::LineSeparator));
+    
+    QSharedPointer<QTextLayout> layout(new QTextLayout(content, font), [](QTextLayout* layout) {
+        QCoreApplication* app = QCoreApplication::instance();
+        if (!app || QThread::currentThread() == app->thread()) {
+            delete layout;
+        } else {
+            QMetaObject::invokeMethod(app, [layout]() { delete layout; }, Qt::QueuedConnection);
+        }
+    });
+    layout->setCacheEnabled(true);  // 保留字形，重绘时不再重新塑形
+    layout->beginLayout();
+    qreal y = 0;
+    forever {
+        QTextLine line = layout->createLine();
+        if (!line.isValid()) {
+            break;
+        }
+        line.setPosition(QPointF(0, y));
+        y += line.height();
+    }
+    layout->endLayout();
+    return layout;
 }
 
-void CaptureManager::drawAnnotation(QPainter& painter, const Annotation& annotation) const
+void CaptureManager::drawAnnotation(QPainter& painter, const Annotation& annotation)
 {
     QPen pen(annotation.color);
     pen.setWidth(annotation.thickness);
@@ -136,11 +507,24 @@ void CaptureManager::drawAnnotation(QPainter& painter, const Annotation& annotat
         }
             
         case AnnotationType::Text:
-            if (!annotation.text.isEmpty()) {
+            // 缓存的排版对象不能跨线程共用，工作线程上退回 drawText
+            if (annotation.textLayout && QThread::currentThread() == QCoreApplication::instance()->thread()) {
+                // 直接绘制缓存的排版结果
+                annotation.textLayout->draw(&painter, annotation.rect.topLeft());
+            } else if (!annotation.text.isEmpty()) {
+                painter.setFont(annotation.font);
                 painter.drawText(annotation.rect, 
                                Qt::AlignLeft | Qt::AlignTop, 
                                annotation.text);
             }
             break;
+            
+        case AnnotationType::Pixelate:
+            if (!annotation.mosaic.isNull()) {
+                painter.drawImage(annotation.rect.normalized(), annotation.mosaic);
+            } else {
+                painter.fillRect(annotation.rect.normalized(), Qt::gray);
+            }
+            break;
     }
 } 
\ No newline at end of file
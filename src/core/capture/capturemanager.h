@@ -10,6 +10,19 @@
 #include <QMutex>
 #include <QMutexLocker>
 #include <QtMath>  // 添加数学函数支持
+#include <QFont>
+#include <QTextLayout>
+#include <QSharedPointer>
+#include <memory>
+#include "regionpresets.h"
+#include "annotationindex.h"
+#include "captureframe.h"
+
+class CaptureScheduler;
+class CaptureHistory;
+class SensitiveContentScanner;
+class ReplayBuffer;
+class CaptureIndexer;
 
 class CaptureManager : public QObject
 {
@@ -19,7 +32,8 @@ public:
     enum class AnnotationType {
         Rectangle,
         Arrow,
-        Text
+        Text,
+        Pixelate    // 马赛克打码
     };
     
     // 定义标注项结构
@@ -32,51 +46,138 @@ public:
         bool filled;          // 是否填充（用于矩形）
         QPoint startPoint;    // 添加：箭头起点
         QPoint endPoint;      // 添加：箭头终点
+        QFont font;           // 文字字体（用于文字标注）
+        QSharedPointer<QTextLayout> textLayout;  // 已排版的文字，重绘时不再重新排版（仅 GUI 线程绘制，可在任意线程释放）
+        QImage mosaic;        // 打码区域的马赛克图，添加或修改标注时由当前帧生成
+    };
+    
+    using AnnotationList = std::shared_ptr<const QVector<Annotation>>;
+    
+    // 某一时刻的截图与标注：两者都不可修改，可以交给任意线程使用
+    struct Snapshot {
+        CaptureFramePtr frame;
+        AnnotationList annotations;
+        
+        bool isValid() const { return frame != nullptr; }
+        // 裁剪并渲染标注，可在任意线程调用
+        QImage render(const QRect& rect) const;
+        QImage render() const { return frame ? render(frame->rect()) : QImage(); }
+    };
+
+    // 后台服务（调度、历史、扫描、回放、索引）会读写用户数据目录和设置，创建历史时还要扫描磁盘；
+    // All 在第一次访问或 startServices() 时才创建，不占用启动路径。
+    // None 只保留帧与标注，供不应触碰用户数据的测试使用，此时各服务的访问函数返回空指针
+    enum class Services {
+        All,
+        None
     };
 
 public:
-    explicit CaptureManager(QObject *parent = nullptr);
+    explicit CaptureManager(QObject *parent = nullptr, Services services = Services::All);
     
     void startCapture();
     QPixmap captureScreen();
     QPixmap captureWindow(WId windowId);
     
+    // 只截取指定的全局区域：仅抓取与之相交的屏幕，不分配整个虚拟桌面
+    QPixmap captureRegion(const QRect& globalRect);
+    
+    // 一次抓取覆盖所有区域的并集，再按区域分别裁剪
+    QVector<QPixmap> captureRegions(const QVector<QRect>& globalRects);
+    
+    // 以下服务在第一次访问时创建，只在 GUI 线程调用
+    // 延时/定时截图调度服务
+    CaptureScheduler* scheduler();
+    
+    // 截图历史
+    CaptureHistory* history();
+    
+    // 敏感信息扫描
+    SensitiveContentScanner* scanner();
+    
+    // 后台回放缓冲，可回到按下快捷键之前的画面
+    ReplayBuffer* replay();
+    
+    // 截图历史的文字索引，在后台空闲时建立
+    CaptureIndexer* indexer();
+    
+    // 创建全部服务，托盘可用、事件循环空闲后调用
+    void startServices();
+    
+    // 选区预设与最近一次选区
+    RegionPresets& presets() { return m_presets; }
+    
     // 使用右值引用优化性能
     void handleCapture(QPixmap &&pixmap);
     
     // 添加缓存机制
     QPixmap getCachedScreen() const;
     
+    // 当前帧与标注的一致快照：读取无锁，只增加引用计数
+    Snapshot snapshot() const;
+    CaptureFramePtr frame() const { return std::atomic_load(&m_frame); }
+    void setFrame(const CaptureFramePtr& frame);
+    
     // 新增编辑相关方法
+    // 写操作以写时复制的方式发布新的标注列表，互斥锁只用于串行化写者
     void addAnnotation(const Annotation& annotation);
     void removeLastAnnotation();
     void clearAnnotations();
     QPixmap getEditedPixmap() const;  // 获取带有标注的图片
+    QPixmap getEditedPixmap(const QRect& rect) const;  // 只渲染指定区域，用于导出选区
     
-    void setOriginalPixmap(const QPixmap& pixmap) { m_lastCapture = pixmap; }
-    const QPixmap& currentPixmap() const { return m_lastCapture; }
+    // 已提交的标注作为可编辑对象
+    QVector<Annotation> annotations() const { return *std::atomic_load(&m_annotations); }
+    int hitTest(const QPoint& pos) const;  // 返回位于最上层的命中标注，未命中返回 -1
+    void updateAnnotation(int index, const Annotation& annotation);
+    void removeAnnotation(int index);
+    // 整体替换标注列表（载入会话时使用），马赛克和文字排版按当前帧重新生成
+    void setAnnotations(const QVector<Annotation>& annotations);
     
-    void clearResources()
-    {
-        QMutexLocker locker(&m_mutex);  // 添加互斥锁保护
-        m_lastCapture = QPixmap();
-        m_annotations.clear();
-    }
+    // 只绘制与 clip 相交的标注
+    void drawAnnotations(QPainter& painter, const QRect& clip) const;
+    static void drawAnnotation(QPainter& painter, const Annotation& annotation);
+    
+    // 标注的绘制范围（含线宽和箭头），用于局部刷新和空间索引
+    static QRect annotationBounds(const Annotation& annotation);
+    static Annotation translatedAnnotation(const Annotation& annotation, const QPoint& delta);
+    
+    // 对文字进行一次排版并返回结果，供编辑预览和已提交的文字标注复用。
+    // 快照可能在工作线程中释放最后一个引用，排版对象总是转交给 GUI 线程删除
+    static QSharedPointer<QTextLayout> createTextLayout(const QString& text, const QFont& font);
+    
+    // 按块求平均生成马赛克，尺寸与输入相同
+    static QImage pixelate(const QImage& image, int blockSize = kPixelateBlock);
+    static constexpr int kPixelateBlock = 8;
+    
+    void clearResources();
     
 signals:
     void captureTaken(const QPixmap &pixmap);
     void captureFinished();
     
 private:
-    QPixmap m_lastCapture;
+    // 以下两个指针只通过 std::atomic_load / std::atomic_store 访问
+    CaptureFramePtr m_frame;
+    AnnotationList m_annotations;       // 存储所有标注
+    
     QScreen *m_primaryScreen{nullptr}; // 缓存主屏幕指针
     
     // 预分配内存，避免频繁分配
     QVector<QScreen*> m_screens;
-    QVector<Annotation> m_annotations;  // 存储所有标注
+    AnnotationIndex m_annotationIndex;  // 标注的空间索引，由 m_mutex 保护
+    RegionPresets m_presets;
+    Services m_services;
+    CaptureScheduler* m_scheduler{nullptr};
+    CaptureHistory* m_history{nullptr};
+    SensitiveContentScanner* m_scanner{nullptr};
+    ReplayBuffer* m_replay{nullptr};
+    CaptureIndexer* m_indexer{nullptr};
     void updateScreenCache();
-    void drawAnnotation(QPainter& painter, const Annotation& annotation) const;
-    QMutex m_mutex;  // 添加互斥锁
+    Annotation preparedAnnotation(const Annotation& annotation) const;
+    void rebuildAnnotationIndex(const QVector<Annotation>& annotations);
+    static bool annotationContains(const Annotation& annotation, const QPoint& pos);
+    mutable QMutex m_mutex;  // 串行化写操作并保护空间索引
 };
 
 #endif // CAPTUREMANAGER_H 
\ No newline at end of file
@@ -0,0 +1,184 @@
+#include "capturescheduler.h"
+#include "capturemanager.h"
+#include "../image/imagehash.h"
+#include "../redaction/redactionrules.h"
+#include "../redaction/sensitivecontentscanner.h"
+#include <QDir>
+#include <QDebug>
+
+CaptureScheduler::CaptureScheduler(CaptureManager* manager, QObject *parent)
+    : QObject(parent)
+    , m_captureManager(manager)
+    , m_encodeQueue(4)
+{
+    m_clock.start();
+
+    m_jobTimer.setSingleShot(true);
+    m_jobTimer.setTimerType(Qt::PreciseTimer);
+    connect(&m_jobTimer, &QTimer::timeout, this, &CaptureScheduler::onJobTimer);
+
+    m_countdownTimer.setInterval(1000);
+    connect(&m_countdownTimer, &QTimer::timeout, this, &CaptureScheduler::onCountdownTimer);
+}
+
+void CaptureScheduler::startCountdown(int seconds)
+{
+    if (seconds <= 0) {
+        emit delayedCaptureDue();
+        return;
+    }
+    m_countdown = seconds;
+    emit countdownTick(m_countdown);
+    m_countdownTimer.start();
+}
+
+void CaptureScheduler::cancelCountdown()
+{
+    m_countdownTimer.stop();
+    m_countdown = 0;
+}
+
+void CaptureScheduler::onCountdownTimer()
+{
+    --m_countdown;
+    if (m_countdown > 0) {
+        emit countdownTick(m_countdown);
+        return;
+    }
+    m_countdownTimer.stop();
+    emit delayedCaptureDue();
+}
+
+int CaptureScheduler::addIntervalJob(const QRect& region, int intervalMs,
+                                     const QString& directory, const QString& prefix)
+{
+    QRect normalized = region.normalized();
+    if (normalized.isEmpty() || directory.isEmpty()) {
+        return -1;
+    }
+    QDir().mkpath(directory);
+
+    Job job;
+    job.id = m_nextJobId++;
+    job.region = normalized;
+    job.intervalMs = qMax(kMinIntervalMs, intervalMs);
+    job.directory = directory;
+    job.prefix = prefix;
+    job.nextIndex = 1;
+    job.nextDue = m_clock.elapsed();   // 立即截第一帧
+    job.dropped = 0;
+    job.duplicates = 0;
+    m_jobs.append(job);
+
+    rearm();
+    emit jobsChanged();
+    return job.id;
+}
+
+void CaptureScheduler::removeJob(int id)
+{
+    for (int i = 0; i < m_jobs.size(); ++i) {
+        if (m_jobs[i].id == id) {
+            m_jobs.removeAt(i);
+            m_savedHashes.remove(id);
+            rearm();
+            emit jobsChanged();
+            return;
+        }
+    }
+}
+
+void CaptureScheduler::clearJobs()
+{
+    if (m_jobs.isEmpty()) {
+        return;
+    }
+    m_jobs.clear();
+    m_savedHashes.clear();
+    m_jobTimer.stop();
+    emit jobsChanged();
+}
+
+void CaptureScheduler::rearm()
+{
+    if (m_jobs.isEmpty()) {
+        m_jobTimer.stop();
+        return;
+    }
+
+    qint64 earliest = m_jobs.first().nextDue;
+    for (const Job& job : m_jobs) {
+        earliest = qMin(earliest, job.nextDue);
+    }
+    m_jobTimer.start(int(qMax<qint64>(0, earliest - m_clock.elapsed())));
+}
+
+void CaptureScheduler::onJobTimer()
+{
+    const qint64 now = m_clock.elapsed();
+
+    // 收集本轮到期的任务
+    QVector<int> dueJobs;
+    QVector<QRect> regions;
+    for (int i = 0; i < m_jobs.size(); ++i) {
+        if (m_jobs[i].nextDue <= now + kCoalesceWindowMs) {
+            dueJobs.append(i);
+            regions.append(m_jobs[i].region);
+        }
+    }
+
+    if (!dueJobs.isEmpty()) {
+        // 一次抓取覆盖所有区域，再分发裁剪结果
+        QVector<QPixmap> crops = m_captureManager->captureRegions(regions);
+        const bool dedupe = HashIndex::isDedupeEnabled();
+        const int distance = HashIndex::dedupeDistance();
+        // 定时截图直接写入磁盘，无法人工检查：开启自动打码时在编码线程中识别并打码后再写入
+        EncodeQueue::Prepare prepare;
+        SensitiveContentScanner* scanner = m_captureManager->scanner();
+        if (RedactionRules::isEnabled() && scanner->isAvailable()) {
+            prepare = [scanner](const QImage& image) { return scanner->redact(image); };
+        }
+
+        for (int k = 0; k < dueJobs.size(); ++k) {
+            Job& job = m_jobs[dueJobs[k]];
+            const QPixmap& crop = crops.value(k);
+
+            const QImage image = crop.toImage();
+            // 画面没有变化（或只有细微变化）时不再保存
+            quint64 perceptual = 0;
+            quint64 content = 0;
+            bool duplicate = false;
+            if (!image.isNull() && dedupe) {
+                perceptual = ImageHash::perceptual(image);
+                content = ImageHash::content(image);
+                duplicate = m_savedHashes[job.id].find(perceptual, content, distance).isValid();
+            }
+
+            if (duplicate) {
+                ++job.duplicates;
+                emit frameSkipped(job.id);
+            } else if (!image.isNull()) {
+                QString filePath = QDir(job.directory).filePath(
+                    QString("%1_%2.png").arg(job.prefix).arg(job.nextIndex, 6, 10, QChar('0')));
+                if (m_encodeQueue.tryEnqueue(image, filePath, prepare)) {
+                    if (dedupe) {
+                        m_savedHashes[job.id].insert(job.nextIndex, perceptual, content);
+                    }
+                    ++job.nextIndex;
+                } else {
+                    // 磁盘跟不上时丢弃这一帧，而不是在内存里排队
+                    ++job.dropped;
+                    emit frameDropped(job.id);
+                }
+            }
+
+            // 落后太多时直接跳到下一个周期，不补拍
+            job.nextDue += job.intervalMs;
+            if (job.nextDue <= now) {
+                job.nextDue = now + job.intervalMs;
+            }
+        }
+    }
+
+    rearm();
+}
@@ -0,0 +1,74 @@
+#ifndef CAPTURESCHEDULER_H
+#define CAPTURESCHEDULER_H
+
+#include <QObject>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QRect>
+#include <QVector>
+#include <QString>
+#include "encodequeue.h"
+#include "../history/hashindex.h"
+
+class CaptureManager;
+
+// 截图调度服务：延时截图与固定区域的定时截图
+// 同一时刻到期的多个任务合并为一次抓取，再分别裁剪；编码经有界队列异步完成
+class CaptureScheduler : public QObject
+{
+    Q_OBJECT
+public:
+    struct Job {
+        int id;
+        QRect region;          // 全局坐标
+        int intervalMs;
+        QString directory;
+        QString prefix;
+        int nextIndex;         // 文件序号
+        qint64 nextDue;        // 相对调度时钟的到期时间（毫秒）
+        int dropped;           // 因队列满而丢弃的帧数
+        int duplicates;        // 与已保存的帧重复而跳过的帧数
+    };
+
+    explicit CaptureScheduler(CaptureManager* manager, QObject *parent = nullptr);
+
+    // 延时截图：每秒发出 countdownTick，结束时发出 delayedCaptureDue
+    void startCountdown(int seconds);
+    void cancelCountdown();
+    bool isCountingDown() const { return m_countdown > 0; }
+
+    // 定时截图：每 intervalMs 毫秒截取 region 并保存为编号文件序列
+    int addIntervalJob(const QRect& region, int intervalMs, const QString& directory,
+                       const QString& prefix = QStringLiteral("capture"));
+    void removeJob(int id);
+    void clearJobs();
+    const QVector<Job>& jobs() const { return m_jobs; }
+
+signals:
+    void countdownTick(int remainingSeconds);
+    void delayedCaptureDue();
+    void jobsChanged();
+    void frameDropped(int jobId);
+    void frameSkipped(int jobId);
+
+private:
+    // 到期时间相差不超过该值的任务视为同一时刻，合并抓取
+    static constexpr int kCoalesceWindowMs = 8;
+    static constexpr int kMinIntervalMs = 50;
+
+    CaptureManager* m_captureManager;
+    EncodeQueue m_encodeQueue;
+    QTimer m_jobTimer;
+    QTimer m_countdownTimer;
+    QElapsedTimer m_clock;
+    QVector<Job> m_jobs;
+    QHash<int, HashIndex> m_savedHashes;   // 每个任务已保存帧的哈希，用于跳过重复帧
+    int m_nextJobId{1};
+    int m_countdown{0};
+
+    void onJobTimer();
+    void onCountdownTimer();
+    void rearm();
+};
+
+#endif // CAPTURESCHEDULER_H
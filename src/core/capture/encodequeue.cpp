@@ -0,0 +1,69 @@
+#include "encodequeue.h"
+#include "../export/imageexporter.h"
+#include <QMutexLocker>
+#include <QDebug>
+
+EncodeQueue::EncodeQueue(int capacity, QObject *parent)
+    : QObject(parent)
+    , m_capacity(qMax(1, capacity))
+{
+    m_worker = QThread::create([this]() { run(); });
+    m_worker->setObjectName("EncodeQueue");
+    m_worker->start(QThread::LowPriority);
+}
+
+EncodeQueue::~EncodeQueue()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_stopping = true;
+        m_hasWork.wakeAll();
+    }
+    // 已入队的任务会在退出前写完
+    m_worker->wait();
+    delete m_worker;
+}
+
+bool EncodeQueue::tryEnqueue(const QImage& image, const QString& filePath, const Prepare& prepare)
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_stopping || m_tasks.size() >= m_capacity) {
+        return false;
+    }
+    m_tasks.enqueue({image, filePath, prepare});
+    m_hasWork.wakeOne();
+    return true;
+}
+
+int EncodeQueue::pendingCount() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_tasks.size();
+}
+
+void EncodeQueue::run()
+{
+    forever {
+        Task task;
+        {
+            QMutexLocker locker(&m_mutex);
+            while (m_tasks.isEmpty() && !m_stopping) {
+                m_hasWork.wait(&m_mutex);
+            }
+            if (m_tasks.isEmpty()) {
+                return;
+            }
+            task = m_tasks.dequeue();
+        }
+
+        if (task.prepare) {
+            task.image = task.prepare(task.image);
+        }
+        if (ImageExporter::save(task.image, task.filePath)) {
+            emit encoded(task.filePath);
+        } else {
+            qDebug() << "Failed to encode" << task.filePath;
+            emit encodeFailed(task.filePath);
+        }
+    }
+}
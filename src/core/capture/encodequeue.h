@@ -0,0 +1,49 @@
+#ifndef ENCODEQUEUE_H
+#define ENCODEQUEUE_H
+
+#include <QObject>
+#include <QImage>
+#include <QString>
+#include <QQueue>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QThread>
+#include <functional>
+
+// 有界编码队列：后台线程负责把图片写入磁盘
+// 队列满时 tryEnqueue 直接返回 false，由调用方决定丢帧，避免磁盘慢时内存无限堆积
+class EncodeQueue : public QObject
+{
+    Q_OBJECT
+public:
+    explicit EncodeQueue(int capacity = 4, QObject *parent = nullptr);
+    ~EncodeQueue();
+
+    // prepare 在编码线程中、写入前对图片做处理（例如自动打码），为空时原样写入
+    using Prepare = std::function<QImage(const QImage&)>;
+    bool tryEnqueue(const QImage& image, const QString& filePath, const Prepare& prepare = Prepare());
+    int pendingCount() const;
+    int capacity() const { return m_capacity; }
+
+signals:
+    void encoded(const QString& filePath);
+    void encodeFailed(const QString& filePath);
+
+private:
+    struct Task {
+        QImage image;
+        QString filePath;
+        Prepare prepare;
+    };
+
+    const int m_capacity;
+    QQueue<Task> m_tasks;
+    mutable QMutex m_mutex;
+    QWaitCondition m_hasWork;
+    bool m_stopping{false};
+    QThread* m_worker{nullptr};
+
+    void run();
+};
+
+#endif // ENCODEQUEUE_H
@@ -0,0 +1,93 @@
+#include "regionpresets.h"
+#include <QSettings>
+
+namespace {
+const char* kGroup = "RegionPresets";
+const char* kLastRegionKey = "lastRegion";
+const char* kPresetsKey = "presetList";
+const char* kLegacyPresetsKey = "presets";    // 旧格式：预设名直接作为键
+}
+
+RegionPresets::RegionPresets()
+{
+    load();
+}
+
+void RegionPresets::setLastRegion(const QRect& rect)
+{
+    QRect region = rect.normalized();
+    if (region.isEmpty() || region == m_lastRegion) {
+        return;
+    }
+    m_lastRegion = region;
+    store();
+}
+
+void RegionPresets::savePreset(const QString& name, const QRect& rect)
+{
+    QRect region = rect.normalized();
+    if (name.isEmpty() || region.isEmpty()) {
+        return;
+    }
+    m_presets.insert(name, region);
+    store();
+}
+
+void RegionPresets::removePreset(const QString& name)
+{
+    if (m_presets.remove(name) > 0) {
+        store();
+    }
+}
+
+void RegionPresets::load()
+{
+    QSettings settings("SCD", "SCD");
+    settings.beginGroup(kGroup);
+    m_lastRegion = settings.value(kLastRegionKey).toRect();
+
+    // 预设名可以包含 “/” “\”，不能作为 QSettings 的键（会变成子分组），按数组存储名字和区域
+    const int count = settings.beginReadArray(kPresetsKey);
+    for (int i = 0; i < count; ++i) {
+        settings.setArrayIndex(i);
+        const QString name = settings.value("name").toString();
+        const QRect rect = settings.value("rect").toRect();
+        if (!name.isEmpty() && !rect.isEmpty()) {
+            m_presets.insert(name, rect);
+        }
+    }
+    settings.endArray();
+
+    // 读取旧格式：含斜杠的名字被存成了子分组，allKeys 可以还原；下次保存时转为新格式
+    if (count == 0) {
+        settings.beginGroup(kLegacyPresetsKey);
+        for (const QString& name : settings.allKeys()) {
+            QRect rect = settings.value(name).toRect();
+            if (!rect.isEmpty()) {
+                m_presets.insert(name, rect);
+            }
+        }
+        settings.endGroup();
+    }
+    settings.endGroup();
+}
+
+void RegionPresets::store() const
+{
+    QSettings settings("SCD", "SCD");
+    settings.beginGroup(kGroup);
+    settings.setValue(kLastRegionKey, m_lastRegion);
+
+    // 整个数组重写，保证删除的预设不会残留
+    settings.remove(kLegacyPresetsKey);
+    settings.remove(kPresetsKey);
+    settings.beginWriteArray(kPresetsKey, int(m_presets.size()));
+    int index = 0;
+    for (auto it = m_presets.constBegin(); it != m_presets.constEnd(); ++it) {
+        settings.setArrayIndex(index++);
+        settings.setValue("name", it.key());
+        settings.setValue("rect", it.value());
+    }
+    settings.endArray();
+    settings.endGroup();
+}
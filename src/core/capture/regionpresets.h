@@ -0,0 +1,34 @@
+#ifndef REGIONPRESETS_H
+#define REGIONPRESETS_H
+
+#include <QRect>
+#include <QString>
+#include <QStringList>
+#include <QMap>
+
+// 选区预设：保存命名选区以及最近一次选区（全局坐标），持久化到 QSettings
+class RegionPresets
+{
+public:
+    RegionPresets();
+
+    // 最近一次选区
+    QRect lastRegion() const { return m_lastRegion; }
+    void setLastRegion(const QRect& rect);
+
+    // 命名预设
+    QStringList names() const { return m_presets.keys(); }
+    QRect preset(const QString& name) const { return m_presets.value(name); }
+    bool contains(const QString& name) const { return m_presets.contains(name); }
+    void savePreset(const QString& name, const QRect& rect);
+    void removePreset(const QString& name);
+
+private:
+    QRect m_lastRegion;
+    QMap<QString, QRect> m_presets;
+
+    void load();
+    void store() const;
+};
+
+#endif // REGIONPRESETS_H
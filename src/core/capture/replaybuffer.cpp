@@ -0,0 +1,364 @@
+#include "replaybuffer.h"
+#include "../../utils/parallelutils.h"
+#include "../image/imagehash.h"
+#include <QGuiApplication>
+#include <QScreen>
+#include <QPixmap>
+#include <QSettings>
+#include <QDateTime>
+#include <QThread>
+#include <QPointer>
+#include <QElapsedTimer>
+#include <QDebug>
+#include <cstring>
+#ifdef Q_OS_WIN
+#include <Windows.h>
+#endif
+
+namespace {
+
+constexpr int kCompressionLevel = 1;
+constexpr int kStatsFrames = 60;    // 每抓取这么多帧输出一次开销统计
+
+#ifdef Q_OS_WIN
+// 按设备名（QScreen::name()，例如 \\.\DISPLAY1）找到显示器的物理像素范围
+bool monitorRect(const QString& deviceName, RECT* rect)
+{
+    struct Search {
+        std::wstring name;
+        RECT rect;
+        bool found;
+    } search{deviceName.toStdWString(), RECT(), false};
+    EnumDisplayMonitors(nullptr, nullptr, [](HMONITOR monitor, HDC, LPRECT, LPARAM data) -> BOOL {
+        Search* search = reinterpret_cast<Search*>(data);
+        MONITORINFOEXW info;
+        info.cbSize = sizeof(info);
+        if (GetMonitorInfoW(monitor, &info) && search->name == info.szDevice) {
+            search->rect = info.rcMonitor;
+            search->found = true;
+            return FALSE;
+        }
+        return TRUE;
+    }, reinterpret_cast<LPARAM>(&search));
+    *rect = search.rect;
+    return search.found;
+}
+
+// 用 GDI 抓取一个显示器的画面，可以在任意线程调用，结果与 QScreen::grabWindow(0) 相同（物理像素）
+QImage grabMonitor(const RECT& rect)
+{
+    const int width = rect.right - rect.left;
+    const int height = rect.bottom - rect.top;
+    QImage image(width, height, QImage::Format_RGB32);
+    if (image.isNull()) {
+        return QImage();
+    }
+    HDC screen = GetDC(nullptr);
+    HDC memory = CreateCompatibleDC(screen);
+    BITMAPINFO info = {};
+    info.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+    info.bmiHeader.biWidth = width;
+    info.bmiHeader.biHeight = -height;  // 自上而下，与 QImage 的行顺序一致
+    info.bmiHeader.biPlanes = 1;
+    info.bmiHeader.biBitCount = 32;
+    info.bmiHeader.biCompression = BI_RGB;
+    void* bits = nullptr;
+    HBITMAP bitmap = CreateDIBSection(screen, &info, DIB_RGB_COLORS, &bits, nullptr, 0);
+    bool ok = false;
+    if (bitmap) {
+        HGDIOBJ previous = SelectObject(memory, bitmap);
+        ok = BitBlt(memory, 0, 0, width, height, screen, rect.left, rect.top, SRCCOPY | CAPTUREBLT);
+        GdiFlush();
+        if (ok) {
+            for (int y = 0; y < height; ++y) {
+                uint* target = reinterpret_cast<uint*>(image.scanLine(y));
+                std::memcpy(target, static_cast<const uchar*>(bits) + size_t(y) * width * 4, size_t(width) * 4);
+                // GDI 不写 alpha，补成不透明
+                for (int x = 0; x < width; ++x) {
+                    target[x] |= 0xff000000u;
+                }
+            }
+        }
+        SelectObject(memory, previous);
+        DeleteObject(bitmap);
+    }
+    DeleteDC(memory);
+    ReleaseDC(nullptr, screen);
+    return ok ? image : QImage();
+}
+#endif
+
+} // namespace
+
+ReplayBuffer::StoredTile::StoredTile(QByteArray data, quint64 hash, std::shared_ptr<std::atomic<qint64>> usage)
+    : data(std::move(data))
+    , hash(hash)
+    , usage(std::move(usage))
+{
+    *this->usage += this->data.size();
+}
+
+ReplayBuffer::StoredTile::~StoredTile()
+{
+    *usage -= data.size();
+}
+
+ReplayBuffer::ReplayBuffer(QObject *parent)
+    : QObject(parent)
+    , m_usage(std::make_shared<std::atomic<qint64>>(0))
+{
+    m_pool.setMaxThreadCount(1);
+
+    QSettings settings("SCD", "SCD");
+    const int fps = qBound(1, settings.value("replay/fps", kDefaultFps).toInt(), 4);
+    m_seconds = qBound(1, settings.value("replay/seconds", kDefaultSeconds).toInt(), 60);
+    m_memoryCap = qint64(qMax(8, settings.value("replay/memoryMB", kDefaultMemoryMB).toInt())) * 1024 * 1024;
+    m_enabled = settings.value("replay/enabled", false).toBool();
+
+    m_timer.setInterval(1000 / fps);
+    m_timer.setTimerType(Qt::CoarseTimer);
+    connect(&m_timer, &QTimer::timeout, this, &ReplayBuffer::grab);
+    updateTimer();
+}
+
+ReplayBuffer::~ReplayBuffer()
+{
+    m_timer.stop();
+    m_pool.waitForDone();
+}
+
+void ReplayBuffer::setEnabled(bool enabled)
+{
+    m_enabled = enabled;
+    QSettings("SCD", "SCD").setValue("replay/enabled", enabled);
+    if (!enabled) {
+        m_frames.clear();
+        emit framesChanged();
+    }
+    updateTimer();
+}
+
+void ReplayBuffer::setPaused(bool paused)
+{
+    m_paused = paused;
+    updateTimer();
+}
+
+void ReplayBuffer::updateTimer()
+{
+    if (m_enabled && !m_paused) {
+        m_timer.start();
+    } else {
+        m_timer.stop();
+    }
+}
+
+qint64 ReplayBuffer::timestampAt(int index) const
+{
+    return index >= 0 && index < m_frames.size() ? m_frames.at(index)->timestamp : 0;
+}
+
+void ReplayBuffer::grab()
+{
+    // 上一帧还在压缩时跳过本次，保证后台占用有上限
+    if (m_busy.exchange(true)) {
+        return;
+    }
+
+    QElapsedTimer guiTimer;
+    guiTimer.start();
+
+    QRect totalRect;
+    const QList<QScreen*> screens = QGuiApplication::screens();
+    for (QScreen *screen : screens) {
+        totalRect = totalRect.united(screen->geometry());
+    }
+    QVector<CaptureFrame::Region> regions;
+    for (QScreen *screen : screens) {
+        regions.append({screen->geometry().translated(-totalRect.topLeft()), QImage()});
+    }
+
+    // Windows 上用 GDI 在工作线程中抓屏，GUI 线程只收集屏幕布局；
+    // 找不到对应显示器（或其他平台）时退回在 GUI 线程用 QScreen::grabWindow 抓取
+    QVector<QRect> monitors;    // 各屏幕的物理像素范围，为空表示在 GUI 线程抓取
+#ifdef Q_OS_WIN
+    for (QScreen *screen : screens) {
+        RECT rect;
+        if (!monitorRect(screen->name(), &rect)) {
+            monitors.clear();
+            break;
+        }
+        monitors.append(QRect(QPoint(rect.left, rect.top), QPoint(rect.right - 1, rect.bottom - 1)));
+    }
+#endif
+    if (monitors.isEmpty()) {
+        for (int i = 0; i < screens.size(); ++i) {
+            regions[i].image = screens[i]->grabWindow(0).toImage();
+        }
+    }
+    const QPoint origin = totalRect.topLeft();
+
+    FramePtr previous = m_frames.isEmpty() ? FramePtr() : m_frames.first();
+    std::shared_ptr<std::atomic<qint64>> usage = m_usage;
+    QPointer<ReplayBuffer> self(this);
+    m_pool.start([self, regions, monitors, origin, previous, usage]() mutable {
+        QThread::currentThread()->setPriority(QThread::LowPriority);
+        QElapsedTimer workerTimer;
+        workerTimer.start();
+        bool grabbed = true;
+#ifdef Q_OS_WIN
+        for (int i = 0; i < monitors.size(); ++i) {
+            const QRect& monitor = monitors.at(i);
+            regions[i].image = grabMonitor(RECT{monitor.left(), monitor.top(),
+                                                monitor.right() + 1, monitor.bottom() + 1});
+            // 显示器在两次调用之间被拔出等情况下抓取失败，丢弃这一帧
+            grabbed = grabbed && !regions[i].image.isNull();
+        }
+#endif
+        FramePtr frame;
+        if (grabbed) {
+            frame = encode(std::make_shared<const CaptureFrame>(regions, origin), previous, usage);
+        }
+        const qint64 workerNs = workerTimer.nsecsElapsed();
+        if (self) {
+            QMetaObject::invokeMethod(self.data(), [self, frame, workerNs]() {
+                if (self) {
+                    self->m_workerNs += workerNs;
+                    self->append(frame);
+                }
+            }, Qt::QueuedConnection);
+        }
+    });
+    m_guiNs += guiTimer.nsecsElapsed();
+}
+
+void ReplayBuffer::append(const FramePtr& frame)
+{
+    m_busy = false;
+    // 后台开销统计：GUI 线程和工作线程每帧的平均耗时，按当前帧率折算为单核占用
+    if (++m_statsFrames >= kStatsFrames) {
+        const double fps = 1000.0 / m_timer.interval();
+        const double guiMs = m_guiNs / 1e6 / m_statsFrames;
+        const double workerMs = m_workerNs / 1e6 / m_statsFrames;
+        qDebug().noquote() << QString("Replay: gui %1 ms, worker %2 ms per frame, %3% of one core at %4 fps, %5 KB")
+                                  .arg(guiMs, 0, 'f', 2).arg(workerMs, 0, 'f', 2)
+                                  .arg((guiMs + workerMs) * fps / 10.0, 0, 'f', 1).arg(fps, 0, 'f', 0)
+                                  .arg(m_usage->load() / 1024);
+        m_statsFrames = 0;
+        m_guiNs = 0;
+        m_workerNs = 0;
+    }
+    if (!frame || !m_enabled) {
+        return;
+    }
+    m_frames.prepend(frame);
+    evict();
+    emit framesChanged();
+}
+
+void ReplayBuffer::evict()
+{
+    // 最新一帧总是保留；丢弃旧帧只释放不再被其他帧共享的图块
+    const qint64 oldest = QDateTime::currentMSecsSinceEpoch() - qint64(m_seconds) * 1000;
+    while (m_frames.size() > 1 && (m_frames.last()->timestamp < oldest || m_usage->load() > m_memoryCap)) {
+        m_frames.removeLast();
+    }
+}
+
+ReplayBuffer::FramePtr ReplayBuffer::encode(const CaptureFramePtr& capture, const FramePtr& previous,
+                                            const std::shared_ptr<std::atomic<qint64>>& usage)
+{
+    auto frame = std::make_shared<Frame>();
+    frame->timestamp = capture->timestamp();
+    frame->origin = capture->origin();
+    frame->size = capture->size();
+    frame->columns = capture->columns();
+    frame->rows = capture->rows();
+    for (const CaptureFrame::Region& region : capture->regions()) {
+        frame->regions.append(region.rect);
+    }
+    frame->tiles.resize(frame->columns * frame->rows);
+
+    // 屏幕布局变化后图块位置不再对应，整帧重新保存
+    const bool comparable = previous && previous->origin == frame->origin && previous->size == frame->size;
+
+    QByteArray raw;
+    for (int row = 0; row < frame->rows; ++row) {
+        for (int column = 0; column < frame->columns; ++column) {
+            const QImage& tile = capture->tile(column, row);
+            if (tile.isNull()) {
+                continue;
+            }
+            const int index = row * frame->columns + column;
+            const quint64 hash = ImageHash::content(tile);
+            if (comparable && previous->tiles.at(index) && previous->tiles.at(index)->hash == hash) {
+                frame->tiles[index] = previous->tiles.at(index);
+                continue;
+            }
+            // 去掉扫描行的对齐填充后压缩
+            const int rowBytes = tile.width() * 4;
+            raw.resize(rowBytes * tile.height());
+            for (int y = 0; y < tile.height(); ++y) {
+                std::memcpy(raw.data() + y * rowBytes, tile.constScanLine(y), size_t(rowBytes));
+            }
+            frame->tiles[index] = std::make_shared<const StoredTile>(qCompress(raw, kCompressionLevel), hash, usage);
+        }
+    }
+    return frame;
+}
+
+CaptureFramePtr ReplayBuffer::frameAt(int index) const
+{
+    if (index < 0 || index >= m_frames.size()) {
+        return CaptureFramePtr();
+    }
+    const FramePtr frame = m_frames.at(index);
+
+    QVector<CaptureFrame::Region> regions;
+    QVector<uchar*> bits;
+    for (const QRect& rect : frame->regions) {
+        QImage image(rect.size(), QImage::Format_ARGB32_Premultiplied);
+        image.fill(Qt::transparent);
+        regions.append({rect, image});
+    }
+    // 先在当前线程取得可写指针，工作线程中不再触发 QImage 的分离检查
+    for (CaptureFrame::Region& region : regions) {
+        bits.append(region.image.bits());
+    }
+
+    // 图块之间互不重叠，可以并行解压并写入各自的像素
+    ParallelUtils::forRange(frame->tiles.size(), 4, [&frame, &regions, &bits](int begin, int end) {
+        for (int index = begin; index < end; ++index) {
+            const TilePtr& stored = frame->tiles.at(index);
+            if (!stored) {
+                continue;
+            }
+            const int column = index % frame->columns;
+            const int row = index / frame->columns;
+            const QRect tileRect = QRect(column * CaptureFrame::kTileSize, row * CaptureFrame::kTileSize,
+                                         CaptureFrame::kTileSize, CaptureFrame::kTileSize)
+                                       .intersected(QRect(QPoint(0, 0), frame->size));
+            const QByteArray raw = qUncompress(stored->data);
+            const int rowBytes = tileRect.width() * 4;
+            if (raw.size() != rowBytes * tileRect.height()) {
+                continue;
+            }
+            for (int i = 0; i < regions.size(); ++i) {
+                const CaptureFrame::Region& region = regions.at(i);
+                const QRect part = region.rect.intersected(tileRect);
+                if (part.isEmpty()) {
+                    continue;
+                }
+                const int sourceX = part.left() - tileRect.left();
+                for (int y = part.top(); y <= part.bottom(); ++y) {
+                    const char* source = raw.constData() + (y - tileRect.top()) * rowBytes + sourceX * 4;
+                    uchar* target = bits[i] + (y - region.rect.top()) * region.image.bytesPerLine()
+                        + (part.left() - region.rect.left()) * 4;
+                    std::memcpy(target, source, size_t(part.width()) * 4);
+                }
+            }
+        }
+    });
+
+    return std::make_shared<const CaptureFrame>(regions, frame->origin);
+}
@@ -0,0 +1,91 @@
+#ifndef REPLAYBUFFER_H
+#define REPLAYBUFFER_H
+
+#include <QObject>
+#include <QTimer>
+#include <QThreadPool>
+#include <QVector>
+#include <QList>
+#include <QRect>
+#include <atomic>
+#include <memory>
+#include "captureframe.h"
+
+// 回放缓冲：后台以 1~4 fps 抓取桌面，保存最近若干秒的画面，截图界面可以回到按下快捷键之前的画面
+// Windows 上抓屏、哈希和压缩都在低优先级的工作线程中完成，GUI 线程只收集屏幕布局
+//
+// 每帧按 CaptureFrame 的图块切分并计算内容哈希，与上一帧相同的图块直接共享，
+// 只有变化的图块在工作线程中压缩保存。所有压缩图块的总大小受内存上限约束，
+// 超出上限或超出时长的最旧帧被丢弃
+class ReplayBuffer : public QObject
+{
+    Q_OBJECT
+public:
+    static constexpr int kDefaultFps = 2;
+    static constexpr int kDefaultSeconds = 10;
+    static constexpr int kDefaultMemoryMB = 64;
+
+    explicit ReplayBuffer(QObject *parent = nullptr);
+    ~ReplayBuffer();
+
+    // 开关保存在设置中，默认关闭
+    bool isEnabled() const { return m_enabled; }
+    void setEnabled(bool enabled);
+    // 截图界面显示期间暂停，避免抓到遮罩本身
+    void setPaused(bool paused);
+
+    // 已缓存的帧数，0 为最新
+    int count() const { return m_frames.size(); }
+    qint64 timestampAt(int index) const;
+    // 解压出完整的一帧，图块并行解压
+    CaptureFramePtr frameAt(int index) const;
+    qint64 memoryBytes() const { return m_usage->load(); }
+
+signals:
+    void framesChanged();
+
+private:
+    // 一个压缩后的图块，多帧之间共享；析构时从总用量中扣除
+    struct StoredTile {
+        StoredTile(QByteArray data, quint64 hash, std::shared_ptr<std::atomic<qint64>> usage);
+        ~StoredTile();
+        QByteArray data;
+        quint64 hash;
+        std::shared_ptr<std::atomic<qint64>> usage;
+    };
+    using TilePtr = std::shared_ptr<const StoredTile>;
+
+    struct Frame {
+        qint64 timestamp{0};
+        QPoint origin;
+        QSize size;
+        QVector<QRect> regions;     // 各屏幕区域，用于还原时分配像素
+        int columns{0};
+        int rows{0};
+        QVector<TilePtr> tiles;     // 屏幕之间的空隙为空
+    };
+    using FramePtr = std::shared_ptr<const Frame>;
+
+    QTimer m_timer;
+    QThreadPool m_pool;             // 单线程、低优先级
+    std::atomic<bool> m_busy{false};
+    std::shared_ptr<std::atomic<qint64>> m_usage;
+    QList<FramePtr> m_frames;       // 最新的在前，只在 GUI 线程修改
+    bool m_enabled{false};
+    bool m_paused{false};
+    int m_seconds{kDefaultSeconds};
+    qint64 m_memoryCap{qint64(kDefaultMemoryMB) * 1024 * 1024};
+    // 开销统计，只在 GUI 线程访问
+    int m_statsFrames{0};
+    qint64 m_guiNs{0};
+    qint64 m_workerNs{0};
+
+    void grab();
+    void append(const FramePtr& frame);
+    void evict();
+    void updateTimer();
+    static FramePtr encode(const CaptureFramePtr& capture, const FramePtr& previous,
+                           const std::shared_ptr<std::atomic<qint64>>& usage);
+};
+
+#endif // REPLAYBUFFER_H
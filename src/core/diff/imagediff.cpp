@@ -0,0 +1,228 @@
+#include "imagediff.h"
+#include "../../utils/parallelutils.h"
+#include "../../utils/simdutils.h"
+#include <QtAlgorithms>
+#include <algorithm>
+#include <numeric>
+#include <atomic>
+
+namespace {
+
+// 单个块内变化像素的精确包围盒（绝对坐标），count 为 0 表示块内无变化
+struct BlockBounds {
+    int minX;
+    int minY;
+    int maxX;
+    int maxY;
+    int count;
+};
+
+inline bool pixelChanged(quint32 a, quint32 b, int tolerance)
+{
+    for (int shift = 0; shift < 32; shift += 8) {
+        int da = int((a >> shift) & 0xff) - int((b >> shift) & 0xff);
+        if (da > tolerance || -da > tolerance) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// 比较一行中的 16 个像素，返回每像素一位的变化掩码，并可选写出掩码字节
+inline quint32 compareSpan16(const quint32* a, const quint32* b, uchar* maskOut, int tolerance)
+{
+#ifdef SCD_HAVE_SSE2
+    const __m128i tol = _mm_set1_epi8(char(qBound(0, tolerance, 255)));
+    const __m128i zero = _mm_setzero_si128();
+    __m128i same[4];
+    for (int i = 0; i < 4; ++i) {
+        __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i * 4));
+        __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i * 4));
+        __m128i absDiff = _mm_or_si128(_mm_subs_epu8(va, vb), _mm_subs_epu8(vb, va));
+        // 任一通道超出容差，该像素的 32 位即非零
+        same[i] = _mm_cmpeq_epi32(_mm_subs_epu8(absDiff, tol), zero);
+    }
+    __m128i packed = _mm_packs_epi16(_mm_packs_epi32(same[0], same[1]),
+                                     _mm_packs_epi32(same[2], same[3]));
+    __m128i changed = _mm_xor_si128(packed, _mm_set1_epi8(char(0xff)));
+    if (maskOut) {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(maskOut), changed);
+    }
+    return quint32(_mm_movemask_epi8(changed));
+#else
+    quint32 bits = 0;
+    for (int i = 0; i < 16; ++i) {
+        bool changed = pixelChanged(a[i], b[i], tolerance);
+        if (maskOut) {
+            maskOut[i] = changed ? 255 : 0;
+        }
+        bits |= quint32(changed) << i;
+    }
+    return bits;
+#endif
+}
+
+inline void extendBlock(BlockBounds& block, int x0, int x1, int y, int count)
+{
+    if (block.count == 0) {
+        block.minX = x0;
+        block.maxX = x1;
+        block.minY = y;
+        block.maxY = y;
+    } else {
+        block.minX = qMin(block.minX, x0);
+        block.maxX = qMax(block.maxX, x1);
+        block.maxY = y;
+    }
+    block.count += count;
+}
+
+int findRoot(QVector<int>& parent, int i)
+{
+    while (parent[i] != i) {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+    return i;
+}
+
+void unite(QVector<int>& parent, int a, int b)
+{
+    a = findRoot(parent, a);
+    b = findRoot(parent, b);
+    if (a != b) {
+        parent[qMax(a, b)] = qMin(a, b);
+    }
+}
+
+} // namespace
+
+ImageDiff::Result ImageDiff::compare(const QImage& before, const QImage& after, const Options& options)
+{
+    Result result;
+    if (before.isNull() || after.isNull()) {
+        return result;
+    }
+
+    // 统一为 32 位格式后按整像素比较
+    const QImage::Format format = QImage::Format_ARGB32_Premultiplied;
+    const QImage imageA = before.format() == format ? before : before.convertToFormat(format);
+    const QImage imageB = after.format() == format ? after : after.convertToFormat(format);
+
+    const int width = qMin(imageA.width(), imageB.width());
+    const int height = qMin(imageA.height(), imageB.height());
+    result.size = QSize(width, height);
+    if (options.buildMask) {
+        result.mask = QImage(width, height, QImage::Format_Grayscale8);
+    }
+
+    const int blocksX = (width + kBlockSize - 1) / kBlockSize;
+    const int blocksY = (height + kBlockSize - 1) / kBlockSize;
+    QVector<BlockBounds> blocks(blocksX * blocksY, BlockBounds{0, 0, 0, 0, 0});
+    std::atomic<qint64> changedPixels{0};
+    uchar* maskBits = options.buildMask ? result.mask.bits() : nullptr;
+    const qsizetype maskStride = options.buildMask ? result.mask.bytesPerLine() : 0;
+
+    // 按块行切分，每个块行只由一个线程写入
+    ParallelUtils::forRange(blocksY, 8, [&](int firstBlockRow, int lastBlockRow) {
+        qint64 localChanged = 0;
+        const int yEnd = qMin(height, lastBlockRow * kBlockSize);
+        for (int y = firstBlockRow * kBlockSize; y < yEnd; ++y) {
+            const quint32* rowA = reinterpret_cast<const quint32*>(imageA.constScanLine(y));
+            const quint32* rowB = reinterpret_cast<const quint32*>(imageB.constScanLine(y));
+            uchar* maskRow = maskBits ? maskBits + y * maskStride : nullptr;
+            BlockBounds* blockRow = blocks.data() + (y / kBlockSize) * blocksX;
+
+            int x = 0;
+            for (; x + kBlockSize <= width; x += kBlockSize) {
+                quint32 bits = compareSpan16(rowA + x, rowB + x, maskRow ? maskRow + x : nullptr,
+                                             options.tolerance);
+                if (bits) {
+                    int count = qPopulationCount(bits);
+                    int first = x + qCountTrailingZeroBits(bits);
+                    int last = x + 31 - qCountLeadingZeroBits(bits);
+                    extendBlock(blockRow[x / kBlockSize], first, last, y, count);
+                    localChanged += count;
+                }
+            }
+            // 行尾不足一个块的像素
+            for (; x < width; ++x) {
+                bool changed = pixelChanged(rowA[x], rowB[x], options.tolerance);
+                if (maskRow) {
+                    maskRow[x] = changed ? 255 : 0;
+                }
+                if (changed) {
+                    extendBlock(blockRow[x / kBlockSize], x, x, y, 1);
+                    ++localChanged;
+                }
+            }
+        }
+        changedPixels += localChanged;
+    });
+    result.changedPixels = changedPixels.load();
+
+    // 在块网格上做 8 连通的连通域分析
+    QVector<int> parent(blocks.size());
+    std::iota(parent.begin(), parent.end(), 0);
+    for (int by = 0; by < blocksY; ++by) {
+        for (int bx = 0; bx < blocksX; ++bx) {
+            int index = by * blocksX + bx;
+            if (blocks[index].count == 0) {
+                continue;
+            }
+            if (bx > 0 && blocks[index - 1].count) {
+                unite(parent, index, index - 1);
+            }
+            if (by > 0) {
+                int up = index - blocksX;
+                if (blocks[up].count) unite(parent, index, up);
+                if (bx > 0 && blocks[up - 1].count) unite(parent, index, up - 1);
+                if (bx + 1 < blocksX && blocks[up + 1].count) unite(parent, index, up + 1);
+            }
+        }
+    }
+
+    // 按根节点汇总包围盒
+    QVector<int> regionOfRoot(blocks.size(), -1);
+    QVector<BlockBounds> regions;
+    for (int index = 0; index < blocks.size(); ++index) {
+        const BlockBounds& block = blocks[index];
+        if (block.count == 0) {
+            continue;
+        }
+        int root = findRoot(parent, index);
+        if (regionOfRoot[root] < 0) {
+            regionOfRoot[root] = regions.size();
+            regions.append(block);
+        } else {
+            BlockBounds& region = regions[regionOfRoot[root]];
+            region.minX = qMin(region.minX, block.minX);
+            region.minY = qMin(region.minY, block.minY);
+            region.maxX = qMax(region.maxX, block.maxX);
+            region.maxY = qMax(region.maxY, block.maxY);
+            region.count += block.count;
+        }
+    }
+
+    for (const BlockBounds& region : regions) {
+        if (region.count >= options.minRegionPixels) {
+            result.regions.append(QRect(QPoint(region.minX, region.minY),
+                                        QPoint(region.maxX, region.maxY)));
+        }
+    }
+
+    // 尺寸不同的部分整体视为变化
+    const int fullWidth = qMax(imageA.width(), imageB.width());
+    const int fullHeight = qMax(imageA.height(), imageB.height());
+    if (fullWidth > width) {
+        result.regions.append(QRect(width, 0, fullWidth - width, fullHeight));
+    }
+    if (fullHeight > height) {
+        result.regions.append(QRect(0, height, width, fullHeight - height));
+    }
+
+    std::sort(result.regions.begin(), result.regions.end(), [](const QRect& a, const QRect& b) {
+        return qint64(a.width()) * a.height() > qint64(b.width()) * b.height();
+    });
+    return result;
+}
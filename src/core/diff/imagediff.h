@@ -0,0 +1,34 @@
+#ifndef IMAGEDIFF_H
+#define IMAGEDIFF_H
+
+#include <QImage>
+#include <QRect>
+#include <QVector>
+
+// 图片差异比较：逐像素生成差异掩码，再用连通域分析得到变化区域的包围盒
+class ImageDiff
+{
+public:
+    struct Options {
+        int tolerance{16};         // 单个通道的允许误差
+        int minRegionPixels{4};    // 变化像素少于该值的区域视为噪点
+        bool buildMask{true};      // 是否输出逐像素掩码
+    };
+
+    struct Result {
+        QSize size;                // 参与比较的区域（两图左上角对齐后的交集）
+        QImage mask;               // Format_Grayscale8，变化像素为 255
+        QVector<QRect> regions;    // 变化区域，按面积从大到小排序
+        qint64 changedPixels{0};
+
+        bool isIdentical() const { return regions.isEmpty(); }
+    };
+
+    static Result compare(const QImage& before, const QImage& after, const Options& options);
+    static Result compare(const QImage& before, const QImage& after) { return compare(before, after, Options()); }
+
+    // 分块边长：连通域分析在块网格上进行
+    static constexpr int kBlockSize = 16;
+};
+
+#endif // IMAGEDIFF_H
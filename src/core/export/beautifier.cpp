@@ -0,0 +1,280 @@
+#include "beautifier.h"
+#include "../../utils/parallelutils.h"
+#include "../../utils/simdutils.h"
+#include <QCache>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QPainter>
+#include <QSettings>
+#include <cstring>
+
+namespace {
+
+constexpr int kColumnChunk = 256;   // 竖直模糊时每个任务处理的列数
+constexpr int kTransposeBlock = 32;
+
+struct ShadowCache {
+    QMutex mutex;
+    QCache<quint64, QImage> images;
+
+    explicit ShadowCache(int maxCost) : images(maxCost) {}
+};
+
+// sums[i] += row[i]（add 为 true）或 sums[i] -= row[i]；16 位累加，窗口和不超过 65535
+void accumulateRow(quint16* sums, const uchar* row, int count, bool add)
+{
+    int i = 0;
+#ifdef SCD_HAVE_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 16 <= count; i += 16) {
+        const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+        __m128i* lo = reinterpret_cast<__m128i*>(sums + i);
+        __m128i* hi = reinterpret_cast<__m128i*>(sums + i + 8);
+        const __m128i plo = _mm_unpacklo_epi8(pixels, zero);
+        const __m128i phi = _mm_unpackhi_epi8(pixels, zero);
+        if (add) {
+            _mm_storeu_si128(lo, _mm_add_epi16(_mm_loadu_si128(lo), plo));
+            _mm_storeu_si128(hi, _mm_add_epi16(_mm_loadu_si128(hi), phi));
+        } else {
+            _mm_storeu_si128(lo, _mm_sub_epi16(_mm_loadu_si128(lo), plo));
+            _mm_storeu_si128(hi, _mm_sub_epi16(_mm_loadu_si128(hi), phi));
+        }
+    }
+#endif
+    for (; i < count; ++i) {
+        sums[i] = quint16(add ? sums[i] + row[i] : sums[i] - row[i]);
+    }
+}
+
+// out[i] = sums[i] / window，用乘以倒数再取高 16 位代替除法
+void writeAverages(const quint16* sums, uchar* out, int count, quint16 reciprocal)
+{
+    int i = 0;
+#ifdef SCD_HAVE_SSE2
+    const __m128i factor = _mm_set1_epi16(short(reciprocal));
+    for (; i + 16 <= count; i += 16) {
+        const __m128i lo = _mm_mulhi_epu16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(sums + i)), factor);
+        const __m128i hi = _mm_mulhi_epu16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(sums + i + 8)), factor);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_packus_epi16(lo, hi));
+    }
+#endif
+    for (; i < count; ++i) {
+        out[i] = uchar((quint32(sums[i]) * reciprocal) >> 16);
+    }
+}
+
+// 竖直方向的盒式模糊，窗口外按 0 计。src 与 dst 都按 width 紧密排列
+void blurVertical(const uchar* src, uchar* dst, int width, int height, int radius)
+{
+    const int window = 2 * radius + 1;
+    const quint16 reciprocal = quint16((65536 + window - 1) / window);
+    const int chunks = (width + kColumnChunk - 1) / kColumnChunk;
+    ParallelUtils::forRange(chunks, 1, [=](int begin, int end) {
+        QVector<quint16> buffer(kColumnChunk);
+        quint16* sums = buffer.data();
+        for (int chunk = begin; chunk < end; ++chunk) {
+            const int x = chunk * kColumnChunk;
+            const int count = qMin(kColumnChunk, width - x);
+            std::memset(sums, 0, sizeof(quint16) * size_t(count));
+            for (int y = 0; y <= radius && y < height; ++y) {
+                accumulateRow(sums, src + qsizetype(y) * width + x, count, true);
+            }
+            for (int y = 0; y < height; ++y) {
+                writeAverages(sums, dst + qsizetype(y) * width + x, count, reciprocal);
+                if (y + radius + 1 < height) {
+                    accumulateRow(sums, src + qsizetype(y + radius + 1) * width + x, count, true);
+                }
+                if (y - radius >= 0) {
+                    accumulateRow(sums, src + qsizetype(y - radius) * width + x, count, false);
+                }
+            }
+        }
+    });
+}
+
+// 转置：dst 为 height × width，按分块访问减少缓存缺失
+void transpose(const uchar* src, uchar* dst, int width, int height)
+{
+    const int blockRows = (height + kTransposeBlock - 1) / kTransposeBlock;
+    ParallelUtils::forRange(blockRows, 1, [=](int begin, int end) {
+        for (int block = begin; block < end; ++block) {
+            const int y0 = block * kTransposeBlock;
+            const int y1 = qMin(height, y0 + kTransposeBlock);
+            for (int x0 = 0; x0 < width; x0 += kTransposeBlock) {
+                const int x1 = qMin(width, x0 + kTransposeBlock);
+                for (int y = y0; y < y1; ++y) {
+                    const uchar* row = src + qsizetype(y) * width;
+                    for (int x = x0; x < x1; ++x) {
+                        dst[qsizetype(x) * height + y] = row[x];
+                    }
+                }
+            }
+        }
+    });
+}
+
+QImage buildShadow(const QSize& size, int radius, int cornerRadius, int opacity, int passes)
+{
+    const int boxRadius = Beautifier::shadowMargin(radius) / passes;
+    const int margin = boxRadius * passes;
+    const int width = size.width() + 2 * margin;
+    const int height = size.height() + 2 * margin;
+
+    // 圆角矩形遮罩
+    QImage mask(width, height, QImage::Format_Alpha8);
+    mask.fill(0);
+    {
+        QPainter painter(&mask);
+        painter.setRenderHint(QPainter::Antialiasing);
+        painter.setPen(Qt::NoPen);
+        painter.setBrush(QColor(0, 0, 0, opacity));
+        painter.drawRoundedRect(QRectF(margin, margin, size.width(), size.height()), cornerRadius, cornerRadius);
+    }
+
+    QByteArray first(qsizetype(width) * height, Qt::Uninitialized);
+    QByteArray second(qsizetype(width) * height, Qt::Uninitialized);
+    uchar* a = reinterpret_cast<uchar*>(first.data());
+    uchar* b = reinterpret_cast<uchar*>(second.data());
+    for (int y = 0; y < height; ++y) {
+        std::memcpy(a + qsizetype(y) * width, mask.constScanLine(y), size_t(width));
+    }
+
+    // 竖直模糊若干次，转置后再竖直模糊（即原图的水平方向），最后转置回来
+    for (int pass = 0; pass < passes; ++pass) {
+        blurVertical(a, b, width, height, boxRadius);
+        std::swap(a, b);
+    }
+    transpose(a, b, width, height);
+    std::swap(a, b);
+    for (int pass = 0; pass < passes; ++pass) {
+        blurVertical(a, b, height, width, boxRadius);
+        std::swap(a, b);
+    }
+    transpose(a, b, height, width);
+
+    // 黑色投影：预乘 ARGB 中只有 alpha 分量
+    QImage shadow(width, height, QImage::Format_ARGB32_Premultiplied);
+    uchar* bits = shadow.bits();
+    const qsizetype stride = shadow.bytesPerLine();
+    const uchar* alpha = b;
+    ParallelUtils::forRange(height, 32, [=](int begin, int end) {
+        for (int y = begin; y < end; ++y) {
+            QRgb* line = reinterpret_cast<QRgb*>(bits + y * stride);
+            const uchar* source = alpha + qsizetype(y) * width;
+            for (int x = 0; x < width; ++x) {
+                line[x] = QRgb(source[x]) << 24;
+            }
+        }
+    });
+    return shadow;
+}
+
+// 只处理四个角：每个角用四分之一圆的遮罩做 DestinationIn，其余像素不动
+QImage roundCorners(const QImage& image, int radius)
+{
+    QImage result = image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    radius = qMin(radius, qMin(result.width(), result.height()) / 2);
+    if (radius <= 0) {
+        return result;
+    }
+
+    QImage corner(radius, radius, QImage::Format_ARGB32_Premultiplied);
+    corner.fill(Qt::transparent);
+    {
+        QPainter painter(&corner);
+        painter.setRenderHint(QPainter::Antialiasing);
+        painter.setPen(Qt::NoPen);
+        painter.setBrush(Qt::black);
+        painter.drawEllipse(QRectF(0, 0, 2 * radius, 2 * radius));
+    }
+
+    QPainter painter(&result);
+    painter.setCompositionMode(QPainter::CompositionMode_DestinationIn);
+    const int right = result.width() - radius;
+    const int bottom = result.height() - radius;
+    painter.drawImage(QPoint(0, 0), corner);
+    painter.drawImage(QPoint(right, 0), corner.mirrored(true, false));
+    painter.drawImage(QPoint(0, bottom), corner.mirrored(false, true));
+    painter.drawImage(QPoint(right, bottom), corner.mirrored(true, true));
+    return result;
+}
+
+} // namespace
+
+bool Beautifier::isEnabled()
+{
+    return QSettings("SCD", "SCD").value("beautify/enabled", false).toBool();
+}
+
+void Beautifier::setEnabled(bool enabled)
+{
+    QSettings settings("SCD", "SCD");
+    settings.setValue("beautify/enabled", enabled);
+}
+
+Beautifier::Style Beautifier::style()
+{
+    QSettings settings("SCD", "SCD");
+    Style style;
+    style.padding = qBound(0, settings.value("beautify/padding", style.padding).toInt(), 512);
+    style.cornerRadius = qBound(0, settings.value("beautify/cornerRadius", style.cornerRadius).toInt(), 255);
+    style.shadowRadius = qBound(0, settings.value("beautify/shadowRadius", style.shadowRadius).toInt(), 255);
+    style.shadowOpacity = qBound(0, settings.value("beautify/shadowOpacity", style.shadowOpacity).toInt(), 255);
+    style.shadowOffset = settings.value("beautify/shadowOffset", style.shadowOffset).toPoint();
+    const QColor background(settings.value("beautify/background", style.background.name(QColor::HexArgb)).toString());
+    if (background.isValid()) {
+        style.background = background;
+    }
+    return style;
+}
+
+int Beautifier::shadowMargin(int radius)
+{
+    // 三次盒式模糊的总半径约等于投影半径
+    return qBound(1, (radius + kPasses - 1) / kPasses, 127) * kPasses;
+}
+
+QImage Beautifier::shadow(const QSize& size, int radius, int cornerRadius, int opacity)
+{
+    static ShadowCache cache(kCacheKB);
+    if (size.isEmpty() || size.width() > 0xffff || size.height() > 0xffff) {
+        return QImage();
+    }
+    radius = qBound(1, radius, 255);
+    cornerRadius = qBound(0, cornerRadius, 255);
+    opacity = qBound(0, opacity, 255);
+    const quint64 key = quint64(size.width()) | (quint64(size.height()) << 16) | (quint64(radius) << 32)
+                      | (quint64(cornerRadius) << 40) | (quint64(opacity) << 48);
+    {
+        QMutexLocker locker(&cache.mutex);
+        if (QImage* cached = cache.images.object(key)) {
+            return *cached;
+        }
+    }
+
+    // 在锁外生成，并发请求同一尺寸时可能重复计算，但不会互相阻塞
+    QImage result = buildShadow(size, radius, cornerRadius, opacity, kPasses);
+    QMutexLocker locker(&cache.mutex);
+    cache.images.insert(key, new QImage(result), int(qMax<qint64>(1, result.sizeInBytes() / 1024)));
+    return result;
+}
+
+QImage Beautifier::apply(const QImage& image, const Style& style)
+{
+    if (image.isNull()) {
+        return image;
+    }
+    const int padding = qMax(0, style.padding);
+    QImage result(image.size() + QSize(2 * padding, 2 * padding), QImage::Format_ARGB32_Premultiplied);
+    result.fill(style.background);
+
+    QPainter painter(&result);
+    if (style.shadowRadius > 0 && style.shadowOpacity > 0) {
+        const int margin = shadowMargin(style.shadowRadius);
+        painter.drawImage(QPoint(padding - margin, padding - margin) + style.shadowOffset,
+                          shadow(image.size(), style.shadowRadius, style.cornerRadius, style.shadowOpacity));
+    }
+    painter.drawImage(QPoint(padding, padding), roundCorners(image, style.cornerRadius));
+    painter.end();
+    return result;
+}
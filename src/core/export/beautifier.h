@@ -0,0 +1,42 @@
+#ifndef BEAUTIFIER_H
+#define BEAUTIFIER_H
+
+#include <QImage>
+#include <QColor>
+#include <QPoint>
+#include <QSize>
+
+// 导出美化：在截图四周留白、铺背景色、裁出圆角并加柔和的投影
+//
+// 投影是圆角矩形遮罩经三次盒式模糊（近似高斯）得到的：竖直方向按行推进，每列维护滑动窗口和，
+// 一次处理 16 列；水平方向先转置再做同样的竖直模糊。结果按（尺寸、模糊半径、圆角、不透明度）缓存，
+// 同样大小的选区再次导出或在截图界面预览时只需一次绘制
+class Beautifier
+{
+public:
+    struct Style {
+        int padding = 48;
+        int cornerRadius = 10;
+        int shadowRadius = 28;
+        int shadowOpacity = 110;        // 0-255
+        QPoint shadowOffset{0, 12};
+        QColor background{232, 237, 243};
+    };
+
+    // 设置保存在 beautify/ 下，默认关闭
+    static bool isEnabled();
+    static void setEnabled(bool enabled);
+    static Style style();
+
+    static QImage apply(const QImage& image, const Style& style);
+
+    // 内容尺寸为 size 的投影（黑色，预乘 ARGB），四周比内容多出 shadowMargin(radius)；可在任意线程调用
+    static QImage shadow(const QSize& size, int radius, int cornerRadius, int opacity);
+    static int shadowMargin(int radius);
+
+private:
+    static constexpr int kPasses = 3;
+    static constexpr int kCacheKB = 64 * 1024;
+};
+
+#endif // BEAUTIFIER_H
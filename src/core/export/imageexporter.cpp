@@ -0,0 +1,236 @@
+#include "imageexporter.h"
+#include "parallelpngencoder.h"
+#include "palettequantizer.h"
+#include "qoicodec.h"
+#include "../image/resampler.h"
+#include <QBuffer>
+#include <QFile>
+#include <QFileInfo>
+#include <QImageWriter>
+#include <QSaveFile>
+#include <QSettings>
+#include <QDebug>
+#include <cstring>
+
+namespace {
+
+const char* kPresetKey = "export/preset";
+const char* kPaletteKey = "export/palette";
+const char* kDitherKey = "export/dither";
+const char* kScaleKey = "export/scale";
+
+// 转换为调色板后编码；颜色过多且不量化时返回空数组，由调用方写全彩 PNG
+QByteArray encodePalettePng(const QImage& image, ImageExporter::Preset preset,
+                            ImageExporter::PaletteMode mode, bool dither)
+{
+    PaletteQuantizer::Options options;
+    options.quantize = (mode == ImageExporter::PaletteMode::Quantize);
+    options.dither = dither;
+    const PaletteQuantizer::Result indexed = PaletteQuantizer::quantize(image, options);
+    if (!indexed.isValid()) {
+        return QByteArray();
+    }
+
+    if (ParallelPngEncoder::isAvailable()) {
+        // 索引值之间没有数值关系，滤波通常只会让数据更难压缩
+        ParallelPngEncoder::Options pngOptions;
+        pngOptions.filter = ParallelPngEncoder::Filter::None;
+        pngOptions.compressionLevel = preset == ImageExporter::Preset::Fastest ? 1
+                                    : preset == ImageExporter::Preset::Smallest ? 9 : 6;
+        return ParallelPngEncoder::encodeIndexed(indexed.indices, indexed.size, indexed.palette, pngOptions);
+    }
+
+    // 未链接 zlib：交给 QImageWriter，它会把 Indexed8 图片写成调色板 PNG
+    QImage image8(indexed.size, QImage::Format_Indexed8);
+    image8.setColorTable(indexed.palette);
+    const int width = indexed.size.width();
+    for (int y = 0; y < image8.height(); ++y) {
+        std::memcpy(image8.scanLine(y), indexed.indices.constData() + qsizetype(y) * width, size_t(width));
+    }
+    QByteArray data;
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::WriteOnly);
+    QImageWriter writer(&buffer, "png");
+    writer.setQuality(preset == ImageExporter::Preset::Fastest ? 90 : preset == ImageExporter::Preset::Smallest ? 0 : -1);
+    return writer.write(image8) ? data : QByteArray();
+}
+
+} // namespace
+
+ImageExporter::Format ImageExporter::formatForPath(const QString& path)
+{
+    const QString suffix = QFileInfo(path).suffix().toLower();
+    if (suffix == "png") {
+        return Format::Png;
+    }
+    if (suffix == "qoi") {
+        return Format::Qoi;
+    }
+    if (suffix == "webp") {
+        return Format::WebP;
+    }
+    return Format::Other;
+}
+
+ImageExporter::Preset ImageExporter::preset()
+{
+    QSettings settings("SCD", "SCD");
+    int value = settings.value(kPresetKey, int(Preset::Balanced)).toInt();
+    return value >= int(Preset::Fastest) && value <= int(Preset::Smallest)
+        ? Preset(value) : Preset::Balanced;
+}
+
+void ImageExporter::setPreset(Preset preset)
+{
+    QSettings settings("SCD", "SCD");
+    settings.setValue(kPresetKey, int(preset));
+}
+
+QString ImageExporter::presetName(Preset preset)
+{
+    switch (preset) {
+    case Preset::Fastest: return "fastest";
+    case Preset::Smallest: return "smallest";
+    default: return "balanced";
+    }
+}
+
+ImageExporter::PaletteMode ImageExporter::paletteMode()
+{
+    QSettings settings("SCD", "SCD");
+    int value = settings.value(kPaletteKey, int(PaletteMode::Exact)).toInt();
+    return value >= int(PaletteMode::Off) && value <= int(PaletteMode::Quantize)
+        ? PaletteMode(value) : PaletteMode::Exact;
+}
+
+void ImageExporter::setPaletteMode(PaletteMode mode)
+{
+    QSettings settings("SCD", "SCD");
+    settings.setValue(kPaletteKey, int(mode));
+}
+
+bool ImageExporter::isDitherEnabled()
+{
+    return QSettings("SCD", "SCD").value(kDitherKey, true).toBool();
+}
+
+void ImageExporter::setDitherEnabled(bool enabled)
+{
+    QSettings settings("SCD", "SCD");
+    settings.setValue(kDitherKey, enabled);
+}
+
+int ImageExporter::scalePercent()
+{
+    return qBound(1, QSettings("SCD", "SCD").value(kScaleKey, 100).toInt(), 100);
+}
+
+void ImageExporter::setScalePercent(int percent)
+{
+    QSettings settings("SCD", "SCD");
+    settings.setValue(kScaleKey, qBound(1, percent, 100));
+}
+
+QImage ImageExporter::scaledForExport(const QImage& image)
+{
+    const int percent = scalePercent();
+    if (percent >= 100 || image.isNull()) {
+        return image;
+    }
+    const QSize size = (QSizeF(image.size()) * (percent / 100.0)).toSize().expandedTo(QSize(1, 1));
+    return Resampler::scale(image, size, Resampler::Filter::Lanczos3);
+}
+
+bool ImageExporter::isWebPAvailable()
+{
+    return QImageWriter::supportedImageFormats().contains("webp");
+}
+
+QByteArray ImageExporter::encode(const QImage& image, Format format, Preset preset, PaletteMode palette, bool dither)
+{
+    if (image.isNull()) {
+        return QByteArray();
+    }
+
+    if (format == Format::Png && palette != PaletteMode::Off) {
+        QByteArray data = encodePalettePng(image, preset, palette, dither);
+        if (!data.isEmpty()) {
+            return data;
+        }
+    }
+
+    if (format == Format::Qoi) {
+        return QoiCodec::encode(image);
+    }
+
+    if (format == Format::Png && ParallelPngEncoder::isAvailable()) {
+        ParallelPngEncoder::Options options;
+        switch (preset) {
+        case Preset::Fastest:
+            options.compressionLevel = 1;
+            options.filter = ParallelPngEncoder::Filter::None;
+            break;
+        case Preset::Balanced:
+            options.compressionLevel = 6;
+            options.filter = ParallelPngEncoder::Filter::Adaptive;
+            break;
+        case Preset::Smallest:
+            options.compressionLevel = 9;
+            options.filter = ParallelPngEncoder::Filter::Adaptive;
+            break;
+        }
+        return ParallelPngEncoder::encode(image, options);
+    }
+
+    if (format == Format::Png || format == Format::WebP) {
+        QByteArray data;
+        QBuffer buffer(&data);
+        buffer.open(QIODevice::WriteOnly);
+        QImageWriter writer(&buffer, format == Format::Png ? "png" : "webp");
+        if (format == Format::WebP) {
+            // WebP 插件在质量为 100 时使用无损模式
+            writer.setQuality(100);
+        } else {
+            // PNG 写入器把 quality 换算为压缩级别，数值越大压缩越少
+            writer.setQuality(preset == Preset::Fastest ? 90 : preset == Preset::Smallest ? 0 : -1);
+        }
+        if (!writer.write(image)) {
+            qDebug() << "Failed to encode image:" << writer.errorString();
+            return QByteArray();
+        }
+        return data;
+    }
+    return QByteArray();
+}
+
+bool ImageExporter::save(const QImage& image, const QString& path, Preset preset, PaletteMode palette, bool dither)
+{
+    const Format format = formatForPath(path);
+    if (format == Format::Other || (format == Format::WebP && !isWebPAvailable())) {
+        return image.save(path);
+    }
+
+    QByteArray data = encode(image, format, preset, palette, dither);
+    if (data.isEmpty()) {
+        return false;
+    }
+    // 先写临时文件再替换，避免读取方看到写了一半的文件
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    file.write(data);
+    return file.commit();
+}
+
+QImage ImageExporter::load(const QString& path)
+{
+    if (formatForPath(path) == Format::Qoi) {
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly)) {
+            return QImage();
+        }
+        return QoiCodec::decode(file.readAll());
+    }
+    return QImage(path);
+}
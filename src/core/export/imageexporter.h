@@ -0,0 +1,75 @@
+#ifndef IMAGEEXPORTER_H
+#define IMAGEEXPORTER_H
+
+#include <QImage>
+#include <QString>
+#include <QByteArray>
+
+// 导出引擎：按文件后缀选择编码器，按预设在速度和体积之间取舍
+//   .png  多线程 PNG（未链接 zlib 时回退到 QImageWriter），可选调色板 PNG
+//   .qoi  QOI 无损快速编码，用于内部归档
+//   .webp 无损 WebP（需要 Qt 的 WebP 图片插件）
+//   其他  交给 QImageWriter
+class ImageExporter
+{
+public:
+    enum class Preset {
+        Fastest,    // 速度优先
+        Balanced,   // 均衡
+        Smallest    // 体积优先
+    };
+
+    enum class Format {
+        Png,
+        Qoi,
+        WebP,
+        Other
+    };
+
+    // PNG 的调色板模式
+    enum class PaletteMode {
+        Off,        // 始终写全彩 PNG
+        Exact,      // 颜色不超过 256 种时写调色板 PNG，像素完全不变
+        Quantize    // 颜色过多时有损量化到 256 色
+    };
+
+    static Format formatForPath(const QString& path);
+
+    // 当前预设保存在设置中，默认为均衡
+    static Preset preset();
+    static void setPreset(Preset preset);
+    static QString presetName(Preset preset);
+
+    // 调色板模式保存在设置中，默认为无损的 Exact，只用于用户主动导出（saveForUser）；量化时是否抖动单独设置，默认开启
+    static PaletteMode paletteMode();
+    static void setPaletteMode(PaletteMode mode);
+    static bool isDitherEnabled();
+    static void setDitherEnabled(bool enabled);
+    // 贴图另存为时的缩放百分比（1-100），默认 100 即原尺寸
+    static int scalePercent();
+    static void setScalePercent(int percent);
+    // 按设置的百分比用 Lanczos3 缩小；历史记录和定时截图不缩放
+    static QImage scaledForExport(const QImage& image);
+
+    static bool isWebPAvailable();
+
+    // 编码为内存数据，Other 格式返回空数组；palette 只作用于 PNG
+    static QByteArray encode(const QImage& image, Format format, Preset preset,
+                             PaletteMode palette = PaletteMode::Off, bool dither = true);
+    static bool save(const QImage& image, const QString& path, Preset preset,
+                     PaletteMode palette = PaletteMode::Off, bool dither = true);
+    // 按当前预设无损写入，不使用调色板设置：历史记录、编码队列等归档写入用这个
+    static bool save(const QImage& image, const QString& path)
+    {
+        return save(image, path, preset(), PaletteMode::Off);
+    }
+    // 用户主动导出：按当前预设和调色板设置（可能有损量化）写入
+    static bool saveForUser(const QImage& image, const QString& path)
+    {
+        return save(image, path, preset(), paletteMode(), isDitherEnabled());
+    }
+    // 读取导出的文件，支持 QImageReader 不认识的 QOI
+    static QImage load(const QString& path);
+};
+
+#endif // IMAGEEXPORTER_H
@@ -0,0 +1,526 @@
+#include "palettequantizer.h"
+#include "../../utils/parallelutils.h"
+#include "../../utils/simdutils.h"
+#include <algorithm>
+#include <climits>
+
+namespace {
+
+constexpr int kMinTableBits = 10;
+constexpr int kHistogramBins = 1 << 18;     // a 取 3 位，r/g/b 各取 5 位
+constexpr int kRefineIterations = 2;
+constexpr QRgb kNoColor = 0x00ffffff;       // 归一化后不会出现的颜色，用作行内缓存的初值
+constexpr qint16 kPadding = 1024;           // 调色板补齐到 8 的倍数时的填充值，距离必然大于任何真实颜色
+
+// 感知权重：人眼对绿色最敏感、对蓝色最不敏感，透明度差异同样明显
+constexpr int kWeights[4] = {3, 3, 4, 2};   // a, r, g, b
+
+// 完全透明的像素颜色无意义，统一为 0，避免占用多个调色板项
+inline QRgb normalized(QRgb color)
+{
+    return qAlpha(color) ? color : 0;
+}
+
+inline int binKey(int a, int r, int g, int b)
+{
+    return ((a >> 5) << 15) | ((r >> 3) << 10) | ((g >> 3) << 5) | (b >> 3);
+}
+
+inline int binKey(QRgb color)
+{
+    return binKey(qAlpha(color), qRed(color), qGreen(color), qBlue(color));
+}
+
+// 开放寻址哈希表：颜色 -> 调色板序号，线性探测。构建后只读，可在多个线程中同时查找
+class ColorTable
+{
+public:
+    explicit ColorTable(int limit)
+    {
+        int bits = kMinTableBits;
+        while ((1 << bits) < limit * 4) {
+            ++bits;
+        }
+        m_shift = 32 - bits;
+        m_mask = (1 << bits) - 1;
+        m_keys.resize(1 << bits);
+        m_values.fill(-1, 1 << bits);
+    }
+
+    // 颜色所在或应当插入的位置
+    int slot(QRgb color) const
+    {
+        const QRgb* keys = m_keys.constData();
+        const int* values = m_values.constData();
+        int slot = int((color * 0x9e3779b1u) >> m_shift);
+        while (values[slot] >= 0 && keys[slot] != color) {
+            slot = (slot + 1) & m_mask;
+        }
+        return slot;
+    }
+
+    int value(QRgb color) const { return m_values.at(slot(color)); }
+
+    // 颜色不存在时插入，返回是否为新颜色
+    bool insert(QRgb color, int value)
+    {
+        const int position = slot(color);
+        if (m_values[position] >= 0) {
+            return false;
+        }
+        m_keys[position] = color;
+        m_values[position] = value;
+        return true;
+    }
+
+    void setValue(QRgb color, int value) { m_values[slot(color)] = value; }
+
+private:
+    QVector<QRgb> m_keys;
+    QVector<int> m_values;
+    int m_shift;
+    int m_mask;
+};
+
+// 收集不同颜色，超过 limit 时返回 false。界面截图有大量连续同色像素，先和前一个像素比较
+bool collectColors(const QImage& image, int limit, ColorTable& table, QVector<QRgb>& colors)
+{
+    for (int y = 0; y < image.height(); ++y) {
+        const QRgb* line = reinterpret_cast<const QRgb*>(image.constScanLine(y));
+        QRgb previous = kNoColor;
+        for (int x = 0; x < image.width(); ++x) {
+            const QRgb color = normalized(line[x]);
+            if (color == previous) {
+                continue;
+            }
+            previous = color;
+            if (table.insert(color, colors.size())) {
+                if (colors.size() == limit) {
+                    return false;
+                }
+                colors.append(color);
+            }
+        }
+    }
+    return true;
+}
+
+// 半透明颜色排在前面，tRNS 块只需覆盖到最后一个半透明项
+void sortPalette(QVector<QRgb>& palette)
+{
+    std::stable_sort(palette.begin(), palette.end(), [](QRgb a, QRgb b) {
+        return (qAlpha(a) == 255) < (qAlpha(b) == 255);
+    });
+}
+
+// 调色板中最近颜色的查找，按通道分开存储以便一次比较 8 项
+class NearestColor
+{
+public:
+    explicit NearestColor(const QVector<QRgb>& palette)
+        : m_count(palette.size())
+    {
+        const int padded = (m_count + 7) & ~7;
+        for (QVector<qint16>& channel : m_channels) {
+            channel.fill(kPadding, padded);
+        }
+        for (int i = 0; i < m_count; ++i) {
+            m_channels[0][i] = qint16(qAlpha(palette[i]));
+            m_channels[1][i] = qint16(qRed(palette[i]));
+            m_channels[2][i] = qint16(qGreen(palette[i]));
+            m_channels[3][i] = qint16(qBlue(palette[i]));
+        }
+    }
+
+    int find(int a, int r, int g, int b) const
+    {
+        const int padded = m_channels[0].size();
+        const qint16* ca = m_channels[0].constData();
+        const qint16* cr = m_channels[1].constData();
+        const qint16* cg = m_channels[2].constData();
+        const qint16* cb = m_channels[3].constData();
+#ifdef SCD_HAVE_SSE2
+        const __m128i va = _mm_set1_epi16(short(a));
+        const __m128i vr = _mm_set1_epi16(short(r));
+        const __m128i vg = _mm_set1_epi16(short(g));
+        const __m128i vb = _mm_set1_epi16(short(b));
+        const __m128i wa = _mm_set1_epi16(kWeights[0]);
+        const __m128i wr = _mm_set1_epi16(kWeights[1]);
+        const __m128i wg = _mm_set1_epi16(kWeights[2]);
+        const __m128i wb = _mm_set1_epi16(kWeights[3]);
+        const __m128i step = _mm_set1_epi32(8);
+        __m128i indexLo = _mm_setr_epi32(0, 1, 2, 3);
+        __m128i indexHi = _mm_setr_epi32(4, 5, 6, 7);
+        __m128i bestDistance = _mm_set1_epi32(INT_MAX);
+        __m128i bestIndex = _mm_setzero_si128();
+
+        auto update = [&bestDistance, &bestIndex](__m128i distance, __m128i index) {
+            const __m128i less = _mm_cmplt_epi32(distance, bestDistance);
+            bestDistance = _mm_or_si128(_mm_and_si128(less, distance), _mm_andnot_si128(less, bestDistance));
+            bestIndex = _mm_or_si128(_mm_and_si128(less, index), _mm_andnot_si128(less, bestIndex));
+        };
+
+        for (int i = 0; i < padded; i += 8) {
+            const __m128i da = _mm_sub_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(ca + i)), va);
+            const __m128i dr = _mm_sub_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(cr + i)), vr);
+            const __m128i dg = _mm_sub_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(cg + i)), vg);
+            const __m128i db = _mm_sub_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(cb + i)), vb);
+            const __m128i wda = _mm_mullo_epi16(da, wa);
+            const __m128i wdr = _mm_mullo_epi16(dr, wr);
+            const __m128i wdg = _mm_mullo_epi16(dg, wg);
+            const __m128i wdb = _mm_mullo_epi16(db, wb);
+            // 两个通道交错后 madd 得到 w1*d1² + w2*d2²
+            const __m128i lo = _mm_add_epi32(
+                _mm_madd_epi16(_mm_unpacklo_epi16(da, dr), _mm_unpacklo_epi16(wda, wdr)),
+                _mm_madd_epi16(_mm_unpacklo_epi16(dg, db), _mm_unpacklo_epi16(wdg, wdb)));
+            const __m128i hi = _mm_add_epi32(
+                _mm_madd_epi16(_mm_unpackhi_epi16(da, dr), _mm_unpackhi_epi16(wda, wdr)),
+                _mm_madd_epi16(_mm_unpackhi_epi16(dg, db), _mm_unpackhi_epi16(wdg, wdb)));
+            update(lo, indexLo);
+            update(hi, indexHi);
+            indexLo = _mm_add_epi32(indexLo, step);
+            indexHi = _mm_add_epi32(indexHi, step);
+        }
+
+        qint32 distances[4];
+        qint32 indices[4];
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(distances), bestDistance);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(indices), bestIndex);
+        int best = 0;
+        for (int lane = 1; lane < 4; ++lane) {
+            if (distances[lane] < distances[best]
+                || (distances[lane] == distances[best] && indices[lane] < indices[best])) {
+                best = lane;
+            }
+        }
+        return indices[best];
+#else
+        int best = 0;
+        int bestDistance = INT_MAX;
+        for (int i = 0; i < padded; ++i) {
+            const int da = ca[i] - a;
+            const int dr = cr[i] - r;
+            const int dg = cg[i] - g;
+            const int db = cb[i] - b;
+            const int distance = kWeights[0] * da * da + kWeights[1] * dr * dr
+                               + kWeights[2] * dg * dg + kWeights[3] * db * db;
+            if (distance < bestDistance) {
+                bestDistance = distance;
+                best = i;
+            }
+        }
+        return best;
+#endif
+    }
+
+    int find(QRgb color) const { return find(qAlpha(color), qRed(color), qGreen(color), qBlue(color)); }
+
+private:
+    QVector<qint16> m_channels[4];  // a, r, g, b
+    int m_count;
+};
+
+// 直方图中的一个非空格子
+struct Cell {
+    int key;
+    quint64 count;
+    quint64 sum[4];     // a, r, g, b
+    int mean[4];
+};
+
+// 中位切分的盒子：cells 中 [begin, end) 的一段
+struct Box {
+    int begin;
+    int end;
+    quint64 count;
+    int channel;        // 加权跨度最大的通道
+    int range;
+};
+
+Box makeBox(const QVector<Cell>& cells, int begin, int end)
+{
+    Box box{begin, end, 0, 0, 0};
+    int low[4] = {255, 255, 255, 255};
+    int high[4] = {0, 0, 0, 0};
+    for (int i = begin; i < end; ++i) {
+        const Cell& cell = cells[i];
+        box.count += cell.count;
+        for (int c = 0; c < 4; ++c) {
+            low[c] = qMin(low[c], cell.mean[c]);
+            high[c] = qMax(high[c], cell.mean[c]);
+        }
+    }
+    for (int c = 0; c < 4; ++c) {
+        const int range = (high[c] - low[c]) * kWeights[c];
+        if (range > box.range) {
+            box.range = range;
+            box.channel = c;
+        }
+    }
+    return box;
+}
+
+QVector<Cell> buildHistogram(const QImage& image)
+{
+    struct Bin {
+        quint64 count = 0;
+        quint64 sum[4] = {0, 0, 0, 0};
+    };
+    QVector<Bin> bins(kHistogramBins);
+    Bin* data = bins.data();
+    for (int y = 0; y < image.height(); ++y) {
+        const QRgb* line = reinterpret_cast<const QRgb*>(image.constScanLine(y));
+        for (int x = 0; x < image.width(); ++x) {
+            const QRgb color = normalized(line[x]);
+            Bin& bin = data[binKey(color)];
+            ++bin.count;
+            bin.sum[0] += qAlpha(color);
+            bin.sum[1] += qRed(color);
+            bin.sum[2] += qGreen(color);
+            bin.sum[3] += qBlue(color);
+        }
+    }
+
+    QVector<Cell> cells;
+    for (int key = 0; key < kHistogramBins; ++key) {
+        const Bin& bin = data[key];
+        if (bin.count == 0) {
+            continue;
+        }
+        Cell cell;
+        cell.key = key;
+        cell.count = bin.count;
+        for (int c = 0; c < 4; ++c) {
+            cell.sum[c] = bin.sum[c];
+            cell.mean[c] = int((bin.sum[c] + bin.count / 2) / bin.count);
+        }
+        cells.append(cell);
+    }
+    return cells;
+}
+
+QRgb meanColor(const quint64 sum[4], quint64 count)
+{
+    auto channel = [&](int c) { return int((sum[c] + count / 2) / count); };
+    return normalized(qRgba(channel(1), channel(2), channel(3), channel(0)));
+}
+
+// 中位切分：每次切开（像素数 × 加权跨度）最大的盒子，在像素数的中位处分成两半
+QVector<QRgb> medianCut(QVector<Cell>& cells, int maxColors)
+{
+    QVector<Box> boxes;
+    boxes.append(makeBox(cells, 0, cells.size()));
+    while (boxes.size() < maxColors) {
+        int target = -1;
+        quint64 bestScore = 0;
+        for (int i = 0; i < boxes.size(); ++i) {
+            const quint64 score = boxes[i].end - boxes[i].begin > 1 ? boxes[i].count * quint64(boxes[i].range) : 0;
+            if (score > bestScore) {
+                bestScore = score;
+                target = i;
+            }
+        }
+        if (target < 0) {
+            break;
+        }
+
+        const Box box = boxes[target];
+        const int channel = box.channel;
+        std::sort(cells.begin() + box.begin, cells.begin() + box.end, [channel](const Cell& a, const Cell& b) {
+            return a.mean[channel] < b.mean[channel];
+        });
+        int split = box.begin + 1;
+        quint64 accumulated = cells[box.begin].count;
+        while (split < box.end - 1 && accumulated < box.count / 2) {
+            accumulated += cells[split].count;
+            ++split;
+        }
+        boxes[target] = makeBox(cells, box.begin, split);
+        boxes.append(makeBox(cells, split, box.end));
+    }
+
+    QVector<QRgb> palette;
+    for (const Box& box : boxes) {
+        quint64 sum[4] = {0, 0, 0, 0};
+        for (int i = box.begin; i < box.end; ++i) {
+            for (int c = 0; c < 4; ++c) {
+                sum[c] += cells[i].sum[c];
+            }
+        }
+        palette.append(meanColor(sum, box.count));
+    }
+    return palette;
+}
+
+// k-means 修正：把每个格子归入最近的颜色，再以像素数加权求新的颜色
+void refinePalette(const QVector<Cell>& cells, QVector<QRgb>& palette)
+{
+    QVector<int> assignment(cells.size());
+    for (int iteration = 0; iteration < kRefineIterations; ++iteration) {
+        const NearestColor nearest(palette);
+        int* assigned = assignment.data();
+        const Cell* cellData = cells.constData();
+        ParallelUtils::forRange(cells.size(), 1024, [&nearest, assigned, cellData](int begin, int end) {
+            for (int i = begin; i < end; ++i) {
+                const int* mean = cellData[i].mean;
+                assigned[i] = nearest.find(mean[0], mean[1], mean[2], mean[3]);
+            }
+        });
+
+        QVector<quint64> sums(palette.size() * 4, 0);
+        QVector<quint64> counts(palette.size(), 0);
+        for (int i = 0; i < cells.size(); ++i) {
+            const int entry = assignment[i];
+            counts[entry] += cells[i].count;
+            for (int c = 0; c < 4; ++c) {
+                sums[entry * 4 + c] += cells[i].sum[c];
+            }
+        }
+        for (int entry = 0; entry < palette.size(); ++entry) {
+            if (counts[entry] > 0) {
+                palette[entry] = meanColor(sums.constData() + entry * 4, counts[entry]);
+            }
+        }
+    }
+}
+
+// Floyd–Steinberg 抖动。误差只在颜色通道上扩散，且只扩散 3/4，减轻平坦区域的噪点
+void ditherIndices(const QImage& image, const QVector<QRgb>& palette, const NearestColor& nearest,
+                   QVector<qint16>& lut, uchar* out)
+{
+    const int width = image.width();
+    QVector<int> current((width + 2) * 3, 0);
+    QVector<int> next((width + 2) * 3, 0);
+    qint16* table = lut.data();
+    for (int y = 0; y < image.height(); ++y) {
+        const QRgb* line = reinterpret_cast<const QRgb*>(image.constScanLine(y));
+        uchar* row = out + qsizetype(y) * width;
+        next.fill(0);
+        for (int x = 0; x < width; ++x) {
+            const QRgb color = normalized(line[x]);
+            const int alpha = qAlpha(color);
+            if (alpha == 0) {
+                row[x] = uchar(table[0]);
+                continue;
+            }
+            const int* error = current.constData() + (x + 1) * 3;
+            const int r = qBound(0, qRed(color) + error[0] / 16, 255);
+            const int g = qBound(0, qGreen(color) + error[1] / 16, 255);
+            const int b = qBound(0, qBlue(color) + error[2] / 16, 255);
+
+            const int key = binKey(alpha, r, g, b);
+            if (table[key] < 0) {
+                table[key] = qint16(nearest.find(alpha, r, g, b));
+            }
+            const QRgb chosen = palette[table[key]];
+            row[x] = uchar(table[key]);
+
+            const int diff[3] = {(r - qRed(chosen)) * 3 / 4, (g - qGreen(chosen)) * 3 / 4,
+                                 (b - qBlue(chosen)) * 3 / 4};
+            int* right = current.data() + (x + 2) * 3;
+            int* below = next.data() + (x + 1) * 3;
+            for (int c = 0; c < 3; ++c) {
+                right[c] += diff[c] * 7;
+                below[c - 3] += diff[c] * 3;
+                below[c] += diff[c] * 5;
+                below[c + 3] += diff[c];
+            }
+        }
+        current.swap(next);
+    }
+}
+
+} // namespace
+
+int PaletteQuantizer::countColors(const QImage& image, int limit)
+{
+    const QImage source = image.convertToFormat(QImage::Format_ARGB32);
+    ColorTable table(limit + 1);
+    QVector<QRgb> colors;
+    return collectColors(source, limit, table, colors) ? colors.size() : limit + 1;
+}
+
+PaletteQuantizer::Result PaletteQuantizer::quantize(const QImage& image, const Options& options)
+{
+    Result result;
+    if (image.isNull()) {
+        return result;
+    }
+    const QImage source = image.convertToFormat(QImage::Format_ARGB32);
+    const int width = source.width();
+    const int height = source.height();
+    const int maxColors = qBound(2, options.maxColors, 256);
+
+    // 1. 颜色不超过上限：直接得到无损调色板
+    ColorTable table(maxColors);
+    QVector<QRgb> colors;
+    if (collectColors(source, maxColors, table, colors)) {
+        sortPalette(colors);
+        for (int i = 0; i < colors.size(); ++i) {
+            table.setValue(colors[i], i);
+        }
+        result.indices.resize(qsizetype(width) * height);
+        uchar* out = reinterpret_cast<uchar*>(result.indices.data());
+        const ColorTable& lookup = table;
+        ParallelUtils::forRange(height, 16, [&source, &lookup, out, width](int begin, int end) {
+            for (int y = begin; y < end; ++y) {
+                const QRgb* line = reinterpret_cast<const QRgb*>(source.constScanLine(y));
+                uchar* row = out + qsizetype(y) * width;
+                QRgb previous = kNoColor;
+                uchar index = 0;
+                for (int x = 0; x < width; ++x) {
+                    const QRgb color = normalized(line[x]);
+                    if (color != previous) {
+                        previous = color;
+                        index = uchar(lookup.value(color));
+                    }
+                    row[x] = index;
+                }
+            }
+        });
+        result.size = source.size();
+        result.palette = colors;
+        result.exact = true;
+        return result;
+    }
+    if (!options.quantize) {
+        return result;
+    }
+
+    // 2. 有损量化：直方图上中位切分，再做 k-means 修正
+    QVector<Cell> cells = buildHistogram(source);
+    QVector<QRgb> palette = medianCut(cells, maxColors);
+    refinePalette(cells, palette);
+    sortPalette(palette);
+    const NearestColor nearest(palette);
+
+    // 每个直方图格子对应的调色板序号，抖动时按需补充
+    QVector<qint16> lut(kHistogramBins, qint16(-1));
+    qint16* table16 = lut.data();
+    const Cell* cellData = cells.constData();
+    ParallelUtils::forRange(cells.size(), 1024, [&nearest, table16, cellData](int begin, int end) {
+        for (int i = begin; i < end; ++i) {
+            const int* mean = cellData[i].mean;
+            table16[cellData[i].key] = qint16(nearest.find(mean[0], mean[1], mean[2], mean[3]));
+        }
+    });
+
+    result.indices.resize(qsizetype(width) * height);
+    uchar* out = reinterpret_cast<uchar*>(result.indices.data());
+    if (options.dither) {
+        ditherIndices(source, palette, nearest, lut, out);
+    } else {
+        ParallelUtils::forRange(height, 16, [&source, table16, out, width](int begin, int end) {
+            for (int y = begin; y < end; ++y) {
+                const QRgb* line = reinterpret_cast<const QRgb*>(source.constScanLine(y));
+                uchar* row = out + qsizetype(y) * width;
+                for (int x = 0; x < width; ++x) {
+                    row[x] = uchar(table16[binKey(normalized(line[x]))]);
+                }
+            }
+        });
+    }
+    result.size = source.size();
+    result.palette = palette;
+    return result;
+}
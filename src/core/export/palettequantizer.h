@@ -0,0 +1,37 @@
+#ifndef PALETTEQUANTIZER_H
+#define PALETTEQUANTIZER_H
+
+#include <QByteArray>
+#include <QImage>
+#include <QVector>
+
+// 把图片转换为调色板形式（每像素一个字节的索引），用于写调色板 PNG
+//
+// 界面截图通常只有几百种颜色：先用开放寻址的哈希表统计颜色，不超过上限时得到无损的调色板；
+// 超过上限时可选择有损量化：在 5 位精度的颜色直方图上做中位切分，再用 k-means 迭代修正，
+// 最近颜色查找使用 SSE2 一次比较 8 个调色板颜色。可选 Floyd–Steinberg 抖动
+class PaletteQuantizer
+{
+public:
+    struct Options {
+        int maxColors = 256;
+        bool quantize = false;  // 颜色超出上限时是否有损量化，否则返回无效结果
+        bool dither = true;     // 仅对有损量化生效
+    };
+
+    struct Result {
+        QSize size;
+        QVector<QRgb> palette;  // 非预乘 ARGB，半透明颜色排在前面（tRNS 可以更短）
+        QByteArray indices;     // 逐行排列，每像素一个字节
+        bool exact = false;     // 无损
+
+        bool isValid() const { return !palette.isEmpty(); }
+    };
+
+    static Result quantize(const QImage& image, const Options& options);
+
+    // 统计不同颜色数，超过 limit 时立即停止并返回 limit + 1
+    static int countColors(const QImage& image, int limit);
+};
+
+#endif // PALETTEQUANTIZER_H
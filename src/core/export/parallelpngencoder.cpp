@@ -0,0 +1,340 @@
+#include "parallelpngencoder.h"
+#include "../../utils/parallelutils.h"
+#include <QVector>
+#include <QList>
+#include <QPair>
+#include <QtEndian>
+#include <cstring>
+#include <cstdlib>
+#ifdef SCD_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+bool ParallelPngEncoder::isAvailable()
+{
+#ifdef SCD_HAVE_ZLIB
+    return true;
+#else
+    return false;
+#endif
+}
+
+#ifndef SCD_HAVE_ZLIB
+
+QByteArray ParallelPngEncoder::encode(const QImage&, const Options&)
+{
+    return QByteArray();
+}
+
+QByteArray ParallelPngEncoder::encodeIndexed(const QByteArray&, const QSize&, const QVector<QRgb>&, const Options&)
+{
+    return QByteArray();
+}
+
+#else
+
+namespace {
+
+constexpr int kWindowSize = 32 * 1024;
+// 每个条带至少这么多字节的原始数据，太小的条带会损失压缩率
+constexpr int kMinStripeBytes = 256 * 1024;
+
+quint8 paeth(int a, int b, int c)
+{
+    int p = a + b - c;
+    int pa = std::abs(p - a);
+    int pb = std::abs(p - b);
+    int pc = std::abs(p - c);
+    if (pa <= pb && pa <= pc) {
+        return quint8(a);
+    }
+    return quint8(pb <= pc ? b : c);
+}
+
+// 对一行做 PNG 滤波，out 的第一个字节为滤波类型
+void filterRow(const quint8* row, const quint8* prior, int length, int bpp,
+               ParallelPngEncoder::Filter filter, quint8* out, quint8* scratch)
+{
+    if (filter == ParallelPngEncoder::Filter::None) {
+        out[0] = 0;
+        std::memcpy(out + 1, row, size_t(length));
+        return;
+    }
+
+    // 依次尝试五种滤波器，保留绝对值和最小的结果
+    quint64 bestScore = ~quint64(0);
+    for (int type = 0; type < 5; ++type) {
+        quint64 score = 0;
+        for (int i = 0; i < length; ++i) {
+            int left = i >= bpp ? row[i - bpp] : 0;
+            int up = prior ? prior[i] : 0;
+            int upLeft = (prior && i >= bpp) ? prior[i - bpp] : 0;
+            quint8 value;
+            switch (type) {
+            case 0: value = row[i]; break;
+            case 1: value = quint8(row[i] - left); break;
+            case 2: value = quint8(row[i] - up); break;
+            case 3: value = quint8(row[i] - ((left + up) >> 1)); break;
+            default: value = quint8(row[i] - paeth(left, up, upLeft)); break;
+            }
+            scratch[i] = value;
+            score += value < 128 ? value : 256 - value;
+        }
+        if (score < bestScore) {
+            bestScore = score;
+            out[0] = quint8(type);
+            std::memcpy(out + 1, scratch, size_t(length));
+        }
+    }
+}
+
+void appendChunk(QByteArray& png, const char* type, const QByteArray& data)
+{
+    uchar header[8];
+    qToBigEndian<quint32>(quint32(data.size()), header);
+    std::memcpy(header + 4, type, 4);
+    png.append(reinterpret_cast<const char*>(header), 8);
+    png.append(data);
+
+    uLong crc = crc32(0L, reinterpret_cast<const Bytef*>(type), 4);
+    crc = crc32(crc, reinterpret_cast<const Bytef*>(data.constData()), uInt(data.size()));
+    uchar trailer[4];
+    qToBigEndian<quint32>(quint32(crc), trailer);
+    png.append(reinterpret_cast<const char*>(trailer), 4);
+}
+
+// 截图通常是带 alpha 格式但完全不透明，此时写 RGB 可省下四分之一的数据
+bool needsAlpha(const QImage& image)
+{
+    if (!image.hasAlphaChannel()) {
+        return false;
+    }
+    if (image.format() != QImage::Format_ARGB32 && image.format() != QImage::Format_ARGB32_Premultiplied) {
+        return true;
+    }
+    for (int y = 0; y < image.height(); ++y) {
+        const QRgb* line = reinterpret_cast<const QRgb*>(image.constScanLine(y));
+        for (int x = 0; x < image.width(); ++x) {
+            if (qAlpha(line[x]) != 255) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+struct Stripe {
+    int firstRow = 0;
+    int rowCount = 0;
+    QByteArray deflated;
+    uLong adler = 1;
+    qint64 inputBytes = 0;
+    bool ok = false;
+};
+
+// 待编码的像素行：data 按 stride 逐行排列，每行 rowBytes 字节
+struct RawRows {
+    const quint8* data = nullptr;
+    qsizetype stride = 0;
+    int width = 0;
+    int height = 0;
+    int rowBytes = 0;
+    int bpp = 1;                // 滤波时“左侧像素”的字节距离，位深不足 8 时为 1
+    quint8 bitDepth = 8;
+    quint8 colorType = 2;
+};
+
+// 滤波、分条带并行压缩并拼接成 PNG；extraChunks 写在 IHDR 之后（如 PLTE、tRNS）
+QByteArray encodeRows(const RawRows& raw, const ParallelPngEncoder::Options& options,
+                      const QList<QPair<QByteArray, QByteArray>>& extraChunks)
+{
+    const int width = raw.width;
+    const int height = raw.height;
+    const int rowBytes = raw.rowBytes;
+    const int filteredRowBytes = rowBytes + 1;
+
+    // 1. 逐行滤波：每行只依赖原始像素，可完全并行
+    QByteArray filtered(qsizetype(filteredRowBytes) * height, Qt::Uninitialized);
+    quint8* filteredData = reinterpret_cast<quint8*>(filtered.data());
+    ParallelUtils::forRange(height, 16, [&](int begin, int end) {
+        QByteArray scratch(rowBytes, Qt::Uninitialized);
+        for (int y = begin; y < end; ++y) {
+            const quint8* row = raw.data + qsizetype(y) * raw.stride;
+            const quint8* prior = y > 0 ? row - raw.stride : nullptr;
+            filterRow(row, prior, rowBytes, raw.bpp, options.filter,
+                      filteredData + qsizetype(y) * filteredRowBytes,
+                      reinterpret_cast<quint8*>(scratch.data()));
+        }
+    });
+
+    // 2. 按行切分条带并行压缩
+    const int rowsPerStripe = qMax(1, qMax(kMinStripeBytes / filteredRowBytes,
+                                           height / (ParallelUtils::threadCount() * 2)));
+    QVector<Stripe> stripes;
+    for (int row = 0; row < height; row += rowsPerStripe) {
+        Stripe stripe;
+        stripe.firstRow = row;
+        stripe.rowCount = qMin(rowsPerStripe, height - row);
+        stripes.append(stripe);
+    }
+
+    const int level = qBound(0, options.compressionLevel, 9);
+    ParallelUtils::forRange(stripes.size(), 1, [&](int begin, int end) {
+        for (int i = begin; i < end; ++i) {
+            Stripe& stripe = stripes[i];
+            const qsizetype offset = qsizetype(stripe.firstRow) * filteredRowBytes;
+            const Bytef* input = reinterpret_cast<const Bytef*>(filteredData + offset);
+            stripe.inputBytes = qsizetype(stripe.rowCount) * filteredRowBytes;
+
+            z_stream stream;
+            std::memset(&stream, 0, sizeof(stream));
+            // 负的 windowBits 输出不带 zlib 头尾的原始 deflate 数据
+            if (deflateInit2(&stream, level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+                continue;
+            }
+            if (offset > 0) {
+                const qsizetype dictionary = qMin<qsizetype>(kWindowSize, offset);
+                deflateSetDictionary(&stream, input - dictionary, uInt(dictionary));
+            }
+
+            const bool last = (i == stripes.size() - 1);
+            stripe.deflated.resize(int(deflateBound(&stream, uLong(stripe.inputBytes)) + 16));
+            stream.next_in = const_cast<Bytef*>(input);
+            stream.avail_in = uInt(stripe.inputBytes);
+            stream.next_out = reinterpret_cast<Bytef*>(stripe.deflated.data());
+            stream.avail_out = uInt(stripe.deflated.size());
+            int status = deflate(&stream, last ? Z_FINISH : Z_SYNC_FLUSH);
+            stripe.ok = last ? (status == Z_STREAM_END) : (status == Z_OK && stream.avail_in == 0);
+            stripe.deflated.resize(int(stream.total_out));
+            deflateEnd(&stream);
+
+            stripe.adler = adler32(1L, input, uInt(stripe.inputBytes));
+        }
+    });
+
+    // 3. 拼接：zlib 头 + 各条带 + 合并后的 Adler-32
+    uLong adler = 1;
+    for (const Stripe& stripe : stripes) {
+        if (!stripe.ok) {
+            return QByteArray();
+        }
+        adler = adler32_combine(adler, stripe.adler, z_off_t(stripe.inputBytes));
+    }
+
+    QByteArray png("\x89PNG\r\n\x1a\n", 8);
+
+    QByteArray header(13, '\0');
+    uchar* ihdr = reinterpret_cast<uchar*>(header.data());
+    qToBigEndian<quint32>(quint32(width), ihdr);
+    qToBigEndian<quint32>(quint32(height), ihdr + 4);
+    ihdr[8] = raw.bitDepth;
+    ihdr[9] = raw.colorType;
+    appendChunk(png, "IHDR", header);
+    for (const auto& chunk : extraChunks) {
+        appendChunk(png, chunk.first.constData(), chunk.second);
+    }
+
+    // zlib 头：CMF=0x78（32K 窗口），FLG 的压缩级别位按 level 填写，校验位使其能被 31 整除
+    const char flg = level <= 1 ? '\x01' : level <= 5 ? '\x5e' : level == 6 ? '\x9c' : '\xda';
+    for (int i = 0; i < stripes.size(); ++i) {
+        QByteArray data;
+        if (i == 0) {
+            data.append('\x78');
+            data.append(flg);
+        }
+        data.append(stripes[i].deflated);
+        if (i == stripes.size() - 1) {
+            uchar checksum[4];
+            qToBigEndian<quint32>(quint32(adler), checksum);
+            data.append(reinterpret_cast<const char*>(checksum), 4);
+        }
+        appendChunk(png, "IDAT", data);
+    }
+    appendChunk(png, "IEND", QByteArray());
+    return png;
+}
+
+} // namespace
+
+QByteArray ParallelPngEncoder::encode(const QImage& source, const Options& options)
+{
+    if (source.isNull()) {
+        return QByteArray();
+    }
+
+    // 无透明通道时写 RGB，否则写 RGBA（PNG 要求非预乘）
+    const bool hasAlpha = needsAlpha(source);
+    const QImage image = source.convertToFormat(hasAlpha ? QImage::Format_RGBA8888 : QImage::Format_RGB888);
+    RawRows raw;
+    raw.data = image.constBits();
+    raw.stride = image.bytesPerLine();
+    raw.width = image.width();
+    raw.height = image.height();
+    raw.bpp = hasAlpha ? 4 : 3;
+    raw.rowBytes = raw.width * raw.bpp;
+    raw.colorType = hasAlpha ? 6 : 2;   // RGBA / RGB
+    return encodeRows(raw, options, {});
+}
+
+QByteArray ParallelPngEncoder::encodeIndexed(const QByteArray& indices, const QSize& size,
+                                             const QVector<QRgb>& palette, const Options& options)
+{
+    const int width = size.width();
+    const int height = size.height();
+    if (size.isEmpty() || palette.isEmpty() || palette.size() > 256
+        || indices.size() < qsizetype(width) * height) {
+        return QByteArray();
+    }
+
+    // 颜色少时每像素用 1/2/4 位，按高位在前打包
+    const int bitDepth = palette.size() <= 2 ? 1 : palette.size() <= 4 ? 2 : palette.size() <= 16 ? 4 : 8;
+    const int rowBytes = (width * bitDepth + 7) / 8;
+    QByteArray packed;
+    const quint8* rows = reinterpret_cast<const quint8*>(indices.constData());
+    if (bitDepth < 8) {
+        packed.fill('\0', qsizetype(rowBytes) * height);
+        quint8* out = reinterpret_cast<quint8*>(packed.data());
+        const int perByte = 8 / bitDepth;
+        ParallelUtils::forRange(height, 64, [=](int begin, int end) {
+            for (int y = begin; y < end; ++y) {
+                const quint8* in = rows + qsizetype(y) * width;
+                quint8* row = out + qsizetype(y) * rowBytes;
+                for (int x = 0; x < width; ++x) {
+                    const int shift = 8 - bitDepth * (x % perByte + 1);
+                    row[x / perByte] |= quint8(in[x] << shift);
+                }
+            }
+        });
+        rows = out;
+    }
+
+    QByteArray plte;
+    QByteArray trns;
+    for (QRgb color : palette) {
+        plte.append(char(qRed(color)));
+        plte.append(char(qGreen(color)));
+        plte.append(char(qBlue(color)));
+        trns.append(char(qAlpha(color)));
+    }
+    // tRNS 只需写到最后一个半透明项
+    while (!trns.isEmpty() && quint8(trns.back()) == 255) {
+        trns.chop(1);
+    }
+    QList<QPair<QByteArray, QByteArray>> chunks{{"PLTE", plte}};
+    if (!trns.isEmpty()) {
+        chunks.append({"tRNS", trns});
+    }
+
+    RawRows raw;
+    raw.data = rows;
+    raw.stride = rowBytes;
+    raw.width = width;
+    raw.height = height;
+    raw.rowBytes = rowBytes;
+    raw.bpp = 1;
+    raw.bitDepth = quint8(bitDepth);
+    raw.colorType = 3;  // 调色板
+    return encodeRows(raw, options, chunks);
+}
+
+#endif // SCD_HAVE_ZLIB
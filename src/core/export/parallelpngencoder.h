@@ -0,0 +1,36 @@
+#ifndef PARALLELPNGENCODER_H
+#define PARALLELPNGENCODER_H
+
+#include <QByteArray>
+#include <QImage>
+#include <QVector>
+
+// 多线程 PNG 编码：逐行滤波后按行条带切分，各条带在线程池中独立 deflate，
+// 再拼接成一个合法的 zlib 流写入 IDAT。
+// 非末尾条带以 Z_SYNC_FLUSH 结束（字节对齐且不带结束标记），
+// 每个条带以前一条带末尾 32KB 作为预设字典，压缩率接近单线程编码；
+// 整体 Adler-32 由各条带的校验值用 adler32_combine 合并
+class ParallelPngEncoder
+{
+public:
+    enum class Filter {
+        None,       // 不滤波，最快
+        Adaptive    // 每行选取绝对值和最小的滤波器
+    };
+
+    struct Options {
+        int compressionLevel = 6;
+        Filter filter = Filter::Adaptive;
+    };
+
+    // 未链接 zlib 时不可用，调用方应回退到 QImageWriter
+    static bool isAvailable();
+    // 失败时返回空数组
+    static QByteArray encode(const QImage& image, const Options& options);
+    // 调色板 PNG：indices 每像素一个字节，颜色不超过 16 种时按 1/2/4 位打包；
+    // 半透明颜色写入 tRNS。调色板图像通常不宜滤波，调用方一般传入 Filter::None
+    static QByteArray encodeIndexed(const QByteArray& indices, const QSize& size,
+                                    const QVector<QRgb>& palette, const Options& options);
+};
+
+#endif // PARALLELPNGENCODER_H
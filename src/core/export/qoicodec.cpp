@@ -0,0 +1,185 @@
+#include "qoicodec.h"
+#include <QtEndian>
+#include <cstring>
+
+namespace {
+
+constexpr quint8 kOpIndex = 0x00;   // 00xxxxxx
+constexpr quint8 kOpDiff = 0x40;    // 01xxxxxx
+constexpr quint8 kOpLuma = 0x80;    // 10xxxxxx
+constexpr quint8 kOpRun = 0xc0;     // 11xxxxxx
+constexpr quint8 kOpRgb = 0xfe;
+constexpr quint8 kOpRgba = 0xff;
+constexpr quint8 kMask2 = 0xc0;
+constexpr int kHeaderSize = 14;
+const char kPadding[8] = {0, 0, 0, 0, 0, 0, 0, 1};
+
+struct Pixel {
+    quint8 r, g, b, a;
+    bool operator==(const Pixel& other) const
+    {
+        return r == other.r && g == other.g && b == other.b && a == other.a;
+    }
+};
+
+inline int hashIndex(const Pixel& p)
+{
+    return (p.r * 3 + p.g * 5 + p.b * 7 + p.a * 11) % 64;
+}
+
+} // namespace
+
+QByteArray QoiCodec::encode(const QImage& source)
+{
+    if (source.isNull()) {
+        return QByteArray();
+    }
+
+    const bool hasAlpha = source.hasAlphaChannel();
+    const QImage image = source.convertToFormat(QImage::Format_RGBA8888);
+    const int width = image.width();
+    const int height = image.height();
+
+    QByteArray out;
+    // 最坏情况每像素 5 字节
+    out.reserve(kHeaderSize + width * height * (hasAlpha ? 5 : 4) + 8);
+
+    uchar header[kHeaderSize];
+    std::memcpy(header, "qoif", 4);
+    qToBigEndian<quint32>(quint32(width), header + 4);
+    qToBigEndian<quint32>(quint32(height), header + 8);
+    header[12] = hasAlpha ? 4 : 3;
+    header[13] = 0;     // sRGB
+    out.append(reinterpret_cast<const char*>(header), kHeaderSize);
+
+    Pixel index[64];
+    std::memset(index, 0, sizeof(index));
+    Pixel previous{0, 0, 0, 255};
+    int run = 0;
+
+    for (int y = 0; y < height; ++y) {
+        const quint8* line = image.constScanLine(y);
+        for (int x = 0; x < width; ++x) {
+            const quint8* px = line + x * 4;
+            const Pixel pixel{px[0], px[1], px[2], px[3]};
+
+            if (pixel == previous) {
+                ++run;
+                if (run == 62) {
+                    out.append(char(kOpRun | (run - 1)));
+                    run = 0;
+                }
+                continue;
+            }
+            if (run > 0) {
+                out.append(char(kOpRun | (run - 1)));
+                run = 0;
+            }
+
+            const int slot = hashIndex(pixel);
+            if (index[slot] == pixel) {
+                out.append(char(kOpIndex | slot));
+            } else {
+                index[slot] = pixel;
+                if (pixel.a == previous.a) {
+                    const int dr = qint8(pixel.r - previous.r);
+                    const int dg = qint8(pixel.g - previous.g);
+                    const int db = qint8(pixel.b - previous.b);
+                    const int drdg = dr - dg;
+                    const int dbdg = db - dg;
+                    if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1) {
+                        out.append(char(kOpDiff | ((dr + 2) << 4) | ((dg + 2) << 2) | (db + 2)));
+                    } else if (dg >= -32 && dg <= 31 && drdg >= -8 && drdg <= 7 && dbdg >= -8 && dbdg <= 7) {
+                        out.append(char(kOpLuma | (dg + 32)));
+                        out.append(char(((drdg + 8) << 4) | (dbdg + 8)));
+                    } else {
+                        const char rgb[4] = {char(kOpRgb), char(pixel.r), char(pixel.g), char(pixel.b)};
+                        out.append(rgb, 4);
+                    }
+                } else {
+                    const char rgba[5] = {char(kOpRgba), char(pixel.r), char(pixel.g), char(pixel.b), char(pixel.a)};
+                    out.append(rgba, 5);
+                }
+            }
+            previous = pixel;
+        }
+    }
+    if (run > 0) {
+        out.append(char(kOpRun | (run - 1)));
+    }
+    out.append(kPadding, 8);
+    return out;
+}
+
+QImage QoiCodec::decode(const QByteArray& data)
+{
+    if (data.size() < kHeaderSize + 8 || !data.startsWith("qoif")) {
+        return QImage();
+    }
+    const uchar* bytes = reinterpret_cast<const uchar*>(data.constData());
+    const quint32 width = qFromBigEndian<quint32>(bytes + 4);
+    const quint32 height = qFromBigEndian<quint32>(bytes + 8);
+    const int channels = bytes[12];
+    if (width == 0 || height == 0 || width > 65535 || height > 65535 || (channels != 3 && channels != 4)) {
+        return QImage();
+    }
+
+    QImage image(int(width), int(height), channels == 4 ? QImage::Format_RGBA8888 : QImage::Format_RGBX8888);
+    if (image.isNull()) {
+        return QImage();
+    }
+
+    Pixel index[64];
+    std::memset(index, 0, sizeof(index));
+    Pixel pixel{0, 0, 0, 255};
+    int run = 0;
+    qsizetype pos = kHeaderSize;
+    const qsizetype end = data.size() - 8;
+
+    for (int y = 0; y < int(height); ++y) {
+        quint8* line = image.scanLine(y);
+        for (int x = 0; x < int(width); ++x) {
+            if (run > 0) {
+                --run;
+            } else if (pos < end) {
+                const quint8 op = bytes[pos++];
+                if (op == kOpRgb) {
+                    if (pos + 3 > end) return QImage();
+                    pixel.r = bytes[pos++];
+                    pixel.g = bytes[pos++];
+                    pixel.b = bytes[pos++];
+                } else if (op == kOpRgba) {
+                    if (pos + 4 > end) return QImage();
+                    pixel.r = bytes[pos++];
+                    pixel.g = bytes[pos++];
+                    pixel.b = bytes[pos++];
+                    pixel.a = bytes[pos++];
+                } else if ((op & kMask2) == kOpIndex) {
+                    pixel = index[op];
+                } else if ((op & kMask2) == kOpDiff) {
+                    pixel.r += ((op >> 4) & 0x03) - 2;
+                    pixel.g += ((op >> 2) & 0x03) - 2;
+                    pixel.b += (op & 0x03) - 2;
+                } else if ((op & kMask2) == kOpLuma) {
+                    if (pos + 1 > end) return QImage();
+                    const quint8 next = bytes[pos++];
+                    const int dg = (op & 0x3f) - 32;
+                    pixel.r += dg - 8 + ((next >> 4) & 0x0f);
+                    pixel.g += dg;
+                    pixel.b += dg - 8 + (next & 0x0f);
+                } else {
+                    run = op & 0x3f;
+                }
+                index[hashIndex(pixel)] = pixel;
+            } else {
+                return QImage();
+            }
+            quint8* px = line + x * 4;
+            px[0] = pixel.r;
+            px[1] = pixel.g;
+            px[2] = pixel.b;
+            px[3] = channels == 4 ? pixel.a : 255;
+        }
+    }
+    return image;
+}
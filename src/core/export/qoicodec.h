@@ -0,0 +1,17 @@
+#ifndef QOICODEC_H
+#define QOICODEC_H
+
+#include <QByteArray>
+#include <QImage>
+
+// QOI（Quite OK Image）无损编解码：单遍、无熵编码，编码速度远高于 PNG，
+// 体积略大，用于内部归档等只关心速度的场景
+class QoiCodec
+{
+public:
+    static QByteArray encode(const QImage& image);
+    // 数据不合法时返回空图
+    static QImage decode(const QByteArray& data);
+};
+
+#endif // QOICODEC_H
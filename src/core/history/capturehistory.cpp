@@ -0,0 +1,271 @@
+#include "capturehistory.h"
+#include "../export/imageexporter.h"
+#include "../image/imagehash.h"
+#include <QDir>
+#include <QFileInfo>
+#include <QSet>
+#include <QStandardPaths>
+#include <QThreadPool>
+#include <QPointer>
+#include <QSaveFile>
+#include <QSettings>
+#include <QtEndian>
+#include <QDebug>
+
+CaptureHistory::CaptureHistory(QObject *parent)
+    : QObject(parent)
+    , m_encodeQueue(8)
+{
+    m_maxEntries = qBound(1, QSettings("SCD", "SCD").value("history/maxEntries", kDefaultMaxEntries).toInt(),
+                          kMaxEntriesLimit);
+    QDir().mkpath(storageDirectory());
+    scan();
+    // 之前版本在淘汰时跳过了正在写盘的文件，写完后留在目录里，这里一并清理
+    prune();
+    loadHashes();
+
+    connect(&m_encodeQueue, &EncodeQueue::encoded, this, &CaptureHistory::finishWrite);
+    connect(&m_encodeQueue, &EncodeQueue::encodeFailed, this, &CaptureHistory::finishWrite);
+}
+
+void CaptureHistory::finishWrite(const QString& filePath)
+{
+    m_pending.remove(filePath);
+    m_pendingSessions.remove(filePath);
+    if (m_pendingDeletes.remove(filePath)) {
+        QFile::remove(filePath);
+    }
+}
+
+void CaptureHistory::setMaxEntries(int maxEntries)
+{
+    m_maxEntries = qBound(1, maxEntries, kMaxEntriesLimit);
+    QSettings("SCD", "SCD").setValue("history/maxEntries", m_maxEntries);
+    prune();
+}
+
+QString CaptureHistory::storageDirectory()
+{
+    return QDir(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation)).filePath("history");
+}
+
+void CaptureHistory::scan()
+{
+    QDir dir(storageDirectory());
+    const QFileInfoList files = dir.entryInfoList({"*.png"}, QDir::Files, QDir::Name);
+    for (const QFileInfo& info : files) {
+        bool ok = false;
+        int id = info.completeBaseName().toInt(&ok);
+        if (!ok) {
+            continue;
+        }
+        m_entries.append({id, info.lastModified(), info.absoluteFilePath()});
+        m_nextId = qMax(m_nextId, id + 1);
+    }
+}
+
+int CaptureHistory::add(const QImage& image, bool* duplicate)
+{
+    if (duplicate) {
+        *duplicate = false;
+    }
+    if (image.isNull()) {
+        return -1;
+    }
+    
+    // 像素完全相同的截图只返回已有记录，不再写盘。手动截图不按感知距离跳过：
+    // 同一区域重新标注后的截图感知哈希几乎不变，但仍是一次新的截图
+    const quint64 perceptual = ImageHash::perceptual(image);
+    const quint64 content = ImageHash::content(image);
+    if (HashIndex::isDedupeEnabled()) {
+        HashIndex::Match match = m_hashIndex.find(perceptual, content, -1);
+        if (match.isValid()) {
+            if (duplicate) {
+                *duplicate = true;
+            }
+            return match.id;
+        }
+    }
+
+    Entry entry;
+    entry.id = m_nextId++;
+    entry.timestamp = QDateTime::currentDateTime();
+    entry.filePath = QDir(storageDirectory()).filePath(QString("%1.png").arg(entry.id, 8, 10, QChar('0')));
+
+    // 队列满时同步写入，历史记录不能丢
+    m_pending.insert(entry.filePath, image);
+    if (!m_encodeQueue.tryEnqueue(image, entry.filePath)) {
+        ImageExporter::save(image, entry.filePath);
+        m_pending.remove(entry.filePath);
+    }
+
+    m_entries.append(entry);
+    m_hashIndex.insert(entry.id, perceptual, content);
+    appendHash(entry.id, perceptual, content);
+    prune();
+    emit entryAdded(entry.id);
+    return entry.id;
+}
+
+QVector<CaptureHistory::Entry> CaptureHistory::entries() const
+{
+    QVector<Entry> result(m_entries.rbegin(), m_entries.rend());
+    return result;
+}
+
+CaptureHistory::Entry CaptureHistory::entry(int id) const
+{
+    for (const Entry& entry : m_entries) {
+        if (entry.id == id) {
+            return entry;
+        }
+    }
+    return Entry();
+}
+
+QImage CaptureHistory::load(int id) const
+{
+    Entry item = entry(id);
+    if (!item.isValid()) {
+        return QImage();
+    }
+    auto pending = m_pending.constFind(item.filePath);
+    if (pending != m_pending.constEnd()) {
+        return pending.value();
+    }
+    return ImageExporter::load(item.filePath);
+}
+
+QString CaptureHistory::sessionPath(const Entry& entry)
+{
+    QFileInfo info(entry.filePath);
+    return info.dir().filePath(info.completeBaseName() + "." + CaptureSession::kSuffix);
+}
+
+void CaptureHistory::saveSession(int id, const CaptureSession& session)
+{
+    Entry item = entry(id);
+    if (!item.isValid() || !session.isValid()) {
+        return;
+    }
+    const QString path = sessionPath(item);
+    m_pendingSessions.insert(path, session);
+    // 重复的截图对应同一个会话文件，两个写任务同时写会互相覆盖出不完整的文件
+    if (m_sessionWrites.contains(path)) {
+        m_staleSessionWrites.insert(path);
+        return;
+    }
+    startSessionWrite(path);
+}
+
+void CaptureHistory::startSessionWrite(const QString& path)
+{
+    m_sessionWrites.insert(path);
+    CaptureSession session = m_pendingSessions.value(path);
+    QPointer<CaptureHistory> self(this);
+    QThreadPool::globalInstance()->start([self, session, path]() mutable {
+        session.save(path);
+        if (self) {
+            QMetaObject::invokeMethod(self.data(), [self, path]() {
+                self->finishSessionWrite(path);
+            }, Qt::QueuedConnection);
+        }
+    });
+}
+
+void CaptureHistory::finishSessionWrite(const QString& path)
+{
+    m_sessionWrites.remove(path);
+    // 写盘期间又保存过：按最新内容再写一次，已被淘汰的文件不再写
+    if (m_staleSessionWrites.remove(path) && !m_pendingDeletes.contains(path)) {
+        startSessionWrite(path);
+        return;
+    }
+    finishWrite(path);
+}
+
+CaptureSession CaptureHistory::loadSession(int id) const
+{
+    Entry item = entry(id);
+    if (!item.isValid()) {
+        return CaptureSession();
+    }
+    const QString path = sessionPath(item);
+    auto pending = m_pendingSessions.constFind(path);
+    if (pending != m_pendingSessions.constEnd()) {
+        return pending.value();
+    }
+    return CaptureSession::load(path);
+}
+
+void CaptureHistory::prune()
+{
+    while (m_entries.size() > m_maxEntries) {
+        Entry oldest = m_entries.takeFirst();
+        m_hashIndex.remove(oldest.id);
+        // 仍在写盘的文件现在删除会被写盘线程重新创建，下次启动时又被当作记录导入；
+        // 记下来，在 finishWrite 中删除
+        for (const QString& path : {oldest.filePath, sessionPath(oldest)}) {
+            if (m_pending.contains(path) || m_pendingSessions.contains(path)) {
+                m_pendingDeletes.insert(path);
+            } else {
+                QFile::remove(path);
+            }
+        }
+        emit entryRemoved(oldest.id);
+    }
+}
+
+QString CaptureHistory::hashFilePath() const
+{
+    return QDir(storageDirectory()).filePath("hashes.idx");
+}
+
+// 每条记录 20 字节：id、感知哈希、内容哈希（小端）
+void CaptureHistory::loadHashes()
+{
+    QFile file(hashFilePath());
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+    const QByteArray data = file.readAll();
+    file.close();
+
+    QSet<int> ids;
+    for (const Entry& entry : m_entries) {
+        ids.insert(entry.id);
+    }
+    int records = 0;
+    for (int offset = 0; offset + kHashRecordSize <= data.size(); offset += kHashRecordSize, ++records) {
+        const uchar* record = reinterpret_cast<const uchar*>(data.constData() + offset);
+        const int id = qFromLittleEndian<qint32>(record);
+        if (ids.contains(id)) {
+            m_hashIndex.insert(id, qFromLittleEndian<quint64>(record + 4), qFromLittleEndian<quint64>(record + 12));
+        }
+    }
+
+    // 已删除记录过多时重写文件
+    if (records > 2 * m_hashIndex.size() + 64) {
+        QSaveFile compacted(hashFilePath());
+        if (compacted.open(QIODevice::WriteOnly)) {
+            for (int offset = 0; offset + kHashRecordSize <= data.size(); offset += kHashRecordSize) {
+                if (ids.contains(qFromLittleEndian<qint32>(data.constData() + offset))) {
+                    compacted.write(data.constData() + offset, kHashRecordSize);
+                }
+            }
+            compacted.commit();
+        }
+    }
+}
+
+void CaptureHistory::appendHash(int id, quint64 perceptual, quint64 content)
+{
+    uchar record[kHashRecordSize];
+    qToLittleEndian<qint32>(id, record);
+    qToLittleEndian<quint64>(perceptual, record + 4);
+    qToLittleEndian<quint64>(content, record + 12);
+    QFile file(hashFilePath());
+    if (file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        file.write(reinterpret_cast<const char*>(record), kHashRecordSize);
+    }
+}
@@ -0,0 +1,80 @@
+#ifndef CAPTUREHISTORY_H
+#define CAPTUREHISTORY_H
+
+#include <QObject>
+#include <QImage>
+#include <QDateTime>
+#include <QHash>
+#include <QSet>
+#include <QVector>
+#include <QString>
+#include "../capture/encodequeue.h"
+#include "../session/capturesession.h"
+#include "hashindex.h"
+
+// 截图历史：每次完成的截图保存到应用数据目录，后台线程负责写盘
+class CaptureHistory : public QObject
+{
+    Q_OBJECT
+public:
+    struct Entry {
+        int id{-1};
+        QDateTime timestamp;
+        QString filePath;
+
+        bool isValid() const { return id >= 0; }
+    };
+
+    explicit CaptureHistory(QObject *parent = nullptr);
+
+    // 与已有记录像素完全相同时不再保存，返回已有记录的 id
+    int add(const QImage& image, bool* duplicate = nullptr);
+    QVector<Entry> entries() const;   // 最新的在前
+    Entry entry(int id) const;
+    QImage load(int id) const;
+    int count() const { return m_entries.size(); }
+
+    // 与截图同名的会话文件，在后台线程写入；写完之前从内存读取
+    void saveSession(int id, const CaptureSession& session);
+    CaptureSession loadSession(int id) const;
+    static QString sessionPath(const Entry& entry);
+
+    static QString storageDirectory();
+
+    // 保留的截图数量，超出后删除最旧的记录；默认 kDefaultMaxEntries，可调到几万张供全文搜索
+    int maxEntries() const { return m_maxEntries; }
+    void setMaxEntries(int maxEntries);
+    static constexpr int kDefaultMaxEntries = 500;
+    static constexpr int kMaxEntriesLimit = 100000;
+
+signals:
+    void entryAdded(int id);
+    void entryRemoved(int id);
+
+private:
+    static constexpr int kHashRecordSize = 20;
+
+    QVector<Entry> m_entries;          // 按 id 升序
+    QHash<QString, QImage> m_pending;  // 尚未写完的图片，写盘期间从内存读取
+    QHash<QString, CaptureSession> m_pendingSessions;  // 每个会话文件最新的内容，写完前从内存读取
+    // 同一会话文件同时只有一个写任务：写盘期间再次保存时只记下，写完后按最新内容重写
+    QSet<QString> m_sessionWrites;
+    QSet<QString> m_staleSessionWrites;
+    QSet<QString> m_pendingDeletes;    // 已被淘汰、但仍在写盘的文件，写完后删除
+    HashIndex m_hashIndex;             // 截图的感知哈希与内容哈希，持久化在 hashes.idx
+    EncodeQueue m_encodeQueue;
+    int m_nextId{1};
+    int m_maxEntries{kDefaultMaxEntries};
+
+    void scan();
+    void prune();
+    // 写盘结束（成功或失败）后清理待写状态，已被淘汰的文件随即删除
+    void finishWrite(const QString& filePath);
+    void startSessionWrite(const QString& path);
+    void finishSessionWrite(const QString& path);
+    void loadHashes();
+    void appendHash(int id, quint64 perceptual, quint64 content);
+    QString hashFilePath() const;
+};
+
+#endif // CAPTUREHISTORY_H
@@ -0,0 +1,122 @@
+#include "hashindex.h"
+#include "../image/imagehash.h"
+#include <QSettings>
+
+namespace {
+
+// 枚举与 value 相差不超过 radius 位的所有 16 位值（从 start 位开始翻转，避免重复）
+template <typename Visitor>
+void forEachNeighbor(quint16 value, int radius, int start, const Visitor& visit)
+{
+    visit(value);
+    if (radius == 0) {
+        return;
+    }
+    for (int bit = start; bit < 16; ++bit) {
+        forEachNeighbor(quint16(value ^ (1u << bit)), radius - 1, bit + 1, visit);
+    }
+}
+
+} // namespace
+
+bool HashIndex::isDedupeEnabled()
+{
+    return QSettings("SCD", "SCD").value("dedupe/enabled", true).toBool();
+}
+
+int HashIndex::dedupeDistance()
+{
+    return qMin(QSettings("SCD", "SCD").value("dedupe/distance", kDefaultDistance).toInt(), int(kMaxDistance));
+}
+
+void HashIndex::insert(int id, quint64 perceptual, quint64 content)
+{
+    remove(id);
+
+    int slot;
+    if (!m_free.isEmpty()) {
+        slot = m_free.takeLast();
+    } else {
+        slot = m_slots.size();
+        m_slots.append(Slot());
+    }
+    m_slots[slot] = {id, perceptual, content};
+    m_slotOfId.insert(id, slot);
+    m_slotOfContent.insert(content, slot);
+    for (int i = 0; i < kSegments; ++i) {
+        m_tables[i][segment(perceptual, i)].append(slot);
+    }
+}
+
+void HashIndex::remove(int id)
+{
+    auto found = m_slotOfId.find(id);
+    if (found == m_slotOfId.end()) {
+        return;
+    }
+    const int slot = found.value();
+    m_slotOfId.erase(found);
+
+    const Slot& item = m_slots.at(slot);
+    if (m_slotOfContent.value(item.content, -1) == slot) {
+        m_slotOfContent.remove(item.content);
+    }
+    for (int i = 0; i < kSegments; ++i) {
+        auto bucket = m_tables[i].find(segment(item.perceptual, i));
+        if (bucket != m_tables[i].end()) {
+            bucket->removeOne(slot);
+            if (bucket->isEmpty()) {
+                m_tables[i].erase(bucket);
+            }
+        }
+    }
+    m_slots[slot] = Slot();
+    m_free.append(slot);
+}
+
+void HashIndex::clear()
+{
+    m_slots.clear();
+    m_free.clear();
+    m_slotOfId.clear();
+    m_slotOfContent.clear();
+    for (auto& table : m_tables) {
+        table.clear();
+    }
+}
+
+HashIndex::Match HashIndex::find(quint64 perceptual, quint64 content, int maxDistance) const
+{
+    Match best;
+    auto exact = m_slotOfContent.constFind(content);
+    if (exact != m_slotOfContent.constEnd()) {
+        const Slot& item = m_slots.at(exact.value());
+        best.id = item.id;
+        best.distance = ImageHash::distance(item.perceptual, perceptual);
+        best.exact = true;
+        return best;
+    }
+    if (maxDistance < 0) {
+        return best;
+    }
+
+    maxDistance = qMin(maxDistance, kMaxDistance);
+    const int radius = maxDistance / kSegments;
+    for (int i = 0; i < kSegments; ++i) {
+        forEachNeighbor(segment(perceptual, i), radius, 0, [&](quint16 value) {
+            auto bucket = m_tables[i].constFind(value);
+            if (bucket == m_tables[i].constEnd()) {
+                return;
+            }
+            for (int slot : bucket.value()) {
+                const Slot& item = m_slots.at(slot);
+                const int distance = ImageHash::distance(item.perceptual, perceptual);
+                if (distance <= maxDistance && (!best.isValid() || distance < best.distance)) {
+                    best.id = item.id;
+                    best.distance = distance;
+                }
+            }
+        });
+    }
+    return best;
+}
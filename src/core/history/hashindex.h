@@ -0,0 +1,56 @@
+#ifndef HASHINDEX_H
+#define HASHINDEX_H
+
+#include <QHash>
+#include <QVector>
+#include <QtGlobal>
+
+// 感知哈希的多索引哈希表：64 位哈希切成 4 段 16 位，每段一张表
+// 汉明距离不超过 r 的两个哈希至少有一段的距离不超过 r/4，
+// 查询时只需在每张表中枚举该半径内的段值，再逐个核对完整距离
+class HashIndex
+{
+public:
+    static constexpr int kMaxDistance = 15;
+    static constexpr int kDefaultDistance = 3;
+
+    struct Match {
+        int id{-1};
+        int distance{-1};
+        bool exact{false};      // 内容哈希相同，像素完全一致
+
+        bool isValid() const { return id >= 0; }
+    };
+
+    void insert(int id, quint64 perceptual, quint64 content);
+    void remove(int id);
+    void clear();
+    int size() const { return m_slots.size() - m_free.size(); }
+
+    // 去重设置："dedupe/enabled" 默认开启；"dedupe/distance" 为判定近似重复的最大汉明距离，
+    // 负数表示只跳过像素完全相同的截图。近似重复只用于定时截图，截图历史只跳过像素完全相同的截图
+    static bool isDedupeEnabled();
+    static int dedupeDistance();
+
+    // 优先返回内容完全相同的记录，其次返回感知距离最小且不超过 maxDistance 的记录
+    Match find(quint64 perceptual, quint64 content, int maxDistance) const;
+
+private:
+    static constexpr int kSegments = 4;
+
+    struct Slot {
+        int id{-1};
+        quint64 perceptual{0};
+        quint64 content{0};
+    };
+
+    QVector<Slot> m_slots;
+    QVector<int> m_free;                         // 已删除的槽位，插入时复用
+    QHash<int, int> m_slotOfId;
+    QHash<quint64, int> m_slotOfContent;
+    QHash<quint16, QVector<int>> m_tables[kSegments];
+
+    static quint16 segment(quint64 hash, int index) { return quint16(hash >> (index * 16)); }
+};
+
+#endif // HASHINDEX_H
@@ -0,0 +1,146 @@
+#include "autotrim.h"
+#include "../capture/captureframe.h"
+#include "../../utils/simdutils.h"
+#include <QSettings>
+
+namespace {
+
+inline bool matches(QRgb pixel, QRgb reference, int tolerance)
+{
+    return qAbs(qAlpha(pixel) - qAlpha(reference)) <= tolerance
+        && qAbs(qRed(pixel) - qRed(reference)) <= tolerance
+        && qAbs(qGreen(pixel) - qGreen(reference)) <= tolerance
+        && qAbs(qBlue(pixel) - qBlue(reference)) <= tolerance;
+}
+
+#ifdef SCD_HAVE_SSE2
+// 4 个像素的每个字节都与参考色相差不超过容差
+inline bool matches4(__m128i pixels, __m128i reference, __m128i tolerance)
+{
+    const __m128i diff = _mm_or_si128(_mm_subs_epu8(pixels, reference), _mm_subs_epu8(reference, pixels));
+    const __m128i over = _mm_subs_epu8(diff, tolerance);
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(over, _mm_setzero_si128())) == 0xffff;
+}
+#endif
+
+// 从行首开始与参考色一致的像素数，最多检查 limit 个
+int matchingPrefix(const QRgb* line, int limit, QRgb reference, int tolerance)
+{
+    int x = 0;
+#ifdef SCD_HAVE_SSE2
+    const __m128i ref = _mm_set1_epi32(int(reference));
+    const __m128i tol = _mm_set1_epi8(char(tolerance));
+    while (x + 4 <= limit && matches4(_mm_loadu_si128(reinterpret_cast<const __m128i*>(line + x)), ref, tol)) {
+        x += 4;
+    }
+#endif
+    while (x < limit && matches(line[x], reference, tolerance)) {
+        ++x;
+    }
+    return x;
+}
+
+// 从 line[end - 1] 向前与参考色一致的像素数，最多检查 limit 个
+int matchingSuffix(const QRgb* line, int end, int limit, QRgb reference, int tolerance)
+{
+    int count = 0;
+#ifdef SCD_HAVE_SSE2
+    const __m128i ref = _mm_set1_epi32(int(reference));
+    const __m128i tol = _mm_set1_epi8(char(tolerance));
+    while (count + 4 <= limit
+           && matches4(_mm_loadu_si128(reinterpret_cast<const __m128i*>(line + end - count - 4)), ref, tol)) {
+        count += 4;
+    }
+#endif
+    while (count < limit && matches(line[end - count - 1], reference, tolerance)) {
+        ++count;
+    }
+    return count;
+}
+
+inline const QRgb* pixelRow(const QImage& image, int y)
+{
+    return reinterpret_cast<const QRgb*>(image.constScanLine(y));
+}
+
+} // namespace
+
+QRect AutoTrim::trim(const QImage& source, const QRect& rect, int tolerance)
+{
+    const QRect area = rect.intersected(source.rect());
+    if (area.width() < 2 || area.height() < 2) {
+        return rect;
+    }
+    // 逐字节比较要求 32 位像素；其他格式只转换选区部分
+    if (source.depth() != 32) {
+        const QImage converted = source.copy(area).convertToFormat(QImage::Format_ARGB32_Premultiplied);
+        return trim(converted, converted.rect(), tolerance).translated(area.topLeft());
+    }
+    tolerance = qBound(0, tolerance, 255);
+
+    const int left = area.left();
+    const int width = area.width();
+    int top = area.top();
+    int bottom = area.bottom();
+
+    // 上下两边：整行与边框色一致
+    const QRgb topColor = pixelRow(source, top)[left];
+    while (top <= bottom && matchingPrefix(pixelRow(source, top) + left, width, topColor, tolerance) == width) {
+        ++top;
+    }
+    if (top > bottom) {
+        return rect;    // 整块都是同一颜色，没有内容可保留
+    }
+    const QRgb bottomColor = pixelRow(source, bottom)[left];
+    while (bottom > top && matchingPrefix(pixelRow(source, bottom) + left, width, bottomColor, tolerance) == width) {
+        --bottom;
+    }
+
+    // 左右两边：每行与边框色一致的前缀（后缀）取最小值，已找到的最小值之后不再检查
+    const QRgb leftColor = pixelRow(source, top)[left];
+    const QRgb rightColor = pixelRow(source, top)[area.right()];
+    int leftTrim = width;
+    int rightTrim = width;
+    for (int y = top; y <= bottom && (leftTrim > 0 || rightTrim > 0); ++y) {
+        const QRgb* line = pixelRow(source, y) + left;
+        if (leftTrim > 0) {
+            leftTrim = matchingPrefix(line, leftTrim, leftColor, tolerance);
+        }
+        if (rightTrim > 0) {
+            rightTrim = matchingSuffix(line, width, rightTrim, rightColor, tolerance);
+        }
+    }
+    // 上下去边后剩下的行中一定有与边框色不同的像素，但左右边框色可能不同，两者之和仍可能覆盖整行
+    if (leftTrim + rightTrim >= width) {
+        return QRect(QPoint(left, top), QPoint(area.right(), bottom));
+    }
+    return QRect(QPoint(left + leftTrim, top), QPoint(area.right() - rightTrim, bottom));
+}
+
+QRect AutoTrim::trim(const CaptureFrame& frame, const QRect& rect, int tolerance)
+{
+    for (const CaptureFrame::Region& region : frame.regions()) {
+        if (region.rect.contains(rect)) {
+            return trim(region.image, rect.translated(-region.rect.topLeft()), tolerance)
+                .translated(region.rect.topLeft());
+        }
+    }
+    // 跨越多个屏幕：合成后再处理，屏幕之间的空隙为透明
+    return trim(frame.crop(rect), QRect(QPoint(0, 0), rect.size()), tolerance).translated(rect.topLeft());
+}
+
+bool AutoTrim::isEnabled()
+{
+    return QSettings("SCD", "SCD").value("trim/enabled", false).toBool();
+}
+
+void AutoTrim::setEnabled(bool enabled)
+{
+    QSettings settings("SCD", "SCD");
+    settings.setValue("trim/enabled", enabled);
+}
+
+int AutoTrim::tolerance()
+{
+    return qBound(0, QSettings("SCD", "SCD").value("trim/tolerance", kDefaultTolerance).toInt(), 255);
+}
@@ -0,0 +1,31 @@
+#ifndef AUTOTRIM_H
+#define AUTOTRIM_H
+
+#include <QImage>
+#include <QRect>
+
+class CaptureFrame;
+
+// 自动去除选区四周的纯色边距和空白
+//
+// 每条边以其最外侧的像素颜色为边框色，由外向内逐行（逐列）比较，
+// 所有像素每个通道与边框色相差不超过 tolerance 时去掉该行（列）。
+// 左右两边不按列访问内存，而是在每一行上求与边框色一致的前缀（后缀）长度再取最小值，
+// 全部比较都在连续内存上用 SSE2 一次处理 4 个像素，4K 区域可以在拖动选区时实时计算
+class AutoTrim
+{
+public:
+    static constexpr int kDefaultTolerance = 8;
+
+    // rect 为 image 中的区域，返回去掉边距后的区域；整块都是边框色时返回 rect
+    static QRect trim(const QImage& image, const QRect& rect, int tolerance);
+    // rect 为帧坐标。选区落在一个屏幕内时直接读取抓图，不复制像素
+    static QRect trim(const CaptureFrame& frame, const QRect& rect, int tolerance);
+
+    // 设置：选区是否自动去边（拖动选区时实时预览，松开后生效），以及容差
+    static bool isEnabled();
+    static void setEnabled(bool enabled);
+    static int tolerance();
+};
+
+#endif // AUTOTRIM_H
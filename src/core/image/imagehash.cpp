@@ -0,0 +1,152 @@
+#include "imagehash.h"
+#include "../../utils/parallelutils.h"
+#include "../../utils/simdutils.h"
+#include <QVector>
+#include <cstring>
+
+namespace {
+
+constexpr int kGridWidth = 9;
+constexpr int kGridHeight = 8;
+constexpr int kMaxSampleRows = 16;   // 每个格子最多采样的行数
+constexpr int kStripeRows = 64;      // 内容哈希的分条行数，固定不变以保证结果稳定
+constexpr quint64 kPrime = 0x100000001b3ULL;
+
+QImage to32Bit(const QImage& image)
+{
+    if (image.format() == QImage::Format_ARGB32_Premultiplied || image.format() == QImage::Format_ARGB32
+        || image.format() == QImage::Format_RGB32) {
+        return image;
+    }
+    return image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+}
+
+// 一段像素的亮度和，按 (B + 2G + R) 近似，最后除以 4
+quint64 lumaSum(const uchar* pixels, int count)
+{
+    quint64 sum = 0;
+    int i = 0;
+#ifdef SCD_HAVE_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i weights = _mm_setr_epi16(1, 2, 1, 0, 1, 2, 1, 0);
+    __m128i acc = _mm_setzero_si128();
+    for (; i + 4 <= count; i += 4) {
+        const __m128i px = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels + i * 4));
+        const __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi8(px, zero), weights);
+        const __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi8(px, zero), weights);
+        acc = _mm_add_epi32(acc, _mm_add_epi32(lo, hi));
+    }
+    quint32 lanes[4];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), acc);
+    sum = quint64(lanes[0]) + lanes[1] + lanes[2] + lanes[3];
+#endif
+    for (; i < count; ++i) {
+        const uchar* p = pixels + i * 4;
+        sum += p[0] + 2 * p[1] + p[2];
+    }
+    return sum;
+}
+
+quint64 hashRows(const QImage& image, int top, int bottom)
+{
+    // 四路独立累加，避免单条乘法依赖链限制吞吐
+    const int bytes = image.width() * 4;
+    const int words = bytes / 8;
+    quint64 lanes[4] = {0x9e3779b97f4a7c15ULL, 0xc2b2ae3d27d4eb4fULL, 0x165667b19e3779f9ULL, 0x27d4eb2f165667c5ULL};
+    for (int y = top; y < bottom; ++y) {
+        const uchar* line = image.constScanLine(y);
+        int i = 0;
+        for (; i + 4 <= words; i += 4) {
+            for (int lane = 0; lane < 4; ++lane) {
+                quint64 word;
+                std::memcpy(&word, line + (i + lane) * 8, 8);
+                lanes[lane] = (lanes[lane] ^ word) * kPrime;
+                lanes[lane] ^= lanes[lane] >> 29;
+            }
+        }
+        for (; i < words; ++i) {
+            quint64 word;
+            std::memcpy(&word, line + i * 8, 8);
+            lanes[0] = (lanes[0] ^ word) * kPrime;
+        }
+        if (bytes % 8) {
+            quint64 word = 0;
+            std::memcpy(&word, line + words * 8, size_t(bytes % 8));
+            lanes[1] = (lanes[1] ^ word) * kPrime;
+        }
+    }
+    quint64 hash = lanes[0];
+    for (int lane = 1; lane < 4; ++lane) {
+        hash ^= lanes[lane] + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+    }
+    return hash;
+}
+
+} // namespace
+
+quint64 ImageHash::perceptual(const QImage& source)
+{
+    if (source.isNull()) {
+        return 0;
+    }
+    const QImage image = to32Bit(source);
+    const int width = image.width();
+    const int height = image.height();
+
+    double luma[kGridHeight][kGridWidth];
+    for (int gy = 0; gy < kGridHeight; ++gy) {
+        const int top = gy * height / kGridHeight;
+        const int bottom = qMax(top + 1, (gy + 1) * height / kGridHeight);
+        const int step = qMax(1, (bottom - top) / kMaxSampleRows);
+        for (int gx = 0; gx < kGridWidth; ++gx) {
+            const int left = gx * width / kGridWidth;
+            const int right = qMax(left + 1, (gx + 1) * width / kGridWidth);
+            quint64 sum = 0;
+            int samples = 0;
+            for (int y = top; y < qMin(bottom, height); y += step) {
+                sum += lumaSum(image.constScanLine(y) + left * 4, qMin(right, width) - left);
+                samples += qMin(right, width) - left;
+            }
+            luma[gy][gx] = samples > 0 ? double(sum) / samples : 0.0;
+        }
+    }
+
+    quint64 hash = 0;
+    int bit = 0;
+    for (int gy = 0; gy < kGridHeight; ++gy) {
+        for (int gx = 0; gx < kGridWidth - 1; ++gx, ++bit) {
+            if (luma[gy][gx] < luma[gy][gx + 1]) {
+                hash |= quint64(1) << bit;
+            }
+        }
+    }
+    return hash;
+}
+
+quint64 ImageHash::content(const QImage& source)
+{
+    if (source.isNull()) {
+        return 0;
+    }
+    const QImage image = to32Bit(source);
+    const int stripes = (image.height() + kStripeRows - 1) / kStripeRows;
+    QVector<quint64> hashes(stripes);
+    quint64* out = hashes.data();
+    ParallelUtils::forRange(stripes, 8, [&image, out](int begin, int end) {
+        for (int i = begin; i < end; ++i) {
+            out[i] = hashRows(image, i * kStripeRows, qMin(image.height(), (i + 1) * kStripeRows));
+        }
+    });
+
+    quint64 hash = (quint64(image.width()) << 32) ^ quint64(image.height());
+    for (quint64 stripe : hashes) {
+        hash = (hash ^ stripe) * kPrime;
+        hash ^= hash >> 31;
+    }
+    return hash;
+}
+
+int ImageHash::distance(quint64 a, quint64 b)
+{
+    return qPopulationCount(a ^ b);
+}
@@ -0,0 +1,21 @@
+#ifndef IMAGEHASH_H
+#define IMAGEHASH_H
+
+#include <QImage>
+#include <QtGlobal>
+
+// 图片哈希：感知哈希用于判断近似重复，内容哈希用于判断像素完全相同
+class ImageHash
+{
+public:
+    // dHash：缩小到 9x8 的灰度网格，比较水平相邻格子的亮度，得到 64 位
+    // 格子亮度直接在原图上按行采样求平均（SSE2），不生成缩小后的图片
+    static quint64 perceptual(const QImage& image);
+
+    // 按像素计算的 64 位哈希；图片按固定行数分条并行计算，结果与线程数无关
+    static quint64 content(const QImage& image);
+
+    static int distance(quint64 a, quint64 b);
+};
+
+#endif // IMAGEHASH_H
@@ -0,0 +1,379 @@
+#include "pixelstore.h"
+#include <QImageReader>
+#include <QVector>
+#include <QDir>
+#include <QtEndian>
+#include <QDebug>
+#include <cstring>
+#include <cstdlib>
+#ifdef SCD_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace {
+
+constexpr int kCancelCheckRows = 64;    // 每解码这么多行检查一次是否取消
+
+#ifdef SCD_HAVE_ZLIB
+
+quint8 paeth(int a, int b, int c)
+{
+    int p = a + b - c;
+    int pa = std::abs(p - a);
+    int pb = std::abs(p - b);
+    int pc = std::abs(p - c);
+    if (pa <= pb && pa <= pc) {
+        return quint8(a);
+    }
+    return quint8(pb <= pc ? b : c);
+}
+
+// 按 PNG 规范还原一行滤波后的数据，prior 为上一行（首行为全零）
+bool unfilterRow(quint8 filter, quint8* row, const quint8* prior, int length, int bpp)
+{
+    switch (filter) {
+    case 0:
+        return true;
+    case 1:
+        for (int i = bpp; i < length; ++i) {
+            row[i] = quint8(row[i] + row[i - bpp]);
+        }
+        return true;
+    case 2:
+        for (int i = 0; i < length; ++i) {
+            row[i] = quint8(row[i] + prior[i]);
+        }
+        return true;
+    case 3:
+        for (int i = 0; i < length; ++i) {
+            const int left = i >= bpp ? row[i - bpp] : 0;
+            row[i] = quint8(row[i] + ((left + prior[i]) >> 1));
+        }
+        return true;
+    case 4:
+        for (int i = 0; i < length; ++i) {
+            const int left = i >= bpp ? row[i - bpp] : 0;
+            const int upLeft = i >= bpp ? prior[i - bpp] : 0;
+            row[i] = quint8(row[i] + paeth(left, prior[i], upLeft));
+        }
+        return true;
+    default:
+        return false;
+    }
+}
+
+struct PngHeader {
+    quint32 width = 0;
+    quint32 height = 0;
+    int bitDepth = 0;
+    int colorType = 0;
+    int interlace = 0;
+    QVector<QRgb> palette;      // 已预乘
+    bool hasTransparency = false;
+
+    int channels() const
+    {
+        switch (colorType) {
+        case 2: return 3;
+        case 4: return 2;
+        case 6: return 4;
+        default: return 1;
+        }
+    }
+    bool hasAlpha() const { return colorType == 4 || colorType == 6 || (colorType == 3 && hasTransparency); }
+};
+
+bool readChunk(QFile& input, QByteArray* type, QByteArray* data)
+{
+    uchar header[8];
+    if (input.read(reinterpret_cast<char*>(header), 8) != 8) {
+        return false;
+    }
+    const quint32 length = qFromBigEndian<quint32>(header);
+    if (length > 0x7fffffffu) {
+        return false;
+    }
+    *type = QByteArray(reinterpret_cast<const char*>(header + 4), 4);
+    *data = input.read(length);
+    // 跳过 CRC；数据损坏时由 inflate 或后续的整图解码报告
+    return data->size() == int(length) && input.skip(4) == 4;
+}
+
+// 单个像素的样本：位深小于 8 时从字节中取出对应的位
+inline int sampleAt(const quint8* row, int index, int bitDepth)
+{
+    if (bitDepth == 8) {
+        return row[index];
+    }
+    const int bit = index * bitDepth;
+    const int shift = 8 - bitDepth - (bit & 7);
+    return (row[bit >> 3] >> shift) & ((1 << bitDepth) - 1);
+}
+
+void convertRow(const PngHeader& header, const quint8* row, QRgb* target)
+{
+    const int width = int(header.width);
+    const int scale = 255 / ((1 << header.bitDepth) - 1);
+    switch (header.colorType) {
+    case 0:
+        for (int x = 0; x < width; ++x) {
+            const int gray = sampleAt(row, x, header.bitDepth) * scale;
+            target[x] = qRgb(gray, gray, gray);
+        }
+        break;
+    case 2:
+        for (int x = 0; x < width; ++x) {
+            target[x] = qRgb(row[3 * x], row[3 * x + 1], row[3 * x + 2]);
+        }
+        break;
+    case 3:
+        for (int x = 0; x < width; ++x) {
+            const int index = sampleAt(row, x, header.bitDepth);
+            target[x] = index < header.palette.size() ? header.palette[index] : qRgb(0, 0, 0);
+        }
+        break;
+    case 4:
+        for (int x = 0; x < width; ++x) {
+            target[x] = qPremultiply(qRgba(row[2 * x], row[2 * x], row[2 * x], row[2 * x + 1]));
+        }
+        break;
+    case 6:
+        for (int x = 0; x < width; ++x) {
+            target[x] = qPremultiply(qRgba(row[4 * x], row[4 * x + 1], row[4 * x + 2], row[4 * x + 3]));
+        }
+        break;
+    }
+}
+
+#endif // SCD_HAVE_ZLIB
+
+} // namespace
+
+std::shared_ptr<const PixelStore> PixelStore::build(const QString& filePath, const std::atomic<bool>& cancelled)
+{
+    std::shared_ptr<PixelStore> store(new PixelStore());
+    store->m_file.setFileTemplate(QDir::tempPath() + "/SCD-pixels-XXXXXX");
+    if (!store->m_file.open()) {
+        qDebug() << "Cannot create pixel store:" << store->m_file.errorString();
+        return nullptr;
+    }
+
+    bool decoded = false;
+#ifdef SCD_HAVE_ZLIB
+    QFile input(filePath);
+    if (input.open(QIODevice::ReadOnly)) {
+        decoded = store->decodePng(input, cancelled);
+    }
+#endif
+    if (!decoded && !cancelled.load()) {
+        // 不是 PNG、PNG 使用了隔行扫描或 16 位等未流式处理的变体，或数据损坏：交给 Qt 整图解码一次
+        store->m_file.resize(0);
+        store->m_file.seek(0);
+        decoded = store->decodeWhole(filePath, cancelled);
+    }
+    if (!decoded || !store->finish()) {
+        return nullptr;
+    }
+    return store;
+}
+
+bool PixelStore::begin(const QSize& size, QImage::Format format)
+{
+    if (size.isEmpty()) {
+        return false;
+    }
+    m_size = size;
+    m_format = format;
+    m_stride = qsizetype(size.width()) * 4;
+    return true;
+}
+
+bool PixelStore::appendRow(const QRgb* row)
+{
+    return m_file.write(reinterpret_cast<const char*>(row), m_stride) == m_stride;
+}
+
+bool PixelStore::finish()
+{
+    const qint64 bytes = qint64(m_stride) * m_size.height();
+    if (!m_file.flush() || m_file.size() != bytes) {
+        return false;
+    }
+    m_bits = m_file.map(0, bytes);
+    if (!m_bits) {
+        qDebug() << "Cannot map pixel store:" << m_file.errorString();
+        return false;
+    }
+    return true;
+}
+
+bool PixelStore::decodeWhole(const QString& filePath, const std::atomic<bool>& cancelled)
+{
+    QImageReader reader(filePath);
+    reader.setAutoTransform(false);
+    QImage image = reader.read();
+    if (image.isNull() || cancelled.load()) {
+        return false;
+    }
+    image = image.convertToFormat(image.hasAlphaChannel() ? QImage::Format_ARGB32_Premultiplied
+                                                          : QImage::Format_RGB32);
+    if (!begin(image.size(), image.format())) {
+        return false;
+    }
+    for (int y = 0; y < image.height(); ++y) {
+        if (!appendRow(reinterpret_cast<const QRgb*>(image.constScanLine(y)))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool PixelStore::decodePng(QFile& input, const std::atomic<bool>& cancelled)
+{
+#ifdef SCD_HAVE_ZLIB
+    static const char kSignature[] = "\x89PNG\r\n\x1a\n";
+    if (input.read(8) != QByteArray(kSignature, 8)) {
+        return false;
+    }
+
+    PngHeader header;
+    QByteArray type;
+    QByteArray data;
+    QVector<QRgb> colors;
+    QByteArray alphas;
+    // 读到第一个 IDAT 为止
+    for (;;) {
+        if (!readChunk(input, &type, &data)) {
+            return false;
+        }
+        if (type == "IHDR") {
+            if (data.size() < 13) {
+                return false;
+            }
+            const uchar* bytes = reinterpret_cast<const uchar*>(data.constData());
+            header.width = qFromBigEndian<quint32>(bytes);
+            header.height = qFromBigEndian<quint32>(bytes + 4);
+            header.bitDepth = bytes[8];
+            header.colorType = bytes[9];
+            header.interlace = bytes[12];
+        } else if (type == "PLTE") {
+            for (int i = 0; i + 2 < data.size(); i += 3) {
+                colors.append(qRgb(uchar(data[i]), uchar(data[i + 1]), uchar(data[i + 2])));
+            }
+        } else if (type == "tRNS") {
+            alphas = data;
+        } else if (type == "IDAT") {
+            break;
+        } else if (type == "IEND") {
+            return false;
+        }
+    }
+
+    // 只流式处理最常见的变体：非隔行，位深不超过 8，灰度和 RGB 没有 tRNS 色键
+    const bool lowDepth = header.bitDepth == 1 || header.bitDepth == 2 || header.bitDepth == 4;
+    const bool supported = header.interlace == 0 && header.width > 0 && header.height > 0
+        && header.width <= 0x7fffffffu / 4 && header.height <= 0x7fffffffu
+        && (header.bitDepth == 8 || (lowDepth && (header.colorType == 0 || header.colorType == 3)))
+        && (header.colorType == 0 || header.colorType == 2 || header.colorType == 3
+            || header.colorType == 4 || header.colorType == 6)
+        && (alphas.isEmpty() || header.colorType == 3);
+    if (!supported) {
+        return false;
+    }
+    header.hasTransparency = !alphas.isEmpty();
+    for (int i = 0; i < colors.size(); ++i) {
+        const int alpha = i < alphas.size() ? uchar(alphas[i]) : 255;
+        header.palette.append(qPremultiply(qRgba(qRed(colors[i]), qGreen(colors[i]), qBlue(colors[i]), alpha)));
+    }
+
+    const int width = int(header.width);
+    const int height = int(header.height);
+    const int bitsPerPixel = header.channels() * header.bitDepth;
+    const int rowBytes = int((qint64(width) * bitsPerPixel + 7) / 8);
+    const int bpp = qMax(1, bitsPerPixel / 8);
+    if (!begin(QSize(width, height), header.hasAlpha() ? QImage::Format_ARGB32_Premultiplied
+                                                        : QImage::Format_RGB32)) {
+        return false;
+    }
+
+    z_stream stream;
+    std::memset(&stream, 0, sizeof(stream));
+    if (inflateInit(&stream) != Z_OK) {
+        return false;
+    }
+    // 每行前有一个滤波类型字节
+    QByteArray current(rowBytes + 1, '\0');
+    QByteArray prior(rowBytes + 1, '\0');
+    QVector<QRgb> pixels(width);
+    int filled = 0;
+    int y = 0;
+    bool ok = true;
+    stream.next_in = reinterpret_cast<Bytef*>(data.data());
+    stream.avail_in = uInt(data.size());
+    while (ok && y < height) {
+        if (stream.avail_in == 0) {
+            // 压缩数据可以分散在多个连续的 IDAT 中
+            if (!readChunk(input, &type, &data) || type != "IDAT") {
+                ok = false;
+                break;
+            }
+            stream.next_in = reinterpret_cast<Bytef*>(data.data());
+            stream.avail_in = uInt(data.size());
+            continue;
+        }
+        stream.next_out = reinterpret_cast<Bytef*>(current.data()) + filled;
+        stream.avail_out = uInt(rowBytes + 1 - filled);
+        const int status = inflate(&stream, Z_NO_FLUSH);
+        if (status != Z_OK && status != Z_STREAM_END) {
+            ok = false;
+            break;
+        }
+        filled = rowBytes + 1 - int(stream.avail_out);
+        if (filled == rowBytes + 1) {
+            quint8* row = reinterpret_cast<quint8*>(current.data()) + 1;
+            const quint8* above = reinterpret_cast<const quint8*>(prior.constData()) + 1;
+            if (!unfilterRow(quint8(current[0]), row, above, rowBytes, bpp)) {
+                ok = false;
+                break;
+            }
+            convertRow(header, row, pixels.data());
+            if (!appendRow(pixels.constData())) {
+                ok = false;
+                break;
+            }
+            current.swap(prior);
+            filled = 0;
+            ++y;
+            if (y % kCancelCheckRows == 0 && cancelled.load()) {
+                ok = false;
+            }
+        } else if (status == Z_STREAM_END) {
+            // 数据不足一整张图
+            ok = false;
+        }
+    }
+    inflateEnd(&stream);
+    return ok && y == height;
+#else
+    Q_UNUSED(input);
+    Q_UNUSED(cancelled);
+    return false;
+#endif
+}
+
+QImage PixelStore::copy(const QRect& rect) const
+{
+    const QRect area = rect.intersected(QRect(QPoint(0, 0), m_size));
+    if (area.isEmpty() || !m_bits) {
+        return QImage();
+    }
+    QImage image(area.size(), m_format);
+    if (image.isNull()) {
+        return image;
+    }
+    const size_t bytes = size_t(area.width()) * 4;
+    for (int y = 0; y < area.height(); ++y) {
+        std::memcpy(image.scanLine(y), m_bits + qsizetype(area.y() + y) * m_stride + qsizetype(area.x()) * 4, bytes);
+    }
+    return image;
+}
@@ -0,0 +1,42 @@
+#ifndef PIXELSTORE_H
+#define PIXELSTORE_H
+
+#include <QImage>
+#include <QTemporaryFile>
+#include <QString>
+#include <memory>
+#include <atomic>
+
+// 解码一次、写入临时文件并映射到内存的原图像素，供不支持区域解码的格式（PNG、BMP、WebP 等）按图块读取。
+//
+// PNG 在有 zlib 时逐行解压和反滤波直接写入文件，解码过程中只持有一行像素；
+// 其余格式整图解码一次后写入文件并立即释放。之后的图块只从映射中复制，
+// 常驻内存由系统页缓存管理，不再每次平移或缩放都重新解码整张图
+class PixelStore
+{
+public:
+    // 在后台线程调用；cancelled 变为 true 时尽快放弃。失败返回空指针
+    static std::shared_ptr<const PixelStore> build(const QString& filePath, const std::atomic<bool>& cancelled);
+
+    QSize size() const { return m_size; }
+    QImage::Format format() const { return m_format; }
+    // 复制原图中的一块区域，可在多个线程同时调用
+    QImage copy(const QRect& rect) const;
+
+private:
+    PixelStore() = default;
+
+    QTemporaryFile m_file;
+    uchar* m_bits{nullptr};
+    QSize m_size;
+    QImage::Format m_format{QImage::Format_RGB32};
+    qsizetype m_stride{0};
+
+    bool begin(const QSize& size, QImage::Format format);
+    bool appendRow(const QRgb* row);
+    bool finish();
+    bool decodePng(QFile& input, const std::atomic<bool>& cancelled);
+    bool decodeWhole(const QString& filePath, const std::atomic<bool>& cancelled);
+};
+
+#endif // PIXELSTORE_H
@@ -0,0 +1,241 @@
+#include "progressiveimage.h"
+#include "pixelstore.h"
+#include <QImageReader>
+#include <QThreadPool>
+#include <QCoreApplication>
+#include <QPointer>
+#include <QElapsedTimer>
+#include <QDebug>
+
+namespace {
+
+// 解码专用线程池：磁盘读取会阻塞，不占用全局线程池
+QThreadPool* decodePool()
+{
+    static QThreadPool* pool = []() {
+        QThreadPool* instance = new QThreadPool();
+        instance->setMaxThreadCount(2);
+        return instance;
+    }();
+    return pool;
+}
+
+QImage::Format tileFormat(const QImage& image)
+{
+    return image.hasAlphaChannel() ? QImage::Format_ARGB32_Premultiplied : QImage::Format_RGB32;
+}
+
+} // namespace
+
+ProgressiveImage::ProgressiveImage(const QString& filePath, QObject *parent)
+    : QObject(parent)
+    , m_filePath(filePath)
+    , m_tiles(kTileCacheKB)
+    , m_generation(std::make_shared<std::atomic<int>>(0))
+    , m_closed(std::make_shared<std::atomic<bool>>(false))
+{
+    QImageReader reader(filePath);
+    reader.setAutoTransform(false);
+    m_fullSize = reader.size();
+    m_clipRect = reader.supportsOption(QImageIOHandler::ClipRect);
+    if (!m_fullSize.isValid()) {
+        qDebug() << "Cannot read image:" << filePath << reader.errorString();
+        return;
+    }
+
+    // JPEG 等格式的解码器支持直接按缩小尺寸解码，不会生成原图大小的中间图
+    QSize previewSize = m_fullSize;
+    if (previewSize.width() > kPreviewEdge || previewSize.height() > kPreviewEdge) {
+        previewSize.scale(kPreviewEdge, kPreviewEdge, Qt::KeepAspectRatio);
+        reader.setScaledSize(previewSize);
+    }
+    m_preview = reader.read();
+    if (m_preview.isNull()) {
+        qDebug() << "Cannot decode image:" << filePath << reader.errorString();
+        return;
+    }
+    m_preview = m_preview.convertToFormat(tileFormat(m_preview));
+}
+
+ProgressiveImage::~ProgressiveImage()
+{
+    // 让仍在排队的任务尽快放弃
+    m_generation->fetch_add(1);
+    m_closed->store(true);
+}
+
+qreal ProgressiveImage::previewScale() const
+{
+    if (m_fullSize.isEmpty()) {
+        return 1.0;
+    }
+    return qreal(m_preview.width()) / m_fullSize.width();
+}
+
+QRect ProgressiveImage::tileRect(quint32 key) const
+{
+    int column = int(key & 0xffff);
+    int row = int(key >> 16);
+    return QRect(column * kTileSize, row * kTileSize, kTileSize, kTileSize)
+        .intersected(QRect(QPoint(0, 0), m_fullSize));
+}
+
+QVector<quint32> ProgressiveImage::tilesIn(const QRect& sourceRect) const
+{
+    QVector<quint32> keys;
+    QRect rect = sourceRect.intersected(QRect(QPoint(0, 0), m_fullSize));
+    if (rect.isEmpty()) {
+        return keys;
+    }
+    for (int row = rect.top() / kTileSize; row <= rect.bottom() / kTileSize; ++row) {
+        for (int column = rect.left() / kTileSize; column <= rect.right() / kTileSize; ++column) {
+            keys.append(tileKey(column, row));
+        }
+    }
+    return keys;
+}
+
+void ProgressiveImage::requestTiles(const QRect& sourceRect)
+{
+    if (!isValid()) {
+        return;
+    }
+    if (!m_clipRect && m_storeState != StoreState::Ready) {
+        // 像素缓存建好后再按最后请求的区域解码
+        m_storeRequest = sourceRect;
+        if (m_storeState == StoreState::None) {
+            buildStore();
+        }
+        return;
+    }
+
+    QVector<quint32> missing;
+    bool hasNew = false;
+    for (quint32 key : tilesIn(sourceRect)) {
+        if (m_tiles.contains(key)) {
+            continue;
+        }
+        missing.append(key);
+        hasNew = hasNew || !m_pending.contains(key);
+    }
+    // 需要的图块都已在解码中，沿用当前任务
+    if (!hasNew) {
+        return;
+    }
+
+    // 视口变了：取消旧任务，只解码当前可见的图块
+    const int generation = m_generation->fetch_add(1) + 1;
+    m_pending = QSet<quint32>(missing.begin(), missing.end());
+
+    QVector<QPair<quint32, QRect>> jobs;
+    for (quint32 key : missing) {
+        jobs.append({key, tileRect(key)});
+    }
+
+    QPointer<ProgressiveImage> guard(this);
+    auto generationCounter = m_generation;
+    const QString path = m_filePath;
+    const std::shared_ptr<const PixelStore> store = m_store;
+    decodePool()->start([guard, generationCounter, generation, path, store, jobs]() {
+        for (const auto& job : jobs) {
+            if (generationCounter->load() != generation) {
+                return;
+            }
+
+            QImage tile;
+            if (store) {
+                tile = store->copy(job.second);
+            } else {
+                QImageReader reader(path);
+                reader.setAutoTransform(false);
+                reader.setClipRect(job.second);
+                tile = reader.read();
+            }
+            if (tile.isNull()) {
+                continue;
+            }
+            tile = tile.convertToFormat(tileFormat(tile));
+
+            const quint32 key = job.first;
+            QMetaObject::invokeMethod(qApp, [guard, key, tile]() {
+                if (guard) {
+                    guard->onTileDecoded(key, tile);
+                }
+            }, Qt::QueuedConnection);
+        }
+    });
+}
+
+void ProgressiveImage::buildStore()
+{
+    m_storeState = StoreState::Building;
+    QPointer<ProgressiveImage> guard(this);
+    auto closed = m_closed;
+    const QString path = m_filePath;
+    decodePool()->start([guard, closed, path]() {
+        QElapsedTimer timer;
+        timer.start();
+        const std::shared_ptr<const PixelStore> store = PixelStore::build(path, *closed);
+        if (store) {
+            qDebug() << "Pixel store for" << path << "built in" << timer.elapsed() << "ms";
+        }
+        QMetaObject::invokeMethod(qApp, [guard, store]() {
+            if (guard) {
+                guard->onStoreBuilt(store);
+            }
+        }, Qt::QueuedConnection);
+    });
+}
+
+void ProgressiveImage::onStoreBuilt(const std::shared_ptr<const PixelStore>& store)
+{
+    if (!store) {
+        // 只能继续显示预览图
+        qDebug() << "Cannot decode full resolution:" << m_filePath;
+        m_storeState = StoreState::Failed;
+        return;
+    }
+    m_store = store;
+    m_storeState = StoreState::Ready;
+    requestTiles(m_storeRequest);
+}
+
+void ProgressiveImage::onTileDecoded(quint32 key, const QImage& image)
+{
+    m_pending.remove(key);
+    m_tiles.insert(key, new QImage(image), qMax(1, int(image.sizeInBytes() / 1024)));
+    emit tileReady(tileRect(key));
+}
+
+QVector<QPair<QRect, QImage>> ProgressiveImage::tiles(const QRect& sourceRect) const
+{
+    QVector<QPair<QRect, QImage>> result;
+    for (quint32 key : tilesIn(sourceRect)) {
+        if (QImage* tile = m_tiles.object(key)) {
+            result.append({tileRect(key), *tile});
+        }
+    }
+    return result;
+}
+
+void ProgressiveImage::loadFull(QObject* context, const std::function<void(const QImage&)>& done) const
+{
+    QPointer<QObject> guard(context);
+    const QString path = m_filePath;
+    const std::shared_ptr<const PixelStore> store = m_store;
+    decodePool()->start([guard, path, store, done]() {
+        QImage image;
+        if (store) {
+            image = store->copy(QRect(QPoint(0, 0), store->size()));
+        } else {
+            QImageReader reader(path);
+            reader.setAutoTransform(false);
+            image = reader.read();
+        }
+        QMetaObject::invokeMethod(qApp, [guard, image, done]() {
+            if (guard) {
+                done(image);
+            }
+        }, Qt::QueuedConnection);
+    });
+}
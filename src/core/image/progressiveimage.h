@@ -0,0 +1,81 @@
+#ifndef PROGRESSIVEIMAGE_H
+#define PROGRESSIVEIMAGE_H
+
+#include <QObject>
+#include <QImage>
+#include <QCache>
+#include <QSet>
+#include <QVector>
+#include <QPair>
+#include <memory>
+#include <atomic>
+#include <functional>
+
+class PixelStore;
+
+// 渐进式解码的大图：打开时只按缩小尺寸解码一张预览图，
+// 放大查看时在后台线程按图块解码原始分辨率，图块缓存有内存上限，
+// 因此不会在不需要时持有整张原图。
+// 解码器支持区域解码（JPEG 等）时每个图块单独解码；PNG 等不支持的格式第一次放大时
+// 在后台解码一次写入 PixelStore，之后的图块都从中复制
+class ProgressiveImage : public QObject
+{
+    Q_OBJECT
+public:
+    // 原图图块边长（像素）
+    static constexpr int kTileSize = 512;
+    // 预览图最长边
+    static constexpr int kPreviewEdge = 2048;
+    // 图块缓存上限（KB）
+    static constexpr int kTileCacheKB = 128 * 1024;
+
+    explicit ProgressiveImage(const QString& filePath, QObject *parent = nullptr);
+    ~ProgressiveImage();
+
+    bool isValid() const { return !m_preview.isNull(); }
+    QString filePath() const { return m_filePath; }
+    QSize fullSize() const { return m_fullSize; }
+    const QImage& preview() const { return m_preview; }
+    // 预览图相对原图的缩放比例
+    qreal previewScale() const;
+
+    // 请求 sourceRect（原图坐标）覆盖的原始分辨率图块；
+    // 缺失的图块交给后台解码，完成后发出 tileReady
+    void requestTiles(const QRect& sourceRect);
+    // 与 sourceRect 相交且已解码的图块及其在原图中的位置
+    QVector<QPair<QRect, QImage>> tiles(const QRect& sourceRect) const;
+
+    // 在解码线程中取得整张原图，仅用于用户主动复制、保存等场景；
+    // 完成后在 GUI 线程调用 done，context 已销毁时不调用
+    void loadFull(QObject* context, const std::function<void(const QImage&)>& done) const;
+
+signals:
+    void tileReady(const QRect& sourceRect);
+
+private:
+    QString m_filePath;
+    QSize m_fullSize;
+    QImage m_preview;
+
+    mutable QCache<quint32, QImage> m_tiles;
+    QSet<quint32> m_pending;
+    // 视口变化时递增，正在进行的解码任务据此放弃过期的图块
+    std::shared_ptr<std::atomic<int>> m_generation;
+    // 析构时置位，让正在建立的 PixelStore 放弃
+    std::shared_ptr<std::atomic<bool>> m_closed;
+
+    enum class StoreState { None, Building, Ready, Failed };
+    bool m_clipRect{false};                 // 解码器能否直接解码一块区域
+    StoreState m_storeState{StoreState::None};
+    std::shared_ptr<const PixelStore> m_store;
+    QRect m_storeRequest;                   // PixelStore 建好前最后请求的区域
+
+    static quint32 tileKey(int column, int row) { return (quint32(row) << 16) | quint32(column); }
+    QRect tileRect(quint32 key) const;
+    QVector<quint32> tilesIn(const QRect& sourceRect) const;
+    void onTileDecoded(quint32 key, const QImage& image);
+    void buildStore();
+    void onStoreBuilt(const std::shared_ptr<const PixelStore>& store);
+};
+
+#endif // PROGRESSIVEIMAGE_H
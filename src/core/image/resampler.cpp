@@ -0,0 +1,362 @@
+#include "resampler.h"
+#include "../../utils/parallelutils.h"
+#include "../../utils/simdutils.h"
+#include <QCache>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QVector>
+#include <QtMath>
+#include <cmath>
+#include <memory>
+
+namespace {
+
+constexpr int kPrecision = 14;          // 权重的定点小数位数
+constexpr int kRowChunk = 16;           // 每个并行任务至少处理的行数
+constexpr int kWeightCacheKB = 4 * 1024;
+constexpr double kHorizontalTapCost = 4.0;  // 水平一趟每个输出像素每个抽头的开销，以竖直一趟为 1
+
+// 一个方向上的滤波权重：每个输出坐标读取 taps 个连续的源坐标，不足的以 0 权重补齐
+struct FilterWeights {
+    int taps = 0;
+    QVector<int> start;         // 每个输出坐标的第一个源坐标，start + taps 不超过源长度
+    QVector<qint16> weights;    // 输出坐标数 × taps，每组之和为 1 << kPrecision
+};
+
+using WeightsPtr = std::shared_ptr<const FilterWeights>;
+
+struct WeightCache {
+    QMutex mutex;
+    QCache<quint64, WeightsPtr> entries{kWeightCacheKB};
+};
+
+double sinc(double x)
+{
+    if (qAbs(x) < 1e-9) {
+        return 1.0;
+    }
+    x *= M_PI;
+    return std::sin(x) / x;
+}
+
+WeightsPtr buildWeights(int sourceLength, int targetLength, Resampler::Filter filter)
+{
+    const double scale = double(sourceLength) / targetLength;
+    const double filterScale = qMax(1.0, scale);
+    const double support = Resampler::radius(filter) * filterScale;
+
+    auto result = std::make_shared<FilterWeights>();
+    const int taps = qMin(sourceLength, int(std::ceil(2 * support)) + 2);
+    result->taps = taps;
+    result->start.resize(targetLength);
+    result->weights.fill(0, targetLength * taps);
+
+    QVector<double> raw(taps);
+    for (int i = 0; i < targetLength; ++i) {
+        const double center = (i + 0.5) * scale;
+        const int left = qMax(0, int(std::floor(center - support)));
+        const int right = qMin(sourceLength, int(std::ceil(center + support)));
+        const int count = qMin(taps, right - left);
+
+        double sum = 0;
+        for (int j = 0; j < count; ++j) {
+            const int x = left + j;
+            if (filter == Resampler::Filter::Box) {
+                // 面积平均：像素 [x, x+1) 与采样区间的重叠长度
+                raw[j] = qMax(0.0, qMin(x + 1.0, center + support) - qMax(double(x), center - support));
+            } else {
+                raw[j] = Resampler::kernel(filter, (x + 0.5 - center) / filterScale);
+            }
+            sum += raw[j];
+        }
+
+        // 窗口贴近末端时整体左移，保证每组都能连续读取 taps 个像素
+        const int start = qMin(left, sourceLength - taps);
+        result->start[i] = start;
+        qint16* weights = result->weights.data() + qsizetype(i) * taps;
+        const int offset = left - start;
+
+        // 量化为定点数，舍入误差补到最大的权重上，保证纯色区域缩放后颜色不变
+        int total = 0;
+        int largest = offset;
+        for (int j = 0; j < count; ++j) {
+            const int value = sum != 0 ? qRound(raw[j] / sum * (1 << kPrecision)) : 0;
+            weights[offset + j] = qint16(value);
+            total += value;
+            if (value > weights[largest]) {
+                largest = offset + j;
+            }
+        }
+        weights[largest] = qint16(weights[largest] + (1 << kPrecision) - total);
+    }
+    return result;
+}
+
+WeightsPtr weightsFor(int sourceLength, int targetLength, Resampler::Filter filter)
+{
+    static WeightCache cache;
+    const quint64 key = (quint64(sourceLength) << 32) | (quint64(targetLength) << 8) | quint64(filter);
+    {
+        QMutexLocker locker(&cache.mutex);
+        if (WeightsPtr* cached = cache.entries.object(key)) {
+            return *cached;
+        }
+    }
+    WeightsPtr weights = buildWeights(sourceLength, targetLength, filter);
+    QMutexLocker locker(&cache.mutex);
+    cache.entries.insert(key, new WeightsPtr(weights),
+                         qMax(1, int(weights->weights.size() * sizeof(qint16) / 1024)));
+    return weights;
+}
+
+// 定点累加结果转为 8 位并限制颜色分量不超过 alpha（预乘格式的要求，负权重可能越界）
+inline QRgb packScalar(int b, int g, int r, int a)
+{
+    a = qBound(0, a >> kPrecision, 255);
+    b = qBound(0, b >> kPrecision, a);
+    g = qBound(0, g >> kPrecision, a);
+    r = qBound(0, r >> kPrecision, a);
+    return QRgb(b) | (QRgb(g) << 8) | (QRgb(r) << 16) | (QRgb(a) << 24);
+}
+
+#ifdef SCD_HAVE_SSE2
+// 两个相邻权重拼成 pmaddwd 的系数：低 16 位乘前一个，高 16 位乘后一个
+inline __m128i weightPair(qint16 first, qint16 second)
+{
+    return _mm_set1_epi32(int(quint16(first)) | (int(quint16(second)) << 16));
+}
+
+// 每个像素的 B、G、R 限制为不超过同一像素的 A（16 位，每像素 4 个分量）
+inline __m128i clampToAlpha(__m128i pixels)
+{
+    const __m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(pixels, 0xff), 0xff);
+    return _mm_min_epi16(pixels, alpha);
+}
+#endif
+
+// 水平方向：一行源像素 → 一行 targetWidth 个像素
+void resampleRow(const QRgb* source, QRgb* target, int targetWidth, const FilterWeights& filter)
+{
+    const int taps = filter.taps;
+    const int* starts = filter.start.constData();
+#ifdef SCD_HAVE_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i rounding = _mm_set1_epi32(1 << (kPrecision - 1));
+    for (int x = 0; x < targetWidth; ++x) {
+        const QRgb* pixels = source + starts[x];
+        const qint16* weights = filter.weights.constData() + qsizetype(x) * taps;
+        __m128i sum = rounding;
+        int t = 0;
+        for (; t + 2 <= taps; t += 2) {
+            // [b0 g0 r0 a0 b1 g1 r1 a1] → [b0 b1 g0 g1 r0 r1 a0 a1]
+            const __m128i pair = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(pixels + t)), zero);
+            const __m128i interleaved = _mm_unpacklo_epi16(pair, _mm_srli_si128(pair, 8));
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(interleaved, weightPair(weights[t], weights[t + 1])));
+        }
+        if (t < taps) {
+            const __m128i single = _mm_unpacklo_epi8(_mm_cvtsi32_si128(int(pixels[t])), zero);
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_unpacklo_epi16(single, zero), weightPair(weights[t], 0)));
+        }
+        sum = _mm_srai_epi32(sum, kPrecision);
+        const __m128i packed = clampToAlpha(_mm_packs_epi32(sum, sum));
+        target[x] = QRgb(_mm_cvtsi128_si32(_mm_packus_epi16(packed, packed)));
+    }
+#else
+    for (int x = 0; x < targetWidth; ++x) {
+        const QRgb* pixels = source + starts[x];
+        const qint16* weights = filter.weights.constData() + qsizetype(x) * taps;
+        int b = 1 << (kPrecision - 1), g = b, r = b, a = b;
+        for (int t = 0; t < taps; ++t) {
+            const QRgb pixel = pixels[t];
+            b += int(pixel & 0xff) * weights[t];
+            g += int((pixel >> 8) & 0xff) * weights[t];
+            r += int((pixel >> 16) & 0xff) * weights[t];
+            a += int(pixel >> 24) * weights[t];
+        }
+        target[x] = packScalar(b, g, r, a);
+    }
+#endif
+}
+
+// 竖直方向：taps 行（rows[0] 起，相邻两行相隔 stride 字节）→ 一行，按字节处理 width 个像素
+void resampleColumn(const uchar* rows, qsizetype stride, const qint16* weights, int taps, QRgb* target, int width)
+{
+    int x = 0;
+#ifdef SCD_HAVE_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i rounding = _mm_set1_epi32(1 << (kPrecision - 1));
+    uchar* out = reinterpret_cast<uchar*>(target);
+    for (; x + 4 <= width; x += 4) {
+        const qsizetype offset = qsizetype(x) * 4;
+        __m128i sum0 = rounding;
+        __m128i sum1 = rounding;
+        __m128i sum2 = rounding;
+        __m128i sum3 = rounding;
+        int t = 0;
+        for (; t < taps; t += 2) {
+            const bool hasSecond = t + 1 < taps;
+            const __m128i coeffs = weightPair(weights[t], hasSecond ? weights[t + 1] : qint16(0));
+            const __m128i first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows + t * stride + offset));
+            const __m128i second = hasSecond
+                ? _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows + (t + 1) * stride + offset))
+                : zero;
+            // 两行同一字节交错后与 [w0 w1] 做 pmaddwd
+            const __m128i firstLow = _mm_unpacklo_epi8(first, zero);
+            const __m128i secondLow = _mm_unpacklo_epi8(second, zero);
+            const __m128i firstHigh = _mm_unpackhi_epi8(first, zero);
+            const __m128i secondHigh = _mm_unpackhi_epi8(second, zero);
+            sum0 = _mm_add_epi32(sum0, _mm_madd_epi16(_mm_unpacklo_epi16(firstLow, secondLow), coeffs));
+            sum1 = _mm_add_epi32(sum1, _mm_madd_epi16(_mm_unpackhi_epi16(firstLow, secondLow), coeffs));
+            sum2 = _mm_add_epi32(sum2, _mm_madd_epi16(_mm_unpacklo_epi16(firstHigh, secondHigh), coeffs));
+            sum3 = _mm_add_epi32(sum3, _mm_madd_epi16(_mm_unpackhi_epi16(firstHigh, secondHigh), coeffs));
+        }
+        const __m128i low = clampToAlpha(_mm_packs_epi32(_mm_srai_epi32(sum0, kPrecision),
+                                                         _mm_srai_epi32(sum1, kPrecision)));
+        const __m128i high = clampToAlpha(_mm_packs_epi32(_mm_srai_epi32(sum2, kPrecision),
+                                                          _mm_srai_epi32(sum3, kPrecision)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + offset), _mm_packus_epi16(low, high));
+    }
+#endif
+    for (; x < width; ++x) {
+        int b = 1 << (kPrecision - 1), g = b, r = b, a = b;
+        for (int t = 0; t < taps; ++t) {
+            const QRgb pixel = reinterpret_cast<const QRgb*>(rows + t * stride)[x];
+            b += int(pixel & 0xff) * weights[t];
+            g += int((pixel >> 8) & 0xff) * weights[t];
+            r += int((pixel >> 16) & 0xff) * weights[t];
+            a += int(pixel >> 24) * weights[t];
+        }
+        target[x] = packScalar(b, g, r, a);
+    }
+}
+
+// 每一行缩放到 filter 的目标宽度
+QImage horizontalPass(const QImage& source, const FilterWeights& filter)
+{
+    const int targetWidth = filter.start.size();
+    QImage result(targetWidth, source.height(), source.format());
+    const uchar* sourceBits = source.constBits();
+    const qsizetype sourceStride = source.bytesPerLine();
+    uchar* targetBits = result.bits();
+    const qsizetype targetStride = result.bytesPerLine();
+    const FilterWeights* weights = &filter;
+    ParallelUtils::forRange(source.height(), kRowChunk, [=](int begin, int end) {
+        for (int y = begin; y < end; ++y) {
+            resampleRow(reinterpret_cast<const QRgb*>(sourceBits + y * sourceStride),
+                        reinterpret_cast<QRgb*>(targetBits + y * targetStride), targetWidth, *weights);
+        }
+    });
+    return result;
+}
+
+// 每一列缩放到 filter 的目标高度，按输出行划分任务
+QImage verticalPass(const QImage& source, const FilterWeights& filter)
+{
+    const int targetHeight = filter.start.size();
+    const int width = source.width();
+    QImage result(width, targetHeight, source.format());
+    const uchar* sourceBits = source.constBits();
+    const qsizetype sourceStride = source.bytesPerLine();
+    uchar* targetBits = result.bits();
+    const qsizetype targetStride = result.bytesPerLine();
+    const FilterWeights* weights = &filter;
+    ParallelUtils::forRange(targetHeight, kRowChunk, [=](int begin, int end) {
+        const int taps = weights->taps;
+        for (int y = begin; y < end; ++y) {
+            resampleColumn(sourceBits + weights->start[y] * sourceStride, sourceStride,
+                           weights->weights.constData() + qsizetype(y) * taps, taps,
+                           reinterpret_cast<QRgb*>(targetBits + y * targetStride), width);
+        }
+    });
+    return result;
+}
+
+} // namespace
+
+double Resampler::kernel(Filter filter, double x)
+{
+    x = qAbs(x);
+    switch (filter) {
+        case Filter::Box:
+            return x < 0.5 ? 1.0 : 0.0;
+        case Filter::Lanczos3:
+            return x < 3.0 ? sinc(x) * sinc(x / 3.0) : 0.0;
+        case Filter::Mitchell: {
+            // B = C = 1/3
+            constexpr double B = 1.0 / 3.0;
+            constexpr double C = 1.0 / 3.0;
+            if (x < 1.0) {
+                return ((12 - 9 * B - 6 * C) * x * x * x + (-18 + 12 * B + 6 * C) * x * x + (6 - 2 * B)) / 6.0;
+            }
+            if (x < 2.0) {
+                return ((-B - 6 * C) * x * x * x + (6 * B + 30 * C) * x * x + (-12 * B - 48 * C) * x
+                        + (8 * B + 24 * C)) / 6.0;
+            }
+            return 0.0;
+        }
+    }
+    return 0.0;
+}
+
+double Resampler::radius(Filter filter)
+{
+    switch (filter) {
+        case Filter::Box: return 0.5;
+        case Filter::Lanczos3: return 3.0;
+        case Filter::Mitchell: return 2.0;
+    }
+    return 1.0;
+}
+
+QString Resampler::filterName(Filter filter)
+{
+    switch (filter) {
+        case Filter::Box: return "box";
+        case Filter::Lanczos3: return "lanczos3";
+        case Filter::Mitchell: return "mitchell";
+    }
+    return QString();
+}
+
+QImage Resampler::scale(const QImage& image, const QSize& size, Filter filter)
+{
+    if (image.isNull() || size.isEmpty()) {
+        return QImage();
+    }
+    if (size == image.size()) {
+        return image;
+    }
+
+    const QImage::Format format = image.hasAlphaChannel() ? QImage::Format_ARGB32_Premultiplied : QImage::Format_RGB32;
+    const QImage source = image.convertToFormat(format);
+    const bool scaleX = size.width() != source.width();
+    const bool scaleY = size.height() != source.height();
+    const WeightsPtr horizontal = scaleX ? weightsFor(source.width(), size.width(), filter) : WeightsPtr();
+    const WeightsPtr vertical = scaleY ? weightsFor(source.height(), size.height(), filter) : WeightsPtr();
+    if (!scaleY) {
+        return horizontalPass(source, *horizontal);
+    }
+    if (!scaleX) {
+        return verticalPass(source, *vertical);
+    }
+
+    // 两趟的先后决定中间图的大小。竖直一趟一次处理 4 个像素，每个抽头的开销约为水平一趟的 1/4，
+    // 按此估算两种顺序的总开销，缩小时通常先做竖直一趟，让水平一趟处理的行数变少
+    const double horizontalTap = kHorizontalTapCost * horizontal->taps * size.width();
+    const double verticalTap = double(vertical->taps) * size.height();
+    const double horizontalFirst = horizontalTap * source.height() + verticalTap * size.width();
+    const double verticalFirst = verticalTap * source.width() + horizontalTap * size.height();
+    if (horizontalFirst <= verticalFirst) {
+        return verticalPass(horizontalPass(source, *horizontal), *vertical);
+    }
+    return horizontalPass(verticalPass(source, *vertical), *horizontal);
+}
+
+QImage Resampler::fit(const QImage& image, const QSize& bound, Filter filter)
+{
+    if (image.width() <= bound.width() && image.height() <= bound.height()) {
+        return image;
+    }
+    const QSize size = image.size().scaled(bound, Qt::KeepAspectRatio).expandedTo(QSize(1, 1));
+    return scale(image, size, filter);
+}
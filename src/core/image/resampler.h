@@ -0,0 +1,34 @@
+#ifndef RESAMPLER_H
+#define RESAMPLER_H
+
+#include <QImage>
+#include <QSize>
+#include <QString>
+
+// 高质量图片缩放：可分离滤波，水平、竖直各一趟（先后顺序按开销估算选择），每趟按行条带分给多个线程
+//
+// 每个输出坐标的滤波权重（14 位定点）按（源长度、目标长度、滤波器）预先计算并缓存，
+// 同一尺寸反复缩放（缩略图、贴图缩放）时不再重新计算。两趟都用 SSE2 的 pmaddwd 一次累加两个抽头：
+// 水平方向把相邻两个源像素的同一通道交错排列，竖直方向把相邻两行的同一字节交错排列
+class Resampler
+{
+public:
+    enum class Filter {
+        Box,        // 面积平均，适合大比例缩小（缩略图）
+        Lanczos3,   // 最锐利，缩小文字截图的默认选择
+        Mitchell    // 振铃较少，适合照片和放大
+    };
+
+    // 缩放到 size，输出为 RGB32（不透明时）或 ARGB32_Premultiplied；尺寸不变时原样返回。可在任意线程调用
+    static QImage scale(const QImage& image, const QSize& size, Filter filter = Filter::Lanczos3);
+    // 保持宽高比缩小到不超过 bound，本来就不超过时原样返回
+    static QImage fit(const QImage& image, const QSize& bound, Filter filter = Filter::Lanczos3);
+
+    // 滤波核与其半径（源像素为单位，缩小时按比例放宽），供基准测试中的浮点参考实现使用；
+    // Box 的权重按像素与采样区间的重叠长度计算，kernel 仅描述其形状
+    static double kernel(Filter filter, double x);
+    static double radius(Filter filter);
+    static QString filterName(Filter filter);
+};
+
+#endif // RESAMPLER_H
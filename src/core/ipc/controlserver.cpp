@@ -0,0 +1,257 @@
+#include "controlserver.h"
+#include "../capture/capturemanager.h"
+#include "../history/capturehistory.h"
+#include "../redaction/redactionrules.h"
+#include "../redaction/sensitivecontentscanner.h"
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QGuiApplication>
+#include <QScreen>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QThreadPool>
+#include <cstring>
+
+ControlServer::ControlServer(CaptureManager* manager, QObject *parent)
+    : QObject(parent)
+    , m_captureManager(manager)
+{
+    // 只允许当前用户连接
+    m_server.setSocketOptions(QLocalServer::UserAccessOption);
+    connect(&m_server, &QLocalServer::newConnection, this, &ControlServer::onNewConnection);
+
+    m_batchTimer.setSingleShot(true);
+    m_batchTimer.setTimerType(Qt::PreciseTimer);
+    connect(&m_batchTimer, &QTimer::timeout, this, &ControlServer::flushCaptures);
+}
+
+ControlServer::~ControlServer()
+{
+    m_server.close();
+}
+
+QString ControlServer::serverName()
+{
+    QString user = qEnvironmentVariable("USERNAME", qEnvironmentVariable("USER"));
+    return QString("SCD-control-%1").arg(user);
+}
+
+bool ControlServer::start()
+{
+    if (m_server.listen(serverName())) {
+        return true;
+    }
+    // 上次异常退出可能残留套接字文件
+    if (m_server.serverError() == QAbstractSocket::AddressInUseError) {
+        QLocalServer::removeServer(serverName());
+        if (m_server.listen(serverName())) {
+            return true;
+        }
+    }
+    qDebug() << "Control server failed to listen:" << m_server.errorString();
+    return false;
+}
+
+void ControlServer::onNewConnection()
+{
+    while (QLocalSocket* socket = m_server.nextPendingConnection()) {
+        connect(socket, &QLocalSocket::readyRead, this, [this, socket]() {
+            onReadyRead(socket);
+        });
+        connect(socket, &QLocalSocket::disconnected, this, [this, socket]() {
+            m_segments.remove(socket);
+            socket->deleteLater();
+        });
+    }
+}
+
+void ControlServer::onReadyRead(QLocalSocket* socket)
+{
+    while (socket->canReadLine()) {
+        QByteArray line = socket->readLine().trimmed();
+        if (line.isEmpty()) {
+            continue;
+        }
+        QJsonParseError error;
+        QJsonDocument document = QJsonDocument::fromJson(line, &error);
+        if (!document.isObject()) {
+            sendError(socket, QJsonValue(), QString("invalid request: %1").arg(error.errorString()));
+            continue;
+        }
+        handleRequest(socket, document.object());
+    }
+}
+
+void ControlServer::handleRequest(QLocalSocket* socket, const QJsonObject& request)
+{
+    const QJsonValue id = request.value("id");
+    const QString command = request.value("cmd").toString();
+
+    if (command == "capture") {
+        QRect region;
+        if (request.contains("rect")) {
+            QJsonArray rect = request.value("rect").toArray();
+            region = QRect(rect.at(0).toInt(), rect.at(1).toInt(), rect.at(2).toInt(), rect.at(3).toInt());
+        } else {
+            QList<QScreen*> screens = QGuiApplication::screens();
+            int index = request.value("screen").toInt(0);
+            if (index >= 0 && index < screens.size()) {
+                region = screens.at(index)->geometry();
+            }
+        }
+        if (region.isEmpty()) {
+            sendError(socket, id, "invalid region");
+            return;
+        }
+
+        // 收集窗口期内的请求，到期后统一抓取
+        m_pendingCaptures.append({socket, id, region});
+        if (!m_batchTimer.isActive()) {
+            m_batchTimer.start(kBatchWindowMs);
+        }
+        return;
+    }
+
+    CaptureHistory* history = m_captureManager->history();
+    if (command == "history.list") {
+        int limit = request.value("limit").toInt(50);
+        QJsonArray items;
+        for (const CaptureHistory::Entry& entry : history->entries()) {
+            if (items.size() >= limit) {
+                break;
+            }
+            items.append(QJsonObject{
+                {"entry", entry.id},
+                {"time", entry.timestamp.toString(Qt::ISODateWithMs)},
+                {"file", entry.filePath}
+            });
+        }
+        sendReply(socket, id, QJsonObject{{"items", items}});
+    } else if (command == "history.get" || command == "history.pin") {
+        QImage image = history->load(request.value("entry").toInt(-1));
+        if (image.isNull()) {
+            sendError(socket, id, "no such entry");
+            return;
+        }
+        if (command == "history.pin") {
+            emit pinRequested(image);
+            sendReply(socket, id, QJsonObject());
+            return;
+        }
+        QJsonObject published = publishImage(socket, image);
+        if (published.contains("error")) {
+            sendError(socket, id, published.value("error").toString());
+        } else {
+            sendReply(socket, id, QJsonObject{{"image", published}});
+        }
+    } else if (command == "activate" || command == "capture.interactive" || command == "pin.file") {
+        // 先应答，让转发进程尽快退出
+        sendReply(socket, id, QJsonObject());
+        emit launchRequested(request);
+    } else if (command == "release") {
+        m_segments[socket].remove(request.value("shm").toString());
+        sendReply(socket, id, QJsonObject());
+    } else {
+        sendError(socket, id, QString("unknown command: %1").arg(command));
+    }
+}
+
+void ControlServer::flushCaptures()
+{
+    QList<PendingCapture> pending;
+    pending.swap(m_pendingCaptures);
+
+    QVector<QRect> regions;
+    regions.reserve(pending.size());
+    for (const PendingCapture& request : pending) {
+        regions.append(request.region);
+    }
+
+    // 一次抓取覆盖所有请求区域
+    QVector<QPixmap> crops = m_captureManager->captureRegions(regions);
+    SensitiveContentScanner* scanner = m_captureManager->scanner();
+    const bool redact = RedactionRules::isEnabled() && scanner->isAvailable();
+    for (int i = 0; i < pending.size(); ++i) {
+        if (!pending[i].socket) {
+            continue;
+        }
+        if (crops.value(i).isNull()) {
+            sendError(pending[i].socket.data(), pending[i].id, "capture failed");
+            continue;
+        }
+        if (!redact) {
+            replyCapture(pending[i], crops[i].toImage());
+            continue;
+        }
+        // 自动化接口同样不能绕过打码：识别在工作线程中完成后再应答
+        QPointer<ControlServer> self(this);
+        const PendingCapture request = pending[i];
+        const QImage image = crops[i].toImage();
+        QThreadPool::globalInstance()->start([self, scanner, request, image]() {
+            const QImage redacted = scanner->redact(image);
+            QMetaObject::invokeMethod(qApp, [self, request, redacted]() {
+                if (self) {
+                    self->replyCapture(request, redacted);
+                }
+            }, Qt::QueuedConnection);
+        });
+    }
+}
+
+void ControlServer::replyCapture(const PendingCapture& request, const QImage& image)
+{
+    QLocalSocket* socket = request.socket.data();
+    if (!socket) {
+        return;
+    }
+    QJsonObject published = publishImage(socket, image);
+    if (published.contains("error")) {
+        sendError(socket, request.id, published.value("error").toString());
+    } else {
+        sendReply(socket, request.id, QJsonObject{{"image", published}});
+    }
+}
+
+QJsonObject ControlServer::publishImage(QLocalSocket* socket, const QImage& source)
+{
+    const QImage image = source.format() == QImage::Format_ARGB32_Premultiplied
+        ? source : source.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+
+    const QString key = QString("%1-%2-%3").arg(serverName())
+        .arg(QCoreApplication::applicationPid()).arg(++m_segmentCounter);
+    auto segment = std::make_shared<QSharedMemory>(key);
+    const qsizetype bytes = image.sizeInBytes();
+    if (!segment->create(int(bytes), QSharedMemory::ReadWrite)) {
+        qDebug() << "Failed to create shared memory:" << segment->errorString();
+        return QJsonObject{{"error", segment->errorString()}};
+    }
+
+    segment->lock();
+    std::memcpy(segment->data(), image.constBits(), size_t(bytes));
+    segment->unlock();
+    m_segments[socket].insert(key, segment);
+
+    return QJsonObject{
+        {"shm", key},
+        {"width", image.width()},
+        {"height", image.height()},
+        {"stride", int(image.bytesPerLine())},
+        {"format", "ARGB32_Premultiplied"},
+        {"size", double(bytes)}
+    };
+}
+
+void ControlServer::sendReply(QLocalSocket* socket, const QJsonValue& id, QJsonObject reply)
+{
+    reply.insert("id", id);
+    if (!reply.contains("ok")) {
+        reply.insert("ok", true);
+    }
+    socket->write(QJsonDocument(reply).toJson(QJsonDocument::Compact));
+    socket->write("\n");
+}
+
+void ControlServer::sendError(QLocalSocket* socket, const QJsonValue& id, const QString& message)
+{
+    sendReply(socket, id, QJsonObject{{"ok", false}, {"error", message}});
+}
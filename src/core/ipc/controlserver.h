@@ -0,0 +1,73 @@
+#ifndef CONTROLSERVER_H
+#define CONTROLSERVER_H
+
+#include <QObject>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QJsonObject>
+#include <QHash>
+#include <QList>
+#include <QTimer>
+#include <QSharedMemory>
+#include <QImage>
+#include <QPointer>
+#include <memory>
+
+class CaptureManager;
+
+// 本地控制接口：通过本地套接字接收按行分隔的 JSON 请求
+// 图片像素放入共享内存段返回，套接字上只传递元数据
+//
+// 请求示例：
+//   {"id":1,"cmd":"capture","rect":[0,0,800,600]}
+//   {"id":2,"cmd":"capture","screen":0}
+//   {"id":3,"cmd":"history.list","limit":20}
+//   {"id":4,"cmd":"history.get","entry":12}
+//   {"id":5,"cmd":"history.pin","entry":12}
+//   {"id":6,"cmd":"release","shm":"<key>"}
+//   {"cmd":"activate"} / {"cmd":"capture.interactive"} / {"cmd":"pin.file","path":"..."}
+//     后三者由第二次启动的进程转发（见 SingleInstance）
+class ControlServer : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ControlServer(CaptureManager* manager, QObject *parent = nullptr);
+    ~ControlServer();
+
+    bool start();
+    static QString serverName();
+
+signals:
+    void pinRequested(const QImage& image);
+    // 启动请求：activate / capture.interactive / pin.file
+    void launchRequested(const QJsonObject& request);
+
+private:
+    // 时间上重叠的截图请求合并为一次抓取
+    static constexpr int kBatchWindowMs = 5;
+
+    struct PendingCapture {
+        QPointer<QLocalSocket> socket;
+        QJsonValue id;
+        QRect region;
+    };
+
+    CaptureManager* m_captureManager;
+    QLocalServer m_server;
+    QList<PendingCapture> m_pendingCaptures;
+    QTimer m_batchTimer;
+    // 每个连接持有的共享内存段，客户端 release 或断开时释放
+    QHash<QLocalSocket*, QHash<QString, std::shared_ptr<QSharedMemory>>> m_segments;
+    quint64 m_segmentCounter{0};
+
+    void onNewConnection();
+    void onReadyRead(QLocalSocket* socket);
+    void handleRequest(QLocalSocket* socket, const QJsonObject& request);
+    void flushCaptures();
+    void replyCapture(const PendingCapture& request, const QImage& image);
+    QJsonObject publishImage(QLocalSocket* socket, const QImage& image);
+    void sendReply(QLocalSocket* socket, const QJsonValue& id, QJsonObject reply);
+    void sendError(QLocalSocket* socket, const QJsonValue& id, const QString& message);
+};
+
+#endif // CONTROLSERVER_H
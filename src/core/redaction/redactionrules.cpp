@@ -0,0 +1,139 @@
+#include "redactionrules.h"
+#include <QSettings>
+#include <QDebug>
+
+QVector<RedactionRules::Rule> RedactionRules::defaults()
+{
+    return {
+        {"card", R"((?<!\d)(?:\d[ -]?){12,18}\d(?!\d))", "luhn", true},
+        {"email", R"([A-Za-z0-9._%+-]+@[A-Za-z0-9.-]+\.[A-Za-z]{2,})", QString(), true}
+    };
+}
+
+QVector<RedactionRules::Rule> RedactionRules::load()
+{
+    QSettings settings("SCD", "SCD");
+    int count = settings.beginReadArray("redaction/rules");
+    QVector<Rule> rules;
+    for (int i = 0; i < count; ++i) {
+        settings.setArrayIndex(i);
+        rules.append({
+            settings.value("name").toString(),
+            settings.value("pattern").toString(),
+            settings.value("validator").toString(),
+            settings.value("enabled", true).toBool()
+        });
+    }
+    settings.endArray();
+
+    if (count == 0) {
+        rules = defaults();
+        save(rules);
+    }
+    return rules;
+}
+
+void RedactionRules::save(const QVector<Rule>& rules)
+{
+    QSettings settings("SCD", "SCD");
+    settings.beginWriteArray("redaction/rules", rules.size());
+    for (int i = 0; i < rules.size(); ++i) {
+        settings.setArrayIndex(i);
+        settings.setValue("name", rules[i].name);
+        settings.setValue("pattern", rules[i].pattern);
+        settings.setValue("validator", rules[i].validator);
+        settings.setValue("enabled", rules[i].enabled);
+    }
+    settings.endArray();
+}
+
+bool RedactionRules::isEnabled()
+{
+    QSettings settings("SCD", "SCD");
+    return settings.value("redaction/enabled", false).toBool();
+}
+
+void RedactionRules::setEnabled(bool enabled)
+{
+    QSettings settings("SCD", "SCD");
+    settings.setValue("redaction/enabled", enabled);
+}
+
+RedactionRules::RedactionRules(const QVector<Rule>& rules)
+{
+    for (const Rule& rule : rules) {
+        if (!rule.enabled) {
+            continue;
+        }
+        QRegularExpression expression(rule.pattern);
+        if (!expression.isValid()) {
+            qDebug() << "Invalid redaction rule" << rule.name << expression.errorString();
+            continue;
+        }
+        expression.optimize();
+        m_rules.append({expression, rule.validator == "luhn"});
+    }
+}
+
+QVector<QRect> RedactionRules::match(const QVector<TextRecognizer::Line>& lines) const
+{
+    QVector<QRect> boxes;
+    for (const TextRecognizer::Line& line : lines) {
+        // 拼接整行文字并记录每个单词在其中的位置
+        QString text;
+        QVector<int> starts;
+        for (const TextRecognizer::Word& word : line) {
+            if (!text.isEmpty()) {
+                text += QLatin1Char(' ');
+            }
+            starts.append(text.size());
+            text += word.text;
+        }
+
+        for (const Compiled& rule : m_rules) {
+            QRegularExpressionMatchIterator it = rule.expression.globalMatch(text);
+            while (it.hasNext()) {
+                QRegularExpressionMatch match = it.next();
+                if (rule.luhn && !luhnValid(match.captured())) {
+                    continue;
+                }
+                const int begin = match.capturedStart();
+                const int end = match.capturedEnd();
+                QRect box;
+                for (int i = 0; i < line.size(); ++i) {
+                    const int wordEnd = starts[i] + line[i].text.size();
+                    if (starts[i] < end && wordEnd > begin) {
+                        box = box.united(line[i].box);
+                    }
+                }
+                if (!box.isEmpty()) {
+                    boxes.append(box);
+                }
+            }
+        }
+    }
+    return boxes;
+}
+
+bool RedactionRules::luhnValid(const QString& text)
+{
+    int sum = 0;
+    int digits = 0;
+    bool doubleIt = false;
+    for (int i = text.size() - 1; i >= 0; --i) {
+        if (!text[i].isDigit()) {
+            continue;
+        }
+        int value = text[i].digitValue();
+        if (doubleIt) {
+            value *= 2;
+            if (value > 9) {
+                value -= 9;
+            }
+        }
+        sum += value;
+        doubleIt = !doubleIt;
+        ++digits;
+    }
+    return digits >= 13 && sum % 10 == 0;
+}
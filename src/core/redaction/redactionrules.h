@@ -0,0 +1,46 @@
+#ifndef REDACTIONRULES_H
+#define REDACTIONRULES_H
+
+#include <QRegularExpression>
+#include <QVector>
+#include <QString>
+#include <QRect>
+#include "textrecognizer.h"
+
+// 敏感信息匹配规则：正则表达式 + 可选的校验（如银行卡号的 Luhn 校验）
+// 规则保存在设置的 redaction/rules 数组中，首次使用时写入默认规则
+class RedactionRules
+{
+public:
+    struct Rule {
+        QString name;
+        QString pattern;
+        QString validator;      // 空或 "luhn"
+        bool enabled{true};
+    };
+
+    static QVector<Rule> load();
+    static void save(const QVector<Rule>& rules);
+    static QVector<Rule> defaults();
+
+    // 是否在截图导出前自动打码
+    static bool isEnabled();
+    static void setEnabled(bool enabled);
+
+    explicit RedactionRules(const QVector<Rule>& rules);
+
+    // 在识别出的文字行中查找匹配项，返回匹配单词的外接矩形
+    // 按行拼接单词后匹配，因此能识别被空格分成几段的卡号
+    QVector<QRect> match(const QVector<TextRecognizer::Line>& lines) const;
+
+    static bool luhnValid(const QString& text);
+
+private:
+    struct Compiled {
+        QRegularExpression expression;
+        bool luhn{false};
+    };
+    QVector<Compiled> m_rules;
+};
+
+#endif // REDACTIONRULES_H
@@ -0,0 +1,273 @@
+#include "sensitivecontentscanner.h"
+#include "redactionrules.h"
+#include "textrecognizer.h"
+#include "../capture/capturemanager.h"
+#include <QDeadlineTimer>
+#include <QPainter>
+#include <QMutexLocker>
+#include <QThread>
+#include <QSemaphore>
+#include <QDebug>
+
+SensitiveContentScanner::SensitiveContentScanner(QObject *parent)
+    : QObject(parent)
+{
+    // 识别引擎按线程初始化，代价较高，线程常驻不回收
+    m_pool.setMaxThreadCount(qBound(1, QThread::idealThreadCount(), 4));
+    m_pool.setExpiryTimeout(-1);
+    // 语言数据缺失等问题只有初始化时才能发现：提前在工作线程中初始化一次，失败时尽早告知用户
+    if (isAvailable()) {
+        m_pool.start([this]() {
+            if (!threadRecognizer()) {
+                reportUnavailable();
+            }
+        });
+    }
+}
+
+SensitiveContentScanner::~SensitiveContentScanner()
+{
+    m_pool.clear();
+    m_pool.waitForDone();
+}
+
+bool SensitiveContentScanner::isAvailable() const
+{
+    return TextRecognizer::isAvailable();
+}
+
+QVector<QRect> SensitiveContentScanner::bands(const QRect& rect, const QRect& bounds)
+{
+    QVector<QRect> result;
+    const int step = kBandHeight - kBandOverlap;
+    // 行按帧坐标对齐，选区上下移动时已有条带仍可复用；列只覆盖选区两侧各 kColumnMargin，
+    // 宽屏或多显示器上不必识别选区以外的整行
+    const int left = rect.left() - kColumnMargin;
+    const int width = rect.width() + 2 * kColumnMargin;
+    int top = (rect.top() / step) * step;
+    for (; top <= rect.bottom(); top += step) {
+        const QRect band = QRect(left, top, width, kBandHeight).intersected(bounds);
+        if (!band.isEmpty()) {
+            result.append(band);
+        }
+        if (top + kBandHeight > rect.bottom()) {
+            break;
+        }
+    }
+    return result;
+}
+
+bool SensitiveContentScanner::covers(const QRect& outer, const QRect& band)
+{
+    return outer.top() == band.top() && outer.bottom() == band.bottom()
+        && outer.left() <= band.left() && outer.right() >= band.right();
+}
+
+bool SensitiveContentScanner::cachedLocked(const QRect& band) const
+{
+    for (const auto& entry : m_cache) {
+        if (covers(entry.first, band)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+TextRecognizer* SensitiveContentScanner::threadRecognizer()
+{
+    // 每个工作线程各持有一个识别引擎
+    thread_local std::unique_ptr<TextRecognizer> recognizer = TextRecognizer::create();
+    return recognizer.get();
+}
+
+QVector<QRect> SensitiveContentScanner::scanImage(const QImage& image, const RedactionRules& rules)
+{
+    TextRecognizer* recognizer = threadRecognizer();
+    if (!recognizer) {
+        reportUnavailable();
+        return QVector<QRect>();
+    }
+    if (!TextRecognizer::likelyContainsText(image)) {
+        return QVector<QRect>();
+    }
+    return rules.match(recognizer->recognize(image));
+}
+
+void SensitiveContentScanner::reportUnavailable()
+{
+    if (!m_unavailableReported.exchange(true)) {
+        qDebug() << "Text recognizer unavailable, captures are not checked for sensitive content";
+        QMetaObject::invokeMethod(this, &SensitiveContentScanner::unavailable, Qt::QueuedConnection);
+    }
+}
+
+void SensitiveContentScanner::scan(const CaptureFramePtr& frame, const QRect& rect)
+{
+    if (!frame || rect.isEmpty() || !isAvailable()) {
+        return;
+    }
+
+    auto rules = std::make_shared<const RedactionRules>(RedactionRules::load());
+    QMutexLocker locker(&m_mutex);
+    if (m_cacheFrame != frame->id()) {
+        m_cacheFrame = frame->id();
+        m_cache.clear();
+    }
+
+    m_currentBands = bands(rect, frame->rect());
+    for (const QRect& band : m_currentBands) {
+        // 已被识别过或正在识别的条带覆盖时跳过；其他帧的条带仍在识别时不能等它，它的结果会被丢弃
+        if (cachedLocked(band)) {
+            continue;
+        }
+        bool running = false;
+        for (const auto& job : m_running) {
+            if (job.first == frame->id() && covers(job.second, band)) {
+                running = true;
+                break;
+            }
+        }
+        if (running) {
+            continue;
+        }
+
+        const QPair<quint64, QRect> job(frame->id(), band);
+        m_running.append(job);
+        m_pool.start([this, frame, band, job, rules]() {
+            QVector<QRect> found = scanImage(frame->crop(band), *rules);
+            for (QRect& box : found) {
+                box.translate(band.topLeft());
+            }
+
+            QMutexLocker locker(&m_mutex);
+            m_running.removeOne(job);
+            // 帧已更换时丢弃结果，新帧的同一条带由它自己的任务识别
+            if (m_cacheFrame != frame->id()) {
+                return;
+            }
+            m_cache.append(qMakePair(band, found));
+            m_bandDone.wakeAll();
+            bool current = false;
+            for (const QRect& needed : m_currentBands) {
+                current = current || covers(band, needed);
+            }
+            if (current) {
+                QMetaObject::invokeMethod(this, &SensitiveContentScanner::progressChanged, Qt::QueuedConnection);
+                if (currentFinishedLocked()) {
+                    QMetaObject::invokeMethod(this, &SensitiveContentScanner::finished, Qt::QueuedConnection);
+                }
+            }
+        });
+    }
+
+    if (currentFinishedLocked()) {
+        QMetaObject::invokeMethod(this, &SensitiveContentScanner::finished, Qt::QueuedConnection);
+    }
+}
+
+void SensitiveContentScanner::reset()
+{
+    QMutexLocker locker(&m_mutex);
+    // 仍在运行的任务发现帧编号不一致后自行丢弃结果
+    m_cacheFrame = 0;
+    m_cache.clear();
+    m_currentBands.clear();
+}
+
+bool SensitiveContentScanner::currentFinishedLocked() const
+{
+    for (const QRect& band : m_currentBands) {
+        if (!cachedLocked(band)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool SensitiveContentScanner::waitForFinished(int timeoutMs)
+{
+    QDeadlineTimer deadline(timeoutMs);
+    QMutexLocker locker(&m_mutex);
+    while (!currentFinishedLocked()) {
+        if (!m_bandDone.wait(&m_mutex, deadline)) {
+            return currentFinishedLocked();
+        }
+    }
+    return true;
+}
+
+QPair<int, int> SensitiveContentScanner::progress() const
+{
+    QMutexLocker locker(&m_mutex);
+    int done = 0;
+    for (const QRect& band : m_currentBands) {
+        if (cachedLocked(band)) {
+            ++done;
+        }
+    }
+    return qMakePair(done, int(m_currentBands.size()));
+}
+
+QVector<QRect> SensitiveContentScanner::matches(const QRect& rect) const
+{
+    QVector<QRect> result;
+    QMutexLocker locker(&m_mutex);
+    // 同一帧先前识别的条带也参与：选区缩小后它们的结果仍然有效
+    for (const auto& entry : m_cache) {
+        for (const QRect& box : entry.second) {
+            if (!box.intersects(rect)) {
+                continue;
+            }
+            // 重叠条带会重复识别同一行，合并重复的结果
+            bool duplicate = false;
+            for (QRect& existing : result) {
+                const QRect common = existing.intersected(box);
+                if (common.width() * common.height() * 2 > box.width() * box.height()) {
+                    existing = existing.united(box);
+                    duplicate = true;
+                    break;
+                }
+            }
+            if (!duplicate) {
+                result.append(box);
+            }
+        }
+    }
+    return result;
+}
+
+QImage SensitiveContentScanner::redact(const QImage& image)
+{
+    if (image.isNull() || !isAvailable()) {
+        return image;
+    }
+
+    // 独立图片不做缓存，条带并行识别后等待全部完成
+    const RedactionRules rules(RedactionRules::load());
+    const QVector<QRect> imageBands = bands(image.rect(), image.rect());
+    QVector<QVector<QRect>> results(imageBands.size());
+    // 只等待本次提交的条带，不受遮罩同时进行的扫描影响
+    QSemaphore done;
+    for (int i = 0; i < imageBands.size(); ++i) {
+        const QRect band = imageBands[i];
+        m_pool.start([this, &image, &rules, &results, &done, band, i]() {
+            QVector<QRect> found = scanImage(image.copy(band), rules);
+            for (QRect& box : found) {
+                box.translate(band.topLeft());
+            }
+            results[i] = found;
+            done.release();
+        });
+    }
+    done.acquire(int(imageBands.size()));
+
+    QImage redacted = image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    QPainter painter(&redacted);
+    for (const QVector<QRect>& found : results) {
+        for (const QRect& box : found) {
+            painter.drawImage(box, CaptureManager::pixelate(redacted.copy(box)));
+        }
+    }
+    painter.end();
+    return redacted;
+}
@@ -0,0 +1,85 @@
+#ifndef SENSITIVECONTENTSCANNER_H
+#define SENSITIVECONTENTSCANNER_H
+
+#include <QObject>
+#include <QThreadPool>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QPair>
+#include <QVector>
+#include <QRect>
+#include <memory>
+#include <atomic>
+#include "../capture/captureframe.h"
+
+class RedactionRules;
+class TextRecognizer;
+
+// 敏感信息扫描：把选区所在的行切成有重叠的水平条带，左右只比选区多出 kColumnMargin，
+// 在后台线程池中并行做文字检测和识别，再用 RedactionRules 匹配。条带结果按帧缓存，
+// 选区在已识别的范围内调整时不重新识别，扩展时只处理没有被已有条带覆盖的部分
+class SensitiveContentScanner : public QObject
+{
+    Q_OBJECT
+public:
+    // 条带高度与相邻条带的重叠：重叠需大于一行文字的高度，保证每行至少完整出现在一个条带中
+    static constexpr int kBandHeight = 160;
+    static constexpr int kBandOverlap = 48;
+    // 条带在选区左右各多识别的宽度：跨过选区边界的卡号、邮箱等需要完整识别才能匹配，
+    // 选区小幅左右调整时也能复用已有条带
+    static constexpr int kColumnMargin = 256;
+
+    explicit SensitiveContentScanner(QObject *parent = nullptr);
+    ~SensitiveContentScanner();
+
+    // 识别引擎在后台线程中预先初始化；初始化失败后不再可用，并发出 unavailable
+    bool isAvailable() const;
+
+    // 异步扫描 rect（帧坐标），全部条带完成后发出 finished
+    void scan(const CaptureFramePtr& frame, const QRect& rect);
+    // 等待最近一次 scan 完成，超时返回 false；timeoutMs 为 0 时只检查是否已完成
+    bool waitForFinished(int timeoutMs);
+    // 最近一次 scan 已完成的条带数和总条带数
+    QPair<int, int> progress() const;
+    // 已完成条带中与 rect 相交的匹配区域（帧坐标），不按 rect 裁剪
+    QVector<QRect> matches(const QRect& rect) const;
+
+    // 丢弃缓存的结果，截图管理器更换或释放当前帧时调用
+    void reset();
+
+    // 同步处理一张独立的图片：识别后直接把匹配区域打上马赛克。会阻塞到识别完成，
+    // 不要在界面线程或本扫描器的线程池中调用
+    QImage redact(const QImage& image);
+
+signals:
+    void finished();
+    // 识别引擎初始化失败，只发出一次。之后的扫描没有结果，调用方需要告知用户截图未经检查
+    void unavailable();
+    // 最近一次 scan 的某个条带完成
+    void progressChanged();
+
+private:
+    QThreadPool m_pool;
+    mutable QMutex m_mutex;
+    QWaitCondition m_bandDone;
+    quint64 m_cacheFrame{0};                          // 缓存对应的帧编号
+    QVector<QPair<QRect, QVector<QRect>>> m_cache;    // 已识别的条带 -> 匹配区域（帧坐标）
+    QVector<QPair<quint64, QRect>> m_running;         // 正在识别的（帧编号，条带）
+    QVector<QRect> m_currentBands;                    // 最近一次 scan 需要的条带
+
+    // 覆盖 rect 的条带，左右各扩展 kColumnMargin，并限制在 bounds 内
+    static QVector<QRect> bands(const QRect& rect, const QRect& bounds);
+    // 行区间相同且左右范围不小于 band 的条带识别结果可以代替 band
+    static bool covers(const QRect& outer, const QRect& band);
+    bool cachedLocked(const QRect& band) const;
+    std::atomic<bool> m_unavailableReported{false};
+
+    // 当前工作线程的识别引擎，初始化失败时为空指针
+    static TextRecognizer* threadRecognizer();
+    // 在工作线程中识别一张图片并返回匹配区域（图片坐标）
+    QVector<QRect> scanImage(const QImage& image, const RedactionRules& rules);
+    void reportUnavailable();
+    bool currentFinishedLocked() const;
+};
+
+#endif // SENSITIVECONTENTSCANNER_H
@@ -0,0 +1,126 @@
+#include "textrecognizer.h"
+#include <QCoreApplication>
+#include <QDir>
+#include <QSettings>
+#include <QDebug>
+#include <atomic>
+#ifdef SCD_WITH_TESSERACT
+#include <tesseract/baseapi.h>
+#include <tesseract/resultiterator.h>
+#endif
+
+namespace {
+
+// 引擎初始化失败一次后不再报告可用，所有线程使用同一份语言数据，失败原因相同
+std::atomic<bool> s_initFailed{false};
+
+#ifdef SCD_WITH_TESSERACT
+
+// 屏幕文字只有 12~16 像素高，放大后识别率明显提高
+constexpr int kUpscale = 2;
+
+class TesseractRecognizer : public TextRecognizer
+{
+public:
+    bool init()
+    {
+        // 语言数据优先从程序目录下的 tessdata 读取，其次使用 TESSDATA_PREFIX
+        QSettings settings("SCD", "SCD");
+        const QString language = settings.value("redaction/language", "eng").toString();
+        QString dataPath = QDir(QCoreApplication::applicationDirPath()).filePath("tessdata");
+        if (!QDir(dataPath).exists()) {
+            dataPath = qEnvironmentVariable("TESSDATA_PREFIX");
+        }
+        const QByteArray path = dataPath.toLocal8Bit();
+        if (m_api.Init(path.isEmpty() ? nullptr : path.constData(),
+                       language.toLatin1().constData(), tesseract::OEM_LSTM_ONLY) != 0) {
+            qDebug() << "Tesseract init failed, data path:" << dataPath;
+            return false;
+        }
+        m_api.SetPageSegMode(tesseract::PSM_SPARSE_TEXT);
+        return true;
+    }
+
+    QVector<Line> recognize(const QImage& image) override
+    {
+        QVector<Line> lines;
+        QImage gray = image.convertToFormat(QImage::Format_Grayscale8)
+            .scaled(image.size() * kUpscale, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+        m_api.SetImage(gray.constBits(), gray.width(), gray.height(), 1, gray.bytesPerLine());
+        m_api.SetSourceResolution(96 * kUpscale);
+        if (m_api.Recognize(nullptr) != 0) {
+            return lines;
+        }
+
+        std::unique_ptr<tesseract::ResultIterator> it(m_api.GetIterator());
+        if (!it) {
+            return lines;
+        }
+        Line current;
+        do {
+            if (it->IsAtBeginningOf(tesseract::RIL_TEXTLINE) && !current.isEmpty()) {
+                lines.append(current);
+                current.clear();
+            }
+            std::unique_ptr<char[]> text(it->GetUTF8Text(tesseract::RIL_WORD));
+            int x1, y1, x2, y2;
+            if (text && it->BoundingBox(tesseract::RIL_WORD, &x1, &y1, &x2, &y2)) {
+                QRect box(QPoint(x1 / kUpscale, y1 / kUpscale), QPoint(x2 / kUpscale, y2 / kUpscale));
+                current.append({box, QString::fromUtf8(text.get())});
+            }
+        } while (it->Next(tesseract::RIL_WORD));
+        if (!current.isEmpty()) {
+            lines.append(current);
+        }
+        m_api.Clear();
+        return lines;
+    }
+
+private:
+    tesseract::TessBaseAPI m_api;
+};
+
+#endif // SCD_WITH_TESSERACT
+
+} // namespace
+
+std::unique_ptr<TextRecognizer> TextRecognizer::create()
+{
+#ifdef SCD_WITH_TESSERACT
+    auto recognizer = std::make_unique<TesseractRecognizer>();
+    if (recognizer->init()) {
+        return recognizer;
+    }
+    s_initFailed = true;
+#endif
+    return nullptr;
+}
+
+bool TextRecognizer::isAvailable()
+{
+#ifdef SCD_WITH_TESSERACT
+    return !s_initFailed;
+#else
+    return false;
+#endif
+}
+
+bool TextRecognizer::likelyContainsText(const QImage& image)
+{
+    const QImage gray = image.convertToFormat(QImage::Format_Grayscale8);
+    // 只要有一行的强边缘占比超过阈值，就认为可能有文字
+    const int threshold = qMax(4, gray.width() / 100);
+    for (int y = 0; y < gray.height(); ++y) {
+        const uchar* line = gray.constScanLine(y);
+        int edges = 0;
+        for (int x = 1; x < gray.width(); ++x) {
+            if (qAbs(int(line[x]) - int(line[x - 1])) > 48) {
+                ++edges;
+            }
+        }
+        if (edges >= threshold) {
+            return true;
+        }
+    }
+    return false;
+}
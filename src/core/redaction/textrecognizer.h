@@ -0,0 +1,33 @@
+#ifndef TEXTRECOGNIZER_H
+#define TEXTRECOGNIZER_H
+
+#include <QImage>
+#include <QRect>
+#include <QString>
+#include <QVector>
+#include <memory>
+
+// 离线文字识别接口。实例不是线程安全的，每个工作线程各持有一个
+class TextRecognizer
+{
+public:
+    struct Word {
+        QRect box;          // 相对于输入图片
+        QString text;
+    };
+    // 一行文字，按阅读顺序排列的单词
+    using Line = QVector<Word>;
+
+    virtual ~TextRecognizer() = default;
+    virtual QVector<Line> recognize(const QImage& image) = 0;
+
+    // 编译时未启用任何识别引擎（SCD_WITH_TESSERACT）或初始化失败时返回空指针
+    static std::unique_ptr<TextRecognizer> create();
+    // 编译时启用了识别引擎，且 create() 没有失败过。语言数据缺失等问题要到第一次初始化时才能发现
+    static bool isAvailable();
+
+    // 廉价的文字检测：统计水平方向的强边缘，没有文字特征的区域无需识别
+    static bool likelyContainsText(const QImage& image);
+};
+
+#endif // TEXTRECOGNIZER_H
@@ -0,0 +1,181 @@
+#include "captureindexer.h"
+#include "../history/capturehistory.h"
+#include "../redaction/textrecognizer.h"
+#include "../export/imageexporter.h"
+#include <QDir>
+#include <QStandardPaths>
+#include <QThread>
+#include <QPointer>
+#include <QElapsedTimer>
+#include <QDebug>
+#include <algorithm>
+
+CaptureIndexer::CaptureIndexer(CaptureHistory* history, QObject *parent)
+    : QObject(parent)
+    , m_history(history)
+    , m_index(QDir(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation)).filePath("search/index.bin"))
+{
+    m_pool.setMaxThreadCount(1);
+    m_pool.setExpiryTimeout(-1);    // 识别引擎按线程初始化，线程常驻
+    m_idleTimer.setSingleShot(true);
+    connect(&m_idleTimer, &QTimer::timeout, this, &CaptureIndexer::dispatch);
+
+    if (!isAvailable()) {
+        return;
+    }
+
+    connect(history, &CaptureHistory::entryRemoved, this, [this](int id) {
+        m_queue.erase(std::remove_if(m_queue.begin(), m_queue.end(), [id](const Pending& pending) {
+            return pending.id == id;
+        }), m_queue.end());
+        if (m_loaded) {
+            m_index.remove(id);
+        } else {
+            m_removedBeforeLoad.append(id);
+        }
+    });
+
+    // 几万张截图的索引解析需要几百毫秒，放在索引线程中，不占用启动时间；
+    // 索引线程只有一个，之后的识别任务一定在加载完成后执行
+    QPointer<CaptureIndexer> self(this);
+    SearchIndex* index = &m_index;
+    m_pool.start([self, index]() {
+        QElapsedTimer timer;
+        timer.start();
+        index->load();
+        qDebug() << "Search index loaded:" << index->documentCount() << "captures in" << timer.elapsed() << "ms";
+        if (self) {
+            QMetaObject::invokeMethod(self.data(), [self]() {
+                if (self) {
+                    self->onLoaded();
+                }
+            }, Qt::QueuedConnection);
+        }
+    });
+}
+
+void CaptureIndexer::onLoaded()
+{
+    m_loaded = true;
+    for (int id : m_removedBeforeLoad) {
+        m_index.remove(id);
+    }
+    m_removedBeforeLoad.clear();
+
+    // 补建尚未索引的历史截图，从新到旧，排在加载期间加入的新截图之后
+    for (const CaptureHistory::Entry& entry : m_history->entries()) {
+        const bool queued = std::any_of(m_queue.cbegin(), m_queue.cend(), [&entry](const Pending& pending) {
+            return pending.id == entry.id;
+        });
+        if (!queued && !m_index.contains(entry.id)) {
+            m_queue.append({entry.id, QImage()});
+        }
+    }
+    emit loaded();
+    scheduleNext();
+}
+
+CaptureIndexer::~CaptureIndexer()
+{
+    m_idleTimer.stop();
+    m_pool.clear();
+    m_pool.waitForDone();
+    if (m_unsaved > 0) {
+        m_index.save();
+    }
+}
+
+bool CaptureIndexer::isAvailable() const
+{
+    return TextRecognizer::isAvailable();
+}
+
+void CaptureIndexer::enqueue(int id, const QImage& image)
+{
+    if (!isAvailable() || id < 0) {
+        return;
+    }
+    // 新截图优先；内存中只保留有限张图片
+    int queuedImages = 0;
+    for (const Pending& pending : m_queue) {
+        queuedImages += pending.image.isNull() ? 0 : 1;
+    }
+    m_queue.prepend({id, queuedImages < kMaxQueuedImages ? image : QImage()});
+    scheduleNext();
+}
+
+void CaptureIndexer::setPaused(bool paused)
+{
+    m_paused = paused;
+    if (paused) {
+        m_idleTimer.stop();
+    } else {
+        scheduleNext();
+    }
+}
+
+void CaptureIndexer::scheduleNext()
+{
+    if (m_loaded && !m_paused && !m_running && !m_queue.isEmpty() && !m_idleTimer.isActive()) {
+        m_idleTimer.start(kIdleDelayMs);
+    }
+}
+
+void CaptureIndexer::dispatch()
+{
+    if (m_paused || m_running || m_queue.isEmpty()) {
+        return;
+    }
+    Pending pending = m_queue.takeFirst();
+    const QString filePath = pending.image.isNull() ? m_history->entry(pending.id).filePath : QString();
+    if (pending.image.isNull() && filePath.isEmpty()) {
+        scheduleNext();
+        return;
+    }
+
+    m_running = true;
+    SearchIndex* index = &m_index;
+    QPointer<CaptureIndexer> self(this);
+    m_pool.start([self, index, pending, filePath]() {
+        QThread::currentThread()->setPriority(QThread::LowestPriority);
+        thread_local std::unique_ptr<TextRecognizer> recognizer = TextRecognizer::create();
+
+        const QImage image = pending.image.isNull() ? ImageExporter::load(filePath) : pending.image;
+        QVector<SearchIndex::Word> words;
+        if (recognizer && !image.isNull() && TextRecognizer::likelyContainsText(image)) {
+            for (const TextRecognizer::Line& line : recognizer->recognize(image)) {
+                for (const TextRecognizer::Word& word : line) {
+                    words.append({word.text, word.box});
+                }
+            }
+        }
+        if (!image.isNull()) {
+            index->add(pending.id, image.size(), words);
+        }
+
+        const int id = pending.id;
+        if (self) {
+            QMetaObject::invokeMethod(self.data(), [self, id]() {
+                if (self) {
+                    self->finished(id);
+                }
+            }, Qt::QueuedConnection);
+        }
+    });
+}
+
+void CaptureIndexer::finished(int id)
+{
+    m_running = false;
+    emit indexed(id);
+
+    // 攒够一批或队列清空时保存；保存也在后台线程执行
+    if (++m_unsaved >= kSaveEvery || m_queue.isEmpty()) {
+        m_unsaved = 0;
+        SearchIndex* index = &m_index;
+        m_pool.start([index]() {
+            index->save();
+        });
+    }
+    scheduleNext();
+}
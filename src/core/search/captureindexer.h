@@ -0,0 +1,66 @@
+#ifndef CAPTUREINDEXER_H
+#define CAPTUREINDEXER_H
+
+#include <QObject>
+#include <QImage>
+#include <QList>
+#include <QVector>
+#include <QTimer>
+#include <QThreadPool>
+#include "searchindex.h"
+
+class CaptureHistory;
+
+// 为截图历史建立全文索引：在低优先级的单个后台线程中逐张识别文字并写入 SearchIndex
+// 每张之间留出空闲间隔，截图界面显示期间暂停，不与正在进行的截图争抢 CPU
+class CaptureIndexer : public QObject
+{
+    Q_OBJECT
+public:
+    explicit CaptureIndexer(CaptureHistory* history, QObject *parent = nullptr);
+    ~CaptureIndexer();
+
+    // 没有可用的识别引擎时不建立索引
+    bool isAvailable() const;
+
+    // image 为空时在后台线程从历史文件读取
+    void enqueue(int id, const QImage& image = QImage());
+    void setPaused(bool paused);
+    int pendingCount() const { return m_queue.size(); }
+
+    const SearchIndex& index() const { return m_index; }
+    // 索引文件在后台加载，完成前查询结果为空
+    bool isLoaded() const { return m_loaded; }
+
+signals:
+    void indexed(int id);
+    void loaded();
+
+private:
+    static constexpr int kIdleDelayMs = 500;      // 两张截图之间的空闲间隔
+    static constexpr int kMaxQueuedImages = 16;   // 超出后只排队 id，处理时再读文件
+    static constexpr int kSaveEvery = 20;         // 每索引这么多张保存一次
+
+    struct Pending {
+        int id;
+        QImage image;
+    };
+
+    CaptureHistory* m_history;
+    SearchIndex m_index;
+    QThreadPool m_pool;
+    QTimer m_idleTimer;
+    QList<Pending> m_queue;
+    bool m_running{false};
+    bool m_loaded{false};
+    QVector<int> m_removedBeforeLoad;   // 加载完成前被淘汰的截图，加载后再从索引中删除
+    bool m_paused{false};
+    int m_unsaved{0};
+
+    void onLoaded();
+    void dispatch();
+    void finished(int id);
+    void scheduleNext();
+};
+
+#endif // CAPTUREINDEXER_H
@@ -0,0 +1,368 @@
+#include "searchindex.h"
+#include <QFile>
+#include <QSaveFile>
+#include <QDataStream>
+#include <QFileInfo>
+#include <QDir>
+#include <QSet>
+#include <algorithm>
+
+namespace {
+
+constexpr quint32 kMagic = 0x49444353;   // "SCDI"
+constexpr quint32 kVersion = 1;
+
+// 坐标可能为负（多屏），按 zigzag 映射为无符号数再编码
+quint32 zigzag(int value)
+{
+    return (quint32(value) << 1) ^ quint32(value >> 31);
+}
+
+int unzigzag(quint32 value)
+{
+    return int(value >> 1) ^ -int(value & 1);
+}
+
+QVector<int> intersectSorted(const QVector<int>& a, const QVector<int>& b)
+{
+    QVector<int> result;
+    std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(result));
+    return result;
+}
+
+} // namespace
+
+SearchIndex::SearchIndex(const QString& path)
+    : m_path(path)
+{
+}
+
+void SearchIndex::appendVarint(QByteArray& out, quint32 value)
+{
+    while (value >= 0x80) {
+        out.append(char((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.append(char(value));
+}
+
+quint32 SearchIndex::readVarint(const QByteArray& data, int& offset)
+{
+    quint32 value = 0;
+    for (int shift = 0; offset < data.size() && shift < 35; shift += 7) {
+        const quint8 byte = quint8(data.at(offset++));
+        value |= quint32(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            break;
+        }
+    }
+    return value;
+}
+
+QVector<int> SearchIndex::decodeDeltas(const QByteArray& data)
+{
+    QVector<int> values;
+    int offset = 0;
+    int current = 0;
+    while (offset < data.size()) {
+        current += int(readVarint(data, offset));
+        values.append(current);
+    }
+    return values;
+}
+
+QByteArray SearchIndex::encodeDeltas(const QVector<int>& values)
+{
+    QByteArray data;
+    int previous = 0;
+    for (int value : values) {
+        appendVarint(data, quint32(value - previous));
+        previous = value;
+    }
+    return data;
+}
+
+QString SearchIndex::normalize(const QString& word)
+{
+    QString text = word.toCaseFolded();
+    int begin = 0;
+    int end = text.size();
+    while (begin < end && (text.at(begin).isPunct() || text.at(begin).isSpace())) {
+        ++begin;
+    }
+    while (end > begin && (text.at(end - 1).isPunct() || text.at(end - 1).isSpace())) {
+        --end;
+    }
+    return text.mid(begin, end - begin);
+}
+
+QVector<quint64> SearchIndex::trigrams(const QString& term)
+{
+    QVector<quint64> result;
+    for (int i = 0; i + 3 <= term.size(); ++i) {
+        result.append((quint64(term.at(i).unicode()) << 32) | (quint64(term.at(i + 1).unicode()) << 16)
+                      | term.at(i + 2).unicode());
+    }
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    return result;
+}
+
+int SearchIndex::termId(const QString& term)
+{
+    auto found = m_termIds.constFind(term);
+    if (found != m_termIds.constEnd()) {
+        return found.value();
+    }
+    const int id = m_terms.size();
+    m_terms.append(term);
+    m_postings.append(QByteArray());
+    m_lastIds.append(0);
+    m_termIds.insert(term, id);
+    indexTrigrams(id);
+    return id;
+}
+
+void SearchIndex::indexTrigrams(int term)
+{
+    // 词编号递增分配，直接追加差值
+    for (quint64 trigram : trigrams(m_terms.at(term))) {
+        int& last = m_trigramLast[trigram];
+        appendVarint(m_trigrams[trigram], quint32(term - last));
+        last = term;
+    }
+}
+
+void SearchIndex::addPosting(int term, int id)
+{
+    if (id > m_lastIds[term]) {
+        // 常见情况：新截图的 id 最大，直接追加
+        appendVarint(m_postings[term], quint32(id - m_lastIds[term]));
+        m_lastIds[term] = id;
+        return;
+    }
+    // 补建旧截图的索引时 id 可能更小，解码后插入
+    QVector<int> ids = decodeDeltas(m_postings[term]);
+    auto position = std::lower_bound(ids.begin(), ids.end(), id);
+    if (position != ids.end() && *position == id) {
+        return;
+    }
+    ids.insert(position, id);
+    m_postings[term] = encodeDeltas(ids);
+}
+
+void SearchIndex::add(int id, const QSize& size, const QVector<Word>& words)
+{
+    QWriteLocker locker(&m_lock);
+    Document document;
+    document.size = size;
+    QSet<int> terms;
+    for (const Word& word : words) {
+        const QString text = normalize(word.text);
+        if (text.isEmpty()) {
+            continue;
+        }
+        const int term = termId(text);
+        appendVarint(document.hits, quint32(term));
+        appendVarint(document.hits, zigzag(word.box.x()));
+        appendVarint(document.hits, zigzag(word.box.y()));
+        appendVarint(document.hits, quint32(word.box.width()));
+        appendVarint(document.hits, quint32(word.box.height()));
+        terms.insert(term);
+    }
+    for (int term : terms) {
+        addPosting(term, id);
+    }
+    // 没有文字的截图也记录下来，避免重复识别
+    m_documents.insert(id, document);
+}
+
+void SearchIndex::remove(int id)
+{
+    // 倒排表中的旧 id 在查询时过滤，保存时清除
+    QWriteLocker locker(&m_lock);
+    m_documents.remove(id);
+}
+
+bool SearchIndex::contains(int id) const
+{
+    QReadLocker locker(&m_lock);
+    return m_documents.contains(id);
+}
+
+int SearchIndex::documentCount() const
+{
+    QReadLocker locker(&m_lock);
+    return m_documents.size();
+}
+
+QVector<int> SearchIndex::matchingTerms(const QString& token) const
+{
+    QVector<int> result;
+    if (token.size() < 3) {
+        // 太短，没有三字组：扫描词典匹配词首
+        for (int term = 0; term < m_terms.size(); ++term) {
+            if (m_terms.at(term).startsWith(token)) {
+                result.append(term);
+            }
+        }
+        return result;
+    }
+
+    // 所有三字组的词表求交集，再核对子串
+    bool first = true;
+    for (quint64 trigram : trigrams(token)) {
+        auto list = m_trigrams.constFind(trigram);
+        if (list == m_trigrams.constEnd()) {
+            return QVector<int>();
+        }
+        const QVector<int> terms = decodeDeltas(list.value());
+        result = first ? terms : intersectSorted(result, terms);
+        first = false;
+        if (result.isEmpty()) {
+            return result;
+        }
+    }
+    QVector<int> verified;
+    for (int term : result) {
+        if (m_terms.at(term).contains(token)) {
+            verified.append(term);
+        }
+    }
+    return verified;
+}
+
+QVector<SearchIndex::Result> SearchIndex::search(const QString& query, int limit) const
+{
+    QReadLocker locker(&m_lock);
+
+    QSet<int> matchedTerms;
+    QVector<int> documents;
+    bool first = true;
+    for (const QString& part : query.split(QChar(' '), Qt::SkipEmptyParts)) {
+        const QString token = normalize(part);
+        if (token.isEmpty()) {
+            continue;
+        }
+        // 一个查询词可能命中多个词，合并它们的倒排表
+        QVector<int> ids;
+        for (int term : matchingTerms(token)) {
+            matchedTerms.insert(term);
+            QVector<int> postings = decodeDeltas(m_postings.at(term));
+            QVector<int> merged;
+            std::set_union(ids.begin(), ids.end(), postings.begin(), postings.end(), std::back_inserter(merged));
+            ids.swap(merged);
+        }
+        documents = first ? ids : intersectSorted(documents, ids);
+        first = false;
+        if (documents.isEmpty()) {
+            return QVector<Result>();
+        }
+    }
+
+    QVector<Result> results;
+    for (auto it = documents.crbegin(); it != documents.crend() && results.size() < limit; ++it) {
+        auto document = m_documents.constFind(*it);
+        if (document == m_documents.constEnd()) {
+            continue;   // 已删除
+        }
+        Result result;
+        result.id = *it;
+        result.size = document->size;
+        int offset = 0;
+        while (offset < document->hits.size()) {
+            const int term = int(readVarint(document->hits, offset));
+            const int x = unzigzag(readVarint(document->hits, offset));
+            const int y = unzigzag(readVarint(document->hits, offset));
+            const int width = int(readVarint(document->hits, offset));
+            const int height = int(readVarint(document->hits, offset));
+            if (matchedTerms.contains(term)) {
+                result.boxes.append(QRect(x, y, width, height));
+            }
+        }
+        results.append(result);
+    }
+    return results;
+}
+
+bool SearchIndex::load()
+{
+    QFile file(m_path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_15);
+    quint32 magic = 0;
+    quint32 version = 0;
+    stream >> magic >> version;
+    if (magic != kMagic || version != kVersion) {
+        return false;
+    }
+
+    // 先解析到一个独立的索引中，不持锁；解析完成后一次交换，期间的查询和删除不会被阻塞
+    SearchIndex loaded(m_path);
+    qint32 termCount = 0;
+    stream >> termCount;
+    for (int i = 0; i < termCount && stream.status() == QDataStream::Ok; ++i) {
+        QString term;
+        QByteArray postings;
+        stream >> term >> postings;
+        const int id = loaded.m_terms.size();
+        loaded.m_terms.append(term);
+        loaded.m_postings.append(postings);
+        const QVector<int> ids = decodeDeltas(postings);
+        loaded.m_lastIds.append(ids.isEmpty() ? 0 : ids.last());
+        loaded.m_termIds.insert(term, id);
+        loaded.indexTrigrams(id);
+    }
+    qint32 documentCount = 0;
+    stream >> documentCount;
+    for (int i = 0; i < documentCount && stream.status() == QDataStream::Ok; ++i) {
+        qint32 id = 0;
+        Document document;
+        stream >> id >> document.size >> document.hits;
+        loaded.m_documents.insert(id, document);
+    }
+    if (stream.status() != QDataStream::Ok) {
+        return false;
+    }
+
+    QWriteLocker locker(&m_lock);
+    m_termIds.swap(loaded.m_termIds);
+    m_terms.swap(loaded.m_terms);
+    m_postings.swap(loaded.m_postings);
+    m_lastIds.swap(loaded.m_lastIds);
+    m_trigrams.swap(loaded.m_trigrams);
+    m_trigramLast.swap(loaded.m_trigramLast);
+    m_documents.swap(loaded.m_documents);
+    return true;
+}
+
+bool SearchIndex::save() const
+{
+    QReadLocker locker(&m_lock);
+    QDir().mkpath(QFileInfo(m_path).absolutePath());
+    QSaveFile file(m_path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_15);
+    stream << kMagic << kVersion;
+
+    // 清除已删除截图的倒排项，不再被任何截图使用的词仍保留编号，保证文档中的词编号有效
+    stream << qint32(m_terms.size());
+    for (int term = 0; term < m_terms.size(); ++term) {
+        QVector<int> ids = decodeDeltas(m_postings.at(term));
+        ids.erase(std::remove_if(ids.begin(), ids.end(), [this](int id) {
+            return !m_documents.contains(id);
+        }), ids.end());
+        stream << m_terms.at(term) << encodeDeltas(ids);
+    }
+    stream << qint32(m_documents.size());
+    for (auto it = m_documents.constBegin(); it != m_documents.constEnd(); ++it) {
+        stream << qint32(it.key()) << it->size << it->hits;
+    }
+    return file.commit();
+}
@@ -0,0 +1,80 @@
+#ifndef SEARCHINDEX_H
+#define SEARCHINDEX_H
+
+#include <QHash>
+#include <QVector>
+#include <QByteArray>
+#include <QString>
+#include <QRect>
+#include <QSize>
+#include <QReadWriteLock>
+
+// 截图历史的全文索引
+//
+// 词典中每个词对应一条倒排表：截图 id 升序排列，按差值做变长整数编码，内存和磁盘上都保持压缩形式。
+// 每个词的三字组再建一层倒排（三字组 -> 词编号），用于匹配词的一部分。
+// 每张截图保存识别出的词与位置，用于在结果缩略图上标出命中的位置。
+// 读写分别加读写锁：索引线程写入，界面线程查询
+class SearchIndex
+{
+public:
+    struct Word {
+        QString text;
+        QRect box;          // 相对于截图
+    };
+
+    struct Result {
+        int id{-1};
+        QSize size;             // 截图尺寸
+        QVector<QRect> boxes;   // 命中词的位置
+    };
+
+    explicit SearchIndex(const QString& path);
+
+    // 可在任意线程调用；解析期间不持锁，完成后整体替换当前内容
+    bool load();
+    // 保存时丢弃已删除截图的倒排项；可在任意线程调用
+    bool save() const;
+
+    void add(int id, const QSize& size, const QVector<Word>& words);
+    void remove(int id);
+    bool contains(int id) const;
+    int documentCount() const;
+
+    // 空格分隔的多个词同时命中才返回；不少于 3 个字符的词可以匹配词的任意部分，
+    // 更短的词匹配词首。结果按 id 从新到旧排列
+    QVector<Result> search(const QString& query, int limit) const;
+
+    // 折叠大小写并去掉首尾标点
+    static QString normalize(const QString& word);
+
+private:
+    // 一张截图的词与位置：[词编号, x, y, w, h] 依次变长编码
+    struct Document {
+        QSize size;
+        QByteArray hits;
+    };
+
+    mutable QReadWriteLock m_lock;
+    QString m_path;
+    QHash<QString, int> m_termIds;
+    QVector<QString> m_terms;
+    QVector<QByteArray> m_postings;      // 词编号 -> 差值编码的截图 id
+    QVector<int> m_lastIds;              // 每条倒排表的最后一个 id，追加时用来求差值
+    QHash<quint64, QByteArray> m_trigrams;   // 三字组 -> 差值编码的词编号
+    QHash<quint64, int> m_trigramLast;       // 每个三字组词表的最后一个词编号
+    QHash<int, Document> m_documents;
+
+    int termId(const QString& term);
+    void addPosting(int term, int id);
+    void indexTrigrams(int term);
+    QVector<int> matchingTerms(const QString& token) const;
+
+    static QVector<quint64> trigrams(const QString& term);
+    static void appendVarint(QByteArray& out, quint32 value);
+    static quint32 readVarint(const QByteArray& data, int& offset);
+    static QVector<int> decodeDeltas(const QByteArray& data);
+    static QByteArray encodeDeltas(const QVector<int>& values);
+};
+
+#endif // SEARCHINDEX_H
@@ -0,0 +1,421 @@
+#include "capturesession.h"
+#include "../../utils/parallelutils.h"
+#include "../image/resampler.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QPainter>
+#include <QSaveFile>
+#include <QBuffer>
+#include <QDataStream>
+#include <QtEndian>
+#include <QDebug>
+#include <cstring>
+
+namespace {
+
+constexpr char kMagic[4] = {'S', 'C', 'D', 'S'};
+constexpr quint32 kVersion = 1;
+constexpr int kHeaderSize = 8;
+constexpr int kChunkHeaderSize = 8;
+constexpr int kCompressionLevel = 1;   // 截图大片同色，最低压缩级别已足够，解压速度与级别无关
+
+struct Chunk {
+    QByteArray type;
+    const uchar* data;
+    quint32 size;
+};
+
+void appendChunk(QIODevice& out, const char* type, const QByteArray& payload)
+{
+    uchar header[kChunkHeaderSize];
+    std::memcpy(header, type, 4);
+    qToLittleEndian<quint32>(quint32(payload.size()), header + 4);
+    out.write(reinterpret_cast<const char*>(header), kChunkHeaderSize);
+    out.write(payload);
+    static const char padding[4] = {0, 0, 0, 0};
+    out.write(padding, (4 - payload.size() % 4) % 4);
+}
+
+void appendInt(QByteArray& out, qint32 value)
+{
+    uchar bytes[4];
+    qToLittleEndian<qint32>(value, bytes);
+    out.append(reinterpret_cast<const char*>(bytes), 4);
+}
+
+qint32 readInt(const uchar* data, int index)
+{
+    return qFromLittleEndian<qint32>(data + index * 4);
+}
+
+// 解析块表，数据指针指向映射的文件内容；格式不合法时返回 false
+bool parseChunks(const uchar* data, qint64 size, QVector<Chunk>& chunks)
+{
+    if (size < kHeaderSize || std::memcmp(data, kMagic, 4) != 0
+        || qFromLittleEndian<quint32>(data + 4) != kVersion) {
+        return false;
+    }
+    qint64 offset = kHeaderSize;
+    while (offset + kChunkHeaderSize <= size) {
+        const quint32 length = qFromLittleEndian<quint32>(data + offset + 4);
+        if (offset + kChunkHeaderSize + length > size) {
+            return false;
+        }
+        chunks.append({QByteArray(reinterpret_cast<const char*>(data + offset), 4),
+                       data + offset + kChunkHeaderSize, length});
+        offset += kChunkHeaderSize + length + (4 - length % 4) % 4;
+    }
+    return true;
+}
+
+} // namespace
+
+CaptureSession::CaptureSession(const CaptureFramePtr& frame, const QVector<Annotation>& annotations, const QRect& selection)
+{
+    setFrame(frame);
+    setAnnotations(annotations);
+    setSelection(selection);
+}
+
+void CaptureSession::setFrame(const CaptureFramePtr& frame)
+{
+    if (frame == m_frame && frame) {
+        return;
+    }
+    m_frame = frame;
+    m_regions.clear();
+    m_mapping.reset();
+    m_thumbnail = QImage();
+    m_origin = frame ? frame->origin() : QPoint();
+}
+
+void CaptureSession::setAnnotations(const QVector<Annotation>& annotations)
+{
+    m_annotations = annotations;
+    m_thumbnail = QImage();
+}
+
+void CaptureSession::setSelection(const QRect& selection)
+{
+    if (selection != m_selection) {
+        m_selection = selection;
+        m_thumbnail = QImage();
+    }
+}
+
+CaptureFramePtr CaptureSession::frame() const
+{
+    if (m_frame || m_regions.isEmpty()) {
+        return m_frame;
+    }
+
+    // 所有区域的条带放在一起并行解压，直接写入各区域图片的扫描行
+    struct Job {
+        uchar* bits;        // 在当前线程取得的可写指针，工作线程不再触发分离检查
+        int width;
+        int height;
+        qsizetype bytesPerLine;
+        int top;
+        const QByteArray* data;
+    };
+    QVector<CaptureFrame::Region> regions;
+    regions.reserve(m_regions.size());
+    for (const EncodedRegion& encoded : m_regions) {
+        regions.append({encoded.rect, QImage(encoded.rect.size(), QImage::Format_ARGB32_Premultiplied)});
+    }
+    QVector<Job> jobs;
+    for (int i = 0; i < m_regions.size(); ++i) {
+        for (int band = 0; band < m_regions[i].bands.size(); ++band) {
+            QImage& image = regions[i].image;
+            jobs.append({image.bits(), image.width(), image.height(), image.bytesPerLine(),
+                         band * kBandHeight, &m_regions[i].bands[band]});
+        }
+    }
+
+    ParallelUtils::forRange(jobs.size(), 1, [&jobs](int begin, int end) {
+        for (int i = begin; i < end; ++i) {
+            const Job& job = jobs[i];
+            const QByteArray raw = qUncompress(*job.data);
+            const int rows = qMin(kBandHeight, job.height - job.top);
+            const int rowBytes = job.width * 4;
+            for (int y = 0; y < rows; ++y) {
+                uchar* line = job.bits + (job.top + y) * job.bytesPerLine;
+                if (raw.size() == rows * rowBytes) {
+                    std::memcpy(line, raw.constData() + y * rowBytes, size_t(rowBytes));
+                } else {
+                    // 损坏的条带保持透明
+                    std::memset(line, 0, size_t(rowBytes));
+                }
+            }
+        }
+    });
+
+    m_frame = std::make_shared<const CaptureFrame>(regions, m_origin);
+    return m_frame;
+}
+
+CaptureFramePtr CaptureSession::previewFrame() const
+{
+    if (m_frame || m_regions.isEmpty()) {
+        return m_frame;
+    }
+    // 缩略图是选区（没有选区时为整帧）的渲染结果，放大铺回原位置，其余部分用深色填充
+    QRect covered = m_selection;
+    if (covered.isEmpty()) {
+        for (const EncodedRegion& encoded : m_regions) {
+            covered |= encoded.rect;
+        }
+    }
+    QVector<CaptureFrame::Region> regions;
+    regions.reserve(m_regions.size());
+    for (const EncodedRegion& encoded : m_regions) {
+        QImage image(encoded.rect.size(), QImage::Format_ARGB32_Premultiplied);
+        image.fill(QColor(40, 40, 40));
+        if (!m_thumbnail.isNull() && covered.intersects(encoded.rect)) {
+            QPainter painter(&image);
+            painter.drawImage(QRect(covered.topLeft() - encoded.rect.topLeft(), covered.size()), m_thumbnail);
+        }
+        regions.append({encoded.rect, image});
+    }
+    return std::make_shared<const CaptureFrame>(regions, m_origin);
+}
+
+void CaptureSession::encodeRegions()
+{
+    if (!m_regions.isEmpty() || !m_frame) {
+        return;
+    }
+
+    struct Job {
+        const QImage* image;
+        int top;
+        QByteArray* out;
+    };
+    const QVector<CaptureFrame::Region>& regions = m_frame->regions();
+    m_regions.resize(regions.size());
+    QVector<Job> jobs;
+    for (int i = 0; i < regions.size(); ++i) {
+        m_regions[i].rect = regions[i].rect;
+        m_regions[i].bands.resize((regions[i].image.height() + kBandHeight - 1) / kBandHeight);
+        for (int band = 0; band < m_regions[i].bands.size(); ++band) {
+            jobs.append({&regions[i].image, band * kBandHeight, &m_regions[i].bands[band]});
+        }
+    }
+
+    ParallelUtils::forRange(jobs.size(), 1, [&jobs](int begin, int end) {
+        QByteArray raw;
+        for (int i = begin; i < end; ++i) {
+            const Job& job = jobs[i];
+            const int rows = qMin(kBandHeight, job.image->height() - job.top);
+            const int rowBytes = job.image->width() * 4;
+            // 去掉扫描行末尾的对齐填充，得到连续的像素
+            raw.resize(rows * rowBytes);
+            for (int y = 0; y < rows; ++y) {
+                std::memcpy(raw.data() + y * rowBytes, job.image->constScanLine(job.top + y), size_t(rowBytes));
+            }
+            *job.out = qCompress(raw, kCompressionLevel);
+        }
+    });
+}
+
+void CaptureSession::renderThumbnail()
+{
+    if (!m_thumbnail.isNull()) {
+        return;
+    }
+    CaptureFramePtr current = frame();
+    if (!current) {
+        return;
+    }
+    CaptureManager::Snapshot snapshot;
+    snapshot.frame = current;
+    snapshot.annotations = std::make_shared<const QVector<Annotation>>(m_annotations);
+    const QRect rect = m_selection.isEmpty() ? current->rect() : m_selection;
+    m_thumbnail = Resampler::fit(snapshot.render(rect), QSize(kThumbnailSize, kThumbnailSize),
+                                 Resampler::Filter::Box);
+}
+
+bool CaptureSession::save(const QString& path)
+{
+    if (!isValid()) {
+        return false;
+    }
+    encodeRegions();
+    renderThumbnail();
+    if (m_mapping && QFileInfo(m_mapping->fileName()).absoluteFilePath() == QFileInfo(path).absoluteFilePath()) {
+        detachMapping();
+    }
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qDebug() << "Failed to save session:" << path << file.errorString();
+        return false;
+    }
+
+    uchar header[kHeaderSize];
+    std::memcpy(header, kMagic, 4);
+    qToLittleEndian<quint32>(kVersion, header + 4);
+    file.write(reinterpret_cast<const char*>(header), kHeaderSize);
+
+    QByteArray meta;
+    for (int value : {m_origin.x(), m_origin.y(),
+                      m_selection.x(), m_selection.y(), m_selection.width(), m_selection.height()}) {
+        appendInt(meta, value);
+    }
+    appendChunk(file, "META", meta);
+
+    // 缩略图放在像素之前，预览时只需读取文件开头
+    QByteArray thumbnail;
+    QBuffer buffer(&thumbnail);
+    buffer.open(QIODevice::WriteOnly);
+    m_thumbnail.save(&buffer, "PNG");
+    appendChunk(file, "THMB", thumbnail);
+
+    for (const EncodedRegion& region : m_regions) {
+        QByteArray payload;
+        for (int value : {region.rect.x(), region.rect.y(), region.rect.width(), region.rect.height(),
+                          int(region.bands.size())}) {
+            appendInt(payload, value);
+        }
+        for (const QByteArray& band : region.bands) {
+            appendInt(payload, band.size());
+        }
+        for (const QByteArray& band : region.bands) {
+            payload.append(band);
+        }
+        appendChunk(file, "FRAM", payload);
+    }
+
+    appendChunk(file, "ANNO", writeAnnotations(m_annotations));
+    return file.commit();
+}
+
+void CaptureSession::detachMapping()
+{
+    if (!m_mapping) {
+        return;
+    }
+    for (EncodedRegion& region : m_regions) {
+        for (QByteArray& band : region.bands) {
+            band = QByteArray(band.constData(), band.size());
+        }
+    }
+    m_mapping.reset();
+}
+
+CaptureSession CaptureSession::load(const QString& path)
+{
+    auto file = std::make_shared<QFile>(path);
+    if (!file->open(QIODevice::ReadOnly)) {
+        return CaptureSession();
+    }
+    const qint64 size = file->size();
+    const uchar* data = file->map(0, size);
+    if (!data) {
+        return CaptureSession();
+    }
+
+    QVector<Chunk> chunks;
+    if (!parseChunks(data, size, chunks)) {
+        qDebug() << "Invalid session file:" << path;
+        return CaptureSession();
+    }
+
+    CaptureSession session;
+    for (const Chunk& chunk : chunks) {
+        if (chunk.type == "META" && chunk.size >= 6 * 4) {
+            session.m_origin = QPoint(readInt(chunk.data, 0), readInt(chunk.data, 1));
+            session.m_selection = QRect(readInt(chunk.data, 2), readInt(chunk.data, 3),
+                                        readInt(chunk.data, 4), readInt(chunk.data, 5));
+        } else if (chunk.type == "THMB") {
+            session.m_thumbnail = QImage::fromData(chunk.data, int(chunk.size), "PNG");
+        } else if (chunk.type == "FRAM" && chunk.size >= 5 * 4) {
+            EncodedRegion region;
+            region.rect = QRect(readInt(chunk.data, 0), readInt(chunk.data, 1),
+                                readInt(chunk.data, 2), readInt(chunk.data, 3));
+            const int bandCount = readInt(chunk.data, 4);
+            const int expected = (region.rect.height() + kBandHeight - 1) / kBandHeight;
+            if (region.rect.isEmpty() || bandCount != expected || chunk.size < quint32(5 + bandCount) * 4) {
+                return CaptureSession();
+            }
+            // 条带只引用映射中的数据，不复制；会话持有映射直到像素被替换
+            quint32 offset = quint32(5 + bandCount) * 4;
+            for (int band = 0; band < bandCount; ++band) {
+                const quint32 length = quint32(readInt(chunk.data, 5 + band));
+                if (offset + length > chunk.size) {
+                    return CaptureSession();
+                }
+                region.bands.append(QByteArray::fromRawData(reinterpret_cast<const char*>(chunk.data + offset),
+                                                            int(length)));
+                offset += length;
+            }
+            session.m_regions.append(region);
+        } else if (chunk.type == "ANNO") {
+            session.m_annotations = readAnnotations(QByteArray::fromRawData(
+                reinterpret_cast<const char*>(chunk.data), int(chunk.size)));
+        }
+    }
+    if (!session.m_regions.isEmpty()) {
+        session.m_mapping = file;
+    }
+    return session;
+}
+
+QImage CaptureSession::loadThumbnail(const QString& path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QImage();
+    }
+    const qint64 size = file.size();
+    const uchar* data = file.map(0, size);
+    QVector<Chunk> chunks;
+    if (!data || !parseChunks(data, size, chunks)) {
+        return QImage();
+    }
+    for (const Chunk& chunk : chunks) {
+        if (chunk.type == "THMB") {
+            return QImage::fromData(chunk.data, int(chunk.size), "PNG");
+        }
+    }
+    return QImage();
+}
+
+QByteArray CaptureSession::writeAnnotations(const QVector<Annotation>& annotations)
+{
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_5_15);
+    stream << qint32(annotations.size());
+    // 只保存矢量属性，排版结果和马赛克在重新载入时生成
+    for (const Annotation& annotation : annotations) {
+        stream << qint32(annotation.type) << annotation.rect << annotation.text << annotation.color
+               << qint32(annotation.thickness) << annotation.filled
+               << annotation.startPoint << annotation.endPoint << annotation.font;
+    }
+    return data;
+}
+
+QVector<CaptureSession::Annotation> CaptureSession::readAnnotations(const QByteArray& data)
+{
+    QDataStream stream(data);
+    stream.setVersion(QDataStream::Qt_5_15);
+    qint32 count = 0;
+    stream >> count;
+    QVector<Annotation> annotations;
+    for (int i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+        Annotation annotation;
+        qint32 type = 0;
+        qint32 thickness = 0;
+        stream >> type >> annotation.rect >> annotation.text >> annotation.color
+               >> thickness >> annotation.filled
+               >> annotation.startPoint >> annotation.endPoint >> annotation.font;
+        if (stream.status() != QDataStream::Ok) {
+            break;
+        }
+        annotation.type = static_cast<CaptureManager::AnnotationType>(type);
+        annotation.thickness = thickness;
+        annotations.append(annotation);
+    }
+    return annotations;
+}
@@ -0,0 +1,81 @@
+#ifndef CAPTURESESSION_H
+#define CAPTURESESSION_H
+
+#include <QImage>
+#include <QRect>
+#include <QString>
+#include <QVector>
+#include <QByteArray>
+#include <memory>
+#include "../capture/capturemanager.h"
+
+class QFile;
+
+// 截图会话：原始帧、选区和矢量标注，保存后可以重新打开继续编辑
+//
+// 文件为分块格式，"SCDS" 与版本号之后是若干 [类型(4) 长度(4) 数据 填充到 4 字节] 的块：
+//   META  帧原点、尺寸、选区
+//   THMB  选区渲染结果的小缩略图（PNG），只读这一块即可预览
+//   FRAM  每个屏幕区域一块，像素按行条带分别压缩，可以并行解压
+//   ANNO  标注列表（QDataStream 二进制）
+// 读取时映射文件，只解析块表和标注；压缩的条带直接引用映射中的数据，
+// 像素在第一次调用 frame() 时才解压
+class CaptureSession
+{
+public:
+    using Annotation = CaptureManager::Annotation;
+
+    static constexpr int kBandHeight = CaptureFrame::kTileSize;
+    static constexpr int kThumbnailSize = 256;
+    static constexpr const char* kSuffix = "scds";
+
+    CaptureSession() = default;
+    CaptureSession(const CaptureFramePtr& frame, const QVector<Annotation>& annotations, const QRect& selection);
+
+    bool isValid() const { return m_frame != nullptr || !m_regions.isEmpty(); }
+
+    // 第一次调用时解压所有条带，之后返回同一帧；整帧解压较慢，打开会话时应在工作线程调用
+    CaptureFramePtr frame() const;
+    // 已解压时返回 frame()，否则返回尺寸相同、用缩略图放大填充选区的预览帧，不解压像素
+    CaptureFramePtr previewFrame() const;
+    bool isDecoded() const { return m_frame != nullptr; }
+    // 帧变化时丢弃已压缩的像素，帧不变时保存直接复用
+    void setFrame(const CaptureFramePtr& frame);
+
+    QVector<Annotation> annotations() const { return m_annotations; }
+    void setAnnotations(const QVector<Annotation>& annotations);
+    QRect selection() const { return m_selection; }      // 帧坐标
+    void setSelection(const QRect& selection);
+
+    // 写入文件；可在工作线程调用
+    bool save(const QString& path);
+    // 读取失败返回无效会话
+    static CaptureSession load(const QString& path);
+    // 只读取缩略图块
+    static QImage loadThumbnail(const QString& path);
+
+private:
+    // 一个屏幕区域的压缩像素：按 kBandHeight 切成条带，每条带单独压缩
+    struct EncodedRegion {
+        QRect rect;
+        QVector<QByteArray> bands;
+    };
+
+    mutable CaptureFramePtr m_frame;
+    QVector<EncodedRegion> m_regions;
+    // load() 映射的会话文件，m_regions 中的条带指向其中的数据
+    std::shared_ptr<QFile> m_mapping;
+    QPoint m_origin;
+    QVector<Annotation> m_annotations;
+    QRect m_selection;
+    QImage m_thumbnail;
+
+    void encodeRegions();
+    // 把条带复制出映射并释放文件，之后才能覆盖写入同一个文件
+    void detachMapping();
+    void renderThumbnail();
+    static QByteArray writeAnnotations(const QVector<Annotation>& annotations);
+    static QVector<Annotation> readAnnotations(const QByteArray& data);
+};
+
+#endif // CAPTURESESSION_H
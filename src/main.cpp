@@ -1,10 +1,45 @@
 #include "app/mainwindow.h"
+#include "app/commandline.h"
+#include "app/singleinstance.h"
+#include "utils/startupprofiler.h"
 #include <QApplication>
 
 int main(int argc, char *argv[])
 {
+    StartupProfiler::begin();
+    
+    // 命令行子命令不启动图形界面
+    int exitCode = 0;
+    if (CommandLine::run(argc, argv, exitCode)) {
+        return exitCode;
+    }
+    
+    // 已有实例在运行时把请求交给它处理，当前进程立即退出
+    SingleInstance instance;
+    if (instance.forwardToRunning(argc, argv)) {
+        return 0;
+    }
+    
     QApplication a(argc, argv);
+    // 常驻托盘：关闭最后一个贴图或主窗口不退出，退出只通过托盘菜单
+    a.setQuitOnLastWindowClosed(false);
+    StartupProfiler::mark("qapplication");
+    // 启动后只显示托盘图标，主窗口由托盘菜单打开
     MainWindow w;
-    w.show();
+    StartupProfiler::mark("main-window");
+    
+    // 启动耗时报告：预热结束后写出并退出，供脚本跟踪冷启动时间
+    int reportIndex = a.arguments().indexOf("--startup-report");
+    if (reportIndex > 0 && reportIndex + 1 < a.arguments().size()) {
+        const QString reportPath = a.arguments().at(reportIndex + 1);
+        QObject::connect(&w, &MainWindow::warmupFinished, &a, [reportPath, &a]() {
+            a.exit(StartupProfiler::writeReport(reportPath) ? 0 : 1);
+        });
+    }
+    
+    QJsonObject request = SingleInstance::requestFromArguments(a.arguments());
+    if (request.value("cmd").toString() != "activate") {
+        w.executeLaunchRequest(request);
+    }
     return a.exec();
 } 
\ No newline at end of file
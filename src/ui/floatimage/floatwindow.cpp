@@ -1,25 +1,170 @@
 #include "floatwindow.h"
 #include <QPainter>
 #include <QFileDialog>
+#include <QWheelEvent>
+#include <QDragEnterEvent>
+#include <QDropEvent>
+#include <QMimeData>
+#include <QScreen>
+#include <QtMath>
+#include <QTimer>
+#include "../../core/image/progressiveimage.h"
+#include "../../core/export/imageexporter.h"
+#include "../../core/image/autotrim.h"
+#include "../../core/export/beautifier.h"
+#include "../../core/image/resampler.h"
 
 FloatWindow::FloatWindow(const QPixmap& pixmap, QWidget* parent)
     : QWidget(parent)
     , m_pixmap(pixmap)
+    , m_sourceSize(pixmap.size())
 {
     setWindowFlags(Qt::FramelessWindowHint | Qt::WindowStaysOnTopHint | Qt::Tool);
     setAttribute(Qt::WA_TranslucentBackground);
+    setAcceptDrops(true);
     resize(pixmap.size());
     createContextMenu();
     
+    m_rescaleTimer = new QTimer(this);
+    m_rescaleTimer->setSingleShot(true);
+    m_rescaleTimer->setInterval(kRescaleDelayMs);
+    connect(m_rescaleTimer, &QTimer::timeout, this, &FloatWindow::rescalePixmap);
+    
     // 允许鼠标追踪
     setMouseTracking(true);
 }
 
+void FloatWindow::setImageSource(ProgressiveImage* source)
+{
+    m_source = source;
+    m_source->setParent(this);
+    m_pixmap = QPixmap::fromImage(source->preview());
+    m_sourceSize = source->fullSize();
+    
+    connect(m_source, &ProgressiveImage::tileReady, this, [this](const QRect& sourceRect) {
+        QRectF target(QPointF(sourceRect.topLeft()) * m_zoom - m_viewOrigin,
+                      QSizeF(sourceRect.size()) * m_zoom);
+        update(target.toAlignedRect());
+    });
+    
+    // 初始大小不超过屏幕可用区域的 80%
+    QScreen* current = screen() ? screen() : QGuiApplication::primaryScreen();
+    QSize limit = current->availableGeometry().size() * 0.8;
+    qreal fit = qMin(qreal(limit.width()) / m_sourceSize.width(),
+                     qreal(limit.height()) / m_sourceSize.height());
+    m_zoom = qMin<qreal>(1.0, fit);
+    m_viewOrigin = QPoint();
+    resize((QSizeF(m_sourceSize) * m_zoom).toSize().expandedTo(QSize(kMinWindowEdge, kMinWindowEdge)));
+    update();
+}
+
+void FloatWindow::setZoom(qreal zoom, const QPoint& anchor)
+{
+    zoom = qBound(kMinZoom, zoom, kMaxZoom);
+    if (qFuzzyCompare(zoom, m_zoom)) {
+        return;
+    }
+    
+    // 锚点下的原图像素在缩放前后保持不动
+    const QPointF sourceAnchor = QPointF(anchor + m_viewOrigin) / m_zoom;
+    const QPoint globalAnchor = mapToGlobal(anchor);
+    m_zoom = zoom;
+    
+    const QSize displaySize = (QSizeF(m_sourceSize) * m_zoom).toSize()
+        .expandedTo(QSize(kMinWindowEdge, kMinWindowEdge));
+    QScreen* current = screen() ? screen() : QGuiApplication::primaryScreen();
+    const QRect available = current->availableGeometry();
+    const QSize windowSize = displaySize.boundedTo(available.size());
+    const QPoint displayAnchor = (sourceAnchor * m_zoom).toPoint();
+    
+    QPoint topLeft;
+    if (windowSize == displaySize) {
+        // 内容能完整显示：移动窗口
+        m_viewOrigin = QPoint();
+        topLeft = globalAnchor - displayAnchor;
+    } else {
+        // 内容大于屏幕：窗口占满可用区域，改为平移视口
+        topLeft = QPoint(qBound(available.left(), pos().x(), available.right() - windowSize.width() + 1),
+                         qBound(available.top(), pos().y(), available.bottom() - windowSize.height() + 1));
+        m_viewOrigin = displayAnchor - (globalAnchor - topLeft);
+    }
+    setGeometry(QRect(topLeft, windowSize));
+    clampViewOrigin();
+    update();
+}
+
+void FloatWindow::clampViewOrigin()
+{
+    const QSize displaySize = (QSizeF(m_sourceSize) * m_zoom).toSize();
+    m_viewOrigin.setX(qBound(0, m_viewOrigin.x(), qMax(0, displaySize.width() - width())));
+    m_viewOrigin.setY(qBound(0, m_viewOrigin.y(), qMax(0, displaySize.height() - height())));
+}
+
+QRect FloatWindow::visibleSourceRect(const QRect& widgetRect) const
+{
+    QRectF source(QPointF(widgetRect.topLeft() + m_viewOrigin) / m_zoom,
+                  QSizeF(widgetRect.size()) / m_zoom);
+    return source.toAlignedRect().intersected(QRect(QPoint(0, 0), m_sourceSize));
+}
+
+bool FloatWindow::isScaledCurrent() const
+{
+    return !m_scaled.isNull() && m_scaledZoom == m_zoom && m_scaledKey == m_pixmap.cacheKey();
+}
+
+void FloatWindow::rescalePixmap()
+{
+    const qreal ratio = devicePixelRatioF();
+    const QSize target = (QSizeF(m_sourceSize) * m_zoom * ratio).toSize();
+    // 只在缩小预览图时生成；放大时双线性插值已经足够，且缓存会比原图更大
+    if (target.isEmpty() || target.width() >= m_pixmap.width()) {
+        m_scaled = QPixmap();
+        return;
+    }
+    m_scaled = QPixmap::fromImage(Resampler::scale(m_pixmap.toImage(), target, Resampler::Filter::Lanczos3));
+    m_scaled.setDevicePixelRatio(ratio);
+    m_scaledZoom = m_zoom;
+    m_scaledKey = m_pixmap.cacheKey();
+    update();
+}
+
 void FloatWindow::paintEvent(QPaintEvent* event)
 {
     QPainter painter(this);
     painter.setRenderHint(QPainter::SmoothPixmapTransform);
-    painter.drawPixmap(rect(), m_pixmap);
+    
+    // 缩小显示时直接贴上预先缩放好的图，不再每次绘制都重新采样
+    if (isScaledCurrent()) {
+        const qreal ratio = m_scaled.devicePixelRatio();
+        const QRect area = event->rect();
+        painter.drawPixmap(QRectF(area), m_scaled,
+                           QRectF(QPointF(area.topLeft() + m_viewOrigin) * ratio, QSizeF(area.size()) * ratio));
+        return;
+    }
+    
+    // 先用预览图（截图贴图即原图）铺满窗口
+    const qreal previewScale = qreal(m_pixmap.width()) / qMax(1, m_sourceSize.width());
+    QRectF visible(QPointF(m_viewOrigin) / m_zoom, QSizeF(size()) / m_zoom);
+    QRectF previewRect(visible.topLeft() * previewScale, visible.size() * previewScale);
+    painter.drawPixmap(QRectF(rect()), m_pixmap, previewRect);
+    if (m_zoom * devicePixelRatioF() < previewScale) {
+        m_rescaleTimer->start();
+    }
+    
+    // 放大超过预览分辨率后，用已解码的原图图块覆盖，缺失的图块交给后台解码
+    if (m_source && m_zoom > m_source->previewScale()) {
+        QRect onScreen = event->rect();
+        if (QScreen* current = screen()) {
+            onScreen &= QRect(mapFromGlobal(current->geometry().topLeft()), current->geometry().size());
+        }
+        QRect sourceRect = visibleSourceRect(onScreen);
+        m_source->requestTiles(sourceRect);
+        for (const auto& tile : m_source->tiles(sourceRect)) {
+            QRectF target(QPointF(tile.first.topLeft()) * m_zoom - m_viewOrigin,
+                          QSizeF(tile.first.size()) * m_zoom);
+            painter.drawImage(target, tile.second);
+        }
+    }
 }
 
 void FloatWindow::mousePressEvent(QMouseEvent* event)
@@ -28,6 +173,11 @@ void FloatWindow::mousePressEvent(QMouseEvent* event)
         m_isDragging = true;
         m_dragStartPos = event->pos();
         setCursor(Qt::ClosedHandCursor);
+    } else if (event->button() == Qt::MiddleButton) {
+        // 中键拖动平移放大后的内容
+        m_isPanning = true;
+        m_dragStartPos = event->pos();
+        setCursor(Qt::SizeAllCursor);
     }
 }
 
@@ -35,17 +185,46 @@ void FloatWindow::mouseMoveEvent(QMouseEvent* event)
 {
     if (m_isDragging) {
         move(pos() + event->pos() - m_dragStartPos);
+    } else if (m_isPanning) {
+        m_viewOrigin -= event->pos() - m_dragStartPos;
+        m_dragStartPos = event->pos();
+        clampViewOrigin();
+        update();
     }
 }
 
 void FloatWindow::mouseReleaseEvent(QMouseEvent* event)
 {
-    if (event->button() == Qt::LeftButton) {
+    if (event->button() == Qt::LeftButton || event->button() == Qt::MiddleButton) {
         m_isDragging = false;
+        m_isPanning = false;
         setCursor(Qt::ArrowCursor);
     }
 }
 
+void FloatWindow::wheelEvent(QWheelEvent* event)
+{
+    const int steps = event->angleDelta().y() / 120;
+    if (steps == 0) {
+        return;
+    }
+    setZoom(m_zoom * qPow(1.1, steps), event->position().toPoint());
+    event->accept();
+}
+
+void FloatWindow::dragEnterEvent(QDragEnterEvent* event)
+{
+    if (event->mimeData()->hasUrls() || event->mimeData()->hasImage()) {
+        event->acceptProposedAction();
+    }
+}
+
+void FloatWindow::dropEvent(QDropEvent* event)
+{
+    emit dropReceived(event->mimeData(), mapToGlobal(event->pos()));
+    event->acceptProposedAction();
+}
+
 void FloatWindow::contextMenuEvent(QContextMenuEvent* event)
 {
     m_contextMenu->exec(event->globalPos());
@@ -57,39 +236,114 @@ void FloatWindow::createContextMenu()
     
     QAction* copyAction = new QAction("复制", this);
     connect(copyAction, &QAction::triggered, [this]() {
-        QApplication::clipboard()->setPixmap(m_pixmap);
+        withFullImage([](const QImage& image) {
+            QApplication::clipboard()->setImage(image);
+        });
     });
     
     QAction* saveAction = new QAction("保存", this);
     connect(saveAction, &QAction::triggered, this, &FloatWindow::saveImage);
     
+    QAction* actualSizeAction = new QAction("原始大小", this);
+    connect(actualSizeAction, &QAction::triggered, this, [this]() {
+        setZoom(1.0, rect().center());
+    });
+    
+    QAction* trimAction = new QAction("去除四周空白", this);
+    connect(trimAction, &QAction::triggered, this, &FloatWindow::trimBorders);
+    
     QAction* closeAction = new QAction("关闭", this);
     connect(closeAction, &QAction::triggered, this, &QWidget::close);
     
     m_contextMenu->addAction(copyAction);
     m_contextMenu->addAction(saveAction);
+    m_contextMenu->addAction(actualSizeAction);
+    m_contextMenu->addAction(trimAction);
     m_contextMenu->addSeparator();
     m_contextMenu->addAction(closeAction);
 }
 
+void FloatWindow::withFullImage(const std::function<void(const QImage&)>& use)
+{
+    if (!m_source) {
+        use(m_pixmap.toImage());
+        return;
+    }
+    // 文件贴图平时只持有预览图，复制和保存时才在解码线程临时解码原图；
+    // 解码期间内容被裁剪替换时放弃这次操作
+    ProgressiveImage* source = m_source;
+    setCursor(Qt::BusyCursor);
+    source->loadFull(this, [this, source, use](const QImage& image) {
+        setCursor(Qt::ArrowCursor);
+        if (m_source != source || image.isNull()) {
+            return;
+        }
+        use(image);
+    });
+}
+
 void FloatWindow::saveImage()
 {
     QString filePath = QFileDialog::getSaveFileName(
         this,
         "保存图片",
         QDir::homePath() + "/screenshot.png",
-        "Images (*.png *.jpg *.bmp)"
+        "Images (*.png *.jpg *.bmp *.webp *.qoi)"
     );
     
     if (!filePath.isEmpty()) {
-        m_pixmap.save(filePath);
+        withFullImage([filePath](const QImage& full) {
+            const QImage image = ImageExporter::scaledForExport(full);
+            ImageExporter::saveForUser(Beautifier::isEnabled() ? Beautifier::apply(image, Beautifier::style()) : image, filePath);
+        });
     }
 }
 
+void FloatWindow::trimBorders()
+{
+    withFullImage([this](const QImage& image) {
+        trimTo(image);
+    });
+}
+
+void FloatWindow::trimTo(const QImage& image)
+{
+    const QRect trimmed = AutoTrim::trim(image, image.rect(), AutoTrim::tolerance());
+    if (trimmed == image.rect()) {
+        return;
+    }
+    
+    // 裁剪后整图已在内存中，不再需要按图块加载原图
+    if (m_source) {
+        m_source->deleteLater();
+        m_source = nullptr;
+    }
+    m_pixmap = QPixmap::fromImage(image.copy(trimmed));
+    m_sourceSize = m_pixmap.size();
+    
+    // 保持剩余内容在屏幕上不动：先平移视口，视口不够时移动窗口
+    QPoint viewOrigin = m_viewOrigin - (QPointF(trimmed.topLeft()) * m_zoom).toPoint();
+    QPoint topLeft = pos();
+    if (viewOrigin.x() < 0) {
+        topLeft.rx() -= viewOrigin.x();
+        viewOrigin.setX(0);
+    }
+    if (viewOrigin.y() < 0) {
+        topLeft.ry() -= viewOrigin.y();
+        viewOrigin.setY(0);
+    }
+    const QSize displaySize = (QSizeF(m_sourceSize) * m_zoom).toSize()
+        .expandedTo(QSize(kMinWindowEdge, kMinWindowEdge));
+    m_viewOrigin = viewOrigin;
+    setGeometry(QRect(topLeft, displaySize.boundedTo(size())));
+    clampViewOrigin();
+    update();
+}
+
 void FloatWindow::mouseDoubleClickEvent(QMouseEvent* event)
 {
     if (event->button() == Qt::LeftButton) {
         // 双击左键关闭窗口
         close();
     }
-} 
\ No newline at end of file
+}
@@ -9,12 +9,31 @@
 #include <QApplication>
 #include <QClipboard>
 #include <QFileDialog>
+#include <functional>
+
+class ProgressiveImage;
+class QMimeData;
+class QTimer;
 
 class FloatWindow : public QWidget
 {
     Q_OBJECT
 public:
     explicit FloatWindow(const QPixmap& pixmap, QWidget* parent = nullptr);
+    const QPixmap& pixmap() const { return m_pixmap; }
+    
+    // 使用渐进式解码的图片作为内容（取得所有权）：显示预览图，
+    // 放大超过预览分辨率后按图块加载原图
+    void setImageSource(ProgressiveImage* source);
+    // 以鼠标位置为锚点缩放，zoom 为相对原图的比例
+    void setZoom(qreal zoom, const QPoint& anchor);
+    // 取得原始分辨率的内容后调用 use：截图贴图立即调用，文件贴图在后台解码完成后调用。
+    // pixmap() 对文件贴图只是预览图，需要原图像素时使用本函数
+    void withFullImage(const std::function<void(const QImage&)>& use);
+    
+signals:
+    // 拖放到贴图上的文件或图片
+    void dropReceived(const QMimeData* mimeData, const QPoint& globalPos);
     
 protected:
     void paintEvent(QPaintEvent* event) override;
@@ -23,15 +42,41 @@ protected:
     void mouseReleaseEvent(QMouseEvent* event) override;
     void contextMenuEvent(QContextMenuEvent* event) override;
     void mouseDoubleClickEvent(QMouseEvent* event) override;
+    void wheelEvent(QWheelEvent* event) override;
+    void dragEnterEvent(QDragEnterEvent* event) override;
+    void dropEvent(QDropEvent* event) override;
     
 private:
+    static constexpr qreal kMinZoom = 0.05;
+    static constexpr qreal kMaxZoom = 16.0;
+    static constexpr int kMinWindowEdge = 16;
+    static constexpr int kRescaleDelayMs = 120;
+    
     QPixmap m_pixmap;
+    ProgressiveImage* m_source{nullptr};
+    QSize m_sourceSize;         // 原图尺寸
+    qreal m_zoom{1.0};
+    QPoint m_viewOrigin;        // 内容大于窗口时，窗口左上角对应的缩放后坐标
+    // 缩小显示时的高质量缩放结果（显示尺寸 × 设备像素比），缩放比例或内容变化后失效
+    QPixmap m_scaled;
+    qreal m_scaledZoom{0.0};
+    qint64 m_scaledKey{0};
+    QTimer* m_rescaleTimer;
     bool m_isDragging{false};
+    bool m_isPanning{false};
     QPoint m_dragStartPos;
     QMenu* m_contextMenu;
     
     void createContextMenu();
     void saveImage();
+    // 去除四周的纯色边距，内容在屏幕上的位置不变
+    void trimBorders();
+    void trimTo(const QImage& image);
+    QRect visibleSourceRect(const QRect& widgetRect) const;
+    void clampViewOrigin();
+    // 缩放停止后用 Lanczos3 重新生成 m_scaled，之前的绘制使用双线性过渡
+    void rescalePixmap();
+    bool isScaledCurrent() const;
 };
 
-#endif // FLOATWINDOW_H 
\ No newline at end of file
+#endif // FLOATWINDOW_H
@@ -6,11 +6,19 @@
 #include <QKeyEvent>
 #include <QTimer>
 #include <QApplication>
+#include <QInputMethodEvent>
+#include <QSettings>
 #include "../toolbar/editbar.h"
 #include "../../core/capture/capturemanager.h"
-
-// 在文件开头，类定义之前添加静态成员初始化
-QCursor* OverlayWidget::s_customCursor = nullptr;
+#include "../../core/capture/replaybuffer.h"
+#include "../../core/redaction/sensitivecontentscanner.h"
+#include "../../core/redaction/redactionrules.h"
+#include "../../core/search/captureindexer.h"
+#include "../../core/image/autotrim.h"
+#include "../../core/barcode/codescanner.h"
+#include <QElapsedTimer>
+#include <algorithm>
+#include <numeric>
 
 OverlayWidget::OverlayWidget(QWidget *parent, CaptureManager* manager)
     : QWidget(parent)
@@ -52,6 +60,26 @@ OverlayWidget::OverlayWidget(QWidget *parent, CaptureManager* manager)
     }
     setGeometry(screenRect);
     
+    // 选区外使用的十字光标
+    QPixmap cursorPixmap(32, 32);
+    cursorPixmap.fill(Qt::transparent);
+    {
+        QPainter painter(&cursorPixmap);
+        // 绘制黑色外边
+        painter.setPen(QPen(QColor(0, 0, 0), 3));
+        painter.drawLine(16, 0, 16, 32);
+        painter.drawLine(0, 16, 32, 16);
+        // 绘制白色内边
+        painter.setPen(QPen(QColor(255, 255, 255), 1));
+        painter.drawLine(16, 0, 16, 32);
+        painter.drawLine(0, 16, 32, 16);
+    }
+    m_crossCursor = QCursor(cursorPixmap, 16, 16);
+    
+    // 十字辅助线开关，按 C 切换
+    m_crosshairEnabled = QSettings("SCD", "SCD").value("overlay/crosshair", false).toBool();
+    m_readoutSize = QFontMetrics(font()).size(Qt::TextSingleLine, "-00000, -00000") + QSize(12, 6);
+    
     // 设置尺寸标签样式
     m_sizeLabel->setStyleSheet(
         "QLabel { "
@@ -66,18 +94,53 @@ OverlayWidget::OverlayWidget(QWidget *parent, CaptureManager* manager)
     
     m_editBar->hide();  // 初始时隐藏工具栏
     
+    // 文字编辑光标闪烁，只刷新光标所在区域
+    m_textFont = m_editBar->currentFont();
+    m_caretTimer.setInterval(500);
+    connect(&m_caretTimer, &QTimer::timeout, this, [this]() {
+        m_caretVisible = !m_caretVisible;
+        update(textCaretRect());
+    });
+    
+    // 合并后的鼠标移动在下一帧到期时处理
+    m_moveTimer.setSingleShot(true);
+    m_moveTimer.setTimerType(Qt::PreciseTimer);
+    connect(&m_moveTimer, &QTimer::timeout, this, &OverlayWidget::flushPendingMove);
+    
     // 连接工具栏信号
     connect(m_editBar, &EditBar::toolChanged, this, &OverlayWidget::handleToolChanged);
-    connect(m_editBar, &EditBar::confirmClicked, this, [this]() {
-        QRect selectedRect = QRect(m_startPos, m_endPos).normalized();
-        emit areaSelected(selectedRect);
-        hide();
+    connect(m_editBar, &EditBar::colorChanged, this, [this](const QColor& color) {
+        m_currentColor = color;
+        if (m_isEditingText) {
+            update(m_textBoxRect);
+        }
     });
+    connect(m_editBar, &EditBar::fontChanged, this, [this](const QFont& font) {
+        m_textFont = font;
+        if (m_isEditingText) {
+            relayoutText();
+        }
+    });
+    connect(m_editBar, &EditBar::confirmClicked, this, &OverlayWidget::confirmSelection);
+    connect(m_editBar, &EditBar::compareClicked, this, [this]() {
+        exportSelection(ExportAction::Compare);
+    });
+    connect(m_editBar, &EditBar::trimClicked, this, &OverlayWidget::trimSelection);
+    connect(m_editBar, &EditBar::decodeClicked, this, &OverlayWidget::decodeCodes);
     connect(m_editBar, &EditBar::cancelClicked, this, [this]() {
         hide();
         emit captureFinished();
     });
     
+    // 扫描结果到达后添加马赛克标注，供用户检查；正在等待扫描的确认随之继续
+    connect(m_captureManager->scanner(), &SensitiveContentScanner::finished,
+            this, &OverlayWidget::onRedactionScanFinished);
+    connect(m_captureManager->scanner(), &SensitiveContentScanner::progressChanged, this, [this]() {
+        if (m_pendingExport != ExportAction::None) {
+            update(redactionBadgeRect());
+        }
+    });
+    
     // 创建事件过滤器来处理工具栏的鼠标事件
     m_editBar->installEventFilter(this);
     
@@ -99,7 +162,7 @@ bool OverlayWidget::eventFilter(QObject *watched, QEvent *event)
             case QEvent::Enter:
             case QEvent::HoverEnter:
             case QEvent::HoverMove:
-                setCursor(Qt::ArrowCursor);
+                applyCursor(Qt::ArrowCursor);
                 return true;
             case QEvent::Leave:
             case QEvent::HoverLeave:
@@ -135,8 +198,12 @@ void OverlayWidget::updateSizeInfo()
     }
     
     QRect rect = QRect(m_startPos, m_endPos).normalized();
-    m_sizeLabel->setText(QString("%1 × %2").arg(rect.width()).arg(rect.height()));
-    m_sizeLabel->adjustSize(); // 确保标签大小正确
+    // 文字不变（例如拖动选区）时不重新排版，只移动位置
+    const QString text = QString("%1 × %2").arg(rect.width()).arg(rect.height());
+    if (text != m_sizeLabel->text()) {
+        m_sizeLabel->setText(text);
+        m_sizeLabel->adjustSize(); // 确保标签大小正确
+    }
     
     // 智能调整标签位置，避免超出屏幕
     QPoint labelPos;
@@ -172,8 +239,10 @@ void OverlayWidget::updateSizeInfo()
     }
     
     m_sizeLabel->move(labelPos);
-    m_sizeLabel->show();
-    m_sizeLabel->raise();
+    if (m_sizeLabel->isHidden()) {
+        m_sizeLabel->show();
+        m_sizeLabel->raise();
+    }
 }
 
 void OverlayWidget::takeScreenshot()
@@ -184,40 +253,35 @@ void OverlayWidget::takeScreenshot()
         totalRect = totalRect.united(screen->geometry());
     }
     
-    // 创建一个完整的截图
-    QPixmap fullScreenshot(totalRect.size());
-    fullScreenshot.fill(Qt::transparent);
-    QPainter painter(&fullScreenshot);
-    
-    // 截取每个屏幕
+    // 每个屏幕单独保存，不为屏幕之间的空隙分配像素
+    QVector<CaptureFrame::Region> regions;
     for (QScreen *screen : QGuiApplication::screens()) {
         QPixmap screenShot = screen->grabWindow(0);
         QRect screenRect = screen->geometry();
-        painter.drawPixmap(screenRect.translated(-totalRect.topLeft()), screenShot);
+        regions.append({screenRect.translated(-totalRect.topLeft()), screenShot.toImage()});
     }
     
-    m_screenSnapshot = fullScreenshot;
-    // 设置到 CaptureManager
-    m_captureManager->setOriginalPixmap(fullScreenshot);
+    // 重新编辑会话时窗口可能按会话的帧调整过，恢复到当前桌面
+    setGeometry(totalRect);
+    
+    // 冻结为不可修改的帧，设置到 CaptureManager
+    m_frame = std::make_shared<const CaptureFrame>(regions, totalRect.topLeft());
+    m_liveFrame = m_frame;
+    m_captureManager->setFrame(m_frame);
 }
 
 void OverlayWidget::show()
 {
     // 先清理所有资源
-    m_screenSnapshot = QPixmap();
+    m_frame.reset();
     m_captureManager->clearResources();
-    
-    // 重置所有状态
-    m_isDrawing = false;
-    m_isDragging = false;
-    m_isAnnotating = false;
-    m_editBar->hide();
-    m_sizeLabel->hide();
-    m_startPos = QPoint(-1, -1);
-    m_endPos = QPoint(-1, -1);
+    resetState();
     
     // 隐藏窗口
     hide();
+    m_captureManager->replay()->setPaused(true);
+    m_captureManager->indexer()->setPaused(true);
+    setWindowFlag(Qt::WindowTransparentForInput, false);
     
     // 延迟执行新截图
     QTimer::singleShot(100, this, [this]() {
@@ -233,24 +297,221 @@ void OverlayWidget::show()
     });
 }
 
+void OverlayWidget::showSession(const CaptureFramePtr& frame, const QVector<CaptureManager::Annotation>& annotations,
+                                const QRect& selection, bool preview)
+{
+    if (!frame) {
+        return;
+    }
+    m_captureManager->clearResources();
+    resetState();
+    setWindowFlag(Qt::WindowTransparentForInput, false);
+    m_captureManager->replay()->setPaused(true);
+    m_captureManager->indexer()->setPaused(true);
+    
+    m_frame = frame;
+    m_captureManager->setFrame(frame);
+    m_captureManager->setAnnotations(annotations);
+    // 已有的打码区域不再重复添加
+    for (const CaptureManager::Annotation& annotation : annotations) {
+        if (annotation.type == CaptureManager::AnnotationType::Pixelate) {
+            m_autoRedacted.append(annotation.rect.normalized());
+        }
+    }
+    
+    // 按保存时的桌面位置显示，屏幕布局变化后也能完整看到整帧
+    setGeometry(QRect(frame->origin(), frame->size()));
+    QWidget::show();
+    setWindowState(Qt::WindowActive);
+    raise();
+    activateWindow();
+    setFocus(Qt::ActiveWindowFocusReason);
+    
+    if (!selection.isEmpty()) {
+        m_startPos = selection.topLeft();
+        m_endPos = selection.bottomRight();
+        updateEditBarPosition();
+        m_editBar->show();
+        m_editBar->raise();
+    }
+    
+    // 预览帧只用于尽快显示界面，打码、去边、导出都要等真正的像素
+    m_framePending = preview;
+    m_editBar->setEnabled(!preview);
+    if (preview) {
+        update(redactionBadgeRect());
+    }
+}
+
+bool OverlayWidget::finishSessionLoad(const CaptureFramePtr& frame)
+{
+    if (!m_framePending || !isVisible() || !frame) {
+        return false;
+    }
+    m_framePending = false;
+    m_frame = frame;
+    m_captureManager->setFrame(frame);
+    m_editBar->setEnabled(true);
+    update();
+    return true;
+}
+
+void OverlayWidget::resetState()
+{
+    m_countdown = 0;
+    m_pendingExport = ExportAction::None;
+    m_framePending = false;
+    m_editBar->setEnabled(true);
+    cancelTextEdit();
+    m_selectedAnnotation = -1;
+    m_annotationDrag = AnnotationDrag::None;
+    m_autoRedacted.clear();
+    m_isDrawing = false;
+    m_isDragging = false;
+    m_isAnnotating = false;
+    m_editBar->hide();
+    m_sizeLabel->hide();
+    m_startPos = QPoint(-1, -1);
+    m_endPos = QPoint(-1, -1);
+    m_crosshairPos = QPoint(-1, -1);
+    m_replayIndex = -1;
+    m_trimPreview = QRect();
+    m_diffRegions.clear();
+    m_autoTrim = AutoTrim::isEnabled();
+    m_trimTolerance = AutoTrim::tolerance();
+    m_beautify = Beautifier::isEnabled();
+    m_beautifyStyle = Beautifier::style();
+    
+    // 按刷新率最高的屏幕确定移动事件的合并间隔
+    qreal refreshRate = 0;
+    for (QScreen* screen : QGuiApplication::screens()) {
+        refreshRate = qMax(refreshRate, screen->refreshRate());
+    }
+    m_frameIntervalNs = qint64(1e9 / (refreshRate >= 24 ? refreshRate : 60.0));
+    m_moveTimer.stop();
+    m_hasPendingMove = false;
+    m_lastMoveNs = -1;
+    m_paintPendingSinceNs = -1;
+    m_inputStats = InputStats();
+    m_inputClock.start();
+}
+
 void OverlayWidget::hide()
 {
+    m_moveTimer.stop();
+    m_hasPendingMove = false;
+    logInputStats();
+    
     // 清理资源
-    m_screenSnapshot = QPixmap();
+    m_frame.reset();
+    m_liveFrame.reset();
     m_captureManager->clearResources();
+    m_captureManager->replay()->setPaused(false);
+    m_captureManager->indexer()->setPaused(false);
     QWidget::hide();
 }
 
+void OverlayWidget::logInputStats()
+{
+    if (m_inputStats.events == 0) {
+        return;
+    }
+    QVector<qint64>& latency = m_inputStats.latencyUs;
+    QString summary;
+    if (!latency.isEmpty()) {
+        std::sort(latency.begin(), latency.end());
+        const qint64 total = std::accumulate(latency.cbegin(), latency.cend(), qint64(0));
+        summary = QString(", latency avg %1 ms p95 %2 ms max %3 ms")
+                      .arg(total / 1000.0 / latency.size(), 0, 'f', 2)
+                      .arg(latency.at(latency.size() * 95 / 100) / 1000.0, 0, 'f', 2)
+                      .arg(latency.last() / 1000.0, 0, 'f', 2);
+    }
+    qDebug().noquote() << QString("Overlay input: %1 moves coalesced into %2 updates (%3 Hz)%4")
+                              .arg(m_inputStats.events).arg(m_inputStats.frames)
+                              .arg(1e9 / m_frameIntervalNs, 0, 'f', 0).arg(summary);
+    m_inputStats = InputStats();
+}
+
+void OverlayWidget::showCountdown(int seconds)
+{
+    m_countdown = seconds;
+    if (!isVisible()) {
+        // 倒计时期间鼠标键盘穿透到下方窗口
+        setWindowFlag(Qt::WindowTransparentForInput, true);
+        m_frame.reset();
+        m_editBar->hide();
+        m_sizeLabel->hide();
+        m_startPos = QPoint(-1, -1);
+        m_endPos = QPoint(-1, -1);
+        QWidget::show();
+    }
+    update(countdownBadgeRect());
+}
+
+void OverlayWidget::hideCountdown()
+{
+    if (m_countdown == 0) {
+        return;
+    }
+    m_countdown = 0;
+    QWidget::hide();
+    setWindowFlag(Qt::WindowTransparentForInput, false);
+}
+
+void OverlayWidget::showDiffRegions(const QVector<QRect>& regions)
+{
+    QRect selectedRect = QRect(m_startPos, m_endPos).normalized();
+    if (!isVisible() || !selectedRect.isValid()) {
+        return;
+    }
+    
+    m_diffRegions.clear();
+    for (const QRect& region : regions) {
+        QRect rect = region.translated(selectedRect.topLeft()).intersected(selectedRect);
+        if (!rect.isEmpty()) {
+            m_diffRegions.append(rect);
+        }
+    }
+    update(selectedRect.adjusted(-2, -2, 2, 2));
+}
+
+QRect OverlayWidget::countdownBadgeRect() const
+{
+    // 显示在主屏幕中央
+    const QSize badgeSize(120, 120);
+    QPoint center = QGuiApplication::primaryScreen()->geometry().center() - geometry().topLeft();
+    return QRect(center - QPoint(badgeSize.width() / 2, badgeSize.height() / 2), badgeSize);
+}
+
 void OverlayWidget::paintEvent(QPaintEvent *event)
 {
-    Q_UNUSED(event);
     QPainter painter(this);
     
-    // 使用高质量渲染
-    painter.setRenderHint(QPainter::SmoothPixmapTransform);
+    // 延时截图倒计时只绘制倒计时标记，其余区域保持透明
+    if (m_countdown > 0) {
+        QRect badge = countdownBadgeRect();
+        painter.setRenderHint(QPainter::Antialiasing);
+        painter.setPen(Qt::NoPen);
+        painter.setBrush(QColor(26, 26, 26, 200));
+        painter.drawRoundedRect(badge, 16, 16);
+        
+        QFont font = painter.font();
+        font.setPixelSize(64);
+        font.setBold(true);
+        painter.setFont(font);
+        painter.setPen(Qt::white);
+        painter.drawText(badge, Qt::AlignCenter, QString::number(m_countdown));
+        return;
+    }
     
-    // 绘制初始截图
-    painter.drawPixmap(rect(), m_screenSnapshot);
+    // 绘制冻结的截图，只复制需要刷新的区域
+    // 十字线移动时刷新区域是几条细线，按区域中的矩形逐块处理，而不是它们的包围盒
+    const QRegion dirty = event->region();
+    if (m_frame) {
+        for (const QRect& rect : dirty) {
+            m_frame->draw(painter, rect);
+        }
+    }
     
     // 绘制选区外的半透明遮罩
     QRect selectedRect = QRect(m_startPos, m_endPos).normalized();
@@ -261,96 +522,191 @@ void OverlayWidget::paintEvent(QPaintEvent *event)
         painter.fillRect(QRect(0, selectedRect.top(), selectedRect.left(), selectedRect.height()), QColor(0, 0, 0, 128));  // 左
         painter.fillRect(QRect(selectedRect.right() + 1, selectedRect.top(), width() - selectedRect.right() - 1, selectedRect.height()), QColor(0, 0, 0, 128));  // 右
         
+        // 美化预览：选区外的投影。拖动新选区时尺寸不断变化，松开后再生成
+        if (m_beautify && !m_isDrawing && m_beautifyStyle.shadowRadius > 0) {
+            const int margin = Beautifier::shadowMargin(m_beautifyStyle.shadowRadius);
+            painter.save();
+            painter.setClipRegion(QRegion(rect()).subtracted(selectedRect));
+            painter.drawImage(selectedRect.topLeft() - QPoint(margin, margin) + m_beautifyStyle.shadowOffset,
+                              Beautifier::shadow(selectedRect.size(), m_beautifyStyle.shadowRadius,
+                                                 m_beautifyStyle.cornerRadius, m_beautifyStyle.shadowOpacity));
+            painter.restore();
+        }
+        
         // 绘制选区边框
         painter.setPen(QPen(Qt::white, 2));
         painter.drawRect(selectedRect);
+        
+        // 去边后的区域预览
+        if ((m_isDrawing || m_isDragging) && m_trimPreview.isValid() && m_trimPreview != selectedRect) {
+            painter.setPen(QPen(QColor(18, 150, 219), 1, Qt::DashLine));
+            painter.drawRect(m_trimPreview.adjusted(0, 0, -1, -1));
+        }
     } else {
         // 如果没有选区，整个屏幕都是半透明的
         painter.fillRect(rect(), QColor(0, 0, 0, 128));
     }
 
-    // 绘制已保存的标注
-    if (!m_isDrawing && !m_isDragging) {
-        QRect selectedRect = QRect(m_startPos, m_endPos).normalized();
-        if (selectedRect.isValid()) {
-            // 获取并绘制带标注的图片
-            QPixmap editedPixmap = m_captureManager->getEditedPixmap();
-            if (!editedPixmap.isNull()) {
-                painter.drawPixmap(selectedRect, editedPixmap, selectedRect);
+    // 绘制已提交的标注：只绘制与刷新区域相交的对象
+    if (selectedRect.isValid()) {
+        painter.save();
+        painter.setRenderHint(QPainter::Antialiasing);
+        for (const QRect& rect : dirty) {
+            QRect clip = selectedRect.intersected(rect);
+            if (!clip.isEmpty()) {
+                painter.setClipRect(clip);
+                m_captureManager->drawAnnotations(painter, clip);
             }
         }
+        painter.restore();
+    }
+    
+    // 与贴图对比的差异区域
+    if (!m_diffRegions.isEmpty()) {
+        painter.save();
+        painter.setPen(QPen(QColor(255, 0, 255), 2));
+        painter.setBrush(QColor(255, 0, 255, 48));
+        for (const QRect& region : m_diffRegions) {
+            if (dirty.intersects(region.adjusted(-2, -2, 2, 2))) {
+                painter.drawRect(region.adjusted(1, 1, -1, -1));
+            }
+        }
+        painter.restore();
+    }
+    
+    // 选中的标注：虚线框与控制点
+    if (m_selectedAnnotation >= 0 && m_selectedAnnotation < m_captureManager->annotations().size()) {
+        painter.save();
+        painter.setBrush(Qt::NoBrush);
+        painter.setPen(QPen(Qt::white, 1, Qt::DashLine));
+        painter.drawRect(CaptureManager::annotationBounds(
+            m_captureManager->annotations().at(m_selectedAnnotation)).adjusted(0, 0, -1, -1));
+        painter.setPen(QPen(QColor(18, 150, 219), 1));
+        painter.setBrush(Qt::white);
+        for (const QRect& handle : annotationHandles(m_selectedAnnotation)) {
+            painter.drawRect(handle.adjusted(0, 0, -1, -1));
+        }
+        painter.restore();
     }
 
     // 绘制正在创建的标注预览
     if (m_isAnnotating) {
-        QPainter painter(this);
+        painter.save();
+        painter.setRenderHint(QPainter::Antialiasing);
+        m_captureManager->drawAnnotation(painter, previewAnnotation());
+        painter.restore();
+    }
+    
+    // 正在编辑的文字：绘制缓存的排版、编辑框和光标
+    if (m_isEditingText && m_textLayout) {
         painter.setRenderHint(QPainter::Antialiasing);
+        painter.setBrush(Qt::NoBrush);
+        painter.setPen(QPen(QColor(255, 255, 255, 160), 1, Qt::DashLine));
+        painter.drawRect(m_textBoxRect.adjusted(0, 0, -1, -1));
         
-        QPen pen(m_currentColor);
-        pen.setWidth(m_currentThickness);
-        painter.setPen(pen);
-
-        QRect annotationRect(m_annotationStart, m_annotationEnd);
+        painter.setPen(m_currentColor);
+        m_textLayout->draw(&painter, m_textPos);
+        if (m_caretVisible) {
+            painter.fillRect(textCaretRect(), m_currentColor);
+        }
+    }
+    
+    // 正在查看回放帧时标出时间
+    if (m_replayIndex >= 0 && dirty.intersects(replayBadgeRect())) {
+        const QRect badge = replayBadgeRect();
+        const qint64 age = m_liveFrame->timestamp() - m_captureManager->replay()->timestampAt(m_replayIndex);
+        painter.fillRect(badge, QColor(26, 26, 26, 220));
+        painter.setPen(Qt::white);
+        painter.drawText(badge, Qt::AlignCenter, QString("回放 -%1 秒  (%2/%3)")
+                         .arg(age / 1000.0, 0, 'f', 1)
+                         .arg(m_replayIndex + 1)
+                         .arg(m_captureManager->replay()->count()));
+    }
+    
+    // 重新编辑的会话正在解压
+    if (m_framePending && dirty.intersects(redactionBadgeRect())) {
+        const QRect badge = redactionBadgeRect();
+        painter.fillRect(badge, QColor(26, 26, 26, 220));
+        painter.setPen(Qt::white);
+        painter.drawText(badge, Qt::AlignCenter, QString("正在打开截图会话，Esc 取消"));
+    }
+    
+    // 确认后等待敏感信息扫描完成
+    if (m_pendingExport != ExportAction::None && dirty.intersects(redactionBadgeRect())) {
+        const QRect badge = redactionBadgeRect();
+        const QPair<int, int> progress = m_captureManager->scanner()->progress();
+        painter.fillRect(badge, QColor(26, 26, 26, 220));
+        painter.setPen(Qt::white);
+        painter.drawText(badge, Qt::AlignCenter, QString("正在检查敏感信息 %1/%2，Esc 取消")
+                         .arg(progress.first).arg(progress.second));
+    }
+    
+    // 十字辅助线与全局坐标读数
+    if (m_crosshairPos.x() >= 0) {
+        painter.setRenderHint(QPainter::Antialiasing, false);
+        painter.fillRect(QRect(0, m_crosshairPos.y(), width(), 1), QColor(18, 150, 219, 200));
+        painter.fillRect(QRect(m_crosshairPos.x(), 0, 1, height()), QColor(18, 150, 219, 200));
         
-        switch (m_currentTool) {
-            case CaptureManager::AnnotationType::Rectangle:
-                if (m_currentFilled) {
-                    QColor fillColor = m_currentColor;
-                    fillColor.setAlpha(40);
-                    painter.setBrush(fillColor);
-                } else {
-                    painter.setBrush(Qt::NoBrush);
-                }
-                painter.drawRect(annotationRect);
-                break;
-                
-            case CaptureManager::AnnotationType::Arrow: {
-                QLineF line(m_annotationStart, m_annotationEnd);
-                
-                // 箭头参数
-                double arrowLength = 20.0;
-                double arrowWidth = 8.0;  // 箭头宽度的一半
-                
-                // 计算箭头方向向量并归一化
-                QPointF direction = line.p2() - line.p1();
-                double length = std::sqrt(direction.x() * direction.x() + direction.y() * direction.y());
-                if (length < 1e-6) return;  // 避免除以零
-                direction /= length;
-                
-                // 计算垂直向量
-                QPointF normal(-direction.y(), direction.x());
-                
-                // 计算箭头底部中心点（从箭头尖端往回移动）
-                QPointF arrowBase = line.p2() - direction * arrowLength;
-                
-                // 计算箭头的三个点
-                QPointF arrowTip = line.p2();  // 箭头尖端
-                QPointF arrowLeft = arrowBase + normal * arrowWidth;
-                QPointF arrowRight = arrowBase - normal * arrowWidth;
-                
-                // 绘制箭头主体（从起点到箭头底部中心）
-                painter.drawLine(line.p1(), arrowBase);
-                
-                // 绘制箭头头部
-                QPolygonF arrowHead;
-                arrowHead << arrowTip << arrowLeft << arrowRight;
-                painter.setBrush(m_currentColor);
-                painter.drawPolygon(arrowHead);
-                break;
-            }
-                
-            case CaptureManager::AnnotationType::Text:
-                // ... 现有的文字预览代码 ...
-                break;
+        QRect readout = readoutRect(m_crosshairPos);
+        if (dirty.intersects(readout)) {
+            QPoint global = m_crosshairPos + geometry().topLeft();
+            painter.fillRect(readout, QColor(26, 26, 26, 220));
+            painter.setPen(Qt::white);
+            painter.drawText(readout, Qt::AlignCenter, QString("%1, %2").arg(global.x()).arg(global.y()));
         }
     }
+    
+    // 输入到画面的延迟：从最早一个被合并的移动事件到达，到包含它的一帧绘制完成
+    if (m_paintPendingSinceNs >= 0) {
+        m_inputStats.latencyUs.append((m_inputClock.nsecsElapsed() - m_paintPendingSinceNs) / 1000);
+        m_paintPendingSinceNs = -1;
+    }
 }
 
 void OverlayWidget::mousePressEvent(QMouseEvent *event)
 {
+    // 先处理尚未处理的移动，按下、松开总是基于最新的状态
+    m_moveTimer.stop();
+    flushPendingMove();
+    
+    // 等待扫描或会话解压期间选区和标注保持不变
+    if (m_pendingExport != ExportAction::None || m_framePending) {
+        return;
+    }
+    
+    // 对比结果只显示到下一次操作
+    if (!m_diffRegions.isEmpty()) {
+        QRect diffBounds;
+        for (const QRect& region : m_diffRegions) {
+            diffBounds = diffBounds.united(region);
+        }
+        m_diffRegions.clear();
+        update(diffBounds.adjusted(-2, -2, 2, 2));
+    }
+    
     if (event->button() == Qt::LeftButton) {
         QRect currentRect = QRect(m_startPos, m_endPos).normalized();
         
+        if (m_isEditingText) {
+            if (m_textBoxRect.contains(event->pos()) && m_textLayout) {
+                // 在编辑框内点击：移动光标
+                QPointF local = event->pos() - m_textPos;
+                for (int i = 0; i < m_textLayout->lineCount(); ++i) {
+                    QTextLine line = m_textLayout->lineAt(i);
+                    if (local.y() < line.y() + line.height() || i == m_textLayout->lineCount() - 1) {
+                        m_textCursor = line.xToCursor(local.x());
+                        break;
+                    }
+                }
+                m_caretVisible = true;
+                m_caretTimer.start();
+                update(m_textBoxRect);
+                return;
+            }
+            // 在编辑框外点击：先提交当前文字
+            commitTextEdit();
+        }
+        
         if (!m_editBar->isVisible()) {
             // 还没有选区，开始选区
             m_isDrawing = true;
@@ -358,8 +714,13 @@ void OverlayWidget::mousePressEvent(QMouseEvent *event)
             updateSizeInfo();
         } else if (m_editBar->currentTool() != EditBar::None && !m_isAnnotating) {
             // 工具栏可见且选择了工具，且不在标注状态时
+            selectAnnotation(-1);
             if (currentRect.contains(event->pos())) {
-                startAnnotation(event->pos());
+                if (m_editBar->currentTool() == EditBar::Text) {
+                    beginTextEdit(event->pos());
+                } else {
+                    startAnnotation(event->pos());
+                }
             } else {
                 // 在选区外点击时，重置工具并开始新选区
                 m_editBar->resetTool();
@@ -368,13 +729,30 @@ void OverlayWidget::mousePressEvent(QMouseEvent *event)
                 m_editBar->hide();
                 updateSizeInfo();
             }
+        } else if (int handle = handleAt(event->pos()); handle >= 0) {
+            // 拖动选中标注的控制点：缩放
+            m_annotationDrag = AnnotationDrag::Resize;
+            m_activeHandle = handle;
+            m_annotationDragOrigin = event->pos();
+            m_annotationBeforeDrag = m_captureManager->annotations().at(m_selectedAnnotation);
+            return;
+        } else if (int hit = m_captureManager->hitTest(event->pos()); hit >= 0 && currentRect.contains(event->pos())) {
+            // 点击已提交的标注：选中并开始移动
+            selectAnnotation(hit);
+            m_annotationDrag = AnnotationDrag::Move;
+            m_annotationDragOrigin = event->pos();
+            m_annotationBeforeDrag = m_captureManager->annotations().at(hit);
+            applyCursor(Qt::SizeAllCursor);
+            return;
         } else if (currentRect.contains(event->pos())) {
             // 在选区内点击，且没有选择工具时，开始拖动
+            selectAnnotation(-1);
             m_isDragging = true;
             m_dragStartPos = event->pos();
-            setCursor(Qt::ClosedHandCursor);
+            applyCursor(Qt::ClosedHandCursor);
         } else {
             // 在选区外点击时开始新选区
+            selectAnnotation(-1);
             m_isDrawing = true;
             m_startPos = m_endPos = event->pos();
             m_editBar->hide();
@@ -386,12 +764,60 @@ void OverlayWidget::mousePressEvent(QMouseEvent *event)
 
 void OverlayWidget::mouseMoveEvent(QMouseEvent *event)
 {
-    if (m_isAnnotating && m_editBar->currentTool() != EditBar::None) {
+    // 高回报率鼠标每秒上千个移动事件，而屏幕每帧只显示一次：这里只记下最新位置，
+    // 距上次处理已满一帧时立即处理（不增加延迟），否则在该帧到期时处理一次
+    ++m_inputStats.events;
+    const qint64 now = m_inputClock.nsecsElapsed();
+    if (!m_hasPendingMove) {
+        m_pendingSinceNs = now;
+    }
+    m_pendingMovePos = event->pos();
+    m_hasPendingMove = true;
+    
+    const qint64 sinceLast = now - m_lastMoveNs;
+    if (m_lastMoveNs < 0 || sinceLast >= m_frameIntervalNs) {
+        m_moveTimer.stop();
+        flushPendingMove();
+    } else if (!m_moveTimer.isActive()) {
+        m_moveTimer.start(int((m_frameIntervalNs - sinceLast + 999999) / 1000000));
+    }
+}
+
+void OverlayWidget::flushPendingMove()
+{
+    if (!m_hasPendingMove) {
+        return;
+    }
+    m_hasPendingMove = false;
+    m_lastMoveNs = m_inputClock.nsecsElapsed();
+    ++m_inputStats.frames;
+    
+    // 只统计会引起重绘的移动；普通悬停只更新光标形状
+    const bool repaints = m_isDrawing || m_isDragging || m_isAnnotating
+        || m_annotationDrag != AnnotationDrag::None || m_crosshairEnabled;
+    if (repaints && m_paintPendingSinceNs < 0) {
+        m_paintPendingSinceNs = m_pendingSinceNs;
+    }
+    handleMouseMove(m_pendingMovePos);
+}
+
+void OverlayWidget::handleMouseMove(const QPoint& pos)
+{
+    if (m_crosshairEnabled) {
+        moveCrosshair(crosshairActive() ? pos : QPoint(-1, -1));
+    }
+    
+    if (m_annotationDrag != AnnotationDrag::None) {
+        dragAnnotation(pos);
+    } else if (m_isAnnotating && m_editBar->currentTool() != EditBar::None) {
         // 只有在工具被选中时才更新标注
-        updateAnnotation(event->pos());
+        updateAnnotation(pos);
     } else if (m_isDrawing) {
         // 正在绘制新选区
-        m_endPos = event->pos();
+        m_endPos = pos;
+        if (m_autoTrim) {
+            m_trimPreview = trimmedSelection();
+        }
         updateSizeInfo();
         update();
     } else if (m_isDragging) {
@@ -402,7 +828,7 @@ void OverlayWidget::mouseMoveEvent(QMouseEvent *event)
         }
 
         // 正在拖动选区
-        QPoint delta = event->pos() - m_dragStartPos;
+        QPoint delta = pos - m_dragStartPos;
         QRect newRect = currentRect.translated(delta);
         
         // 优化边界检查逻辑
@@ -427,7 +853,10 @@ void OverlayWidget::mouseMoveEvent(QMouseEvent *event)
         // 应用移动
         m_startPos = m_startPos + delta;
         m_endPos = m_endPos + delta;
-        m_dragStartPos = event->pos();
+        m_dragStartPos = pos;
+        if (m_autoTrim) {
+            m_trimPreview = trimmedSelection();
+        }
         
         updateSizeInfo();
         updateEditBarPosition();
@@ -436,42 +865,164 @@ void OverlayWidget::mouseMoveEvent(QMouseEvent *event)
         // 更新鼠标样式
         QRect currentRect = QRect(m_startPos, m_endPos).normalized();
         if (currentRect.isValid() && currentRect.width() > 0 && currentRect.height() > 0 
-            && currentRect.contains(event->pos())) {
-            if (m_editBar->currentTool() != EditBar::None) {
-                setCursor(Qt::CrossCursor);
+            && currentRect.contains(pos)) {
+            bool noTool = m_editBar->isVisible() && m_editBar->currentTool() == EditBar::None;
+            int handle = noTool ? handleAt(pos) : -1;
+            if (handle >= 0) {
+                // 控制点：按方向显示缩放光标
+                static const Qt::CursorShape handleCursors[] = {
+                    Qt::SizeFDiagCursor, Qt::SizeVerCursor, Qt::SizeBDiagCursor, Qt::SizeHorCursor,
+                    Qt::SizeFDiagCursor, Qt::SizeVerCursor, Qt::SizeBDiagCursor, Qt::SizeHorCursor
+                };
+                bool isArrow = m_captureManager->annotations().at(m_selectedAnnotation).type
+                    == CaptureManager::AnnotationType::Arrow;
+                applyCursor(isArrow ? Qt::CrossCursor : handleCursors[handle]);
+            } else if (noTool && m_captureManager->hitTest(pos) >= 0) {
+                applyCursor(Qt::SizeAllCursor);
+            } else if (m_editBar->currentTool() != EditBar::None) {
+                applyCursor(Qt::CrossCursor);
             } else if (currentRect.size() == size()) {
-                updateCursor(event->pos());
+                updateCursor(pos);
             } else {
-                setCursor(Qt::OpenHandCursor);
+                applyCursor(Qt::OpenHandCursor);
             }
         } else {
-            updateCursor(event->pos());
+            updateCursor(pos);
         }
     }
 }
 
 void OverlayWidget::mouseReleaseEvent(QMouseEvent *event)
 {
+    m_moveTimer.stop();
+    flushPendingMove();
+    
     if (event->button() == Qt::LeftButton) {
-        if (m_isAnnotating) {
+        if (m_annotationDrag != AnnotationDrag::None) {
+            m_annotationDrag = AnnotationDrag::None;
+            m_activeHandle = -1;
+            updateCursor(event->pos());
+        } else if (m_isAnnotating) {
             finishAnnotation();
         } else if (m_isDrawing) {
             // 完成绘制新选区
             m_isDrawing = false;
             m_endPos = event->pos();
+            if (m_autoTrim) {
+                trimSelection();
+            }
             updateEditBarPosition();
             m_editBar->show();
             m_editBar->raise();
+            moveCrosshair(QPoint(-1, -1));
+            startRedactionScan();
         } else if (m_isDragging) {
             // 完成拖动
             m_isDragging = false;
+            if (m_autoTrim) {
+                trimSelection();
+            }
             updateCursor(event->pos());
+            startRedactionScan();
         }
     }
 }
 
+void OverlayWidget::leaveEvent(QEvent *event)
+{
+    // 光标移到其他窗口（包括工具栏）时去掉十字线；先处理尚未处理的移动，避免之后又把十字线画回来
+    m_moveTimer.stop();
+    flushPendingMove();
+    moveCrosshair(QPoint(-1, -1));
+    QWidget::leaveEvent(event);
+}
+
 void OverlayWidget::keyPressEvent(QKeyEvent *event)
 {
+    // 会话解压期间只响应 Esc：放弃这次编辑
+    if (m_framePending) {
+        if (event->key() == Qt::Key_Escape) {
+            hide();
+            emit captureFinished();
+        }
+        event->accept();
+        return;
+    }
+    
+    // 等待扫描期间只响应 Esc：取消等待，回到编辑状态
+    if (m_pendingExport != ExportAction::None) {
+        if (event->key() == Qt::Key_Escape) {
+            cancelPendingExport();
+        }
+        event->accept();
+        return;
+    }
+    
+    if (m_isEditingText && handleTextKey(event)) {
+        event->accept();
+        return;
+    }
+    
+    // 删除选中的标注
+    if ((event->key() == Qt::Key_Delete || event->key() == Qt::Key_Backspace)
+        && m_selectedAnnotation >= 0) {
+        QRect area = annotationDecorationRect(m_selectedAnnotation);
+        m_captureManager->removeAnnotation(m_selectedAnnotation);
+        m_selectedAnnotation = -1;
+        m_annotationDrag = AnnotationDrag::None;
+        update(area);
+        event->accept();
+        return;
+    }
+    
+    // 撤销最后一个标注
+    if (event->matches(QKeySequence::Undo) && !m_captureManager->annotations().isEmpty()) {
+        int last = m_captureManager->annotations().size() - 1;
+        QRect area = annotationDecorationRect(last);
+        if (m_selectedAnnotation == last) {
+            m_selectedAnnotation = -1;
+            m_annotationDrag = AnnotationDrag::None;
+        }
+        m_captureManager->removeLastAnnotation();
+        update(area);
+        event->accept();
+        return;
+    }
+    
+    // 在回放缓冲的历史帧之间切换
+    if ((event->key() == Qt::Key_PageUp || event->key() == Qt::Key_PageDown) && m_liveFrame) {
+        int index = m_replayIndex + (event->key() == Qt::Key_PageUp ? 1 : -1);
+        if (index >= -1 && index < m_captureManager->replay()->count()) {
+            showReplayFrame(index);
+        }
+        event->accept();
+        return;
+    }
+    
+    // 去除选区四周的纯色边距
+    if (event->key() == Qt::Key_T && event->modifiers() == Qt::NoModifier && !m_isDrawing) {
+        trimSelection();
+        event->accept();
+        return;
+    }
+    
+    // 识别选区（没有选区时为整个画面）中的二维码和条码
+    if (event->key() == Qt::Key_Q && event->modifiers() == Qt::NoModifier && !m_isDrawing
+        && CodeScanner::isAvailable()) {
+        decodeCodes();
+        event->accept();
+        return;
+    }
+    
+    // 切换十字辅助线
+    if (event->key() == Qt::Key_C && event->modifiers() == Qt::NoModifier) {
+        m_crosshairEnabled = !m_crosshairEnabled;
+        QSettings("SCD", "SCD").setValue("overlay/crosshair", m_crosshairEnabled);
+        moveCrosshair(m_crosshairEnabled && crosshairActive() ? mapFromGlobal(QCursor::pos()) : QPoint(-1, -1));
+        event->accept();
+        return;
+    }
+    
     if (event->key() == Qt::Key_Escape) {
         if (m_isDrawing) {
             // 如果正在绘制，先取消当前选区
@@ -522,6 +1073,13 @@ void OverlayWidget::updateEditBarPosition()
 
 void OverlayWidget::handleToolChanged(EditBar::Tool tool)
 {
+    // 切换工具时提交正在编辑的文字
+    if (tool != EditBar::Text) {
+        commitTextEdit();
+    }
+    // 文字选项的显隐会改变工具栏宽度
+    updateEditBarPosition();
+    
     switch (tool) {
         case EditBar::Rectangle:
             m_currentTool = CaptureManager::AnnotationType::Rectangle;
@@ -533,15 +1091,8 @@ void OverlayWidget::handleToolChanged(EditBar::Tool tool)
             m_currentTool = CaptureManager::AnnotationType::Text;
             break;
         case EditBar::Pin:
-            // 触发贴图功能
-            if (QRect currentRect = QRect(m_startPos, m_endPos).normalized(); 
-                currentRect.isValid()) {
-                QPixmap screenshot = m_captureManager->captureScreen();
-                QPixmap croppedShot = screenshot.copy(currentRect);
-                emit createFloatWindow(croppedShot);
-                hide();  // 添加这行：贴图后自动隐藏截图界面
-                emit captureFinished();  // 发送截图完成信号
-            }
+            // 触发贴图功能，与导出一样先等扫描完成
+            exportSelection(ExportAction::Pin);
             break;
         default:
             m_currentTool = CaptureManager::AnnotationType::Rectangle;
@@ -558,7 +1109,7 @@ void OverlayWidget::updateCursor(const QPoint &pos)
     if (m_editBar->isVisible()) {
         QPoint localPos = m_editBar->mapFromParent(pos);
         if (m_editBar->rect().contains(localPos)) {
-            setCursor(Qt::ArrowCursor);
+            applyCursor(Qt::ArrowCursor);
             return;
         }
     }
@@ -569,32 +1120,66 @@ void OverlayWidget::updateCursor(const QPoint &pos)
         && currentRect.contains(pos)) {
         // 根据当前工具状态设置光标
         if (m_editBar->currentTool() != EditBar::None) {
-            setCursor(Qt::CrossCursor);  // 绘制工具时使用十字光标
+            applyCursor(Qt::CrossCursor);  // 绘制工具时使用十字光标
         } else {
-            setCursor(Qt::OpenHandCursor);  // 无工具时使用手形光标
+            applyCursor(Qt::OpenHandCursor);  // 无工具时使用手形光标
         }
         return;
     }
     
     // 在其他区域显示自定义十字光标
-    if (!s_customCursor) {
-        QPixmap pixmap(32, 32);
-        pixmap.fill(Qt::transparent);
-        QPainter painter(&pixmap);
-        
-        // 绘制黑色外边
-        painter.setPen(QPen(QColor(0, 0, 0), 3));
-        painter.drawLine(16, 0, 16, 32);
-        painter.drawLine(0, 16, 32, 16);
-        
-        // 绘制白色内边
-        painter.setPen(QPen(QColor(255, 255, 255), 1));
-        painter.drawLine(16, 0, 16, 32);
-        painter.drawLine(0, 16, 32, 16);
-        
-        s_customCursor = new QCursor(pixmap, 16, 16);
+    applyCursor(Qt::BitmapCursor);
+}
+
+void OverlayWidget::applyCursor(Qt::CursorShape shape)
+{
+    // 形状不变时不调用 setCursor，避免每次鼠标移动都经过平台层重设光标
+    if (shape == m_cursorShape) {
+        return;
+    }
+    m_cursorShape = shape;
+    if (shape == Qt::BitmapCursor) {
+        setCursor(m_crossCursor);
+    } else {
+        setCursor(shape);
+    }
+}
+
+bool OverlayWidget::crosshairActive() const
+{
+    // 只在确定选区之前显示
+    return m_crosshairEnabled && m_countdown == 0 && !m_editBar->isVisible();
+}
+
+QRect OverlayWidget::readoutRect(const QPoint& pos) const
+{
+    // 默认在光标右下方，靠近边缘时翻到另一侧
+    QPoint topLeft = pos + QPoint(16, 16);
+    if (topLeft.x() + m_readoutSize.width() > width()) {
+        topLeft.setX(pos.x() - 16 - m_readoutSize.width());
+    }
+    if (topLeft.y() + m_readoutSize.height() > height()) {
+        topLeft.setY(pos.y() - 16 - m_readoutSize.height());
+    }
+    return QRect(topLeft, m_readoutSize);
+}
+
+void OverlayWidget::moveCrosshair(const QPoint& pos)
+{
+    if (pos == m_crosshairPos) {
+        return;
+    }
+    // 旧位置和新位置各刷新一条横线、一条竖线和读数框
+    const QPoint positions[] = {m_crosshairPos, pos};
+    m_crosshairPos = pos;
+    for (const QPoint& p : positions) {
+        if (p.x() < 0) {
+            continue;
+        }
+        update(QRect(0, p.y(), width(), 1));
+        update(QRect(p.x(), 0, 1, height()));
+        update(readoutRect(p));
     }
-    setCursor(*s_customCursor);
 }
 
 void OverlayWidget::startAnnotation(const QPoint& pos)
@@ -606,9 +1191,140 @@ void OverlayWidget::startAnnotation(const QPoint& pos)
 void OverlayWidget::updateAnnotation(const QPoint& pos)
 {
     if (m_isAnnotating) {
+        // 只刷新预览的新旧范围
+        QRect oldArea = CaptureManager::annotationBounds(previewAnnotation());
         m_annotationEnd = pos;
-        update();
+        update(oldArea.united(CaptureManager::annotationBounds(previewAnnotation())));
+    }
+}
+
+CaptureManager::Annotation OverlayWidget::previewAnnotation() const
+{
+    CaptureManager::Annotation annotation;
+    annotation.type = m_currentTool;
+    annotation.rect = QRect(m_annotationStart, m_annotationEnd).normalized();
+    annotation.color = m_currentColor;
+    annotation.thickness = m_currentThickness;
+    annotation.filled = m_currentFilled;
+    annotation.startPoint = m_annotationStart;
+    annotation.endPoint = m_annotationEnd;
+    return annotation;
+}
+
+void OverlayWidget::selectAnnotation(int index)
+{
+    if (index == m_selectedAnnotation) {
+        return;
+    }
+    if (m_selectedAnnotation >= 0) {
+        update(annotationDecorationRect(m_selectedAnnotation));
+    }
+    m_selectedAnnotation = index;
+    if (m_selectedAnnotation >= 0) {
+        update(annotationDecorationRect(m_selectedAnnotation));
+    }
+}
+
+void OverlayWidget::dragAnnotation(const QPoint& pos)
+{
+    if (m_selectedAnnotation < 0) {
+        return;
+    }
+    
+    QPoint delta = pos - m_annotationDragOrigin;
+    CaptureManager::Annotation updated = m_annotationBeforeDrag;
+    
+    if (m_annotationDrag == AnnotationDrag::Move) {
+        updated = CaptureManager::translatedAnnotation(m_annotationBeforeDrag, delta);
+    } else if (updated.type == CaptureManager::AnnotationType::Arrow) {
+        // 箭头的两个控制点分别是起点和终点
+        if (m_activeHandle == 0) {
+            updated.startPoint += delta;
+        } else {
+            updated.endPoint += delta;
+        }
+        updated.rect = QRect(updated.startPoint, updated.endPoint).normalized();
+    } else {
+        // 控制点顺序：左上、上、右上、右、右下、下、左下、左
+        QRect r = m_annotationBeforeDrag.rect.normalized();
+        int left = r.left(), top = r.top(), right = r.right(), bottom = r.bottom();
+        switch (m_activeHandle) {
+            case 0: left += delta.x(); top += delta.y(); break;
+            case 1: top += delta.y(); break;
+            case 2: right += delta.x(); top += delta.y(); break;
+            case 3: right += delta.x(); break;
+            case 4: right += delta.x(); bottom += delta.y(); break;
+            case 5: bottom += delta.y(); break;
+            case 6: left += delta.x(); bottom += delta.y(); break;
+            case 7: left += delta.x(); break;
+            default: break;
+        }
+        updated.rect = QRect(QPoint(left, top), QPoint(right, bottom)).normalized();
+        updated.startPoint = updated.rect.topLeft();
+        updated.endPoint = updated.rect.bottomRight();
     }
+    
+    // 只刷新标注移动前后的范围
+    QRect oldArea = annotationDecorationRect(m_selectedAnnotation);
+    m_captureManager->updateAnnotation(m_selectedAnnotation, updated);
+    update(oldArea.united(annotationDecorationRect(m_selectedAnnotation)));
+}
+
+QVector<QRect> OverlayWidget::annotationHandles(int index) const
+{
+    QVector<QRect> handles;
+    if (index < 0 || index >= m_captureManager->annotations().size()) {
+        return handles;
+    }
+    
+    const int size = 8;
+    auto handleAtPoint = [size](const QPoint& center) {
+        return QRect(center.x() - size / 2, center.y() - size / 2, size, size);
+    };
+    
+    const CaptureManager::Annotation annotation = m_captureManager->annotations().at(index);
+    switch (annotation.type) {
+        case CaptureManager::AnnotationType::Rectangle:
+        case CaptureManager::AnnotationType::Pixelate: {
+            QRect r = annotation.rect.normalized();
+            handles << handleAtPoint(r.topLeft())
+                    << handleAtPoint(QPoint(r.center().x(), r.top()))
+                    << handleAtPoint(r.topRight())
+                    << handleAtPoint(QPoint(r.right(), r.center().y()))
+                    << handleAtPoint(r.bottomRight())
+                    << handleAtPoint(QPoint(r.center().x(), r.bottom()))
+                    << handleAtPoint(r.bottomLeft())
+                    << handleAtPoint(QPoint(r.left(), r.center().y()));
+            break;
+        }
+        case CaptureManager::AnnotationType::Arrow:
+            handles << handleAtPoint(annotation.startPoint) << handleAtPoint(annotation.endPoint);
+            break;
+        case CaptureManager::AnnotationType::Text:
+            // 文字只支持移动
+            break;
+    }
+    return handles;
+}
+
+int OverlayWidget::handleAt(const QPoint& pos) const
+{
+    const QVector<QRect> handles = annotationHandles(m_selectedAnnotation);
+    for (int i = 0; i < handles.size(); ++i) {
+        if (handles[i].adjusted(-2, -2, 2, 2).contains(pos)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+QRect OverlayWidget::annotationDecorationRect(int index) const
+{
+    if (index < 0 || index >= m_captureManager->annotations().size()) {
+        return QRect();
+    }
+    // 标注本身加上控制点的范围
+    return CaptureManager::annotationBounds(m_captureManager->annotations().at(index)).adjusted(-6, -6, 6, 6);
 }
 
 void OverlayWidget::finishAnnotation()
@@ -631,18 +1347,405 @@ void OverlayWidget::finishAnnotation()
                 annotation.endPoint = m_annotationEnd;
                 
                 m_captureManager->addAnnotation(annotation);
-                m_screenSnapshot = m_captureManager->getEditedPixmap();
             }
         }
         
+        // 工具保持选中，可以连续绘制；只刷新该标注的范围
+        QRect area = CaptureManager::annotationBounds(previewAnnotation());
         m_isAnnotating = false;
-        m_editBar->resetTool();
-        update();
+        update(area);
+    }
+}
+
+void OverlayWidget::beginTextEdit(const QPoint& pos)
+{
+    commitTextEdit();
+    
+    m_isEditingText = true;
+    m_textPos = pos;
+    m_textBuffer.clear();
+    m_textCursor = 0;
+    m_textBoxRect = QRect();
+    relayoutText();
+    
+    m_caretVisible = true;
+    m_caretTimer.start();
+    setAttribute(Qt::WA_InputMethodEnabled, true);
+    setFocus(Qt::OtherFocusReason);
+}
+
+void OverlayWidget::commitTextEdit()
+{
+    if (!m_isEditingText) {
+        return;
+    }
+    
+    m_isEditingText = false;
+    m_caretTimer.stop();
+    setAttribute(Qt::WA_InputMethodEnabled, false);
+    update(m_textBoxRect);
+    
+    if (!m_textBuffer.trimmed().isEmpty() && m_textLayout) {
+        CaptureManager::Annotation annotation;
+        annotation.type = CaptureManager::AnnotationType::Text;
+        annotation.rect = QRect(m_textPos, m_textLayout->boundingRect().size().toSize());
+        annotation.text = m_textBuffer;
+        annotation.color = m_currentColor;
+        annotation.thickness = m_currentThickness;
+        annotation.filled = false;
+        annotation.startPoint = m_textPos;
+        annotation.endPoint = annotation.rect.bottomRight();
+        annotation.font = m_textFont;
+        annotation.textLayout = m_textLayout;  // 复用编辑时的排版结果
+        
+        m_captureManager->addAnnotation(annotation);
+        update(CaptureManager::annotationBounds(annotation));
+    }
+    
+    m_textLayout.reset();
+    m_textBuffer.clear();
+    m_textBoxRect = QRect();
+}
+
+void OverlayWidget::cancelTextEdit()
+{
+    if (!m_isEditingText) {
+        return;
+    }
+    
+    m_isEditingText = false;
+    m_caretTimer.stop();
+    setAttribute(Qt::WA_InputMethodEnabled, false);
+    update(m_textBoxRect);
+    m_textLayout.reset();
+    m_textBuffer.clear();
+    m_textBoxRect = QRect();
+}
+
+void OverlayWidget::insertText(const QString& text)
+{
+    m_textBuffer.insert(m_textCursor, text);
+    m_textCursor += text.length();
+}
+
+void OverlayWidget::relayoutText()
+{
+    // 只有正在编辑的文字会重新排版，刷新范围为新旧文字框的并集
+    QRect oldBox = m_textBoxRect;
+    m_textLayout = CaptureManager::createTextLayout(m_textBuffer, m_textFont);
+    
+    QFontMetrics metrics(m_textFont);
+    QSizeF bounds = m_textLayout->boundingRect().size();
+    QSize boxSize(qMax(qCeil(bounds.width()), metrics.averageCharWidth()),
+                  qMax(qCeil(bounds.height()), metrics.height()));
+    m_textBoxRect = QRect(m_textPos, boxSize).adjusted(-4, -4, 4, 4);
+    
+    update(oldBox.united(m_textBoxRect));
+}
+
+bool OverlayWidget::handleTextKey(QKeyEvent *event)
+{
+    switch (event->key()) {
+        case Qt::Key_Escape:
+            cancelTextEdit();
+            return true;
+        case Qt::Key_Return:
+        case Qt::Key_Enter:
+            if (event->modifiers() & Qt::ShiftModifier) {
+                insertText(QStringLiteral("\n"));
+                break;
+            }
+            commitTextEdit();
+            return true;
+        case Qt::Key_Backspace:
+            if (m_textCursor > 0) {
+                m_textBuffer.remove(--m_textCursor, 1);
+            }
+            break;
+        case Qt::Key_Delete:
+            if (m_textCursor < m_textBuffer.length()) {
+                m_textBuffer.remove(m_textCursor, 1);
+            }
+            break;
+        case Qt::Key_Left:
+            m_textCursor = qMax(0, m_textCursor - 1);
+            break;
+        case Qt::Key_Right:
+            m_textCursor = qMin(m_textBuffer.length(), m_textCursor + 1);
+            break;
+        case Qt::Key_Home:
+            m_textCursor = 0;
+            break;
+        case Qt::Key_End:
+            m_textCursor = m_textBuffer.length();
+            break;
+        default: {
+            QString text = event->text();
+            if (text.isEmpty() || !text.at(0).isPrint()) {
+                return false;
+            }
+            insertText(text);
+            break;
+        }
     }
+    
+    relayoutText();
+    m_caretVisible = true;
+    m_caretTimer.start();
+    return true;
+}
+
+void OverlayWidget::inputMethodEvent(QInputMethodEvent *event)
+{
+    if (!m_isEditingText || event->commitString().isEmpty()) {
+        QWidget::inputMethodEvent(event);
+        return;
+    }
+    insertText(event->commitString());
+    relayoutText();
+    m_caretVisible = true;
+    m_caretTimer.start();
+    event->accept();
+}
+
+QVariant OverlayWidget::inputMethodQuery(Qt::InputMethodQuery query) const
+{
+    if (m_isEditingText) {
+        switch (query) {
+            case Qt::ImCursorRectangle:
+                return textCaretRect();
+            case Qt::ImFont:
+                return m_textFont;
+            case Qt::ImCursorPosition:
+                return m_textCursor;
+            case Qt::ImSurroundingText:
+                return m_textBuffer;
+            default:
+                break;
+        }
+    }
+    return QWidget::inputMethodQuery(query);
+}
+
+QRect OverlayWidget::textCaretRect() const
+{
+    if (m_textLayout) {
+        QTextLine line = m_textLayout->lineForTextPosition(m_textCursor);
+        if (line.isValid()) {
+            int x = qRound(line.cursorToX(m_textCursor));
+            return QRect(m_textPos.x() + x, m_textPos.y() + qRound(line.y()),
+                         2, qCeil(line.height()));
+        }
+    }
+    return QRect(m_textPos, QSize(2, QFontMetrics(m_textFont).height()));
 }
 
 OverlayWidget::~OverlayWidget()
 {
-    delete s_customCursor;
-    s_customCursor = nullptr;
 } 
+
+void OverlayWidget::startRedactionScan()
+{
+    QRect selectedRect = QRect(m_startPos, m_endPos).normalized();
+    if (!RedactionRules::isEnabled() || !m_frame || selectedRect.isEmpty()) {
+        return;
+    }
+    // 已扫描过的条带直接复用，只识别新增部分
+    m_captureManager->scanner()->scan(m_frame, selectedRect);
+}
+
+void OverlayWidget::exportSelection(ExportAction action)
+{
+    commitTextEdit();
+    // 导出、贴图、对比前都必须完成敏感信息扫描并打码：扫描未完成时显示进度并等待，Esc 取消等待
+    SensitiveContentScanner* scanner = m_captureManager->scanner();
+    if (RedactionRules::isEnabled() && scanner->isAvailable()) {
+        // 选区在上次扫描后可能又被修改（去边、重新编辑的会话），已扫描的条带直接复用
+        startRedactionScan();
+        if (!scanner->waitForFinished(0)) {
+            m_pendingExport = action;
+            m_editBar->setEnabled(false);
+            update(redactionBadgeRect());
+            return;
+        }
+        applyRedactions();
+    }
+    finishExport(action);
+}
+
+void OverlayWidget::finishExport(ExportAction action)
+{
+    QRect selectedRect = QRect(m_startPos, m_endPos).normalized();
+    switch (action) {
+        case ExportAction::Confirm:
+            emit areaSelected(selectedRect);
+            hide();
+            break;
+        case ExportAction::Pin:
+            if (selectedRect.isValid()) {
+                emit createFloatWindow(m_captureManager->getEditedPixmap(selectedRect));
+                hide();  // 贴图后自动隐藏截图界面
+                emit captureFinished();
+            }
+            break;
+        case ExportAction::Compare:
+            if (selectedRect.isValid()) {
+                // 帧按逻辑像素存储，文件贴图按原图像素：把选区所在屏幕的设备像素比一并交给对比
+                QScreen* screen = QGuiApplication::screenAt(mapToGlobal(selectedRect.center()));
+                const qreal ratio = screen ? screen->devicePixelRatio() : devicePixelRatioF();
+                emit compareRequested(m_frame ? m_frame->crop(selectedRect) : QImage(), ratio);
+            }
+            break;
+        case ExportAction::None:
+            break;
+    }
+}
+
+void OverlayWidget::cancelPendingExport()
+{
+    if (m_pendingExport == ExportAction::None) {
+        return;
+    }
+    m_pendingExport = ExportAction::None;
+    m_editBar->setEnabled(true);
+    update(redactionBadgeRect());
+}
+
+void OverlayWidget::onRedactionScanFinished()
+{
+    applyRedactions();
+    if (m_pendingExport != ExportAction::None && m_captureManager->scanner()->waitForFinished(0)) {
+        const ExportAction action = m_pendingExport;
+        cancelPendingExport();
+        exportSelection(action);
+    }
+}
+
+QRect OverlayWidget::redactionBadgeRect() const
+{
+    const QRect selectedRect = QRect(m_startPos, m_endPos).normalized();
+    QRect badge(0, 0, 300, 32);
+    badge.moveCenter(selectedRect.isEmpty() ? rect().center() : selectedRect.center());
+    return badge;
+}
+
+void OverlayWidget::applyRedactions()
+{
+    QRect selectedRect = QRect(m_startPos, m_endPos).normalized();
+    if (!isVisible() || !m_frame || selectedRect.isEmpty()) {
+        return;
+    }
+    
+    // 匹配区域不按选区裁剪：选区之后再扩大时，已添加的马赛克仍覆盖整个匹配
+    for (const QRect& match : m_captureManager->scanner()->matches(selectedRect)) {
+        const QRect area = match.adjusted(-2, -2, 2, 2);
+        // 只跳过同一处匹配（用户删除过的也在其中）；与已添加区域相邻或部分重叠的匹配仍要打码
+        bool applied = false;
+        for (const QRect& existing : m_autoRedacted) {
+            if (qAbs(existing.left() - area.left()) <= 2 && qAbs(existing.top() - area.top()) <= 2
+                && qAbs(existing.right() - area.right()) <= 2 && qAbs(existing.bottom() - area.bottom()) <= 2) {
+                applied = true;
+                break;
+            }
+        }
+        if (applied) {
+            continue;
+        }
+        
+        CaptureManager::Annotation annotation;
+        annotation.type = CaptureManager::AnnotationType::Pixelate;
+        annotation.rect = area;
+        annotation.color = Qt::transparent;
+        annotation.thickness = 0;
+        annotation.filled = true;
+        annotation.startPoint = area.topLeft();
+        annotation.endPoint = area.bottomRight();
+        m_captureManager->addAnnotation(annotation);
+        m_autoRedacted.append(area);
+        update(area);
+    }
+}
+
+void OverlayWidget::showReplayFrame(int index)
+{
+    CaptureFramePtr frame = index < 0 ? m_liveFrame : m_captureManager->replay()->frameAt(index);
+    // 屏幕布局变化前的帧与当前窗口对不上，不显示
+    if (!frame || frame->origin() != m_liveFrame->origin() || frame->size() != m_liveFrame->size()) {
+        return;
+    }
+    m_replayIndex = index;
+    m_frame = frame;
+    m_captureManager->setFrame(frame);
+    
+    // 自动打码的位置只对原来那一帧有效：去掉自动添加的马赛克，对新帧重新扫描
+    QVector<CaptureManager::Annotation> annotations = m_captureManager->annotations();
+    if (!m_autoRedacted.isEmpty()) {
+        annotations.erase(std::remove_if(annotations.begin(), annotations.end(),
+                                         [this](const CaptureManager::Annotation& annotation) {
+            return annotation.type == CaptureManager::AnnotationType::Pixelate
+                && m_autoRedacted.contains(annotation.rect.normalized());
+        }), annotations.end());
+        m_autoRedacted.clear();
+        m_selectedAnnotation = -1;
+    }
+    // 马赛克取自画面，换帧后重新生成
+    m_captureManager->setAnnotations(annotations);
+    startRedactionScan();
+    update();
+}
+
+QRect OverlayWidget::replayBadgeRect() const
+{
+    return QRect(width() / 2 - 110, 16, 220, 32);
+}
+
+QRect OverlayWidget::trimmedSelection() const
+{
+    const QRect selectedRect = QRect(m_startPos, m_endPos).normalized();
+    if (!m_frame || selectedRect.width() < 2 || selectedRect.height() < 2) {
+        return selectedRect;
+    }
+    return AutoTrim::trim(*m_frame, selectedRect, m_trimTolerance);
+}
+
+void OverlayWidget::trimSelection()
+{
+    const QRect selectedRect = QRect(m_startPos, m_endPos).normalized();
+    const QRect trimmed = trimmedSelection();
+    m_trimPreview = QRect();
+    if (trimmed == selectedRect || trimmed.isEmpty()) {
+        update();
+        return;
+    }
+    m_startPos = trimmed.topLeft();
+    m_endPos = trimmed.bottomRight();
+    if (m_editBar->isVisible()) {
+        updateEditBarPosition();
+    }
+    update();
+}
+
+void OverlayWidget::decodeCodes()
+{
+    if (!m_frame) {
+        return;
+    }
+    const QRect selectedRect = QRect(m_startPos, m_endPos).normalized();
+    const bool hasSelection = selectedRect.width() > 1 && selectedRect.height() > 1;
+    
+    // 整屏扫描的耗时用 SCD codes 测量
+    const QVector<CodeScanner::Result> results =
+        CodeScanner::scan(m_frame->crop(hasSelection ? selectedRect : m_frame->rect()));
+    
+    QStringList payloads;
+    for (const CodeScanner::Result& result : results) {
+        payloads.append(result.text);
+    }
+    emit codesDecoded(payloads);
+    
+    // 没有找到时保留截图界面，用户可以调整选区后重试
+    if (!payloads.isEmpty()) {
+        hide();
+        emit captureFinished();
+    }
+}
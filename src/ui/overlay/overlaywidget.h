@@ -7,8 +7,10 @@
 #include <QPixmap>
 #include <QLabel>
 #include <QTimer>
+#include <QElapsedTimer>
 #include "../toolbar/editbar.h"
 #include "../../core/capture/capturemanager.h"
+#include "../../core/export/beautifier.h"
 
 class OverlayWidget : public QWidget
 {
@@ -18,15 +20,32 @@ public:
     ~OverlayWidget();
     void show();
     void hide();
+    // 重新编辑保存的会话：不截图，直接显示给定的帧、标注和选区。
+    // preview 为 true 时 frame 只是预览，在 finishSessionLoad 给出真正的帧之前不能编辑，Esc 取消
+    void showSession(const CaptureFramePtr& frame, const QVector<CaptureManager::Annotation>& annotations,
+                     const QRect& selection, bool preview = false);
+    // 会话像素解压完成；界面已关闭或没有在等待时返回 false
+    bool finishSessionLoad(const CaptureFramePtr& frame);
+    // 延时截图倒计时：窗口不接收输入，只绘制倒计时标记
+    void showCountdown(int seconds);
+    void hideCountdown();
+    // 将差异区域（相对选区左上角）标在选区上：只是临时的显示层，不是标注，
+    // 不会被导出、保存或撤销，下一次鼠标按下或截图结束时清除
+    void showDiffRegions(const QVector<QRect>& regions);
     QPoint getStartPos() const { return m_startPos; }
     QPoint getEndPos() const { return m_endPos; }
+    // 当前选区的全局坐标
+    QRect selectedGlobalRect() const { return QRect(m_startPos, m_endPos).normalized().translated(geometry().topLeft()); }
     
 protected:
     void paintEvent(QPaintEvent *event) override;
     void mousePressEvent(QMouseEvent *event) override;
     void mouseMoveEvent(QMouseEvent *event) override;
     void mouseReleaseEvent(QMouseEvent *event) override;
+    void leaveEvent(QEvent *event) override;
     void keyPressEvent(QKeyEvent *event) override;
+    void inputMethodEvent(QInputMethodEvent *event) override;
+    QVariant inputMethodQuery(Qt::InputMethodQuery query) const override;
     bool eventFilter(QObject *watched, QEvent *event) override;
     
 private:
@@ -37,7 +56,7 @@ private:
     QPoint m_dragStartPos;
     QLabel *m_sizeLabel;
     EditBar *m_editBar;
-    QPixmap m_screenSnapshot;
+    CaptureFramePtr m_frame;         // 冻结的截图帧
     bool m_isAnnotating{false};  // 是否正在绘制标注
     QPoint m_annotationStart;    // 标注起始点
     QPoint m_annotationEnd;      // 标注结束点
@@ -46,21 +65,137 @@ private:
     int m_currentThickness{2};       // 当前线条粗细
     bool m_currentFilled{false};     // 当前是否填充
     CaptureManager* m_captureManager;  // 添加成员变量
-    static QCursor* s_customCursor;  // 添加静态成员声明
+    QCursor m_crossCursor;           // 选区外的十字光标，构造时生成一次
+    Qt::CursorShape m_cursorShape{Qt::ArrowCursor};  // 当前已设置的光标，Qt::BitmapCursor 表示 m_crossCursor
+    int m_countdown{0};              // 延时截图剩余秒数，0 表示未在倒计时
     
+    // 文字标注的原位编辑状态
+    bool m_isEditingText{false};
+    QPoint m_textPos;                // 文字左上角
+    QString m_textBuffer;
+    int m_textCursor{0};
+    bool m_caretVisible{false};
+    QTimer m_caretTimer;
+    QFont m_textFont;
+    QSharedPointer<QTextLayout> m_textLayout;  // 正在编辑的文字的排版，提交后直接交给标注复用
+    QRect m_textBoxRect;             // 文字框区域，输入和光标闪烁只刷新这一块
+    
+    // 已提交标注的选中、移动与缩放
+    enum class AnnotationDrag {
+        None,
+        Move,
+        Resize
+    };
+    int m_selectedAnnotation{-1};
+    AnnotationDrag m_annotationDrag{AnnotationDrag::None};
+    int m_activeHandle{-1};
+    QPoint m_annotationDragOrigin;
+    CaptureManager::Annotation m_annotationBeforeDrag;
+    
+    // 全屏十字辅助线与坐标读数：每次移动只刷新新旧两条 1 像素宽的线和读数框
+    bool m_crosshairEnabled{false};
+    QPoint m_crosshairPos{-1, -1};   // 当前绘制的位置，(-1, -1) 表示未绘制
+    QSize m_readoutSize;             // 读数框按最长的坐标文字预先计算，移动时不重新测量
+    
+    // 回放：PageUp/PageDown 在回放缓冲的历史帧之间切换，-1 表示按下快捷键时抓取的画面
+    int m_replayIndex{-1};
+    CaptureFramePtr m_liveFrame;
+    
+    // 自动去边：开启时拖动选区过程中实时计算去边后的区域（虚线框），松开后选区收缩到该区域
+    bool m_autoTrim{false};
+    int m_trimTolerance{0};
+    QRect m_trimPreview;
+    
+    // 与贴图对比的差异区域（覆盖层坐标），只绘制不进入标注
+    QVector<QRect> m_diffRegions;
+    
+    // 导出美化开启时在选区四周预览投影，投影取自缓存，重绘只是一次贴图
+    bool m_beautify{false};
+    Beautifier::Style m_beautifyStyle;
+    
+    // 自动打码：已添加过的匹配区域（未按选区裁剪），用户删除后同一处不会再次添加
+    QVector<QRect> m_autoRedacted;
+    // 把选区像素交出去的操作，都要先等敏感信息扫描完成
+    enum class ExportAction {
+        None,
+        Confirm,
+        Pin,
+        Compare
+    };
+    ExportAction m_pendingExport{ExportAction::None};    // 已请求导出，正在等待扫描完成
+    bool m_framePending{false};      // 正在显示会话的预览帧，等待像素解压
+
+    
+    // 鼠标移动按显示器刷新节奏合并：每帧最多处理一次最新位置，选区、拖动、标注和标签位置随之更新
+    QTimer m_moveTimer;
+    QElapsedTimer m_inputClock;
+    qint64 m_frameIntervalNs{16666667};
+    qint64 m_lastMoveNs{-1};         // 上次处理移动的时刻，-1 表示还没有处理过
+    bool m_hasPendingMove{false};
+    QPoint m_pendingMovePos;
+    qint64 m_pendingSinceNs{-1};     // 最早一个尚未处理的移动事件的到达时刻
+    qint64 m_paintPendingSinceNs{-1};  // 已处理、尚未绘制的移动事件的到达时刻
+    
+    // 合并统计，隐藏时输出到调试日志
+    struct InputStats {
+        int events{0};               // 收到的移动事件
+        int frames{0};               // 实际处理的次数
+        QVector<qint64> latencyUs;   // 每次重绘的输入到画面延迟
+    };
+    InputStats m_inputStats;
+    
+    void handleMouseMove(const QPoint& pos);
+    void flushPendingMove();
+    void logInputStats();
     void updateSizeInfo();
     void updateEditBarPosition();
     void handleToolChanged(EditBar::Tool tool);
     void updateCursor(const QPoint &pos);
+    void applyCursor(Qt::CursorShape shape);
+    bool crosshairActive() const;
+    void moveCrosshair(const QPoint& pos);
+    QRect readoutRect(const QPoint& pos) const;
+    void showReplayFrame(int index);
+    QRect trimmedSelection() const;
+    void trimSelection();
+    void decodeCodes();
+    QRect replayBadgeRect() const;
     void takeScreenshot();
+    void resetState();
     void startAnnotation(const QPoint& pos);
     void updateAnnotation(const QPoint& pos);
     void finishAnnotation();
+    QRect countdownBadgeRect() const;
+    void beginTextEdit(const QPoint& pos);
+    void commitTextEdit();
+    void cancelTextEdit();
+    void insertText(const QString& text);
+    void relayoutText();
+    bool handleTextKey(QKeyEvent *event);
+    QRect textCaretRect() const;
+    CaptureManager::Annotation previewAnnotation() const;
+    void selectAnnotation(int index);
+    void dragAnnotation(const QPoint& pos);
+    QVector<QRect> annotationHandles(int index) const;
+    int handleAt(const QPoint& pos) const;
+    QRect annotationDecorationRect(int index) const;
+    void startRedactionScan();
+    void applyRedactions();
+    void confirmSelection() { exportSelection(ExportAction::Confirm); }
+    void exportSelection(ExportAction action);
+    void finishExport(ExportAction action);
+    void cancelPendingExport();
+    void onRedactionScanFinished();
+    QRect redactionBadgeRect() const;
     
 signals:
     void areaSelected(const QRect &rect);
     void captureFinished();
     void createFloatWindow(const QPixmap& pixmap);
+    // selection 为选区的逻辑像素，devicePixelRatio 为选区所在屏幕的设备像素比
+    void compareRequested(const QImage& selection, qreal devicePixelRatio);
+    // 识别到的二维码/条码内容，没有找到时为空列表
+    void codesDecoded(const QStringList& payloads);
 };
 
 #endif // OVERLAYWIDGET_H 
@@ -0,0 +1,159 @@
+#include "searchwindow.h"
+#include "../../core/history/capturehistory.h"
+#include "../../core/search/captureindexer.h"
+#include "../../core/session/capturesession.h"
+#include "../../core/image/resampler.h"
+#include <QLineEdit>
+#include <QListWidget>
+#include <QLabel>
+#include <QVBoxLayout>
+#include <QPainter>
+#include <QImageReader>
+#include <QElapsedTimer>
+
+namespace {
+
+// 优先读取会话文件开头的缩略图，没有会话时按比例解码历史图片
+QImage loadThumbnail(const CaptureHistory::Entry& entry, int edge)
+{
+    QImage thumbnail = CaptureSession::loadThumbnail(CaptureHistory::sessionPath(entry));
+    if (thumbnail.isNull()) {
+        // JPEG 等解码器能直接按缩小尺寸解码；其他格式解码原图后再做面积平均缩小
+        QImageReader reader(entry.filePath);
+        QSize size = reader.size();
+        if (size.isValid() && reader.supportsOption(QImageIOHandler::ScaledSize)) {
+            reader.setScaledSize(size.scaled(edge, edge, Qt::KeepAspectRatio));
+        }
+        thumbnail = reader.read();
+    }
+    return Resampler::fit(thumbnail, QSize(edge, edge), Resampler::Filter::Box);
+}
+
+} // namespace
+
+SearchWindow::SearchWindow(CaptureHistory* history, CaptureIndexer* indexer, QWidget* parent)
+    : QWidget(parent)
+    , m_history(history)
+    , m_indexer(indexer)
+{
+    setWindowFlags(Qt::Tool | Qt::WindowStaysOnTopHint);
+    setWindowTitle("搜索截图历史");
+    resize(760, 520);
+
+    m_queryEdit = new QLineEdit(this);
+    m_queryEdit->setPlaceholderText("输入截图中的文字，空格分隔多个词");
+    m_queryEdit->setClearButtonEnabled(true);
+
+    m_resultList = new QListWidget(this);
+    m_resultList->setViewMode(QListView::IconMode);
+    m_resultList->setResizeMode(QListView::Adjust);
+    m_resultList->setMovement(QListView::Static);
+    m_resultList->setIconSize(QSize(kThumbnailEdge, kThumbnailEdge));
+    m_resultList->setSpacing(6);
+
+    m_statusLabel = new QLabel(this);
+
+    QVBoxLayout* layout = new QVBoxLayout(this);
+    layout->addWidget(m_queryEdit);
+    layout->addWidget(m_resultList);
+    layout->addWidget(m_statusLabel);
+
+    // 输入停顿后再查询
+    m_debounceTimer.setSingleShot(true);
+    m_debounceTimer.setInterval(kDebounceMs);
+    connect(&m_debounceTimer, &QTimer::timeout, this, &SearchWindow::runQuery);
+    connect(m_queryEdit, &QLineEdit::textChanged, this, [this]() {
+        m_debounceTimer.start();
+    });
+    connect(m_queryEdit, &QLineEdit::returnPressed, this, &SearchWindow::runQuery);
+    connect(m_resultList, &QListWidget::itemActivated, this, [this](QListWidgetItem* item) {
+        emit entryActivated(item->data(Qt::UserRole).toInt());
+    });
+
+    // 索引加载完成后重新执行已输入的查询
+    connect(m_indexer, &CaptureIndexer::loaded, this, &SearchWindow::runQuery);
+
+    if (!m_indexer->isAvailable()) {
+        m_queryEdit->setEnabled(false);
+    }
+    updateStatus();
+}
+
+void SearchWindow::showEvent(QShowEvent* event)
+{
+    QWidget::showEvent(event);
+    m_queryEdit->setFocus();
+    m_queryEdit->selectAll();
+    if (!m_queryEdit->text().isEmpty()) {
+        runQuery();     // 索引可能已有更新
+    }
+}
+
+void SearchWindow::runQuery()
+{
+    m_debounceTimer.stop();
+    m_resultList->clear();
+    const QString query = m_queryEdit->text().trimmed();
+    if (query.isEmpty() || !m_indexer->isAvailable()) {
+        updateStatus();
+        return;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    const QVector<SearchIndex::Result> results = m_indexer->index().search(query, kMaxResults);
+    const qint64 elapsedUs = timer.nsecsElapsed() / 1000;
+
+    for (const SearchIndex::Result& result : results) {
+        CaptureHistory::Entry entry = m_history->entry(result.id);
+        if (!entry.isValid()) {
+            continue;
+        }
+        QImage thumbnail = loadThumbnail(entry, kThumbnailEdge);
+        if (thumbnail.isNull()) {
+            continue;
+        }
+
+        // 命中的词按缩略图比例标出
+        thumbnail = thumbnail.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+        if (!result.size.isEmpty()) {
+            QPainter painter(&thumbnail);
+            painter.setRenderHint(QPainter::Antialiasing);
+            painter.scale(qreal(thumbnail.width()) / result.size.width(),
+                          qreal(thumbnail.height()) / result.size.height());
+            painter.setPen(Qt::NoPen);
+            painter.setBrush(QColor(255, 200, 0, 110));
+            for (const QRect& box : result.boxes) {
+                painter.drawRect(box.adjusted(-2, -2, 2, 2));
+            }
+        }
+
+        QListWidgetItem* item = new QListWidgetItem(QIcon(QPixmap::fromImage(thumbnail)),
+                                                    entry.timestamp.toString("MM-dd hh:mm:ss"));
+        item->setData(Qt::UserRole, entry.id);
+        m_resultList->addItem(item);
+    }
+    updateStatus(m_resultList->count(), elapsedUs);
+}
+
+void SearchWindow::updateStatus(int resultCount, qint64 elapsedUs)
+{
+    if (!m_indexer->isAvailable()) {
+        m_statusLabel->setText("当前版本未包含文字识别引擎，无法建立搜索索引");
+        return;
+    }
+    if (!m_indexer->isLoaded()) {
+        m_statusLabel->setText("正在加载搜索索引…");
+        return;
+    }
+    const int documents = m_indexer->index().documentCount();
+    const int pending = m_indexer->pendingCount();
+    QString text = QString("已索引 %1 张截图").arg(documents);
+    if (pending > 0) {
+        text += QString("，%1 张排队中").arg(pending);
+    }
+    if (resultCount >= 0) {
+        text += QString("，找到 %1 张（%2 ms）").arg(resultCount).arg(elapsedUs / 1000.0, 0, 'f', 1);
+    }
+    m_statusLabel->setText(text);
+}
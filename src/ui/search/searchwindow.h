@@ -0,0 +1,43 @@
+#ifndef SEARCHWINDOW_H
+#define SEARCHWINDOW_H
+
+#include <QWidget>
+#include <QTimer>
+
+class QLineEdit;
+class QListWidget;
+class QLabel;
+class CaptureHistory;
+class CaptureIndexer;
+
+// 按识别出的文字搜索截图历史，结果缩略图上标出命中的位置
+class SearchWindow : public QWidget
+{
+    Q_OBJECT
+public:
+    SearchWindow(CaptureHistory* history, CaptureIndexer* indexer, QWidget* parent = nullptr);
+
+signals:
+    // 双击结果
+    void entryActivated(int id);
+
+protected:
+    void showEvent(QShowEvent* event) override;
+
+private:
+    static constexpr int kDebounceMs = 150;
+    static constexpr int kMaxResults = 50;
+    static constexpr int kThumbnailEdge = 160;
+
+    CaptureHistory* m_history;
+    CaptureIndexer* m_indexer;
+    QLineEdit* m_queryEdit;
+    QListWidget* m_resultList;
+    QLabel* m_statusLabel;
+    QTimer m_debounceTimer;
+
+    void runQuery();
+    void updateStatus(int resultCount = -1, qint64 elapsedUs = 0);
+};
+
+#endif // SEARCHWINDOW_H
@@ -3,6 +3,10 @@
 #include <QIcon>
 #include <QStyle>
 #include <QFrame>
+#include <QFontComboBox>
+#include <QSpinBox>
+#include <QPainter>
+#include "../../core/barcode/codescanner.h"
 
 EditBar::EditBar(QWidget *parent)
     : QWidget(parent)
@@ -28,6 +32,16 @@ EditBar::EditBar(QWidget *parent)
         "QToolButton:checked {"
         "   background-color: #4D4D4D;"
         "}"
+        "QToolButton#ColorButton:checked {"
+        "   border: 2px solid white;"
+        "}"
+        "QFontComboBox, QSpinBox {"
+        "   color: white;"
+        "   background-color: #3D3D3D;"
+        "   border: none;"
+        "   border-radius: 3px;"
+        "   padding: 2px;"
+        "}"
     );
     
     setupUI();
@@ -51,6 +65,41 @@ void EditBar::setupUI()
     // 贴图工具
     layout->addWidget(createToolButton(":/icons/pin.png", "贴图", Pin));
     
+    // 与贴图对比
+    QToolButton* compareBtn = createToolButton(":/icons/compare.png", "与最近的贴图对比", None);
+    connect(compareBtn, &QToolButton::clicked, this, &EditBar::compareClicked);
+    layout->addWidget(compareBtn);
+    
+    // 自动去边
+    QToolButton* trimBtn = createToolButton(":/icons/trim.png", "去除四周空白 (T)", None);
+    connect(trimBtn, &QToolButton::clicked, this, &EditBar::trimClicked);
+    layout->addWidget(trimBtn);
+    
+    // 识别二维码/条码，未编译解码库时不显示
+    if (CodeScanner::isAvailable()) {
+        QToolButton* decodeBtn = createToolButton(":/icons/qrcode.png", "识别二维码/条码 (Q)", None);
+        connect(decodeBtn, &QToolButton::clicked, this, &EditBar::decodeClicked);
+        layout->addWidget(decodeBtn);
+    }
+    
+    // 颜色选择
+    QFrame* colorLine = new QFrame(this);
+    colorLine->setFrameShape(QFrame::VLine);
+    colorLine->setFrameShadow(QFrame::Sunken);
+    layout->addWidget(colorLine);
+    
+    const QColor colors[] = {Qt::red, QColor(255, 193, 7), QColor(76, 175, 80),
+                             QColor(33, 150, 243), Qt::black, Qt::white};
+    for (const QColor& color : colors) {
+        layout->addWidget(createColorButton(color));
+    }
+    
+    // 文字选项：字体和字号。QFontComboBox 构造时会枚举系统字体，
+    // 这里只放一个空容器，首次选中文字工具时再填充
+    m_textOptions = new QWidget(this);
+    m_textOptions->hide();
+    layout->addWidget(m_textOptions);
+    
     // 添加分隔线
     QFrame* line = new QFrame(this);
     line->setFrameShape(QFrame::VLine);
@@ -85,17 +134,19 @@ QToolButton* EditBar::createToolButton(const QString &iconPath,
             if (m_currentTool == tool) {
                 m_currentTool = None;
                 btn->setChecked(false);
+                updateTextOptions();
                 emit toolChanged(None);
             } else {
                 m_currentTool = tool;
                 // 取消其他按钮的选中状态
                 for (auto child : children()) {
-                    if (auto toolBtn = qobject_cast<QToolButton*>(child)) {
+                    if (auto toolBtn = qobject_cast<QToolButton*>(child); toolBtn && toolBtn->objectName() != "ColorButton") {
                         if (toolBtn != btn) {
                             toolBtn->setChecked(false);
                         }
                     }
                 }
+                updateTextOptions();
                 emit toolChanged(tool);
             }
         });
@@ -109,10 +160,11 @@ void EditBar::show()
     // 重置工具状态
     m_currentTool = None;
     for (auto child : children()) {
-        if (auto toolBtn = qobject_cast<QToolButton*>(child)) {
+        if (auto toolBtn = qobject_cast<QToolButton*>(child); toolBtn && toolBtn->objectName() != "ColorButton") {
             toolBtn->setChecked(false);
         }
     }
+    updateTextOptions();
     QWidget::show();
 }
 
@@ -122,10 +174,96 @@ void EditBar::resetTool()
         m_currentTool = None;
         // 取消所有工具按钮的选中状态
         for (auto child : children()) {
-            if (auto toolBtn = qobject_cast<QToolButton*>(child)) {
+            if (auto toolBtn = qobject_cast<QToolButton*>(child); toolBtn && toolBtn->objectName() != "ColorButton") {
                 toolBtn->setChecked(false);
             }
         }
+        updateTextOptions();
         emit toolChanged(None);
     }
+}
+
+QFont EditBar::currentFont() const
+{
+    // 文字选项尚未创建时使用默认字体
+    QFont font = m_fontCombo ? m_fontCombo->currentFont() : QFont();
+    font.setPixelSize(m_sizeSpin ? m_sizeSpin->value() : kDefaultTextSize);
+    return font;
+}
+
+void EditBar::ensureTextOptions()
+{
+    if (m_fontCombo) {
+        return;
+    }
+    
+    QHBoxLayout *textLayout = new QHBoxLayout(m_textOptions);
+    textLayout->setSpacing(2);
+    textLayout->setContentsMargins(4, 0, 0, 0);
+    
+    m_fontCombo = new QFontComboBox(m_textOptions);
+    m_fontCombo->setFixedWidth(120);
+    m_fontCombo->setToolTip("字体");
+    m_fontCombo->setCurrentFont(QFont());
+    textLayout->addWidget(m_fontCombo);
+    
+    m_sizeSpin = new QSpinBox(m_textOptions);
+    m_sizeSpin->setRange(8, 96);
+    m_sizeSpin->setValue(kDefaultTextSize);
+    m_sizeSpin->setSuffix(" px");
+    m_sizeSpin->setToolTip("字号");
+    textLayout->addWidget(m_sizeSpin);
+    
+    connect(m_fontCombo, &QFontComboBox::currentFontChanged, this, [this]() {
+        emit fontChanged(currentFont());
+    });
+    connect(m_sizeSpin, QOverload<int>::of(&QSpinBox::valueChanged), this, [this]() {
+        emit fontChanged(currentFont());
+    });
+}
+
+QToolButton* EditBar::createColorButton(const QColor& color)
+{
+    // 色块按钮不参与工具按钮的互斥，单独处理选中状态
+    QToolButton *btn = new QToolButton(this);
+    btn->setObjectName("ColorButton");
+    btn->setProperty("swatchColor", color);
+    btn->setCheckable(true);
+    btn->setChecked(color == m_currentColor);
+    btn->setFixedSize(22, 22);
+    btn->setToolTip(color.name());
+    
+    QPixmap swatch(14, 14);
+    swatch.fill(color);
+    QPainter painter(&swatch);
+    painter.setPen(QColor(128, 128, 128));
+    painter.drawRect(0, 0, 13, 13);
+    painter.end();
+    btn->setIcon(QIcon(swatch));
+    btn->setIconSize(swatch.size());
+    
+    connect(btn, &QToolButton::clicked, this, [this, btn, color]() {
+        m_currentColor = color;
+        for (auto child : children()) {
+            if (auto other = qobject_cast<QToolButton*>(child)) {
+                if (other->objectName() == "ColorButton") {
+                    other->setChecked(other == btn);
+                }
+            }
+        }
+        emit colorChanged(color);
+    });
+    return btn;
+}
+
+void EditBar::updateTextOptions()
+{
+    bool visible = (m_currentTool == Text);
+    if (visible) {
+        ensureTextOptions();
+    }
+    if (m_textOptions->isHidden() == visible) {
+        m_textOptions->setVisible(visible);
+        adjustSize();
+    }
 } 
\ No newline at end of file
@@ -4,6 +4,11 @@
 #include <QWidget>
 #include <QHBoxLayout>
 #include <QToolButton>
+#include <QColor>
+#include <QFont>
+
+class QFontComboBox;
+class QSpinBox;
 
 class EditBar : public QWidget
 {
@@ -20,6 +25,8 @@ public:
 
     explicit EditBar(QWidget *parent = nullptr);
     Tool currentTool() const { return m_currentTool; }
+    QColor currentColor() const { return m_currentColor; }
+    QFont currentFont() const;
     void show();
     void resetTool();
 
@@ -27,12 +34,26 @@ signals:
     void toolChanged(Tool tool);
     void confirmClicked();
     void cancelClicked();
+    void compareClicked();
+    void trimClicked();
+    void decodeClicked();
+    void colorChanged(const QColor& color);
+    void fontChanged(const QFont& font);
 
 private:
+    static constexpr int kDefaultTextSize = 16;
+
     Tool m_currentTool{None};
+    QColor m_currentColor{Qt::red};
+    QWidget* m_textOptions{nullptr};   // 字体与字号，仅文字工具选中时显示
+    QFontComboBox* m_fontCombo{nullptr};
+    QSpinBox* m_sizeSpin{nullptr};
     QToolButton* createToolButton(const QString &iconPath, 
                                 const QString &tooltip,
                                 Tool tool);
+    QToolButton* createColorButton(const QColor& color);
+    void updateTextOptions();
+    void ensureTextOptions();
     void setupUI();
 };
 
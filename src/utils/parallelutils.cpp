@@ -0,0 +1,73 @@
+#include "parallelutils.h"
+#include <QThread>
+#include <QThreadPool>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+
+namespace {
+
+struct RangeState {
+    std::function<void(int, int)> body;
+    int count{0};
+    int chunkSize{1};
+    int chunkCount{0};
+    std::atomic<int> nextChunk{0};
+    std::atomic<int> doneChunks{0};
+    std::mutex mutex;
+    std::condition_variable finished;
+
+    // 领取并执行剩余的块，直到全部被领取
+    void drain()
+    {
+        int chunk;
+        while ((chunk = nextChunk.fetch_add(1)) < chunkCount) {
+            int begin = chunk * chunkSize;
+            int end = qMin(count, begin + chunkSize);
+            body(begin, end);
+            if (doneChunks.fetch_add(1) + 1 == chunkCount) {
+                std::lock_guard<std::mutex> lock(mutex);
+                finished.notify_all();
+            }
+        }
+    }
+};
+
+} // namespace
+
+int ParallelUtils::threadCount()
+{
+    return qMax(1, QThread::idealThreadCount());
+}
+
+void ParallelUtils::forRange(int count, int minChunk, const std::function<void(int begin, int end)>& body)
+{
+    if (count <= 0) {
+        return;
+    }
+
+    const int workers = threadCount();
+    const int chunkSize = qMax(qMax(1, minChunk), (count + workers * 2 - 1) / (workers * 2));
+    const int chunkCount = (count + chunkSize - 1) / chunkSize;
+    if (chunkCount == 1 || workers == 1) {
+        body(0, count);
+        return;
+    }
+
+    // 状态由共享指针持有：线程池中迟到的任务在调用方返回后仍可安全访问
+    auto state = std::make_shared<RangeState>();
+    state->body = body;
+    state->count = count;
+    state->chunkSize = chunkSize;
+    state->chunkCount = chunkCount;
+
+    const int helpers = qMin(workers, chunkCount) - 1;
+    for (int i = 0; i < helpers; ++i) {
+        QThreadPool::globalInstance()->start([state]() { state->drain(); });
+    }
+    state->drain();
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->finished.wait(lock, [&state]() { return state->doneChunks.load() == state->chunkCount; });
+}
@@ -0,0 +1,15 @@
+#ifndef PARALLELUTILS_H
+#define PARALLELUTILS_H
+
+#include <functional>
+
+class ParallelUtils
+{
+public:
+    // 把 [0, count) 切分成不小于 minChunk 的块，在全局线程池和调用线程上并行执行，
+    // 返回时所有块均已完成。调用线程自己也领取任务，因此在线程池繁忙或嵌套调用时不会死锁
+    static void forRange(int count, int minChunk, const std::function<void(int begin, int end)>& body);
+    static int threadCount();
+};
+
+#endif // PARALLELUTILS_H
@@ -0,0 +1,10 @@
+#ifndef SIMDUTILS_H
+#define SIMDUTILS_H
+
+// SSE2 在 x86-64 上总是可用；其他平台走标量实现
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SCD_HAVE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#endif // SIMDUTILS_H
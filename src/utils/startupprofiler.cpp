@@ -0,0 +1,71 @@
+#include "startupprofiler.h"
+#include <QElapsedTimer>
+#include <QVector>
+#include <QPair>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QJsonDocument>
+#include <QStringList>
+#include <QDebug>
+
+namespace {
+QElapsedTimer& timer()
+{
+    static QElapsedTimer instance;
+    return instance;
+}
+
+QVector<QPair<QString, qint64>>& phases()
+{
+    static QVector<QPair<QString, qint64>> instance;
+    return instance;
+}
+}
+
+void StartupProfiler::begin()
+{
+    timer().start();
+    phases().clear();
+}
+
+void StartupProfiler::mark(const QString &phase)
+{
+    if (!timer().isValid()) {
+        return;
+    }
+    qint64 ms = timer().elapsed();
+    phases().append({phase, ms});
+    qDebug() << "Startup phase" << phase << ms << "ms";
+}
+
+qint64 StartupProfiler::elapsed()
+{
+    return timer().isValid() ? timer().elapsed() : 0;
+}
+
+bool StartupProfiler::writeReport(const QString &path)
+{
+    QJsonArray items;
+    for (const auto &phase : phases()) {
+        items.append(QJsonObject{{"phase", phase.first}, {"ms", double(phase.second)}});
+    }
+    QJsonObject report{{"phases", items}, {"total", double(elapsed())}};
+
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qDebug() << "Failed to write startup report:" << path;
+        return false;
+    }
+    file.write(QJsonDocument(report).toJson());
+    return true;
+}
+
+QString StartupProfiler::summary()
+{
+    QStringList parts;
+    for (const auto &phase : phases()) {
+        parts << QString("%1=%2ms").arg(phase.first).arg(phase.second);
+    }
+    return parts.join(", ");
+}
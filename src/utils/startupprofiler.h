@@ -0,0 +1,22 @@
+#ifndef STARTUPPROFILER_H
+#define STARTUPPROFILER_H
+
+#include <QString>
+
+// 启动阶段计时：记录从进程入口到各阶段完成的耗时，
+// 用于跟踪冷启动到托盘可用的时间。只在主线程调用
+class StartupProfiler
+{
+public:
+    // 在 main() 入口处调用，作为计时起点
+    static void begin();
+    // 记录一个阶段完成的时间点
+    static void mark(const QString &phase);
+    static qint64 elapsed();
+
+    // 以 JSON 写出全部阶段：{"phases":[{"phase":..,"ms":..},..],"total":..}
+    static bool writeReport(const QString &path);
+    static QString summary();
+};
+
+#endif // STARTUPPROFILER_H